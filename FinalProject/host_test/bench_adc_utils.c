@@ -0,0 +1,121 @@
+/**
+ * @file bench_adc_utils.c
+ * @author David Ramírez Betancourth
+ * @brief ns/sample of raw_to_voltage_block() against one raw_to_voltage()
+ * call per sample, and reads/s of get_raw_data_multi() against one
+ * get_raw_data() plus timestamp per channel
+ *
+ * The driver stand-ins are a few integer operations, far cheaper than
+ * adc_cali_raw_to_voltage() and adc_oneshot_read() on target, so the
+ * ratios here only count the per-call checks, indirections and clock
+ * reads the batched paths remove. The on-target read figures come from
+ * the "adcbench" UART command.
+ */
+
+#include "adc_utils.h"
+#include "host_test.h"
+
+#include "esp_timer.h"
+
+#define BLOCK_LEN 256
+#define ROUNDS    20000
+#define SCAN_CHANNELS 4
+#define SCAN_ROUNDS   1000000
+
+// One reading of every channel of ADC1, each stamped: per channel, then in one pass
+static void bench_multi_read(void)
+{
+    adc_channel_handle_t handles[SCAN_CHANNELS];
+    int raw[SCAN_CHANNELS];
+    int multi[SCAN_CHANNELS];
+    int64_t ts[SCAN_CHANNELS];
+    int64_t skew_single = 0;
+    int64_t skew_multi = 0;
+
+    for (int i = 0; i < SCAN_CHANNELS; i++) {
+        adc_config_t conf = {
+            .unit_id = ADC_UNIT_1, .channel = (adc_channel_t)(i + 3), .atten = ADC_ATTEN_DB_12, .bitwidth = ADC_BITWIDTH_12,
+        };
+        set_adc(&conf, &handles[i]);
+        CHECK(handles[i] != NULL);
+    }
+    size_t n = adc_unit_channels(ADC_UNIT_1, handles, SCAN_CHANNELS);
+    CHECK(n == SCAN_CHANNELS);
+
+    double t0 = host_seconds();
+    for (int r = 0; r < SCAN_ROUNDS; r++) {
+        for (size_t i = 0; i < n; i++) {
+            get_raw_data(handles[i], &raw[i]);
+            ts[i] = esp_timer_get_time();
+        }
+        skew_single += ts[n - 1] - ts[0];
+        host_sink += raw[r % n];
+    }
+    double t_single = host_seconds() - t0;
+
+    t0 = host_seconds();
+    for (int r = 0; r < SCAN_ROUNDS; r++) {
+        get_raw_data_multi(handles, n, multi, ts);
+        skew_multi += ts[n - 1] - ts[0];
+        host_sink += multi[r % n];
+    }
+    double t_multi = host_seconds() - t0;
+
+    double reads = (double)SCAN_ROUNDS * n;
+    printf("get_raw_data per channel: %6.2f Mreads/s, first->last %.3f us\n", reads / t_single * 1e-6,
+           (double)skew_single / SCAN_ROUNDS);
+    printf("get_raw_data_multi:       %6.2f Mreads/s, first->last %.3f us (%.1fx)\n", reads / t_multi * 1e-6,
+           (double)skew_multi / SCAN_ROUNDS, t_single / t_multi);
+
+    for (size_t i = 0; i < n; i++) {
+        CHECK(multi[i] == raw[i]);
+        adc_release(handles[i]);
+    }
+}
+
+int main(void)
+{
+    static const adc_config_t conf = {
+        .unit_id = ADC_UNIT_1, .channel = ADC_CHANNEL_3, .atten = ADC_ATTEN_DB_12, .bitwidth = ADC_BITWIDTH_12,
+    };
+    adc_channel_handle_t handle;
+    int raw[BLOCK_LEN];
+    int single[BLOCK_LEN];
+    int block[BLOCK_LEN];
+
+    set_adc(&conf, &handle);
+    CHECK(handle != NULL);
+
+    // Codes spread like a real signal, mostly below the curved top
+    for (int i = 0; i < BLOCK_LEN; i++) {
+        raw[i] = (i * 2654435761u) % 3200;
+    }
+
+    double t0 = host_seconds();
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int i = 0; i < BLOCK_LEN; i++) {
+            raw_to_voltage(handle, raw[i], &single[i]);
+        }
+        host_sink += single[r % BLOCK_LEN];
+    }
+    double t_single = host_seconds() - t0;
+
+    t0 = host_seconds();
+    for (int r = 0; r < ROUNDS; r++) {
+        raw_to_voltage_block(handle, raw, block, BLOCK_LEN);
+        host_sink += block[r % BLOCK_LEN];
+    }
+    double t_block = host_seconds() - t0;
+
+    double n = (double)ROUNDS * BLOCK_LEN;
+    printf("raw_to_voltage per sample: %6.2f ns/sample\n", t_single / n * 1e9);
+    printf("raw_to_voltage_block:      %6.2f ns/sample (%.1fx)\n", t_block / n * 1e9, t_single / t_block);
+
+    for (int i = 0; i < BLOCK_LEN; i++) {
+        CHECK(block[i] - single[i] <= 1 && single[i] - block[i] <= 1);
+    }
+    adc_release(handle);
+
+    bench_multi_read();
+    HOST_TEST_END();
+}
@@ -0,0 +1,61 @@
+/**
+ * @file bench_filter_chain.c
+ * @author David Ramírez Betancourth
+ * @brief ns/sample of each filter stage and of a typical chain, on
+ * 64-sample blocks of noisy input
+ */
+
+#include "filter_chain.h"
+#include "host_test.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define BLOCK_LEN 64
+#define ROUNDS    20000
+
+static float input[BLOCK_LEN * 16];
+
+static double ns_per_sample(filter_chain_t *chain)
+{
+    float block[BLOCK_LEN];
+
+    double t0 = host_seconds();
+    for (int r = 0; r < ROUNDS; r++) {
+        memcpy(block, &input[(r % 16) * BLOCK_LEN], sizeof(block));
+        filter_chain_process(chain, block, BLOCK_LEN);
+        host_sink += block[BLOCK_LEN - 1];
+    }
+    return (host_seconds() - t0) / ((double)ROUNDS * BLOCK_LEN) * 1e9;
+}
+
+int main(void)
+{
+    filter_chain_t chain;
+    biquad_coeffs_t c[FILTER_MAX_SECTIONS];
+    size_t n = filter_design_lowpass(FILTER_BUTTERWORTH, 4, 5, 100, 0, c, FILTER_MAX_SECTIONS);
+
+    srand(1);
+    for (size_t i = 0; i < sizeof(input) / sizeof(input[0]); i++) {
+        input[i] = 25.0f + (float)rand() / (float)RAND_MAX;
+    }
+
+    filter_chain_init(&chain);
+    CHECK(filter_chain_add_moving_average(&chain, 8));
+    printf("moving average (8):        %6.2f ns/sample\n", ns_per_sample(&chain));
+
+    filter_chain_init(&chain);
+    CHECK(filter_chain_add_median(&chain, 9));
+    printf("median (9):                %6.2f ns/sample\n", ns_per_sample(&chain));
+
+    filter_chain_init(&chain);
+    CHECK(filter_chain_add_biquads(&chain, c, n));
+    printf("butterworth (4th order):   %6.2f ns/sample\n", ns_per_sample(&chain));
+
+    filter_chain_init(&chain);
+    CHECK(filter_chain_add_median(&chain, 5));
+    CHECK(filter_chain_add_biquads(&chain, c, n));
+    printf("median (5) + butterworth:  %6.2f ns/sample\n", ns_per_sample(&chain));
+
+    HOST_TEST_END();
+}
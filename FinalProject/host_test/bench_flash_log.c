@@ -0,0 +1,126 @@
+/**
+ * @file bench_flash_log.c
+ * @author David Ramírez Betancourth
+ * @brief flash_log write throughput and mount (recovery) time on the
+ * file-image backend
+ *
+ * Besides the host rates, the backend calls are counted and turned into
+ * an estimate of flash busy time with typical SPI NOR figures (W25Q32
+ * class: 0.7 ms per 256-byte page program, 45 ms per 4 KB sector erase).
+ * That estimate is what bounds the device rate; the host figures show the
+ * log code itself is not the limit.
+ */
+
+#include "flash_log.h"
+#include "host_test.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define IMAGE_PATH     "bench_flash_log.img"
+#define NUM_SECTORS    64
+#define RECORDS        100000
+#define RECORD_LEN     40
+#define PAGE_PROG_MS   0.7
+#define PAGE_SIZE      256
+#define SECTOR_ERASE_MS 45.0
+
+typedef struct {
+    flash_log_backend_t file;
+    uint32_t reads, writes, erases;
+    uint64_t bytes_written;
+    uint32_t pages_programmed;
+} counting_backend_t;
+
+static counting_backend_t counting;
+
+static esp_err_t counting_read(void *ctx, uint32_t offset, void *buf, size_t len)
+{
+    counting_backend_t *c = ctx;
+    c->reads++;
+    return c->file.read(c->file.ctx, offset, buf, len);
+}
+
+static esp_err_t counting_write(void *ctx, uint32_t offset, const void *buf, size_t len)
+{
+    counting_backend_t *c = ctx;
+    c->writes++;
+    c->bytes_written += len;
+    // Program operations never cross a page
+    c->pages_programmed += (offset + len - 1) / PAGE_SIZE - offset / PAGE_SIZE + 1;
+    return c->file.write(c->file.ctx, offset, buf, len);
+}
+
+static esp_err_t counting_erase(void *ctx, uint32_t offset)
+{
+    counting_backend_t *c = ctx;
+    c->erases++;
+    return c->file.erase_sector(c->file.ctx, offset);
+}
+
+static flash_log_backend_t open_image(void)
+{
+    memset(&counting, 0, sizeof(counting));
+    CHECK(flash_log_file_backend(IMAGE_PATH, NUM_SECTORS * FLASH_LOG_SECTOR_SIZE, &counting.file) == ESP_OK);
+    return (flash_log_backend_t) {
+        .read = counting_read,
+        .write = counting_write,
+        .erase_sector = counting_erase,
+        .size = NUM_SECTORS * FLASH_LOG_SECTOR_SIZE,
+        .ctx = &counting,
+    };
+}
+
+int main(void)
+{
+    flash_log_backend_t backend;
+    flash_log_stats_t stats;
+    uint8_t rec[RECORD_LEN];
+
+    remove(IMAGE_PATH);
+    backend = open_image();
+    CHECK(flash_log_mount(&backend) == ESP_OK);
+
+    // The writer task flushes once the active buffer is half full
+    double t0 = host_seconds();
+    for (uint32_t seq = 0; seq < RECORDS; seq++) {
+        memcpy(rec, &seq, sizeof(seq));
+        memset(rec + sizeof(seq), (int)seq, sizeof(rec) - sizeof(seq));
+        if (!flash_log_append(rec, sizeof(rec))) {
+            flash_log_flush();
+            flash_log_append(rec, sizeof(rec));
+        }
+        if (seq % ((FLASH_LOG_STAGING_BYTES / 2) / (RECORD_LEN + 8)) == 0) {
+            flash_log_flush();
+        }
+    }
+    flash_log_flush();
+    double t_write = host_seconds() - t0;
+
+    flash_log_get_stats(&stats);
+    double kb = (double)counting.bytes_written / 1024;
+    double flash_ms = counting.pages_programmed * PAGE_PROG_MS + counting.erases * SECTOR_ERASE_MS;
+    printf("write: %u records of %d B, %.0f records/s, %.1f MB/s on the host\n", stats.written, RECORD_LEN,
+           stats.written / t_write, kb / 1024 / t_write);
+    printf("       %u write calls (%.0f B each), %u erases\n", counting.writes, (double)counting.bytes_written /
+           counting.writes, counting.erases);
+    printf("       estimated flash time %.1f ms/KB, %.0f records/s sustained on the device\n", flash_ms / kb,
+           stats.written / (flash_ms / 1000));
+    CHECK(stats.written == RECORDS);
+    CHECK(stats.write_errors == 0);
+
+    // Recovery: the newest sector is full, the whole area holds data
+    flash_log_file_backend_close(&counting.file);
+    backend = open_image();
+    t0 = host_seconds();
+    CHECK(flash_log_mount(&backend) == ESP_OK);
+    double t_mount = host_seconds() - t0;
+    flash_log_get_stats(&stats);
+    printf("mount: %.0f us on the host (%lld us by esp_timer), %u backend reads for %d sectors\n",
+           t_mount * 1e6, (long long)stats.mount_us, counting.reads, NUM_SECTORS);
+    CHECK(stats.torn_records == 0);
+
+    flash_log_file_backend_close(&counting.file);
+    remove(IMAGE_PATH);
+    HOST_TEST_END();
+}
@@ -0,0 +1,177 @@
+/**
+ * @file bench_json_scan.c
+ * @author David Ramírez Betancourth
+ * @brief /pwmValues.json body load: json_scan fed in scratch-buffer pieces
+ * against the cJSON_Parse handler it replaced
+ *
+ * http_server_read_body() hands the scanner at most HTTP_BODY_SCRATCH_LEN
+ * bytes per receive, so the bodies here are fed in 128-byte pieces; the
+ * body sizes go up to HTTP_PWM_BODY_MAX. The cJSON path is the old
+ * handler: NUL-terminated copy of the whole body, cJSON_Parse,
+ * cJSON_GetObjectItemCaseSensitive, cJSON_Delete, with every heap call
+ * counted. It needs the cJSON sources bundled with ESP-IDF (CJSON_DIR in
+ * CMake); without them only the scanner is measured.
+ */
+
+#include "json_scan.h"
+#include "host_test.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HOST_HAVE_CJSON
+#include "cJSON.h"
+#endif
+
+#define SCRATCH_LEN    128      // HTTP_BODY_SCRATCH_LEN in http_server.c
+#define BODY_MAX       256      // HTTP_PWM_BODY_MAX
+#define ROUNDS         200000
+
+typedef struct {
+    const char *name;
+    char text[BODY_MAX + 1];
+    size_t len;
+} body_t;
+
+static body_t bodies[3];
+
+// Smallest request, one padded with fields the handler ignores, one with nesting to skip
+static void make_bodies(void)
+{
+    body_t *b = bodies;
+
+    b->name = "minimal";
+    b->len = (size_t)snprintf(b->text, sizeof(b->text), "{\"pwm_val\": 42}");
+
+    b++;
+    b->name = "padded";
+    b->len = (size_t)snprintf(b->text, sizeof(b->text), "{\"client\": \"dashboard\", \"ts\": 1729180000, ");
+    while (b->len < BODY_MAX - 40) {
+        b->len += (size_t)snprintf(b->text + b->len, sizeof(b->text) - b->len, "\"f%zu\": %zu.25, ", b->len, b->len);
+    }
+    b->len += (size_t)snprintf(b->text + b->len, sizeof(b->text) - b->len, "\"pwm_val\": 42.5}");
+
+    b++;
+    b->name = "nested";
+    b->len = (size_t)snprintf(b->text, sizeof(b->text),
+                              "{\"meta\": {\"src\": \"ui\", \"tags\": [\"a\", \"b\", {\"k\": [1, 2, 3]}]}, "
+                              "\"history\": [[0, 10], [1, 20], [2, 30], [3, 40], [4, 50], [5, 60]], "
+                              "\"note\": \"escaped \\\"quote\\\" and } ] brackets\", \"pwm_val\": 99}");
+}
+
+//-----------------------------------Request paths-----------------------------------
+
+static const char *const keys[] = {"pwm_val"};
+
+// What the /pwmValues.json handler does with the scanner
+static bool scan_body(const body_t *b, double *pwm_val)
+{
+    json_scan_t scan;
+    bool ok = true;
+
+    json_scan_init(&scan, keys, 1, pwm_val);
+    for (size_t pos = 0; pos < b->len && ok; pos += SCRATCH_LEN) {
+        size_t n = b->len - pos < SCRATCH_LEN ? b->len - pos : SCRATCH_LEN;
+        ok = json_scan_feed(&scan, b->text + pos, n);
+    }
+    return ok && json_scan_finish(&scan) && json_scan_found(&scan, 0);
+}
+
+#ifdef HOST_HAVE_CJSON
+static uint32_t heap_calls;
+
+static void *counting_malloc(size_t size)
+{
+    heap_calls++;
+    return malloc(size);
+}
+
+static void counting_free(void *p)
+{
+    if (p) {
+        heap_calls++;
+    }
+    free(p);
+}
+
+// The old receive_http_content() plus handler
+static bool cjson_body(const body_t *b, double *pwm_val)
+{
+    bool ok = false;
+    char *buf = counting_malloc(b->len + 1);
+
+    if (!buf) {
+        return false;
+    }
+    memcpy(buf, b->text, b->len);
+    buf[b->len] = '\0';
+
+    cJSON *root = cJSON_Parse(buf);
+    if (root) {
+        cJSON *item = cJSON_GetObjectItemCaseSensitive(root, "pwm_val");
+        if (cJSON_IsNumber(item)) {
+            *pwm_val = cJSON_GetNumberValue(item);
+            ok = true;
+        }
+        cJSON_Delete(root);
+    }
+    counting_free(buf);
+    return ok;
+}
+#endif
+
+typedef bool (*body_fn_t)(const body_t *b, double *pwm_val);
+
+static double ns_per_body(body_fn_t fn, const body_t *b)
+{
+    double value = 0;
+    uint32_t ok = 0;
+    double t0 = host_seconds();
+
+    for (int i = 0; i < ROUNDS; i++) {
+        ok += fn(b, &value);
+    }
+    double t = host_seconds() - t0;
+
+    CHECK(ok == ROUNDS);
+    host_sink += value;
+    return t / ROUNDS * 1e9;
+}
+
+int main(void)
+{
+    make_bodies();
+
+#ifdef HOST_HAVE_CJSON
+    cJSON_Hooks hooks = {.malloc_fn = counting_malloc, .free_fn = counting_free};
+    cJSON_InitHooks(&hooks);
+#endif
+
+    for (size_t i = 0; i < sizeof(bodies) / sizeof(bodies[0]); i++) {
+        const body_t *b = &bodies[i];
+        double value = -1;
+
+        CHECK(b->len <= BODY_MAX);
+        CHECK(scan_body(b, &value) && value == strtod(strstr(b->text, "\"pwm_val\":") + 10, NULL));
+
+        double ns = ns_per_body(scan_body, b);
+        printf("%-8s %3zu B  json_scan: %7.1f ns/body, %6.1f MB/s, 0 heap calls\n", b->name, b->len, ns,
+               b->len / ns * 1e3);
+
+#ifdef HOST_HAVE_CJSON
+        double cjson_value = -1;
+        heap_calls = 0;
+        CHECK(cjson_body(b, &cjson_value) && cjson_value == value);
+        uint32_t calls = heap_calls;
+
+        ns = ns_per_body(cjson_body, b);
+        printf("%-8s %3zu B  cJSON:     %7.1f ns/body, %6.1f MB/s, %u heap calls\n", b->name, b->len, ns,
+               b->len / ns * 1e3, calls);
+#endif
+    }
+
+#ifndef HOST_HAVE_CJSON
+    printf("cJSON: not built, point CJSON_DIR at the cJSON sources to compare\n");
+#endif
+    HOST_TEST_END();
+}
@@ -0,0 +1,284 @@
+/**
+ * @file bench_json_writer.c
+ * @author David Ramírez Betancourth
+ * @brief Sensor endpoint body built with json_writer against the cJSON
+ * handler it replaced: time per request, heap calls and fragmentation
+ *
+ * The cJSON path is the old handler sequence: cJSON_CreateObject, one
+ * cJSON_AddNumberToObject, cJSON_Print, strlen, cJSON_Delete, cJSON_free.
+ * It needs the cJSON sources bundled with ESP-IDF (CJSON_DIR in CMake,
+ * found through IDF_PATH); without them only the writer is measured.
+ *
+ * For the fragmentation test both paths allocate from a small first-fit
+ * heap while another "task" keeps a sliding set of long-lived buffers, as
+ * sockets and queues do on the device. Every KEEP_EVERY requests that task
+ * runs in the middle of the request, after its second allocation, which
+ * pins the long-lived buffer between the request's short-lived blocks.
+ * The figure reported is the worst 1 - largest free block / total free
+ * seen between requests.
+ */
+
+#include "json_writer.h"
+#include "host_test.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef HOST_HAVE_CJSON
+#include "cJSON.h"
+#endif
+
+#define ROUNDS         200000
+#define HEAP_BYTES     16384
+#define FRAG_REQUESTS  20000
+#define KEEP_EVERY     7         // Requests between long-lived allocations
+#define KEEP_LIVE      24        // Long-lived buffers alive at a time
+
+//-----------------------------------First-fit heap-----------------------------------
+
+// Blocks are laid out back to back; size includes the header
+typedef struct {
+    uint32_t size;
+    uint32_t used;
+} heap_block_t;
+
+static _Alignas(8) uint8_t heap[HEAP_BYTES];
+static uint32_t heap_mallocs;
+static uint32_t heap_failures;
+
+static void heap_reset(void)
+{
+    heap_block_t *b = (heap_block_t *)heap;
+    b->size = HEAP_BYTES;
+    b->used = 0;
+    heap_mallocs = 0;
+    heap_failures = 0;
+}
+
+static heap_block_t *heap_next(heap_block_t *b)
+{
+    uint8_t *next = (uint8_t *)b + b->size;
+    return next < heap + HEAP_BYTES ? (heap_block_t *)next : NULL;
+}
+
+static void *heap_malloc(size_t size)
+{
+    uint32_t need = (uint32_t)((size + sizeof(heap_block_t) + 7) & ~(size_t)7);
+
+    heap_mallocs++;
+    for (heap_block_t *b = (heap_block_t *)heap; b; b = heap_next(b)) {
+        if (b->used) {
+            continue;
+        }
+        // Merge the free blocks that follow
+        for (heap_block_t *n = heap_next(b); n && !n->used; n = heap_next(b)) {
+            b->size += n->size;
+        }
+        if (b->size < need) {
+            continue;
+        }
+        if (b->size - need >= 2 * sizeof(heap_block_t)) {
+            heap_block_t *rest = (heap_block_t *)((uint8_t *)b + need);
+            rest->size = b->size - need;
+            rest->used = 0;
+            b->size = need;
+        }
+        b->used = 1;
+        return b + 1;
+    }
+    heap_failures++;
+    return NULL;
+}
+
+static void heap_free(void *p)
+{
+    if (p) {
+        ((heap_block_t *)p - 1)->used = 0;
+    }
+}
+
+static double heap_fragmentation(void)
+{
+    uint32_t total = 0;
+    uint32_t largest = 0;
+    uint32_t run = 0;
+
+    for (heap_block_t *b = (heap_block_t *)heap; b; b = heap_next(b)) {
+        if (b->used) {
+            run = 0;
+            continue;
+        }
+        run += b->size;
+        total += b->size;
+        largest = run > largest ? run : largest;
+    }
+    return total ? 1.0 - (double)largest / total : 0.0;
+}
+
+//-----------------------------------Request bodies-----------------------------------
+
+// What send_topic_value_json() does in http_server.c
+static size_t writer_body(float value, char *out, size_t cap)
+{
+    char buf[48];
+    json_writer_t w;
+    size_t len;
+
+    json_writer_init(&w, buf, sizeof(buf));
+    json_obj_begin(&w);
+    json_kv_float(&w, "temp", value, 2);
+    json_obj_end(&w);
+    if (!json_writer_finish(&w, &len) || len >= cap) {
+        return 0;
+    }
+    memcpy(out, buf, len + 1);
+    return len;
+}
+
+#ifdef HOST_HAVE_CJSON
+static size_t cjson_body(float value, char *out, size_t cap)
+{
+    size_t len = 0;
+    cJSON *root = cJSON_CreateObject();
+
+    if (root && cJSON_AddNumberToObject(root, "temp", value)) {
+        char *json_string = cJSON_Print(root);
+        if (json_string) {
+            len = strlen(json_string);
+            if (len < cap) {
+                memcpy(out, json_string, len + 1);
+            } else {
+                len = 0;
+            }
+            cJSON_free(json_string);
+        }
+    }
+    cJSON_Delete(root);
+    return len;
+}
+#endif
+
+typedef size_t (*body_fn_t)(float value, char *out, size_t cap);
+
+// Number formatting alone: json_float() against snprintf("%.2f")
+static void float_formatting(void)
+{
+    char buf[32];
+    json_writer_t w;
+
+    double t0 = host_seconds();
+    for (int i = 0; i < ROUNDS; i++) {
+        json_writer_init(&w, buf, sizeof(buf));
+        json_float(&w, -50.0f + (float)i * 0.0137f, 2);
+        host_sink += (double)w.len;
+    }
+    double t_writer = host_seconds() - t0;
+
+    t0 = host_seconds();
+    for (int i = 0; i < ROUNDS; i++) {
+        host_sink += snprintf(buf, sizeof(buf), "%.2f", (double)(-50.0f + (float)i * 0.0137f));
+    }
+    double t_snprintf = host_seconds() - t0;
+
+    printf("json_float:  %6.1f ns/value, snprintf %%.2f %6.1f ns/value\n", t_writer / ROUNDS * 1e9,
+           t_snprintf / ROUNDS * 1e9);
+}
+
+static double ns_per_request(body_fn_t body)
+{
+    char out[64];
+    double t0 = host_seconds();
+
+    for (int i = 0; i < ROUNDS; i++) {
+        host_sink += (double)body(20.0f + (float)(i % 1000) * 0.01f, out, sizeof(out));
+    }
+    return (host_seconds() - t0) / ROUNDS * 1e9;
+}
+
+//-----------------------------------Fragmentation-----------------------------------
+
+static void *keep[KEEP_LIVE];
+static size_t keep_next;
+static uint32_t keep_count;
+static bool keep_pending;       // The other task runs during this request
+static uint32_t request_mallocs;
+
+static void other_task_step(void)
+{
+    if (!keep_pending) {
+        return;
+    }
+    keep_pending = false;
+    heap_free(keep[keep_next]);
+    keep[keep_next] = heap_malloc(64 + (keep_count++ * 37) % 300);
+    keep_next = (keep_next + 1) % KEEP_LIVE;
+}
+
+#ifdef HOST_HAVE_CJSON
+// Allocator seen by the request, lets the other task in after its second block
+static void *request_malloc(size_t size)
+{
+    void *p = heap_malloc(size);
+
+    if (++request_mallocs == 2) {
+        other_task_step();
+    }
+    return p;
+}
+#endif
+
+static void fragmentation_run(const char *name, body_fn_t body)
+{
+    char out[64];
+    double worst = 0;
+
+    heap_reset();
+    memset(keep, 0, sizeof(keep));
+    keep_next = 0;
+    keep_count = 0;
+
+    for (int i = 0; i < FRAG_REQUESTS; i++) {
+        request_mallocs = 0;
+        keep_pending = (i % KEEP_EVERY == 0);
+        CHECK(body(20.0f + (float)(i % 1000) * 0.01f, out, sizeof(out)) > 0);
+        if (i == 0) {
+            printf("%s: %u heap allocations per request\n", name, request_mallocs);
+        }
+        other_task_step();      // If the request gave it no chance
+
+        double frag = heap_fragmentation();
+        worst = frag > worst ? frag : worst;
+    }
+    printf("%s: worst fragmentation %.1f %%, %u failed allocations\n", name, worst * 100, heap_failures);
+    CHECK(heap_failures == 0);
+    for (int k = 0; k < KEEP_LIVE; k++) {
+        heap_free(keep[k]);
+    }
+}
+
+int main(void)
+{
+    char out[64];
+
+    CHECK(writer_body(25.125f, out, sizeof(out)) > 0 && strcmp(out, "{\"temp\":25.13}") == 0);
+    float_formatting();
+    printf("json_writer: %6.1f ns/request\n", ns_per_request(writer_body));
+
+#ifdef HOST_HAVE_CJSON
+    cJSON_Hooks hooks = {.malloc_fn = request_malloc, .free_fn = heap_free};
+
+    // Timing with the system allocator, then everything on the small heap
+    printf("cJSON:       %6.1f ns/request\n", ns_per_request(cjson_body));
+    cJSON_InitHooks(&hooks);
+    fragmentation_run("cJSON", cjson_body);
+#else
+    printf("cJSON:       not built, point CJSON_DIR at the cJSON sources to compare\n");
+#endif
+
+    // Only the long-lived buffers touched the heap
+    fragmentation_run("json_writer", writer_body);
+    CHECK(heap_mallocs == (FRAG_REQUESTS + KEEP_EVERY - 1) / KEEP_EVERY);
+
+    HOST_TEST_END();
+}
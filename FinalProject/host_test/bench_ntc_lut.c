@@ -0,0 +1,74 @@
+/**
+ * @file bench_ntc_lut.c
+ * @author David Ramírez Betancourth
+ * @brief ns/sample of ntc_lut_lookup() against the path it replaced:
+ * raw_to_voltage() and the beta model with its divide and logf() per sample
+ *
+ * On the host the driver stand-in and logf() are both cheap, so the ratio
+ * understates the gain on the ESP32, whose FPU has no divide or log.
+ */
+
+#include "ntc_lut.h"
+#include "host_test.h"
+
+#define BLOCK_LEN 256
+#define ROUNDS    20000
+
+static const ntc_params_t params = {
+    .beta = 10000.0,
+    .r0 = 10000.0,
+    .t0 = 298.15,
+    .r_fixed = 1000.0,
+    .v_in = 4.8,
+};
+
+int main(void)
+{
+    static const adc_config_t conf = {
+        .unit_id = ADC_UNIT_1, .channel = ADC_CHANNEL_3, .atten = ADC_ATTEN_DB_12, .bitwidth = ADC_BITWIDTH_12,
+    };
+    static ntc_lut_t lut;
+    adc_channel_handle_t handle;
+    int raw[BLOCK_LEN];
+    float old_c[BLOCK_LEN];
+    int32_t lut_mdeg[BLOCK_LEN];
+
+    set_adc(&conf, &handle);
+    CHECK(handle != NULL);
+    ntc_lut_build(&lut, &params, handle);
+
+    // Codes around room temperature with some spread
+    for (int i = 0; i < BLOCK_LEN; i++) {
+        raw[i] = 300 + (int)((i * 2654435761u) % 1500);
+    }
+
+    double t0 = host_seconds();
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int i = 0; i < BLOCK_LEN; i++) {
+            int mv;
+            raw_to_voltage(handle, raw[i], &mv);
+            ntc_voltage_to_celsius(&params, mv, &old_c[i]);
+        }
+        host_sink += old_c[r % BLOCK_LEN];
+    }
+    double t_old = host_seconds() - t0;
+
+    t0 = host_seconds();
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int i = 0; i < BLOCK_LEN; i++) {
+            ntc_lut_lookup(&lut, raw[i], &lut_mdeg[i]);
+        }
+        host_sink += lut_mdeg[r % BLOCK_LEN];
+    }
+    double t_lut = host_seconds() - t0;
+
+    double n = (double)ROUNDS * BLOCK_LEN;
+    printf("raw_to_voltage + logf: %6.2f ns/sample\n", t_old / n * 1e9);
+    printf("ntc_lut_lookup:        %6.2f ns/sample (%.1fx)\n", t_lut / n * 1e9, t_old / t_lut);
+
+    for (int i = 0; i < BLOCK_LEN; i++) {
+        CHECK_NEAR(lut_mdeg[i] / 1000.0, old_c[i], 0.1);
+    }
+    adc_release(handle);
+    HOST_TEST_END();
+}
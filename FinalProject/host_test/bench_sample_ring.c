@@ -0,0 +1,175 @@
+/**
+ * @file bench_sample_ring.c
+ * @author David Ramírez Betancourth
+ * @brief Samples/s through sample_ring against the per-sample queue path
+ * it replaced
+ *
+ * The old path sent one {float, bool} item per sample through a 10-deep
+ * FreeRTOS queue. Here that queue is a mutex and two condition variables,
+ * the host counterpart of the queue's lock and its blocked-task lists: one
+ * lock and one wakeup per sample, as xQueueSend()/xQueueReceive() cost.
+ * Both sides run as two threads and nothing is dropped, so the figure is
+ * the sustained transfer rate. Host numbers only rank the two paths.
+ */
+
+#include "sample_ring.h"
+#include "host_test.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+#define BENCH_SAMPLES  1000000
+#define RING_CAPACITY  1024
+#define RING_BATCH     64
+#define QUEUE_LEN      10
+
+//-----------------------------------Queue path-------------------------------------------
+
+typedef struct {
+    float value;
+    bool type;
+} adc_type_data_t;
+
+typedef struct {
+    adc_type_data_t items[QUEUE_LEN];
+    size_t head;
+    size_t count;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+} host_queue_t;
+
+static host_queue_t queue = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .not_empty = PTHREAD_COND_INITIALIZER,
+    .not_full = PTHREAD_COND_INITIALIZER,
+};
+
+static void queue_send(const adc_type_data_t *item)
+{
+    pthread_mutex_lock(&queue.lock);
+    while (queue.count == QUEUE_LEN) {
+        pthread_cond_wait(&queue.not_full, &queue.lock);
+    }
+    queue.items[(queue.head + queue.count) % QUEUE_LEN] = *item;
+    queue.count++;
+    pthread_cond_signal(&queue.not_empty);
+    pthread_mutex_unlock(&queue.lock);
+}
+
+static void queue_receive(adc_type_data_t *item)
+{
+    pthread_mutex_lock(&queue.lock);
+    while (queue.count == 0) {
+        pthread_cond_wait(&queue.not_empty, &queue.lock);
+    }
+    *item = queue.items[queue.head];
+    queue.head = (queue.head + 1) % QUEUE_LEN;
+    queue.count--;
+    pthread_cond_signal(&queue.not_full);
+    pthread_mutex_unlock(&queue.lock);
+}
+
+static void *queue_producer(void *arg)
+{
+    (void)arg;
+    for (uint32_t i = 0; i < BENCH_SAMPLES; i++) {
+        adc_type_data_t item = {.value = (float)i, .type = i & 1};
+        queue_send(&item);
+    }
+    return NULL;
+}
+
+static void *queue_consumer(void *arg)
+{
+    double *sum = arg;
+    adc_type_data_t item;
+
+    for (uint32_t i = 0; i < BENCH_SAMPLES; i++) {
+        queue_receive(&item);
+        *sum += item.value;
+    }
+    return NULL;
+}
+
+//-----------------------------------Ring path-------------------------------------------
+
+static sample_ring_t ring;
+static sample_t ring_storage[RING_CAPACITY];
+
+static void *ring_producer(void *arg)
+{
+    (void)arg;
+    for (uint32_t i = 0; i < BENCH_SAMPLES; ) {
+        sample_t *span;
+        size_t n = sample_ring_reserve(&ring, &span, RING_BATCH);
+        if (n == 0) {
+            sched_yield();
+            continue;
+        }
+        if (n > BENCH_SAMPLES - i) {
+            n = BENCH_SAMPLES - i;
+        }
+        for (size_t k = 0; k < n; k++) {
+            span[k] = (sample_t) {.timestamp_us = i + k, .value = (float)(i + k), .source = (i + k) & 1};
+        }
+        sample_ring_commit(&ring, n);
+        i += (uint32_t)n;
+    }
+    return NULL;
+}
+
+static void *ring_consumer(void *arg)
+{
+    double *sum = arg;
+
+    for (uint32_t i = 0; i < BENCH_SAMPLES; ) {
+        const sample_t *view;
+        size_t n = sample_ring_peek(&ring, &view);
+        if (n == 0) {
+            sched_yield();
+            continue;
+        }
+        for (size_t k = 0; k < n; k++) {
+            *sum += view[k].value;
+        }
+        sample_ring_release(&ring, n);
+        i += (uint32_t)n;
+    }
+    return NULL;
+}
+
+//-----------------------------------Runner-------------------------------------------
+
+static double run(void *(*producer)(void *), void *(*consumer)(void *), double *sum)
+{
+    pthread_t prod;
+    pthread_t cons;
+    double t0 = host_seconds();
+
+    pthread_create(&cons, NULL, consumer, sum);
+    pthread_create(&prod, NULL, producer, NULL);
+    pthread_join(prod, NULL);
+    pthread_join(cons, NULL);
+    return BENCH_SAMPLES / (host_seconds() - t0);
+}
+
+int main(void)
+{
+    // Sum of 0..N-1 in float steps, identical for both paths
+    double queue_sum = 0;
+    double ring_sum = 0;
+
+    double queue_rate = run(queue_producer, queue_consumer, &queue_sum);
+
+    CHECK(sample_ring_init(&ring, ring_storage, RING_CAPACITY));
+    double ring_rate = run(ring_producer, ring_consumer, &ring_sum);
+
+    printf("queue (len %d, 1 item/call): %10.0f samples/s\n", QUEUE_LEN, queue_rate);
+    printf("ring  (cap %d, batch %d):  %10.0f samples/s (%.1fx)\n", RING_CAPACITY, RING_BATCH, ring_rate,
+           ring_rate / queue_rate);
+
+    CHECK(queue_sum == ring_sum);
+    CHECK(ring_rate > queue_rate);
+    HOST_TEST_END();
+}
@@ -0,0 +1,173 @@
+/**
+ * @file bench_telemetry_bus.c
+ * @author David Ramírez Betancourth
+ * @brief telemetry_bus publish latency and fan-out cost, from no subscriber
+ * up to TELEMETRY_MAX_SUBSCRIBERS, and telemetry_latest() reads against a
+ * publishing thread
+ *
+ * Subscribers run in the publisher's context, so a publish costs the
+ * seqlock write plus one call per matching subscriber, and the last
+ * subscriber sees the message after all the others. On the host the
+ * seqlock's critical section is a pthread mutex, dearer than a portMUX on
+ * target; the per-subscriber slope is what carries over.
+ */
+
+#include "telemetry_bus.h"
+#include "host_test.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#define PUBLISHES      1000000
+#define SAMPLED        100000      // Single publishes timed one by one
+#define READS          2000000
+
+static uint64_t delivered;
+static double last_delivery_ns;     // Publish call -> last subscriber, per sample
+static struct timespec publish_start;
+
+static double ns_since(const struct timespec *t0)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)(t.tv_sec - t0->tv_sec) * 1e9 + (double)(t.tv_nsec - t0->tv_nsec);
+}
+
+static void count_cb(const telemetry_msg_t *msg, void *user_ctx)
+{
+    (void)user_ctx;
+    delivered++;
+    host_sink += msg->value.f;
+}
+
+// Subscribed last: how long after the publish call the fan-out reaches it
+// (its own clock read shows in the ns/publish of that run)
+static void last_cb(const telemetry_msg_t *msg, void *user_ctx)
+{
+    (void)msg, (void)user_ctx;
+    delivered++;
+    last_delivery_ns = ns_since(&publish_start);
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Mean ns per publish, then p50/p99 of single publishes and of the delivery
+// to the last subscriber
+static void bench_publish(int topic, int subscribers, int registered, bool timed_last)
+{
+    static double call_ns[SAMPLED];
+    static double last_ns[SAMPLED];
+
+    delivered = 0;
+    double t0 = host_seconds();
+    for (int i = 0; i < PUBLISHES; i++) {
+        telemetry_publish_float(topic, (float)i, i);
+    }
+    double mean_ns = (host_seconds() - t0) / PUBLISHES * 1e9;
+    CHECK(delivered == (uint64_t)PUBLISHES * subscribers);
+
+    for (int i = 0; i < SAMPLED; i++) {
+        clock_gettime(CLOCK_MONOTONIC, &publish_start);
+        telemetry_publish_float(topic, (float)i, i);
+        call_ns[i] = ns_since(&publish_start);
+        last_ns[i] = last_delivery_ns;
+    }
+    qsort(call_ns, SAMPLED, sizeof(call_ns[0]), cmp_double);
+    qsort(last_ns, SAMPLED, sizeof(last_ns[0]), cmp_double);
+
+    printf("%d/%d subscribers match: %6.1f ns/publish, single publish p50 %5.0f p99 %5.0f ns", subscribers, registered, mean_ns,
+           call_ns[SAMPLED / 2], call_ns[SAMPLED * 99 / 100]);
+    if (timed_last) {
+        printf(", last subscriber after p50 %5.0f p99 %5.0f ns", last_ns[SAMPLED / 2], last_ns[SAMPLED * 99 / 100]);
+    }
+    printf("\n");
+}
+
+//-----------------------------------Readers vs publisher---------------------------
+
+static atomic_bool publishing;
+
+static void *publisher(void *arg)
+{
+    int topic = *(int *)arg;
+    int32_t i = 0;
+
+    while (atomic_load(&publishing)) {
+        telemetry_publish_int(topic, i, (int64_t)i * 3);
+        i++;
+    }
+    return NULL;
+}
+
+static void bench_latest(int topic)
+{
+    telemetry_msg_t msg;
+    uint64_t torn = 0;
+    pthread_t thread;
+
+    telemetry_publish_int(topic, 0, 0);
+    double t0 = host_seconds();
+    for (int i = 0; i < READS; i++) {
+        telemetry_latest(topic, &msg);
+        host_sink += msg.value.i;
+    }
+    double idle_ns = (host_seconds() - t0) / READS * 1e9;
+
+    atomic_store(&publishing, true);
+    pthread_create(&thread, NULL, publisher, &topic);
+    t0 = host_seconds();
+    for (int i = 0; i < READS; i++) {
+        telemetry_latest(topic, &msg);
+        // The publisher stamps value i with 3 * i: a mismatch is a torn copy
+        if (msg.timestamp_us != (int64_t)msg.value.i * 3) {
+            torn++;
+        }
+    }
+    double busy_ns = (host_seconds() - t0) / READS * 1e9;
+    atomic_store(&publishing, false);
+    pthread_join(thread, NULL);
+
+    printf("telemetry_latest: %5.1f ns/read idle, %5.1f ns/read against a publishing thread\n", idle_ns, busy_ns);
+    CHECK(torn == 0);
+}
+
+int main(void)
+{
+    int topic;
+    int other;
+    int counter;
+
+    CHECK(telemetry_register("ntc_c", TELEMETRY_FLOAT, &topic) == ESP_OK);
+    CHECK(telemetry_register("ambient_c", TELEMETRY_FLOAT, &other) == ESP_OK);
+    CHECK(telemetry_register("counter", TELEMETRY_INT, &counter) == ESP_OK);
+
+    bench_publish(topic, 0, 0, false);
+
+    // Subscribers of another topic are skipped, not called
+    CHECK(telemetry_subscribe(other, count_cb, NULL) == ESP_OK);
+    CHECK(telemetry_subscribe(other, count_cb, NULL) == ESP_OK);
+    bench_publish(topic, 0, 2, false);
+
+    // Matching subscribers one at a time, topic and all-topic ones alternating
+    int subs = 0;
+    while (subs < TELEMETRY_MAX_SUBSCRIBERS - 3) {
+        CHECK(telemetry_subscribe(subs % 2 ? TELEMETRY_ALL_TOPICS : topic, count_cb, NULL) == ESP_OK);
+        subs++;
+        bench_publish(topic, subs, subs + 2, false);
+    }
+
+    // The last one fills the table and timestamps its delivery
+    CHECK(telemetry_subscribe(topic, last_cb, NULL) == ESP_OK);
+    subs++;
+    CHECK(telemetry_subscribe(topic, last_cb, NULL) == ESP_ERR_NO_MEM);
+    bench_publish(topic, subs, subs + 2, true);
+
+    bench_latest(counter);
+    HOST_TEST_END();
+}
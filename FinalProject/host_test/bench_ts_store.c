@@ -0,0 +1,84 @@
+/**
+ * @file bench_ts_store.c
+ * @author David Ramírez Betancourth
+ * @brief ts_store insert and query throughput
+ *
+ * Inserts run at 20 S/s timestamps, so every 20th insert closes a 1 s
+ * aggregate and every 1200th a 1 min one, as adc_task feeds it. Queries
+ * run against the filled store: random 64-point pages of the raw tier, the
+ * way /history.json pages, and whole-tier reads.
+ */
+
+#include "ts_store.h"
+#include "host_test.h"
+
+#define INSERTS    5000000
+#define QUERIES    200000
+#define PERIOD_US  50000LL
+
+static ts_store_t store;
+static ts_point_t points[TS_STORE_MIN_LEN];
+static uint64_t rng_state = 0x2545F4914F6CDD1Du;
+
+static uint32_t rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)(rng_state >> 32);
+}
+
+// queries random pages of up to page points starting within the tier's span
+static void bench_query(ts_tier_t tier, size_t page, int64_t now_us, int queries)
+{
+    const ts_ring_t *ring = &store.tiers[tier];
+    int64_t oldest_us = (int64_t)ring->t_ms[(ring->head + ring->cap - ring->count) % ring->cap] * 1000;
+    uint64_t span_ms = (uint64_t)(now_us - oldest_us) / 1000;
+    size_t total = 0;
+
+    double t0 = host_seconds();
+    for (int i = 0; i < queries; i++) {
+        int64_t from = page < ring->count ? oldest_us + (int64_t)(rng() % span_ms) * 1000 : 0;
+        total += ts_store_query(&store, tier, from, now_us, points, page);
+    }
+    double dt = host_seconds() - t0;
+    host_sink = points[0].mean;
+
+    printf("%-5s %4zu-point pages: %8.0f queries/s, %6.1f M points/s, %.2f points/query\n",
+           tier == TS_TIER_RAW ? "raw" : tier == TS_TIER_SEC ? "1 s" : "1 min", page, queries / dt,
+           total / dt * 1e-6, (double)total / queries);
+    CHECK(total > 0);
+}
+
+int main(void)
+{
+    printf("store footprint %zu bytes (TS_STORE_BYTES %d)\n", sizeof(ts_store_t), TS_STORE_BYTES);
+
+    ts_store_init(&store, "bench", 100.0f);
+    double t0 = host_seconds();
+    for (int i = 0; i < INSERTS; i++) {
+        ts_store_insert(&store, 1000000 + i * PERIOD_US, (float)(i % 1000) * 0.25f);
+    }
+    double dt = host_seconds() - t0;
+    printf("insert: %.1f M inserts/s, %.1f ns each\n", INSERTS / dt * 1e-6, dt / INSERTS * 1e9);
+
+    CHECK(store.tiers[TS_TIER_RAW].count == TS_STORE_RAW_LEN);
+    CHECK(store.tiers[TS_TIER_SEC].count == TS_STORE_SEC_LEN);
+    CHECK(store.tiers[TS_TIER_MIN].count == TS_STORE_MIN_LEN);
+
+    int64_t now = 1000000 + (int64_t)INSERTS * PERIOD_US;
+    bench_query(TS_TIER_RAW, 64, now, QUERIES);
+    bench_query(TS_TIER_RAW, TS_STORE_RAW_LEN, now, QUERIES / 20);
+    bench_query(TS_TIER_SEC, TS_STORE_SEC_LEN, now, QUERIES / 20);
+    bench_query(TS_TIER_MIN, TS_STORE_MIN_LEN, now, QUERIES / 20);
+
+    t0 = host_seconds();
+    int tiers = 0;
+    for (int i = 0; i < QUERIES; i++) {
+        tiers += ts_store_best_tier(&store, now - (int64_t)(rng() % 86400) * 1000000);
+    }
+    dt = host_seconds() - t0;
+    host_sink = tiers;
+    printf("best_tier: %.1f M calls/s\n", QUERIES / dt * 1e-6);
+    HOST_TEST_END();
+}
@@ -0,0 +1,271 @@
+/**
+ * @file http_client.h
+ * @author David Ramírez Betancourth
+ * @brief Minimal blocking HTTP/1.1 client for the device clients
+ *
+ * One connection per client_t, keep-alive, with a read buffer and byte
+ * counters for both directions so the clients can report what went over
+ * the wire, headers included. Just enough HTTP for the firmware's
+ * responses: Content-Length or chunked bodies, no redirects, no TLS.
+ */
+
+#ifndef HTTP_CLIENT_H
+#define HTTP_CLIENT_H
+
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CLIENT_BUF_LEN  8192
+
+typedef struct {
+    char host[128];
+    char port[8];
+    int fd;
+    char buf[CLIENT_BUF_LEN];
+    size_t pos;                 // Next unread byte of buf
+    size_t len;                 // Bytes in buf
+    uint64_t rx_bytes;
+    uint64_t tx_bytes;
+} client_t;
+
+typedef struct {
+    int status;
+    bool close;                 // Server sent Connection: close
+    bool chunked;
+    long content_len;           // -1 if not given
+    char etag[64];
+    char content_type[64];
+} client_response_t;
+
+static inline double client_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// "host" or "host:port", port defaults to 80
+static inline void client_init(client_t *c, const char *arg)
+{
+    const char *colon = strrchr(arg, ':');
+    int host_len = colon ? (int)(colon - arg) : (int)strlen(arg);
+
+    memset(c, 0, sizeof(*c));
+    c->fd = -1;
+    snprintf(c->host, sizeof(c->host), "%.*s", host_len, arg);
+    snprintf(c->port, sizeof(c->port), "%s", colon ? colon + 1 : "80");
+}
+
+static inline void client_close(client_t *c)
+{
+    if (c->fd >= 0) {
+        close(c->fd);
+    }
+    c->fd = -1;
+    c->pos = 0;
+    c->len = 0;
+}
+
+// Connects if not connected; a receive timeout bounds every read
+static inline bool client_connect(client_t *c, int timeout_s)
+{
+    struct addrinfo hints = {.ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM};
+    struct addrinfo *res;
+    int one = 1;
+    struct timeval tv = {.tv_sec = timeout_s};
+
+    if (c->fd >= 0) {
+        return true;
+    }
+    if (getaddrinfo(c->host, c->port, &hints, &res) != 0) {
+        return false;
+    }
+    c->fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (c->fd >= 0 && connect(c->fd, res->ai_addr, res->ai_addrlen) != 0) {
+        close(c->fd);
+        c->fd = -1;
+    }
+    freeaddrinfo(res);
+    if (c->fd < 0) {
+        return false;
+    }
+    setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    setsockopt(c->fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    return true;
+}
+
+static inline bool client_send(client_t *c, const void *data, size_t len)
+{
+    const char *p = data;
+
+    while (len > 0) {
+        ssize_t n = send(c->fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+        c->tx_bytes += (uint64_t)n;
+    }
+    return true;
+}
+
+// Refills the buffer if empty, false on EOF, error or timeout
+static inline bool client_fill(client_t *c)
+{
+    if (c->pos < c->len) {
+        return true;
+    }
+    ssize_t n;
+    do {
+        n = recv(c->fd, c->buf, sizeof(c->buf), 0);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) {
+        return false;
+    }
+    c->pos = 0;
+    c->len = (size_t)n;
+    c->rx_bytes += (uint64_t)n;
+    return true;
+}
+
+// One line without its CR LF, truncated to cap - 1
+static inline bool client_read_line(client_t *c, char *line, size_t cap)
+{
+    size_t n = 0;
+
+    while (client_fill(c)) {
+        char ch = c->buf[c->pos++];
+        if (ch == '\n') {
+            if (n > 0 && line[n - 1] == '\r') {
+                n--;
+            }
+            line[n] = '\0';
+            return true;
+        }
+        if (n + 1 < cap) {
+            line[n++] = ch;
+        }
+    }
+    return false;
+}
+
+// Exactly len bytes; out may be NULL to skip them
+static inline bool client_read(client_t *c, void *out, size_t len)
+{
+    char *p = out;
+
+    while (len > 0) {
+        if (!client_fill(c)) {
+            return false;
+        }
+        size_t n = c->len - c->pos < len ? c->len - c->pos : len;
+        if (p) {
+            memcpy(p, c->buf + c->pos, n);
+            p += n;
+        }
+        c->pos += n;
+        len -= n;
+    }
+    return true;
+}
+
+static inline bool client_read_headers(client_t *c, client_response_t *r)
+{
+    char line[512];
+
+    memset(r, 0, sizeof(*r));
+    r->content_len = -1;
+    if (!client_read_line(c, line, sizeof(line)) || sscanf(line, "HTTP/1.%*d %d", &r->status) != 1) {
+        return false;
+    }
+    while (client_read_line(c, line, sizeof(line))) {
+        char *value = strchr(line, ':');
+
+        if (line[0] == '\0') {
+            return true;
+        }
+        if (!value) {
+            continue;
+        }
+        *value++ = '\0';
+        value += strspn(value, " \t");
+        if (strcasecmp(line, "Content-Length") == 0) {
+            r->content_len = strtol(value, NULL, 10);
+        } else if (strcasecmp(line, "Transfer-Encoding") == 0) {
+            r->chunked = strcasecmp(value, "chunked") == 0;
+        } else if (strcasecmp(line, "Connection") == 0) {
+            r->close = strcasecmp(value, "close") == 0;
+        } else if (strcasecmp(line, "ETag") == 0) {
+            snprintf(r->etag, sizeof(r->etag), "%s", value);
+        } else if (strcasecmp(line, "Content-Type") == 0) {
+            snprintf(r->content_type, sizeof(r->content_type), "%s", value);
+        }
+    }
+    return false;
+}
+
+// Size line of the next chunk, -1 on error; 0 is the last chunk
+static inline long client_read_chunk_size(client_t *c)
+{
+    char line[64];
+
+    if (!client_read_line(c, line, sizeof(line))) {
+        return -1;
+    }
+    return strtol(line, NULL, 16);
+}
+
+/**
+ * Reads a whole body into body (truncated to cap - 1, NUL terminated).
+ * Returns the body length, -1 on error.
+ */
+static inline long client_read_body(client_t *c, const client_response_t *r, char *body, size_t cap)
+{
+    size_t kept = 0;
+    long total = 0;
+
+    if (!r->chunked) {
+        long len = r->content_len > 0 ? r->content_len : 0;
+        size_t take = (size_t)len < cap - 1 ? (size_t)len : cap - 1;
+        if (!client_read(c, body, take) || !client_read(c, NULL, (size_t)len - take)) {
+            return -1;
+        }
+        body[take] = '\0';
+        return len;
+    }
+
+    for (;;) {
+        long size = client_read_chunk_size(c);
+        if (size < 0) {
+            return -1;
+        }
+        if (size == 0) {
+            char line[8];
+            return client_read_line(c, line, sizeof(line)) ? total : -1;   // Empty trailer
+        }
+        size_t take = kept + (size_t)size < cap - 1 ? (size_t)size : cap - 1 - kept;
+        if (!client_read(c, body + kept, take) || !client_read(c, NULL, (size_t)size - take + 2)) {
+            return -1;
+        }
+        kept += take;
+        total += size;
+        body[kept] = '\0';
+    }
+}
+
+#endif // HTTP_CLIENT_H
@@ -0,0 +1,197 @@
+/**
+ * @file http_load.c
+ * @author David Ramírez Betancourth
+ * @brief Load client for the telemetry polls: requests/s and bytes per
+ * update, before (split) and after (snapshot) /telemetry.json
+ *
+ *   http_load <host[:port]> split|snapshot [clients] [seconds] [period_ms]
+ *
+ * split:    one update is GET /lm35Sensor.json + GET /anemoSensor.json,
+ *           what app.js used to poll.
+ * snapshot: one update is GET /telemetry.json with If-None-Match, so an
+ *           unchanged snapshot costs a bodyless 304.
+ *
+ * Every client keeps one keep-alive connection and runs updates back to
+ * back, or one per period_ms like a browser tab. Bytes are counted on the
+ * socket, headers included.
+ */
+
+#include "http_client.h"
+
+#include <pthread.h>
+
+#define MAX_LATENCIES  (1 << 20)
+
+typedef struct {
+    pthread_t thread;
+    client_t conn;
+    bool snapshot;
+    double seconds;
+    int period_ms;
+    uint64_t requests, updates, ok, not_modified, errors, reconnects;
+    uint64_t rx_bytes, tx_bytes;
+} load_client_t;
+
+static double latencies[MAX_LATENCIES];
+static size_t num_latencies;
+static pthread_mutex_t latencies_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// One GET on the kept-alive connection, reconnecting first if needed
+static bool get(load_client_t *lc, const char *path, char *etag, size_t etag_cap)
+{
+    char request[256];
+    char body[1024];
+    client_response_t r;
+    int len;
+
+    if (lc->conn.fd < 0) {
+        if (!client_connect(&lc->conn, 5)) {
+            return false;
+        }
+        lc->reconnects++;
+    }
+
+    if (etag && etag[0]) {
+        len = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: %s\r\nIf-None-Match: %s\r\n\r\n", path,
+                       lc->conn.host, etag);
+    } else {
+        len = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: %s\r\n\r\n", path, lc->conn.host);
+    }
+
+    lc->requests++;
+    if (!client_send(&lc->conn, request, (size_t)len) || !client_read_headers(&lc->conn, &r) ||
+        client_read_body(&lc->conn, &r, body, sizeof(body)) < 0) {
+        client_close(&lc->conn);
+        return false;
+    }
+    if (r.close) {
+        client_close(&lc->conn);
+    }
+
+    if (r.status == 304) {
+        lc->not_modified++;
+    } else if (r.status == 200) {
+        lc->ok++;
+        if (etag) {
+            snprintf(etag, etag_cap, "%s", r.etag);
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static void *load_thread(void *arg)
+{
+    load_client_t *lc = arg;
+    char etag[64] = "";
+    double start = client_seconds();
+    double next = start;
+
+    while (client_seconds() - start < lc->seconds) {
+        double t0 = client_seconds();
+        bool ok;
+
+        if (lc->snapshot) {
+            ok = get(lc, "/telemetry.json", etag, sizeof(etag));
+        } else {
+            ok = get(lc, "/lm35Sensor.json", NULL, 0) && get(lc, "/anemoSensor.json", NULL, 0);
+        }
+        double dt = client_seconds() - t0;
+
+        if (!ok) {
+            lc->errors++;
+            usleep(100000);
+            continue;
+        }
+        lc->updates++;
+        pthread_mutex_lock(&latencies_lock);
+        if (num_latencies < MAX_LATENCIES) {
+            latencies[num_latencies++] = dt;
+        }
+        pthread_mutex_unlock(&latencies_lock);
+
+        if (lc->period_ms > 0) {
+            next += lc->period_ms * 1e-3;
+            double wait = next - client_seconds();
+            if (wait > 0) {
+                usleep((useconds_t)(wait * 1e6));
+            }
+        }
+    }
+
+    lc->rx_bytes = lc->conn.rx_bytes;
+    lc->tx_bytes = lc->conn.tx_bytes;
+    client_close(&lc->conn);
+    return NULL;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3 || (strcmp(argv[2], "split") != 0 && strcmp(argv[2], "snapshot") != 0)) {
+        fprintf(stderr, "usage: %s <host[:port]> split|snapshot [clients] [seconds] [period_ms]\n", argv[0]);
+        return 2;
+    }
+    int num_clients = argc > 3 ? atoi(argv[3]) : 1;
+    double seconds = argc > 4 ? atof(argv[4]) : 10.0;
+    int period_ms = argc > 5 ? atoi(argv[5]) : 0;
+    if (num_clients < 1 || num_clients > 64 || seconds <= 0) {
+        fprintf(stderr, "clients must be 1-64 and seconds > 0\n");
+        return 2;
+    }
+
+    load_client_t *clients = calloc((size_t)num_clients, sizeof(load_client_t));
+    for (int i = 0; i < num_clients; i++) {
+        client_init(&clients[i].conn, argv[1]);
+        clients[i].snapshot = strcmp(argv[2], "snapshot") == 0;
+        clients[i].seconds = seconds;
+        clients[i].period_ms = period_ms;
+    }
+
+    double t0 = client_seconds();
+    for (int i = 0; i < num_clients; i++) {
+        pthread_create(&clients[i].thread, NULL, load_thread, &clients[i]);
+    }
+    load_client_t total = {0};
+    for (int i = 0; i < num_clients; i++) {
+        load_client_t *lc = &clients[i];
+        pthread_join(lc->thread, NULL);
+        total.requests += lc->requests;
+        total.updates += lc->updates;
+        total.ok += lc->ok;
+        total.not_modified += lc->not_modified;
+        total.errors += lc->errors;
+        total.reconnects += lc->reconnects;
+        total.rx_bytes += lc->rx_bytes;
+        total.tx_bytes += lc->tx_bytes;
+    }
+    double elapsed = client_seconds() - t0;
+
+    printf("%s, %d client(s), %.1f s%s\n", argv[2], num_clients, elapsed, period_ms > 0 ? "" : ", back to back");
+    if (period_ms > 0) {
+        printf("  one update per %d ms per client\n", period_ms);
+    }
+    printf("  %.1f requests/s, %.1f updates/s, %llu errors, %llu connections\n", total.requests / elapsed,
+           total.updates / elapsed, (unsigned long long)total.errors, (unsigned long long)total.reconnects);
+    printf("  responses: %llu 200, %llu 304\n", (unsigned long long)total.ok,
+           (unsigned long long)total.not_modified);
+    if (total.updates > 0) {
+        printf("  bytes per update: %.1f received, %.1f sent\n", (double)total.rx_bytes / total.updates,
+               (double)total.tx_bytes / total.updates);
+    }
+    if (num_latencies > 0) {
+        qsort(latencies, num_latencies, sizeof(double), compare_double);
+        printf("  update time: p50 %.2f ms, p99 %.2f ms, max %.2f ms\n", latencies[num_latencies / 2] * 1e3,
+               latencies[num_latencies * 99 / 100] * 1e3, latencies[num_latencies - 1] * 1e3);
+    }
+
+    free(clients);
+    return total.updates > 0 ? 0 : 1;
+}
@@ -0,0 +1,244 @@
+/**
+ * @file sse_soak.c
+ * @author David Ramírez Betancourth
+ * @brief Multi-client soak of the /events stream: update latency, frame
+ * spacing, refusals and drops
+ *
+ *   sse_soak <host[:port]> [clients] [seconds]
+ *
+ * Every client holds one /events stream and reconnects if it is dropped.
+ * Frames carry the board's time twice: top-level "t_ms" when the frame
+ * was built and one "t_ms" per topic when it was published. So the
+ * latency is reported in two parts:
+ * - publish -> frame: newest topic t_ms to frame t_ms, on the board's clock
+ * - frame -> arrival: arrival minus frame t_ms, above the smallest value
+ *   seen in the run (the clocks are not synchronized, so only the part
+ *   above the fastest delivery is known)
+ * Clients beyond HTTP_EVENTS_MAX_CLIENTS should see 503.
+ */
+
+#include "http_client.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define MAX_FRAMES  (1 << 20)
+
+typedef struct {
+    pthread_t thread;
+    client_t conn;
+    uint64_t frames, pings, refused, drops, connects;
+    double max_gap_s;           // Longest time without a frame or ping
+} sse_client_t;
+
+typedef struct {
+    double publish_to_frame_ms;
+    double offset_ms;           // Arrival on the host clock minus frame t_ms
+} frame_sample_t;
+
+static frame_sample_t samples[MAX_FRAMES];
+static size_t num_samples;
+static pthread_mutex_t samples_lock = PTHREAD_MUTEX_INITIALIZER;
+static atomic_bool stop;
+static double start_s;
+
+// Frame t_ms (the first one) and the newest topic t_ms, false if none
+static bool frame_times(const char *json, double *frame_ms, double *newest_topic_ms)
+{
+    const char *p = strstr(json, "\"t_ms\":");
+
+    if (!p) {
+        return false;
+    }
+    *frame_ms = strtod(p + 7, NULL);
+    *newest_topic_ms = -1;
+    while ((p = strstr(p + 7, "\"t_ms\":")) != NULL) {
+        double t = strtod(p + 7, NULL);
+        if (t > *newest_topic_ms) {
+            *newest_topic_ms = t;
+        }
+    }
+    return *newest_topic_ms >= 0;
+}
+
+static void record_frame(const char *data, double arrival_s)
+{
+    double frame_ms;
+    double topic_ms;
+
+    if (!frame_times(data, &frame_ms, &topic_ms)) {
+        return;
+    }
+    pthread_mutex_lock(&samples_lock);
+    if (num_samples < MAX_FRAMES) {
+        samples[num_samples++] = (frame_sample_t) {
+            .publish_to_frame_ms = frame_ms - topic_ms,
+            .offset_ms = (arrival_s - start_s) * 1e3 - frame_ms,
+        };
+    }
+    pthread_mutex_unlock(&samples_lock);
+}
+
+// Reads one stream until it ends; SSE lines are split across chunks freely
+static void read_stream(sse_client_t *sc)
+{
+    static _Thread_local char chunk[4096];
+    static _Thread_local char line[4096];
+    static _Thread_local char data[4096];
+    size_t line_len = 0;
+    size_t data_len = 0;
+    double last = client_seconds();
+
+    while (!atomic_load(&stop)) {
+        long size = client_read_chunk_size(&sc->conn);
+        if (size <= 0 || (size_t)size > sizeof(chunk) || !client_read(&sc->conn, chunk, (size_t)size) ||
+            !client_read(&sc->conn, NULL, 2)) {
+            return;
+        }
+        double now = client_seconds();
+
+        for (long i = 0; i < size; i++) {
+            if (chunk[i] != '\n') {
+                if (line_len + 1 < sizeof(line)) {
+                    line[line_len++] = chunk[i];
+                }
+                continue;
+            }
+            line[line_len] = '\0';
+
+            if (line_len == 0) {
+                // End of an event
+                if (data_len > 0) {
+                    sc->frames++;
+                    record_frame(data, now);
+                }
+                data_len = 0;
+            } else if (line[0] == ':') {
+                sc->pings++;
+            } else if (strncmp(line, "data: ", 6) == 0) {
+                data_len = (size_t)snprintf(data, sizeof(data), "%s", line + 6);
+            }
+            line_len = 0;
+
+            if (now - last > sc->max_gap_s) {
+                sc->max_gap_s = now - last;
+            }
+            last = now;
+        }
+    }
+}
+
+static void *sse_thread(void *arg)
+{
+    sse_client_t *sc = arg;
+    char request[256];
+    char body[256];
+    client_response_t r;
+
+    while (!atomic_load(&stop)) {
+        bool refused = false;
+
+        // The board sends a comment line at least every 15 s
+        if (!client_connect(&sc->conn, 20)) {
+            usleep(500000);
+            continue;
+        }
+        sc->connects++;
+
+        int len = snprintf(request, sizeof(request),
+                           "GET /events HTTP/1.1\r\nHost: %s\r\nAccept: text/event-stream\r\n\r\n", sc->conn.host);
+        if (client_send(&sc->conn, request, (size_t)len) && client_read_headers(&sc->conn, &r)) {
+            if (r.status == 200 && r.chunked) {
+                read_stream(sc);
+                if (!atomic_load(&stop)) {
+                    sc->drops++;
+                }
+            } else {
+                sc->refused++;
+                refused = true;
+                client_read_body(&sc->conn, &r, body, sizeof(body));
+            }
+        }
+        client_close(&sc->conn);
+        if (!atomic_load(&stop) && refused) {
+            usleep(2000000);     // Full: try again later, like the browser's retry
+        }
+    }
+    return NULL;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void print_percentiles(const char *name, double *values, size_t n)
+{
+    qsort(values, n, sizeof(double), compare_double);
+    printf("  %-36s p50 %7.1f ms, p99 %7.1f ms, max %7.1f ms\n", name, values[n / 2], values[n * 99 / 100],
+           values[n - 1]);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <host[:port]> [clients] [seconds]\n", argv[0]);
+        return 2;
+    }
+    int num_clients = argc > 2 ? atoi(argv[2]) : 3;
+    double seconds = argc > 3 ? atof(argv[3]) : 60.0;
+    if (num_clients < 1 || num_clients > 64 || seconds <= 0) {
+        fprintf(stderr, "clients must be 1-64 and seconds > 0\n");
+        return 2;
+    }
+
+    sse_client_t *clients = calloc((size_t)num_clients, sizeof(sse_client_t));
+    start_s = client_seconds();
+    for (int i = 0; i < num_clients; i++) {
+        client_init(&clients[i].conn, argv[1]);
+        pthread_create(&clients[i].thread, NULL, sse_thread, &clients[i]);
+    }
+
+    usleep((useconds_t)(seconds * 1e6));
+    atomic_store(&stop, true);
+    for (int i = 0; i < num_clients; i++) {
+        // Unblocks a pending read, the thread then sees stop
+        if (clients[i].conn.fd >= 0) {
+            shutdown(clients[i].conn.fd, SHUT_RDWR);
+        }
+    }
+
+    uint64_t frames = 0;
+    printf("%d client(s), %.0f s\n", num_clients, seconds);
+    for (int i = 0; i < num_clients; i++) {
+        sse_client_t *sc = &clients[i];
+        pthread_join(sc->thread, NULL);
+        printf("  client %d: %llu frames (%.1f/s), %llu pings, longest silence %.2f s, %llu connects, "
+               "%llu refused, %llu dropped\n", i, (unsigned long long)sc->frames, sc->frames / seconds,
+               (unsigned long long)sc->pings, sc->max_gap_s, (unsigned long long)sc->connects,
+               (unsigned long long)sc->refused, (unsigned long long)sc->drops);
+        frames += sc->frames;
+    }
+
+    if (num_samples > 0) {
+        static double values[MAX_FRAMES];
+        double min_offset = samples[0].offset_ms;
+
+        for (size_t i = 0; i < num_samples; i++) {
+            values[i] = samples[i].publish_to_frame_ms;
+            if (samples[i].offset_ms < min_offset) {
+                min_offset = samples[i].offset_ms;
+            }
+        }
+        print_percentiles("publish -> frame", values, num_samples);
+        for (size_t i = 0; i < num_samples; i++) {
+            values[i] = samples[i].offset_ms - min_offset;
+        }
+        print_percentiles("frame -> arrival, above the fastest", values, num_samples);
+    }
+
+    free(clients);
+    return frames > 0 ? 0 : 1;
+}
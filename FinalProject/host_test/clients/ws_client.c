@@ -0,0 +1,273 @@
+/**
+ * @file ws_client.c
+ * @author David Ramírez Betancourth
+ * @brief /ws client: command round-trip latency, messages/s and telemetry
+ * rate
+ *
+ *   ws_client <host[:port]> [seconds] [pwm|ping] [window]
+ *
+ * Sends PWM setpoints (answered with PWM_ACK after pwm_cmd is published)
+ * or PINGs (answered with PONG) and times each request to its reply. With
+ * window 1 every request waits for the previous reply, which gives the
+ * latency; a larger window keeps that many in flight, which gives the
+ * throughput. TELEMETRY frames pushed meanwhile are counted. The protocol
+ * is described in main/request/http_ws.h.
+ */
+
+#include "http_client.h"
+
+#define MAX_WINDOW     256
+#define MAX_RTTS       (1 << 20)
+#define MSG_PWM        0x01
+#define MSG_PING       0x02
+#define MSG_TELEMETRY  0x10
+#define MSG_TOPICS     0x11
+#define MSG_PWM_ACK    0x81
+#define MSG_PONG       0x82
+
+typedef struct {
+    uint64_t sent, replies, mismatched;
+    uint64_t telemetry_frames, telemetry_bytes;
+    int topics;
+} ws_stats_t;
+
+static double rtts[MAX_RTTS];
+static size_t num_rtts;
+static double sent_at[MAX_WINDOW];
+
+static void base64(const uint8_t *in, size_t len, char *out)
+{
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t v = (uint32_t)in[i] << 16 | (i + 1 < len ? in[i + 1] << 8 : 0) | (i + 2 < len ? in[i + 2] : 0);
+        *out++ = table[v >> 18 & 63];
+        *out++ = table[v >> 12 & 63];
+        *out++ = i + 1 < len ? table[v >> 6 & 63] : '=';
+        *out++ = i + 2 < len ? table[v & 63] : '=';
+    }
+    *out = '\0';
+}
+
+static bool ws_handshake(client_t *c)
+{
+    uint8_t key[16];
+    char key64[32];
+    char request[256];
+    client_response_t r;
+
+    for (size_t i = 0; i < sizeof(key); i++) {
+        key[i] = (uint8_t)rand();
+    }
+    base64(key, sizeof(key), key64);
+    int len = snprintf(request, sizeof(request),
+                       "GET /ws HTTP/1.1\r\nHost: %s\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                       "Sec-WebSocket-Key: %s\r\nSec-WebSocket-Version: 13\r\n\r\n", c->host, key64);
+    return client_send(c, request, (size_t)len) && client_read_headers(c, &r) && r.status == 101;
+}
+
+// Client frames are masked (RFC 6455 5.3)
+static bool ws_send(client_t *c, uint8_t opcode, const uint8_t *payload, size_t len)
+{
+    uint8_t frame[2 + 4 + 125];
+    uint32_t mask = (uint32_t)rand();
+
+    if (len > 125) {
+        return false;
+    }
+    frame[0] = 0x80 | opcode;
+    frame[1] = 0x80 | (uint8_t)len;
+    memcpy(&frame[2], &mask, 4);
+    for (size_t i = 0; i < len; i++) {
+        frame[6 + i] = payload[i] ^ frame[2 + i % 4];
+    }
+    return client_send(c, frame, 6 + len);
+}
+
+// Next frame; payloads longer than cap are skipped and reported as length 0
+static bool ws_read(client_t *c, uint8_t *opcode, uint8_t *payload, size_t cap, size_t *len)
+{
+    uint8_t head[2];
+    uint8_t ext[8];
+    uint8_t mask[4] = {0};
+    uint64_t n;
+
+    if (!client_read(c, head, 2)) {
+        return false;
+    }
+    *opcode = head[0] & 0x0F;
+    n = head[1] & 0x7F;
+    if (n == 126) {
+        if (!client_read(c, ext, 2)) {
+            return false;
+        }
+        n = (uint64_t)ext[0] << 8 | ext[1];
+    } else if (n == 127) {
+        if (!client_read(c, ext, 8)) {
+            return false;
+        }
+        n = 0;
+        for (int i = 0; i < 8; i++) {
+            n = n << 8 | ext[i];
+        }
+    }
+    if ((head[1] & 0x80) && !client_read(c, mask, 4)) {
+        return false;
+    }
+    if (n > cap) {
+        *len = 0;
+        return client_read(c, NULL, (size_t)n);
+    }
+    if (!client_read(c, payload, (size_t)n)) {
+        return false;
+    }
+    for (uint64_t i = 0; i < n; i++) {
+        payload[i] ^= mask[i % 4];
+    }
+    *len = (size_t)n;
+    return true;
+}
+
+static bool send_request(client_t *c, bool pwm, uint32_t id)
+{
+    uint8_t msg[5];
+    size_t len;
+
+    if (pwm) {
+        msg[0] = MSG_PWM;
+        msg[1] = (uint8_t)id;
+        msg[2] = (uint8_t)(id >> 8);
+        msg[3] = (uint8_t)(id % 101);
+        len = 4;
+    } else {
+        msg[0] = MSG_PING;
+        memcpy(&msg[1], &id, 4);     // Little-endian host
+        len = 5;
+    }
+    sent_at[id % MAX_WINDOW] = client_seconds();
+    return ws_send(c, 0x2, msg, len);
+}
+
+// Handles one server frame; returns the request id it answers, -1 otherwise
+static long handle_frame(client_t *c, ws_stats_t *st, bool pwm, uint32_t next_reply, uint8_t opcode,
+                         uint8_t *p, size_t len)
+{
+    if (opcode == 0x9) {
+        ws_send(c, 0xA, p, len);    // Pong
+        return -1;
+    }
+    if (opcode != 0x2 || len == 0) {
+        return -1;
+    }
+
+    switch (p[0]) {
+    case MSG_TELEMETRY:
+        st->telemetry_frames++;
+        st->telemetry_bytes += len;
+        return -1;
+    case MSG_TOPICS:
+        st->topics = len > 1 ? p[1] : 0;
+        return -1;
+    case MSG_PWM_ACK:
+        if (pwm && len >= 4) {
+            uint32_t seq = p[1] | p[2] << 8;
+            // Sequence numbers are 16 bit, replies come back in order
+            if (seq != (next_reply & 0xFFFF) || p[3] != next_reply % 101) {
+                st->mismatched++;
+            }
+            return next_reply;
+        }
+        return -1;
+    case MSG_PONG:
+        if (!pwm && len >= 5) {
+            uint32_t token;
+            memcpy(&token, &p[1], 4);
+            if (token != next_reply) {
+                st->mismatched++;
+            }
+            return next_reply;
+        }
+        return -1;
+    default:
+        return -1;
+    }
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv)
+{
+    client_t conn;
+    ws_stats_t st = {0};
+    uint8_t payload[512];
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <host[:port]> [seconds] [pwm|ping] [window]\n", argv[0]);
+        return 2;
+    }
+    double seconds = argc > 2 ? atof(argv[2]) : 10.0;
+    bool pwm = argc <= 3 || strcmp(argv[3], "ping") != 0;
+    int window = argc > 4 ? atoi(argv[4]) : 1;
+    if (seconds <= 0 || window < 1 || window > MAX_WINDOW) {
+        fprintf(stderr, "seconds must be > 0 and window 1-%d\n", MAX_WINDOW);
+        return 2;
+    }
+
+    srand((unsigned)time(NULL));
+    client_init(&conn, argv[1]);
+    if (!client_connect(&conn, 5) || !ws_handshake(&conn)) {
+        fprintf(stderr, "no WebSocket at %s:%s/ws\n", conn.host, conn.port);
+        return 1;
+    }
+
+    uint32_t next_request = 0;
+    uint32_t next_reply = 0;
+    double start = client_seconds();
+    bool ok = true;
+
+    while (ok) {
+        bool sending = client_seconds() - start < seconds;
+
+        while (sending && next_request - next_reply < (uint32_t)window) {
+            ok = send_request(&conn, pwm, next_request++);
+            st.sent++;
+        }
+        if (!sending && next_reply == next_request) {
+            break;
+        }
+
+        uint8_t opcode;
+        size_t len;
+        if (!ok || !ws_read(&conn, &opcode, payload, sizeof(payload), &len) || opcode == 0x8) {
+            ok = false;
+            break;
+        }
+        if (handle_frame(&conn, &st, pwm, next_reply, opcode, payload, len) >= 0) {
+            if (num_rtts < MAX_RTTS) {
+                rtts[num_rtts++] = client_seconds() - sent_at[next_reply % MAX_WINDOW];
+            }
+            st.replies++;
+            next_reply++;
+        }
+    }
+    double elapsed = client_seconds() - start;
+    client_close(&conn);
+
+    printf("%s, window %d, %.1f s%s\n", pwm ? "pwm" : "ping", window, elapsed, ok ? "" : ", connection lost");
+    printf("  %llu sent, %llu replies (%.0f msgs/s), %llu out of order or wrong\n", (unsigned long long)st.sent,
+           (unsigned long long)st.replies, st.replies / elapsed, (unsigned long long)st.mismatched);
+    if (num_rtts > 0) {
+        qsort(rtts, num_rtts, sizeof(double), compare_double);
+        printf("  round trip: p50 %.2f ms, p99 %.2f ms, max %.2f ms\n", rtts[num_rtts / 2] * 1e3,
+               rtts[num_rtts * 99 / 100] * 1e3, rtts[num_rtts - 1] * 1e3);
+    }
+    printf("  telemetry: %d topics, %llu frames (%.1f/s), %.0f bytes/s\n", st.topics,
+           (unsigned long long)st.telemetry_frames, st.telemetry_frames / elapsed, st.telemetry_bytes / elapsed);
+
+    return ok && st.replies > 0 && st.mismatched == 0 ? 0 : 1;
+}
@@ -0,0 +1,55 @@
+/**
+ * @file host_test.h
+ * @author David Ramírez Betancourth
+ * @brief Minimal check macros and timing for the host tests
+ *
+ * A failed CHECK prints its location and the test keeps going, so one run
+ * reports every failure; HOST_TEST_END() turns the count into the exit code.
+ */
+
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+
+static int host_test_failures;
+
+#define CHECK(cond) do {                                                        \
+        if (!(cond)) {                                                          \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            host_test_failures++;                                               \
+        }                                                                       \
+    } while (0)
+
+#define CHECK_NEAR(a, b, tol) do {                                              \
+        double a_ = (a), b_ = (b);                                              \
+        if (!(fabs(a_ - b_) <= (tol))) {                                        \
+            fprintf(stderr, "%s:%d: CHECK_NEAR(%s, %s, %s) failed: %g vs %g\n", \
+                    __FILE__, __LINE__, #a, #b, #tol, a_, b_);                  \
+            host_test_failures++;                                               \
+        }                                                                       \
+    } while (0)
+
+#define HOST_TEST_END() do {                                                    \
+        if (host_test_failures) {                                               \
+            fprintf(stderr, "%d check(s) failed\n", host_test_failures);        \
+            return 1;                                                           \
+        }                                                                       \
+        printf("ok\n");                                                         \
+        return 0;                                                               \
+    } while (0)
+
+// Wall clock for benchmarks, independent of the esp_timer stand-in
+static inline double host_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// Keeps a benchmark result alive without printing it
+static volatile double host_sink;
+
+#endif // HOST_TEST_H
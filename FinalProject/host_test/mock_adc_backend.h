@@ -0,0 +1,96 @@
+/**
+ * @file mock_adc_backend.h
+ * @author David Ramírez Betancourth
+ * @brief Scripted adc_stream backend shared by the acquisition host tests
+ *
+ * Tests push conversions with mock_push() and pump them through
+ * adc_stream_poll(), standing in for the acquisition task the host cannot
+ * create.
+ */
+
+#ifndef MOCK_ADC_BACKEND_H
+#define MOCK_ADC_BACKEND_H
+
+#include "adc_stream.h"
+
+#include <string.h>
+
+#define MOCK_MAX_SAMPLES 8192
+
+// Scripted conversions, handed out in reads of at most max_samples
+typedef struct {
+    adc_stream_sample_t samples[MOCK_MAX_SAMPLES];
+    size_t count;
+    size_t pos;
+    uint32_t lost;
+    bool started;
+    adc_stream_hw_config_t hw;
+} mock_backend_t;
+
+static mock_backend_t mock;
+
+static esp_err_t mock_start(void *ctx, const adc_stream_hw_config_t *hw)
+{
+    mock_backend_t *m = ctx;
+    m->hw = *hw;
+    m->started = true;
+    return ESP_OK;
+}
+
+static esp_err_t mock_stop(void *ctx)
+{
+    mock_backend_t *m = ctx;
+    m->started = false;
+    return ESP_OK;
+}
+
+static esp_err_t mock_read(void *ctx, adc_stream_sample_t *out, size_t max_samples, size_t *out_count,
+                           uint32_t timeout_ms)
+{
+    mock_backend_t *m = ctx;
+    size_t n = m->count - m->pos;
+
+    (void)timeout_ms;
+    if (n == 0) {
+        *out_count = 0;
+        return ESP_ERR_TIMEOUT;
+    }
+    if (n > max_samples) {
+        n = max_samples;
+    }
+    memcpy(out, &m->samples[m->pos], n * sizeof(*out));
+    m->pos += n;
+    *out_count = n;
+    return ESP_OK;
+}
+
+static uint32_t mock_take_lost(void *ctx)
+{
+    mock_backend_t *m = ctx;
+    uint32_t lost = m->lost;
+    m->lost = 0;
+    return lost;
+}
+
+static const adc_stream_backend_t mock_backend = {
+    .start = mock_start,
+    .stop = mock_stop,
+    .read = mock_read,
+    .take_lost = mock_take_lost,
+    .ctx = &mock,
+};
+
+static void mock_push(uint8_t channel, uint16_t raw)
+{
+    if (mock.count < MOCK_MAX_SAMPLES) {
+        mock.samples[mock.count++] = (adc_stream_sample_t) {.channel = channel, .raw = raw};
+    }
+}
+
+static void pump(void)
+{
+    while (adc_stream_poll(0) > 0) {
+    }
+}
+
+#endif // MOCK_ADC_BACKEND_H
@@ -0,0 +1,19 @@
+// Host stand-in for the ESP-IDF header of the same name
+#ifndef ADC_CALI_H
+#define ADC_CALI_H
+
+#include "esp_err.h"
+
+typedef struct host_adc_cali *adc_cali_handle_t;
+
+esp_err_t adc_cali_raw_to_voltage(adc_cali_handle_t handle, int raw, int *voltage);
+
+/**
+ * Host only: curve every scheme converts with. The default imitates the
+ * ESP32 line-fitting scheme at 12 dB: a line up to code 2880, a lookup
+ * table blended in above it.
+ */
+void host_adc_cali_set_curve(int (*curve)(int raw));
+int host_adc_cali_esp32_curve(int raw);
+
+#endif // ADC_CALI_H
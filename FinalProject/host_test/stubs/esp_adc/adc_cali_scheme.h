@@ -0,0 +1,20 @@
+// Host stand-in for the ESP-IDF header of the same name
+#ifndef ADC_CALI_SCHEME_H
+#define ADC_CALI_SCHEME_H
+
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_oneshot.h"
+
+typedef struct {
+    adc_unit_t unit_id;
+    adc_atten_t atten;
+    adc_bitwidth_t bitwidth;
+} adc_cali_line_fitting_config_t;
+
+esp_err_t adc_cali_create_scheme_line_fitting(const adc_cali_line_fitting_config_t *config, adc_cali_handle_t *out);
+esp_err_t adc_cali_delete_scheme_line_fitting(adc_cali_handle_t handle);
+
+/** Host only: live line-fitting schemes for one unit and attenuation. */
+int host_adc_cali_alive(adc_unit_t unit, adc_atten_t atten);
+
+#endif // ADC_CALI_SCHEME_H
@@ -0,0 +1,55 @@
+// Host stand-in for the ESP-IDF header of the same name
+#ifndef ADC_ONESHOT_H
+#define ADC_ONESHOT_H
+
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "soc/soc_caps.h"
+
+typedef enum {
+    ADC_UNIT_1,
+    ADC_UNIT_2,
+} adc_unit_t;
+
+typedef enum {
+    ADC_CHANNEL_0, ADC_CHANNEL_1, ADC_CHANNEL_2, ADC_CHANNEL_3, ADC_CHANNEL_4,
+    ADC_CHANNEL_5, ADC_CHANNEL_6, ADC_CHANNEL_7, ADC_CHANNEL_8, ADC_CHANNEL_9,
+} adc_channel_t;
+
+typedef enum {
+    ADC_ATTEN_DB_0,
+    ADC_ATTEN_DB_2_5,
+    ADC_ATTEN_DB_6,
+    ADC_ATTEN_DB_12,
+} adc_atten_t;
+
+typedef enum {
+    ADC_BITWIDTH_DEFAULT = 0,
+    ADC_BITWIDTH_12 = 12,
+} adc_bitwidth_t;
+
+typedef struct host_adc_unit *adc_oneshot_unit_handle_t;
+
+typedef struct {
+    adc_unit_t unit_id;
+} adc_oneshot_unit_init_cfg_t;
+
+typedef struct {
+    adc_atten_t atten;
+    adc_bitwidth_t bitwidth;
+} adc_oneshot_chan_cfg_t;
+
+esp_err_t adc_oneshot_new_unit(const adc_oneshot_unit_init_cfg_t *config, adc_oneshot_unit_handle_t *out);
+esp_err_t adc_oneshot_del_unit(adc_oneshot_unit_handle_t handle);
+esp_err_t adc_oneshot_config_channel(adc_oneshot_unit_handle_t handle, adc_channel_t channel,
+                                     const adc_oneshot_chan_cfg_t *config);
+esp_err_t adc_oneshot_read(adc_oneshot_unit_handle_t handle, adc_channel_t channel, int *out_raw);
+
+/**
+ * Host only: live units of one ADC. Like the driver, a unit cannot be
+ * created twice (ESP_ERR_NOT_FOUND) until it is deleted.
+ */
+int host_adc_units_alive(adc_unit_t unit);
+
+#endif // ADC_ONESHOT_H
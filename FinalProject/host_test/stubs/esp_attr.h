@@ -0,0 +1,8 @@
+// Host stand-in for the ESP-IDF header of the same name
+#ifndef ESP_ATTR_H
+#define ESP_ATTR_H
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+#endif // ESP_ATTR_H
@@ -0,0 +1,37 @@
+// Host stand-in for the ESP-IDF header of the same name
+#ifndef ESP_TIMER_H
+#define ESP_TIMER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+typedef struct esp_timer *esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void *arg);
+
+typedef enum {
+    ESP_TIMER_TASK,
+} esp_timer_dispatch_t;
+
+typedef struct {
+    esp_timer_cb_t callback;
+    void *arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char *name;
+    bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+/**
+ * Monotonic time in us. Tests can freeze it with host_time_set() and move
+ * it with host_time_advance(); host_time_set(-1) returns to the real clock.
+ */
+int64_t esp_timer_get_time(void);
+void host_time_set(int64_t now_us);
+void host_time_advance(int64_t delta_us);
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out);
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us);
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+
+#endif // ESP_TIMER_H
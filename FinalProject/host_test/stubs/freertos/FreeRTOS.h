@@ -0,0 +1,43 @@
+// Host stand-in for the FreeRTOS header of the same name
+//
+// Every critical section takes one process-wide recursive mutex, the host
+// equivalent of masking interrupts on both cores.
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sdkconfig.h"
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE              1
+#define pdFALSE             0
+#define pdPASS              1
+#define pdFAIL              0
+#define portMAX_DELAY       0xFFFFFFFFu
+#define portTICK_PERIOD_MS  1
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
+
+typedef struct {
+    int unused;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED    {0}
+#define portMUX_INITIALIZE(mux)         ((void)(mux))
+
+void host_critical_enter(void);
+void host_critical_exit(void);
+
+#define taskENTER_CRITICAL(mux)         ((void)(mux), host_critical_enter())
+#define taskEXIT_CRITICAL(mux)          ((void)(mux), host_critical_exit())
+#define portENTER_CRITICAL(mux)         taskENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL(mux)          taskEXIT_CRITICAL(mux)
+#define portENTER_CRITICAL_ISR(mux)     taskENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL_ISR(mux)      taskEXIT_CRITICAL(mux)
+
+#endif // FREERTOS_H
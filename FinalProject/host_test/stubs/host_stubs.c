@@ -0,0 +1,339 @@
+// Host implementations behind the stand-in ESP-IDF and FreeRTOS headers
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "esp_adc/adc_cali_scheme.h"
+#include "esp_adc/adc_continuous.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+//-----------------------------------Critical sections------------------------------
+
+static pthread_mutex_t critical_mutex;
+static pthread_once_t critical_once = PTHREAD_ONCE_INIT;
+
+static void critical_init(void)
+{
+    pthread_mutexattr_t attr;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&critical_mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+void host_critical_enter(void)
+{
+    pthread_once(&critical_once, critical_init);
+    pthread_mutex_lock(&critical_mutex);
+}
+
+void host_critical_exit(void)
+{
+    pthread_mutex_unlock(&critical_mutex);
+}
+
+//-----------------------------------Semaphores-------------------------------------
+
+struct host_mutex {
+    pthread_mutex_t mutex;
+};
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    SemaphoreHandle_t sem = malloc(sizeof(*sem));
+
+    if (sem) {
+        pthread_mutex_init(&sem->mutex, NULL);
+    }
+    return sem;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    (void)ticks;
+    return pthread_mutex_lock(&sem->mutex) == 0 ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    return pthread_mutex_unlock(&sem->mutex) == 0 ? pdTRUE : pdFALSE;
+}
+
+//-----------------------------------Tasks------------------------------------------
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *out, BaseType_t core)
+{
+    (void)fn, (void)name, (void)stack, (void)arg, (void)priority, (void)core;
+    if (out) {
+        *out = NULL;
+    }
+    return pdFAIL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                       UBaseType_t priority, TaskHandle_t *out)
+{
+    return xTaskCreatePinnedToCore(fn, name, stack, arg, priority, out, 0);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    (void)task;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    struct timespec ts = {ticks / 1000, (long)(ticks % 1000) * 1000000L};
+    nanosleep(&ts, NULL);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+    (void)clear, (void)ticks;
+    return 0;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    (void)task;
+    return pdPASS;
+}
+
+//-----------------------------------Timer------------------------------------------
+
+static int64_t fixed_time_us = -1;
+
+int64_t esp_timer_get_time(void)
+{
+    struct timespec ts;
+
+    if (fixed_time_us >= 0) {
+        return fixed_time_us;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void host_time_set(int64_t now_us)
+{
+    fixed_time_us = now_us;
+}
+
+void host_time_advance(int64_t delta_us)
+{
+    if (fixed_time_us >= 0) {
+        fixed_time_us += delta_us;
+    }
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out)
+{
+    (void)args;
+    *out = (esp_timer_handle_t)1;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    (void)timer, (void)timeout_us;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    (void)timer;
+    return ESP_OK;
+}
+
+//-----------------------------------Partitions-------------------------------------
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label)
+{
+    (void)type, (void)subtype, (void)label;
+    return NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *part, size_t offset, void *dst, size_t size)
+{
+    (void)part, (void)offset, (void)dst, (void)size;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *part, size_t offset, const void *src, size_t size)
+{
+    (void)part, (void)offset, (void)src, (void)size;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *part, size_t offset, size_t size)
+{
+    (void)part, (void)offset, (void)size;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+//-----------------------------------ADC oneshot and calibration--------------------
+
+struct host_adc_unit {
+    adc_unit_t unit;
+};
+
+struct host_adc_cali {
+    adc_unit_t unit;
+    adc_atten_t atten;
+};
+
+static int (*cali_curve)(int raw) = host_adc_cali_esp32_curve;
+static int units_alive[ADC_UNIT_2 + 1];
+static int cali_alive[ADC_UNIT_2 + 1][SOC_ADC_ATTEN_NUM];
+
+int host_adc_cali_esp32_curve(int raw)
+{
+    // Line-fitting part: coefficient A in 1/65536 mV per code, B in mV
+    int mv = (int)(((int64_t)raw * 53293 + 32768) / 65536) + 142;
+
+    // The LUT pulls the top of the range below the line
+    if (raw > 2880) {
+        mv -= (raw - 2880) * (raw - 2880) / 4000;
+    }
+    return mv;
+}
+
+void host_adc_cali_set_curve(int (*curve)(int raw))
+{
+    cali_curve = curve ? curve : host_adc_cali_esp32_curve;
+}
+
+int host_adc_units_alive(adc_unit_t unit)
+{
+    return units_alive[unit];
+}
+
+int host_adc_cali_alive(adc_unit_t unit, adc_atten_t atten)
+{
+    return cali_alive[unit][atten];
+}
+
+esp_err_t adc_oneshot_new_unit(const adc_oneshot_unit_init_cfg_t *config, adc_oneshot_unit_handle_t *out)
+{
+    if (units_alive[config->unit_id] > 0) {
+        return ESP_ERR_NOT_FOUND;   // Already claimed
+    }
+    *out = malloc(sizeof(**out));
+    if (!*out) {
+        return ESP_ERR_NO_MEM;
+    }
+    (*out)->unit = config->unit_id;
+    units_alive[config->unit_id]++;
+    return ESP_OK;
+}
+
+esp_err_t adc_oneshot_del_unit(adc_oneshot_unit_handle_t handle)
+{
+    if (!handle) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    units_alive[handle->unit]--;
+    free(handle);
+    return ESP_OK;
+}
+
+esp_err_t adc_oneshot_config_channel(adc_oneshot_unit_handle_t handle, adc_channel_t channel,
+                                     const adc_oneshot_chan_cfg_t *config)
+{
+    (void)handle, (void)channel, (void)config;
+    return ESP_OK;
+}
+
+esp_err_t adc_oneshot_read(adc_oneshot_unit_handle_t handle, adc_channel_t channel, int *out_raw)
+{
+    (void)handle;
+    *out_raw = (int)channel * 400;
+    return ESP_OK;
+}
+
+esp_err_t adc_cali_create_scheme_line_fitting(const adc_cali_line_fitting_config_t *config, adc_cali_handle_t *out)
+{
+    *out = malloc(sizeof(**out));
+    if (!*out) {
+        return ESP_ERR_NO_MEM;
+    }
+    (*out)->unit = config->unit_id;
+    (*out)->atten = config->atten;
+    cali_alive[config->unit_id][config->atten]++;
+    return ESP_OK;
+}
+
+esp_err_t adc_cali_delete_scheme_line_fitting(adc_cali_handle_t handle)
+{
+    if (!handle) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    cali_alive[handle->unit][handle->atten]--;
+    free(handle);
+    return ESP_OK;
+}
+
+esp_err_t adc_cali_raw_to_voltage(adc_cali_handle_t handle, int raw, int *voltage)
+{
+    if (!handle || raw < 0 || raw > 4095) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *voltage = cali_curve(raw);
+    return ESP_OK;
+}
+
+//-----------------------------------ADC continuous---------------------------------
+
+esp_err_t adc_continuous_new_handle(const adc_continuous_handle_cfg_t *config, adc_continuous_handle_t *out)
+{
+    (void)config, (void)out;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t adc_continuous_config(adc_continuous_handle_t handle, const adc_continuous_config_t *config)
+{
+    (void)handle, (void)config;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t adc_continuous_register_event_callbacks(adc_continuous_handle_t handle, const adc_continuous_evt_cbs_t *cbs,
+                                                  void *user_data)
+{
+    (void)handle, (void)cbs, (void)user_data;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t adc_continuous_start(adc_continuous_handle_t handle)
+{
+    (void)handle;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t adc_continuous_stop(adc_continuous_handle_t handle)
+{
+    (void)handle;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t adc_continuous_read(adc_continuous_handle_t handle, uint8_t *buf, uint32_t length_max,
+                              uint32_t *out_length, uint32_t timeout_ms)
+{
+    (void)handle, (void)buf, (void)length_max, (void)timeout_ms;
+    *out_length = 0;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t adc_continuous_deinit(adc_continuous_handle_t handle)
+{
+    (void)handle;
+    return ESP_ERR_NOT_SUPPORTED;
+}
@@ -0,0 +1,9 @@
+// Host build configuration, the subset of sdkconfig the sources look at
+#ifndef SDKCONFIG_H
+#define SDKCONFIG_H
+
+#define CONFIG_IDF_TARGET_ESP32                 1
+#define CONFIG_ADC_CONTINUOUS_ISR_IRAM_SAFE     1
+#define CONFIG_HTTPD_WS_SUPPORT                 1
+
+#endif // SDKCONFIG_H
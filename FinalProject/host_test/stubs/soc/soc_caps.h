@@ -0,0 +1,16 @@
+// Host stand-in for the ESP-IDF header of the same name, ESP32 values
+#ifndef SOC_CAPS_H
+#define SOC_CAPS_H
+
+#include "sdkconfig.h"
+
+#define SOC_ADC_MAX_CHANNEL_NUM         10
+#define SOC_ADC_PATT_LEN_MAX            16
+#define SOC_ADC_ATTEN_NUM               4
+#define SOC_ADC_RTC_MAX_BITWIDTH        12
+#define SOC_ADC_DIGI_MAX_BITWIDTH       12
+#define SOC_ADC_DIGI_RESULT_BYTES       2
+#define SOC_ADC_SAMPLE_FREQ_THRES_HIGH  (2 * 1000 * 1000)
+#define SOC_ADC_SAMPLE_FREQ_THRES_LOW   (20 * 1000)
+
+#endif // SOC_CAPS_H
@@ -0,0 +1,237 @@
+/**
+ * @file test_acq_service.c
+ * @author David Ramírez Betancourth
+ * @brief acq_service over the mock adc_stream backend: several clients per
+ * channel at different rates, stride averaging, block timestamps and the
+ * hold/wait instrumentation
+ */
+
+#include "acq_service.h"
+#include "host_test.h"
+#include "mock_adc_backend.h"
+
+#include "esp_timer.h"
+
+#define SCAN_RATE_HZ  1280
+#define SCAN_PERIOD_US (1000000 / SCAN_RATE_HZ)
+#define SCAN_BLOCK    16                // Shortest client span, see the clients below
+#define PHASE_LEN     2048              // Scan samples per channel and test phase
+#define CHUNK         256               // Scan samples per mock refill
+#define T0_US         ((int64_t)1000000000)
+
+// ch3 at 1280/320 Hz, ch6 at 640/20 Hz
+static const adc_config_t ch3 = {.unit_id = ADC_UNIT_1, .channel = ADC_CHANNEL_3, .atten = ADC_ATTEN_DB_12, .bitwidth = ADC_BITWIDTH_12};
+static const adc_config_t ch6 = {.unit_id = ADC_UNIT_1, .channel = ADC_CHANNEL_6, .atten = ADC_ATTEN_DB_12, .bitwidth = ADC_BITWIDTH_12};
+
+typedef struct {
+    const char *name;
+    const adc_config_t *channel;
+    uint32_t rate_hz;
+    size_t block_len;
+    int64_t hold_us;        // Time the callback takes in the second phase
+    // Observed
+    size_t blocks;
+    size_t bad_values;
+    size_t bad_timestamps;
+    uint32_t waits;
+    int64_t wait_min, wait_max, wait_sum;
+} client_t;
+
+static client_t clients[ACQ_SERVICE_MAX_CLIENTS] = {
+    {"fast", &ch3, 1280, 64, 3},
+    {"slow", &ch3, 320, 4, 5},
+    {"mid", &ch6, 640, 16, 7},
+    {"display", &ch6, 20, 2, 11},
+};
+
+static bool timed_phase;            // Callbacks take hold_us
+static int64_t last_dispatch_scan;  // Scan block of the previous callback, all clients
+static size_t out_of_order;
+
+// Scan sample i of a channel, every conversion of its decimation group alike
+static uint16_t input(adc_channel_t channel, size_t i)
+{
+    return channel == ADC_CHANNEL_3 ? (uint16_t)((i * 7) % 4096) : (uint16_t)(4095 - (i * 3) % 4096);
+}
+
+static void on_block(adc_channel_t channel, const uint16_t *raw, size_t count, int64_t timestamp_us, void *user_ctx)
+{
+    client_t *c = user_ctx;
+    int64_t now = esp_timer_get_time();
+    size_t stride = SCAN_RATE_HZ / c->rate_hz;
+    size_t first = c->blocks * c->block_len * stride;   // First scan sample of the block
+    size_t last = first + count * stride - 1;
+
+    CHECK(channel == c->channel->channel);
+    CHECK(count == c->block_len);
+
+    // Each delivered sample is its stride group's mean, rounded half up
+    for (size_t k = 0; k < count; k++) {
+        uint32_t sum = 0;
+        for (size_t i = 0; i < stride; i++) {
+            sum += input(channel, first + k * stride + i);
+        }
+        if (raw[k] != (sum + stride / 2) / stride) {
+            c->bad_values++;
+        }
+    }
+
+    // With the clock frozen the newest sample is dated back from the end
+    // of its scan block by one scan period per younger sample
+    if (!timed_phase && timestamp_us != T0_US - (int64_t)(SCAN_BLOCK - 1 - last % SCAN_BLOCK) * SCAN_PERIOD_US) {
+        c->bad_timestamps++;
+    }
+
+    // Callbacks follow the scan
+    if ((int64_t)(last / SCAN_BLOCK) < last_dispatch_scan) {
+        out_of_order++;
+    }
+    last_dispatch_scan = (int64_t)(last / SCAN_BLOCK);
+
+    int64_t wait = now - timestamp_us;
+    c->wait_min = c->waits == 0 || wait < c->wait_min ? wait : c->wait_min;
+    c->wait_max = c->waits == 0 || wait > c->wait_max ? wait : c->wait_max;
+    c->wait_sum += wait;
+    c->waits++;
+
+    c->blocks++;
+    if (timed_phase) {
+        host_time_advance(c->hold_us);
+    }
+}
+
+// One phase of PHASE_LEN scan samples on both channels, in mock refills
+static void run_phase(size_t start, uint32_t decimation)
+{
+    for (size_t base = start; base < start + PHASE_LEN; base += CHUNK) {
+        mock.count = 0;
+        mock.pos = 0;
+        for (size_t i = base; i < base + CHUNK; i++) {
+            for (uint32_t d = 0; d < decimation; d++) {
+                mock_push(ADC_CHANNEL_3, input(ADC_CHANNEL_3, i));
+                mock_push(ADC_CHANNEL_6, input(ADC_CHANNEL_6, i));
+            }
+        }
+        CHECK(mock.count == CHUNK * decimation * 2);
+        pump();
+    }
+}
+
+static void test_register(void)
+{
+    adc_config_t adc2 = ch3;
+    acq_client_config_t conf = {.channel = &ch3, .rate_hz = 100, .block_len = 8, .on_block = on_block};
+    int id;
+
+    adc2.unit_id = ADC_UNIT_2;
+
+    CHECK(acq_service_register(NULL, &id) == ESP_ERR_INVALID_ARG);
+    conf.channel = &adc2;
+    CHECK(acq_service_register(&conf, &id) == ESP_ERR_INVALID_ARG);
+    conf.channel = &ch3;
+    conf.block_len = 0;
+    CHECK(acq_service_register(&conf, &id) == ESP_ERR_INVALID_ARG);
+    conf.block_len = ADC_STREAM_MAX_BLOCK_LEN + 1;
+    CHECK(acq_service_register(&conf, &id) == ESP_ERR_INVALID_ARG);
+    conf.block_len = 8;
+    conf.rate_hz = ADC_STREAM_MAX_RATE_HZ + 1;
+    CHECK(acq_service_register(&conf, &id) == ESP_ERR_INVALID_ARG);
+    conf.rate_hz = 100;
+    conf.on_block = NULL;
+    CHECK(acq_service_register(&conf, &id) == ESP_ERR_INVALID_ARG);
+    CHECK(acq_service_client_count() == 0);
+    CHECK(acq_service_start(&mock_backend) == ESP_ERR_INVALID_ARG);
+    CHECK(acq_service_stop() == ESP_ERR_INVALID_STATE);
+
+    for (int c = 0; c < ACQ_SERVICE_MAX_CLIENTS; c++) {
+        acq_client_config_t client = {
+            .channel = clients[c].channel,
+            .rate_hz = clients[c].rate_hz,
+            .block_len = clients[c].block_len,
+            .on_block = on_block,
+            .user_ctx = &clients[c],
+            .name = clients[c].name,
+        };
+        CHECK(acq_service_register(&client, &id) == ESP_OK);
+        CHECK(id == c);
+    }
+    conf.on_block = on_block;
+    CHECK(acq_service_register(&conf, &id) == ESP_ERR_NO_MEM);
+    CHECK(acq_service_client_count() == ACQ_SERVICE_MAX_CLIENTS);
+    CHECK(acq_service_client_stats(-1) == NULL);
+    CHECK(acq_service_client_stats(ACQ_SERVICE_MAX_CLIENTS) == NULL);
+}
+
+static void test_dispatch(void)
+{
+    adc_stream_stats_t stream;
+
+    // The acquisition task cannot be created on the host: the scan is set up
+    // and then pumped by hand
+    memset(&mock, 0, sizeof(mock));
+    CHECK(acq_service_start(&mock_backend) == ESP_ERR_NO_MEM);
+    CHECK(mock.hw.num_channels == 2);
+    adc_stream_get_stats(&stream);
+    CHECK(stream.hw_rate_hz == 2 * SCAN_RATE_HZ * stream.decimation);
+
+    for (int c = 0; c < ACQ_SERVICE_MAX_CLIENTS; c++) {
+        acq_client_stats_t *stats = acq_service_client_stats(c);
+        CHECK(stats->rate_hz == clients[c].rate_hz);
+        CHECK(stats->stride == SCAN_RATE_HZ / clients[c].rate_hz);
+        CHECK(strcmp(stats->name, clients[c].name) == 0);
+    }
+
+    // Frozen clock: exact timestamps, callbacks take no time
+    host_time_set(T0_US);
+    last_dispatch_scan = -1;
+    timed_phase = false;
+    run_phase(0, stream.decimation);
+
+    // Each callback now takes hold_us, which later callbacks of the same
+    // scan block see as wait
+    timed_phase = true;
+    run_phase(PHASE_LEN, stream.decimation);
+    host_time_set(-1);
+
+    CHECK(out_of_order == 0);
+    for (int c = 0; c < ACQ_SERVICE_MAX_CLIENTS; c++) {
+        client_t *cl = &clients[c];
+        acq_client_stats_t *stats = acq_service_client_stats(c);
+        size_t span = cl->block_len * stats->stride;
+        timing_summary_t hold;
+        timing_summary_t wait;
+
+        timing_stats_summary(&stats->hold, &hold);
+        timing_stats_summary(&stats->wait, &wait);
+        printf("%-8s %4lu Hz stride %2lu: %4zu blocks, hold %lld..%lld us, wait %lld..%lld us (mean %lld)\n",
+               cl->name, (unsigned long)stats->rate_hz, (unsigned long)stats->stride, cl->blocks,
+               (long long)hold.min_us, (long long)hold.max_us, (long long)wait.min_us, (long long)wait.max_us,
+               (long long)wait.mean_us);
+
+        CHECK(cl->blocks == 2 * PHASE_LEN / span);
+        CHECK(stats->blocks == cl->blocks);
+        CHECK(cl->bad_values == 0);
+        CHECK(cl->bad_timestamps == 0);
+
+        // hold: 0 with the frozen clock, exactly hold_us afterwards
+        CHECK(hold.count == cl->blocks);
+        CHECK(hold.min_us == 0 && hold.max_us == cl->hold_us);
+        CHECK(hold.mean_us == cl->hold_us * (int64_t)(cl->blocks / 2) / (int64_t)cl->blocks);
+
+        // wait: what the callback itself saw
+        CHECK(wait.count == cl->waits);
+        CHECK(wait.min_us == cl->wait_min && wait.max_us == cl->wait_max);
+        CHECK(wait.mean_us == cl->wait_sum / (int64_t)cl->waits);
+    }
+
+    // The slow ch3 client dispatches after the fast one on shared scan
+    // blocks, so it waits for it
+    CHECK(clients[1].wait_max >= clients[0].hold_us);
+}
+
+int main(void)
+{
+    test_register();
+    test_dispatch();
+    HOST_TEST_END();
+}
@@ -0,0 +1,199 @@
+/**
+ * @file test_adc_decimator.c
+ * @author David Ramírez Betancourth
+ * @brief Decimator gain, fractional bits and lag on clean and noisy ramps
+ *
+ * The noisy ramp is what the ADC delivers for a slow temperature drift:
+ * the true value plus about 1 LSB of white noise, quantized to whole
+ * codes. Its outputs are compared with the ramp at the centre of each
+ * group, which is where a boxcar's output belongs.
+ */
+
+#include "adc_decimator.h"
+#include "host_test.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define RAMP_LEN   (64 * 4096)
+#define NOISE_LSB  1.0
+
+static uint64_t rng_state = 0x2545F4914F6CDD1Du;
+
+static double uniform(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return ((rng_state >> 11) + 0.5) / 9007199254740992.0;
+}
+
+static double gaussian(void)
+{
+    return sqrt(-2.0 * log(uniform())) * cos(2.0 * M_PI * uniform());
+}
+
+static void test_init(void)
+{
+    adc_decimator_t dec;
+
+    CHECK(!adc_decimator_init(NULL, 2));
+    CHECK(!adc_decimator_init(&dec, ADC_DECIMATOR_MAX_RATIO_LOG2 + 1));
+    for (unsigned r = 0; r <= ADC_DECIMATOR_MAX_RATIO_LOG2; r++) {
+        CHECK(adc_decimator_init(&dec, r));
+        CHECK(adc_decimator_frac_bits(&dec) == r / 2);
+        CHECK(adc_decimator_enob_gain(&dec) == 0.5f * (float)r);
+    }
+}
+
+// A constant comes out as itself << frac_bits at every ratio, full scale included
+static void test_unity_gain(void)
+{
+    static int in[1 << ADC_DECIMATOR_MAX_RATIO_LOG2];
+    int32_t out[2];
+    adc_decimator_t dec;
+
+    for (unsigned r = 0; r <= ADC_DECIMATOR_MAX_RATIO_LOG2; r++) {
+        size_t len = (size_t)1 << r;
+        for (int code = 0; code <= 4095; code += 4095) {
+            for (size_t i = 0; i < len; i++) {
+                in[i] = code;
+            }
+            adc_decimator_init(&dec, r);
+            CHECK(adc_decimator_process(&dec, in, len, out) == 1);
+            CHECK(out[0] == (int32_t)code << adc_decimator_frac_bits(&dec));
+        }
+    }
+}
+
+// Outputs are the group mean rounded half to even at frac_bits, and the
+// result does not depend on how the input is split into blocks
+static void test_rounding_and_blocks(void)
+{
+    static int in[64 * 50];
+    static int32_t whole[64];
+    static int32_t split[64];
+    adc_decimator_t dec;
+
+    for (size_t i = 0; i < sizeof(in) / sizeof(in[0]); i++) {
+        in[i] = (int)((i * 2654435761u) >> 20) % 4096;
+    }
+
+    for (unsigned r = 1; r <= 6; r++) {
+        size_t ratio = (size_t)1 << r;
+        size_t len = ratio * 50;
+
+        adc_decimator_init(&dec, r);
+        unsigned frac = adc_decimator_frac_bits(&dec);
+        CHECK(adc_decimator_process(&dec, in, len, whole) == 50);
+        for (size_t k = 0; k < 50; k++) {
+            int64_t sum = 0;
+            for (size_t i = 0; i < ratio; i++) {
+                sum += in[k * ratio + i];
+            }
+            CHECK(whole[k] == (int32_t)nearbyint((double)sum / (double)(ratio >> frac)));
+        }
+
+        // Odd block sizes straddle the group boundaries
+        adc_decimator_init(&dec, r);
+        size_t produced = 0;
+        for (size_t pos = 0, step = 1; pos < len; pos += step, step = step % 13 + 1) {
+            size_t n = step < len - pos ? step : len - pos;
+            produced += adc_decimator_process(&dec, in + pos, n, split + produced);
+        }
+        CHECK(produced == 50);
+        CHECK(memcmp(whole, split, 50 * sizeof(int32_t)) == 0);
+    }
+}
+
+// A clean ramp: output k is the ramp at the middle of group k, i.e. the
+// stage delays the signal by (R - 1) / 2 input samples
+static void test_ramp_lag(void)
+{
+    static int in[64 * 32];
+    int32_t out[32];
+    adc_decimator_t dec;
+
+    for (size_t i = 0; i < 64 * 32; i++) {
+        in[i] = 100 + (int)i;
+    }
+    adc_decimator_init(&dec, 6);
+    CHECK(adc_decimator_process(&dec, in, 64 * 32, out) == 32);
+    for (size_t k = 0; k < 32; k++) {
+        double centre = 100 + k * 64.0 + (64 - 1) / 2.0;
+        CHECK_NEAR(out[k] / 8.0, centre, 0.5 / 8);
+    }
+}
+
+typedef struct {
+    double rms;         // RMS error against the ramp at the group centre, in LSB
+    double mean;        // Mean error, in LSB
+} ramp_error_t;
+
+// Slow ramp plus white noise, quantized to codes; frac_bits overrides the
+// decimator's own to compare with a plain integer mean
+static ramp_error_t noisy_ramp(unsigned ratio_log2, int frac_bits)
+{
+    static int in[RAMP_LEN];
+    static int32_t out[RAMP_LEN];
+    const double slope = 40.0 / RAMP_LEN;       // 40 codes over the whole run
+    const size_t ratio = (size_t)1 << ratio_log2;
+    adc_decimator_t dec;
+    ramp_error_t e = {0};
+
+    for (size_t i = 0; i < RAMP_LEN; i++) {
+        in[i] = (int)lrint(1000.0 + slope * (double)i + NOISE_LSB * gaussian());
+    }
+    adc_decimator_init(&dec, ratio_log2);
+    if (frac_bits >= 0) {
+        dec.frac_bits = (uint8_t)frac_bits;
+    }
+    size_t produced = adc_decimator_process(&dec, in, RAMP_LEN, out);
+    CHECK(produced == RAMP_LEN / ratio);
+
+    for (size_t k = 0; k < produced; k++) {
+        double centre = 1000.0 + slope * (k * (double)ratio + (ratio - 1) / 2.0);
+        double err = ldexp(out[k], -(int)dec.frac_bits) - centre;
+        e.rms += err * err;
+        e.mean += err;
+    }
+    e.rms = sqrt(e.rms / produced);
+    e.mean /= produced;
+    return e;
+}
+
+static void test_noisy_ramp(void)
+{
+    // No decimation: the noise plus code quantization
+    ramp_error_t raw = noisy_ramp(0, -1);
+    printf("1:1   rms %.3f LSB\n", raw.rms);
+
+    for (unsigned r = 2; r <= 8; r += 2) {
+        adc_decimator_t dec;
+        adc_decimator_init(&dec, r);
+
+        ramp_error_t e = noisy_ramp(r, -1);
+        ramp_error_t whole_codes = noisy_ramp(r, 0);
+        double gained = log2(raw.rms / e.rms);
+        printf("%3u:1 rms %.3f LSB (%.2f bits, expected %.1f), mean %+.4f; integer output rms %.3f LSB\n", 1u << r,
+               e.rms, gained, adc_decimator_enob_gain(&dec), e.mean, whole_codes.rms);
+
+        // Within a quarter bit of the white-noise figure, and unbiased
+        CHECK(fabs(gained - adc_decimator_enob_gain(&dec)) < 0.25);
+        CHECK(fabs(e.mean) < 0.02);
+        // The fractional bits are what carries the gain past one LSB
+        if (r >= 6) {
+            CHECK(whole_codes.rms > 2.0 * e.rms);
+        }
+    }
+}
+
+int main(void)
+{
+    test_init();
+    test_unity_gain();
+    test_rounding_and_blocks();
+    test_ramp_lag();
+    test_noisy_ramp();
+    HOST_TEST_END();
+}
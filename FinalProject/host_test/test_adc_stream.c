@@ -0,0 +1,147 @@
+/**
+ * @file test_adc_stream.c
+ * @author David Ramírez Betancourth
+ * @brief adc_stream driven by a mock backend: rate setup, averaging
+ * decimation, block delivery and counters
+ */
+
+#include "adc_stream.h"
+#include "host_test.h"
+#include "mock_adc_backend.h"
+
+#include <string.h>
+
+// Collected blocks
+static uint16_t got[2][1024];
+static size_t got_len[2];
+
+static void on_block(adc_channel_t channel, const uint16_t *raw, size_t count, void *user_ctx)
+{
+    int lane = (channel == ADC_CHANNEL_3) ? 0 : 1;
+
+    (void)user_ctx;
+    for (size_t i = 0; i < count && got_len[lane] < 1024; i++) {
+        got[lane][got_len[lane]++] = raw[i];
+    }
+}
+
+static const adc_config_t channels[2] = {
+    {.unit_id = ADC_UNIT_1, .channel = ADC_CHANNEL_3, .atten = ADC_ATTEN_DB_12, .bitwidth = ADC_BITWIDTH_12},
+    {.unit_id = ADC_UNIT_1, .channel = ADC_CHANNEL_6, .atten = ADC_ATTEN_DB_12, .bitwidth = ADC_BITWIDTH_12},
+};
+
+static void reset(void)
+{
+    memset(&mock, 0, sizeof(mock));
+    memset(got_len, 0, sizeof(got_len));
+}
+
+static void test_rejects_bad_config(void)
+{
+    adc_stream_config_t config = {
+        .channels = channels, .num_channels = 2, .sample_rate_hz = 100, .block_len = 16, .on_block = on_block,
+    };
+    adc_config_t dup[2] = {channels[0], channels[0]};
+    adc_config_t adc2 = channels[0];
+
+    adc2.unit_id = ADC_UNIT_2;
+
+    CHECK(adc_stream_init(&config, &mock_backend) == ESP_OK);
+
+    config.sample_rate_hz = 0;
+    CHECK(adc_stream_init(&config, &mock_backend) == ESP_ERR_INVALID_ARG);
+    config.sample_rate_hz = 100;
+
+    config.block_len = ADC_STREAM_MAX_BLOCK_LEN + 1;
+    CHECK(adc_stream_init(&config, &mock_backend) == ESP_ERR_INVALID_ARG);
+    config.block_len = 16;
+
+    config.channels = dup;
+    CHECK(adc_stream_init(&config, &mock_backend) == ESP_ERR_INVALID_ARG);
+
+    config.channels = &adc2;
+    config.num_channels = 1;
+    CHECK(adc_stream_init(&config, &mock_backend) == ESP_ERR_INVALID_ARG);
+}
+
+// Below the SoC minimum the hardware runs faster and every delivered sample
+// is the mean of its group, so a tone at the hardware Nyquist rate vanishes
+static void test_decimation_averages(void)
+{
+    adc_stream_config_t config = {
+        .channels = channels, .num_channels = 2, .sample_rate_hz = 1280, .block_len = 16, .on_block = on_block,
+    };
+    adc_stream_stats_t stats;
+
+    reset();
+    CHECK(adc_stream_init(&config, &mock_backend) == ESP_OK);
+    adc_stream_get_stats(&stats);
+
+    uint32_t decimation = stats.decimation;
+    CHECK(decimation == (SOC_ADC_SAMPLE_FREQ_THRES_LOW + 2560 - 1) / 2560);
+    CHECK(stats.hw_rate_hz == 2560 * decimation);
+
+    // The task cannot be created on the host, the backend is started and stopped again
+    CHECK(adc_stream_start() == ESP_ERR_NO_MEM);
+    CHECK(mock.hw.conv_rate_hz == stats.hw_rate_hz);
+    CHECK(mock.hw.num_channels == 2);
+    CHECK(!mock.started);
+
+    // Channel 3 alternates 1000 +- 800 every conversion, channel 6 ramps
+    for (uint32_t i = 0; i < 32 * decimation; i++) {
+        mock_push(ADC_CHANNEL_3, (i & 1) ? 1800 : 200);
+        mock_push(ADC_CHANNEL_6, (uint16_t)i);
+    }
+    pump();
+
+    CHECK(got_len[0] == 32);
+    CHECK(got_len[1] == 32);
+    for (size_t k = 0; k < got_len[0]; k++) {
+        CHECK(got[0][k] == 1000);
+    }
+    for (size_t k = 0; k < got_len[1]; k++) {
+        // Mean of k*d .. k*d + d - 1, rounded half up
+        uint32_t expected = (uint32_t)((k * decimation * 2 + decimation - 1 + 1) / 2);
+        CHECK(got[1][k] == expected);
+    }
+
+    adc_stream_get_stats(&stats);
+    CHECK(stats.blocks == 4);
+    CHECK(stats.samples[0] == 32);
+    CHECK(stats.samples[1] == 32);
+}
+
+static void test_counters(void)
+{
+    adc_stream_config_t config = {
+        .channels = channels, .num_channels = 1, .sample_rate_hz = 20000, .block_len = 8, .on_block = on_block,
+    };
+    adc_stream_stats_t stats;
+
+    reset();
+    CHECK(adc_stream_init(&config, &mock_backend) == ESP_OK);
+    adc_stream_get_stats(&stats);
+    CHECK(stats.decimation == 1);
+
+    for (int i = 0; i < 20; i++) {
+        mock_push(ADC_CHANNEL_3, (uint16_t)i);
+        mock_push(ADC_CHANNEL_0, 0);        // Not in the scan list
+    }
+    mock.lost = 128;
+    pump();
+
+    adc_stream_get_stats(&stats);
+    CHECK(got_len[0] == 16);                // Two full blocks, 4 samples still pending
+    CHECK(got[0][15] == 15);
+    CHECK(stats.unknown == 20);
+    CHECK(stats.lost == 128);
+    CHECK(stats.blocks == 2);
+}
+
+int main(void)
+{
+    test_rejects_bad_config();
+    test_decimation_averages();
+    test_counters();
+    HOST_TEST_END();
+}
@@ -0,0 +1,325 @@
+/**
+ * @file test_adc_utils.c
+ * @author David Ramírez Betancourth
+ * @brief raw_to_voltage_block() against the per-sample driver path over
+ * every code, on the ESP32-like curve and on a purely linear one; channel
+ * pool churn against a model of the shared units and calibration schemes;
+ * get_raw_data_multi() against per-channel reads
+ */
+
+#include "adc_utils.h"
+#include "host_test.h"
+
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
+#include "esp_timer.h"
+
+#define FULL_SCALE 4095
+#define POOL_SIZE  10               // MAX_ADC_CHANNELS in adc_utils.c
+#define CHURN_OPS  20000
+
+static const adc_config_t conf = {
+    .unit_id = ADC_UNIT_1, .channel = ADC_CHANNEL_3, .atten = ADC_ATTEN_DB_12, .bitwidth = ADC_BITWIDTH_12,
+};
+
+static int linear_curve(int raw)
+{
+    return (int)(((int64_t)raw * 50000 + 32768) / 65536) + 75;
+}
+
+// Returns the highest code the block path converted without the driver
+static int check_all_codes(adc_channel_handle_t handle)
+{
+    static int raw[FULL_SCALE + 1 + 3];
+    static int block[FULL_SCALE + 1 + 3];
+    int n = 0;
+
+    for (int code = 0; code <= FULL_SCALE; code++) {
+        raw[n++] = code;
+    }
+    // Out-of-range codes go to the driver, which rejects them
+    raw[n++] = -1;
+    raw[n++] = FULL_SCALE + 1;
+    raw[n++] = 100;
+
+    raw_to_voltage_block(handle, raw, block, (size_t)n);
+
+    int worst = 0;
+    for (int i = 0; i < n; i++) {
+        int single;
+        raw_to_voltage(handle, raw[i], &single);
+        int err = block[i] - single;
+        if (err < 0) {
+            err = -err;
+        }
+        if (err > worst) {
+            worst = err;
+        }
+    }
+    CHECK(worst <= 1);
+    CHECK(block[FULL_SCALE + 1] == -1);
+    CHECK(block[FULL_SCALE + 2] == -1);
+    return worst;
+}
+
+//-----------------------------------Churn-----------------------------------------
+
+// What set_adc()/adc_release() should have done: live handles, newest last
+typedef struct {
+    adc_channel_handle_t handle;
+    adc_config_t config;
+} live_t;
+
+static live_t live[POOL_SIZE];
+static size_t num_live;
+
+static uint32_t rng_state = 0x12345678u;
+
+static uint32_t rng(uint32_t n)
+{
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return (uint32_t)(((uint64_t)(rng_state >> 8) * n) >> 24);
+}
+
+// Units, schemes and per-unit lists match the model
+static void check_model(void)
+{
+    for (int unit = ADC_UNIT_1; unit <= ADC_UNIT_2; unit++) {
+        adc_channel_handle_t listed[POOL_SIZE + 1];
+        size_t expected = 0;
+        int per_atten[SOC_ADC_ATTEN_NUM] = {0};
+
+        size_t n = adc_unit_channels((adc_unit_t)unit, listed, POOL_SIZE + 1);
+        // Most recently configured first
+        for (size_t i = num_live; i-- > 0;) {
+            if (live[i].config.unit_id != (adc_unit_t)unit) {
+                continue;
+            }
+            per_atten[live[i].config.atten]++;
+            if (expected >= n || listed[expected] != live[i].handle) {
+                host_test_failures++;
+                fprintf(stderr, "unit %d: list entry %zu wrong\n", unit, expected);
+                return;
+            }
+            expected++;
+        }
+        CHECK(n == expected);
+
+        // One unit while any channel uses it, one scheme per used attenuation
+        CHECK(host_adc_units_alive((adc_unit_t)unit) == (expected > 0));
+        for (int atten = 0; atten < SOC_ADC_ATTEN_NUM; atten++) {
+            CHECK(host_adc_cali_alive((adc_unit_t)unit, (adc_atten_t)atten) == (per_atten[atten] > 0));
+        }
+    }
+}
+
+static void model_remove(size_t i)
+{
+    for (; i + 1 < num_live; i++) {
+        live[i] = live[i + 1];
+    }
+    num_live--;
+}
+
+// Random set/release over both units and every attenuation, through
+// repeated pool exhaustion
+static void test_churn(void)
+{
+    size_t exhausted = 0;
+
+    for (int op = 0; op < CHURN_OPS; op++) {
+        if (num_live == 0 || rng(100) < 55) {
+            adc_config_t config = {
+                .unit_id = (adc_unit_t)rng(2),
+                .channel = (adc_channel_t)rng(10),
+                .atten = (adc_atten_t)rng(SOC_ADC_ATTEN_NUM),
+                .bitwidth = ADC_BITWIDTH_12,
+            };
+            adc_channel_handle_t handle;
+
+            set_adc(&config, &handle);
+            if (num_live == POOL_SIZE) {
+                CHECK(handle == NULL);
+                exhausted++;
+            } else {
+                CHECK(handle != NULL);
+                if (handle) {
+                    live[num_live++] = (live_t) {handle, config};
+                }
+            }
+        } else {
+            size_t i = rng((uint32_t)num_live);
+            adc_channel_handle_t handle = live[i].handle;
+
+            adc_release(handle);
+            model_remove(i);
+            adc_release(handle);        // Released twice: nothing happens
+        }
+        check_model();
+    }
+
+    // Every live handle still reads and converts through its own unit and scheme
+    for (size_t i = 0; i < num_live; i++) {
+        int raw;
+        int mv;
+        get_raw_data(live[i].handle, &raw);
+        CHECK(raw == (int)live[i].config.channel * 400);
+        raw_to_voltage(live[i].handle, 1000, &mv);
+        CHECK(mv == host_adc_cali_esp32_curve(1000));
+    }
+
+    printf("churn: %d ops, pool full %zu times\n", CHURN_OPS, exhausted);
+    CHECK(exhausted > 0);
+
+    while (num_live > 0) {
+        adc_release(live[num_live - 1].handle);
+        num_live--;
+        check_model();
+    }
+}
+
+// Exhaustion does not leak unit or scheme references, and the pool recovers
+static void test_exhaustion(void)
+{
+    adc_channel_handle_t handles[POOL_SIZE];
+    adc_channel_handle_t extra;
+    adc_config_t config = conf;
+
+    for (int i = 0; i < POOL_SIZE; i++) {
+        config.channel = (adc_channel_t)i;
+        set_adc(&config, &handles[i]);
+        CHECK(handles[i] != NULL);
+    }
+    config.unit_id = ADC_UNIT_2;
+    set_adc(&config, &extra);
+    CHECK(extra == NULL);
+    CHECK(host_adc_units_alive(ADC_UNIT_2) == 0);
+    CHECK(host_adc_cali_alive(ADC_UNIT_2, config.atten) == 0);
+
+    // A freed slot is reused
+    adc_release(handles[4]);
+    set_adc(&config, &extra);
+    CHECK(extra == handles[4]);
+    CHECK(host_adc_units_alive(ADC_UNIT_2) == 1);
+    adc_release(extra);
+
+    for (int i = 0; i < POOL_SIZE; i++) {
+        adc_release(handles[i]);       // handles[4] is already free
+    }
+    CHECK(host_adc_units_alive(ADC_UNIT_1) == 0 && host_adc_units_alive(ADC_UNIT_2) == 0);
+    CHECK(host_adc_cali_alive(ADC_UNIT_1, conf.atten) == 0);
+
+    // Bad configurations take nothing
+    config = conf;
+    config.unit_id = (adc_unit_t)(ADC_UNIT_2 + 1);
+    set_adc(&config, &extra);
+    CHECK(extra == NULL);
+    config = conf;
+    config.atten = (adc_atten_t)SOC_ADC_ATTEN_NUM;
+    set_adc(&config, &extra);
+    CHECK(extra == NULL);
+    set_adc(NULL, &extra);
+    CHECK(extra == NULL);
+    CHECK(host_adc_units_alive(ADC_UNIT_1) == 0);
+}
+
+//-----------------------------------Multi-channel read----------------------------
+
+static void test_multi_read(void)
+{
+    adc_channel_handle_t handles[4];
+    adc_channel_handle_t listed[4];
+    adc_channel_handle_t other_unit;
+    adc_config_t config = conf;
+    int raw[4];
+    int64_t ts[4];
+
+    for (int i = 0; i < 4; i++) {
+        config.channel = (adc_channel_t)(2 * i + 1);
+        set_adc(&config, &handles[i]);
+    }
+    config.unit_id = ADC_UNIT_2;
+    set_adc(&config, &other_unit);
+
+    // Every configured channel of the unit, stamped in order inside the burst
+    size_t n = adc_unit_channels(ADC_UNIT_1, listed, 4);
+    CHECK(n == 4);
+    int64_t before = esp_timer_get_time();
+    CHECK(get_raw_data_multi(listed, n, raw, ts) == ESP_OK);
+    int64_t after = esp_timer_get_time();
+    for (size_t i = 0; i < n; i++) {
+        int single;
+        get_raw_data(listed[i], &single);
+        CHECK(raw[i] == single && single != -1);
+        CHECK(ts[i] >= before && ts[i] <= after);
+        CHECK(i == 0 || ts[i] >= ts[i - 1]);
+    }
+    CHECK(get_raw_data_multi(handles, 4, raw, NULL) == ESP_OK);
+    CHECK(raw[0] == 400 && raw[3] == 2800);
+
+    // Frozen clock: the stamps are the burst instant
+    host_time_set(5000);
+    CHECK(get_raw_data_multi(handles, 4, raw, ts) == ESP_OK);
+    CHECK(ts[0] == 5000 && ts[3] == 5000);
+    host_time_set(-1);
+
+    // Refused as a whole: mixed units, NULL or released handles
+    adc_channel_handle_t mixed[2] = {handles[0], other_unit};
+    CHECK(get_raw_data_multi(mixed, 2, raw, ts) == ESP_ERR_INVALID_ARG);
+    CHECK(raw[0] == -1 && raw[1] == -1);
+    mixed[1] = NULL;
+    CHECK(get_raw_data_multi(mixed, 2, raw, ts) == ESP_ERR_INVALID_ARG);
+    CHECK(get_raw_data_multi(handles, 0, raw, ts) == ESP_ERR_INVALID_ARG);
+    CHECK(get_raw_data_multi(NULL, 4, raw, ts) == ESP_ERR_INVALID_ARG);
+
+    // A unit owned by the continuous driver is not read in oneshot mode
+    adc_unit_set_streaming(ADC_UNIT_1, true);
+    CHECK(get_raw_data_multi(handles, 4, raw, ts) == ESP_ERR_INVALID_STATE);
+    CHECK(raw[0] == -1 && raw[3] == -1);
+    get_raw_data(handles[0], &raw[0]);
+    CHECK(raw[0] == -1);
+    get_raw_data(other_unit, &raw[0]);
+    CHECK(raw[0] == 7 * 400);
+    adc_unit_set_streaming(ADC_UNIT_1, false);
+    CHECK(get_raw_data_multi(handles, 4, raw, ts) == ESP_OK);
+
+    adc_release(handles[2]);
+    CHECK(get_raw_data_multi(handles, 4, raw, ts) == ESP_ERR_INVALID_ARG);
+
+    for (int i = 0; i < 4; i++) {
+        adc_release(handles[i]);
+    }
+    adc_release(other_unit);
+}
+
+int main(void)
+{
+    adc_channel_handle_t handle;
+    int out[4];
+    int raw[4] = {0, 1000, 2000, 3000};
+
+    // ESP32 line fitting with the curved top above 2880
+    set_adc(&conf, &handle);
+    CHECK(handle != NULL);
+    printf("esp32 curve: max |block - single| = %d mV\n", check_all_codes(handle));
+    adc_release(handle);
+
+    // The whole range is linear, the cache must cover it
+    host_adc_cali_set_curve(linear_curve);
+    set_adc(&conf, &handle);
+    CHECK(handle != NULL);
+    printf("linear curve: max |block - single| = %d mV\n", check_all_codes(handle));
+    adc_release(handle);
+    host_adc_cali_set_curve(NULL);
+
+    // A released handle converts to -1
+    raw_to_voltage_block(handle, raw, out, 4);
+    for (int i = 0; i < 4; i++) {
+        CHECK(out[i] == -1);
+    }
+
+    test_exhaustion();
+    test_churn();
+    test_multi_read();
+    HOST_TEST_END();
+}
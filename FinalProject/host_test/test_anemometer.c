@@ -0,0 +1,60 @@
+/**
+ * @file test_anemometer.c
+ * @author David Ramírez Betancourth
+ * @brief Table lookup against the King's law model over the table range,
+ * and the readings that must give 0
+ */
+
+#include "anemometer.h"
+#include "host_test.h"
+
+// Same constants and table range as main.c
+static const anemometer_params_t params = {
+    .power_w = 0.05,
+    .king_a = 0.002,
+    .king_b = 0.002,
+    .king_n = 0.5,
+    .alpha_per_k = 0.0028,
+    .t_ref_c = 25.0,
+};
+
+int main(void)
+{
+    anemometer_t anemo;
+    double worst = 0;
+    float worst_dt = 0;
+    float worst_ta = 0;
+
+    CHECK(!anemometer_build(&anemo, &params, 0.0f, 40.0f, 0.0f, 50.0f));
+    CHECK(!anemometer_build(&anemo, &params, 1.0f, 40.0f, 50.0f, 50.0f));
+    CHECK(anemometer_build(&anemo, &params, 1.0f, 40.0f, 0.0f, 50.0f));
+
+    // Off-grid points, between the rows and columns
+    for (float dt = 1.0f; dt <= 40.0f; dt += 0.013f) {
+        for (float ta = 0.0f; ta <= 50.0f; ta += 0.37f) {
+            double err = fabs(anemometer_kmh(&anemo, dt, ta) - anemometer_model_kmh(&params, dt, ta));
+            if (err > worst) {
+                worst = err;
+                worst_dt = dt;
+                worst_ta = ta;
+            }
+        }
+    }
+    printf("max error %.3f km/h at dT %.2f, ambient %.1f\n", worst, worst_dt, worst_ta);
+    CHECK(worst <= 0.25);
+
+    // On the grid the table is exact up to float rounding
+    CHECK_NEAR(anemometer_kmh(&anemo, 40.0f, 0.0f), anemometer_model_kmh(&params, 40.0f, 0.0f), 1e-3);
+
+    // Not a hot-wire reading
+    CHECK(anemometer_kmh(&anemo, 0.0f, 25.0f) == 0.0f);
+    CHECK(anemometer_kmh(&anemo, -3.0f, 25.0f) == 0.0f);
+    CHECK(anemometer_kmh(&anemo, 0.5f, 25.0f) == 0.0f);
+    CHECK(anemometer_kmh(&anemo, NAN, 25.0f) == 0.0f);
+
+    // Clamped above the table and outside the ambient range
+    CHECK(anemometer_kmh(&anemo, 80.0f, 25.0f) == anemometer_kmh(&anemo, 40.0f, 25.0f));
+    CHECK(anemometer_kmh(&anemo, 10.0f, -20.0f) == anemometer_kmh(&anemo, 10.0f, 0.0f));
+    CHECK(anemometer_kmh(&anemo, 10.0f, NAN) == anemometer_kmh(&anemo, 10.0f, 0.0f));
+    HOST_TEST_END();
+}
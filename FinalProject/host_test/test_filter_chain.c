@@ -0,0 +1,225 @@
+/**
+ * @file test_filter_chain.c
+ * @author David Ramírez Betancourth
+ * @brief Frequency response of the designed low-pass filters, measured
+ * through the chain, and the moving average and median stages
+ */
+
+#include "filter_chain.h"
+#include "host_test.h"
+
+#include <complex.h>
+#include <string.h>
+
+#define FS_HZ  100.0
+#define FC_HZ  5.0
+
+// Response of the sections evaluated on the unit circle, in dB
+static double design_db(const biquad_coeffs_t *c, size_t n, double f_hz)
+{
+    double complex z1 = cexp(-I * 2 * M_PI * f_hz / FS_HZ);
+    double complex h = 1;
+
+    for (size_t i = 0; i < n; i++) {
+        h *= (c[i].b0 + c[i].b1 * z1 + c[i].b2 * z1 * z1) / (1 + c[i].a1 * z1 + c[i].a2 * z1 * z1);
+    }
+    return 20 * log10(cabs(h));
+}
+
+// Steady-state gain of a sine run through the chain, in dB. The amplitude
+// comes from correlating 4 s of output with the input frequency, after 4 s
+// to settle; the test frequencies fit whole periods in that window.
+static double measured_db(filter_chain_t *chain, double f_hz)
+{
+    float block[100];
+    double complex acc = 0;
+    size_t n = 0;
+
+    filter_chain_reset(chain);
+    for (int b = 0; b < 8; b++) {
+        for (int i = 0; i < 100; i++) {
+            block[i] = (float)cos(2 * M_PI * f_hz * (double)(n + i) / FS_HZ);
+        }
+        filter_chain_process(chain, block, 100);
+        for (int i = 0; i < 100; i++, n++) {
+            if (b >= 4) {
+                acc += block[i] * cexp(-I * 2 * M_PI * f_hz * (double)n / FS_HZ);
+            }
+        }
+    }
+    return 20 * log10(2 * cabs(acc) / 400);
+}
+
+static float step_overshoot(filter_chain_t *chain, float *step)
+{
+    float max = 0;
+
+    for (int i = 0; i < 256; i++) {
+        step[i] = 1.0f;
+    }
+    filter_chain_process(chain, step, 256);
+    for (int i = 0; i < 256; i++) {
+        max = fmaxf(max, step[i]);
+    }
+    return max - 1.0f;
+}
+
+static size_t design(filter_response_t response, unsigned order, biquad_coeffs_t *c, filter_chain_t *chain)
+{
+    size_t n = filter_design_lowpass(response, order, FC_HZ, FS_HZ, 1.0f, c, FILTER_MAX_SECTIONS);
+
+    filter_chain_init(chain);
+    CHECK(filter_chain_add_biquads(chain, c, n));
+    return n;
+}
+
+static void test_butterworth(void)
+{
+    biquad_coeffs_t c[FILTER_MAX_SECTIONS];
+    filter_chain_t chain;
+    size_t n = design(FILTER_BUTTERWORTH, 4, c, &chain);
+
+    CHECK(n == 2);
+    CHECK_NEAR(design_db(c, n, 0), 0, 1e-4);
+    CHECK_NEAR(design_db(c, n, FC_HZ), -3.01, 0.05);
+    // Maximally flat: under 0.1 dB down at 0.6 fc
+    CHECK(design_db(c, n, 0.6 * FC_HZ) > -0.1);
+    // 24 dB/octave, a little more after the bilinear warp
+    CHECK(design_db(c, n, 2 * FC_HZ) < -24);
+    CHECK_NEAR(measured_db(&chain, 1), design_db(c, n, 1), 0.05);
+    CHECK_NEAR(measured_db(&chain, FC_HZ), -3.01, 0.1);
+    CHECK_NEAR(measured_db(&chain, 2 * FC_HZ), design_db(c, n, 2 * FC_HZ), 0.5);
+}
+
+static void test_chebyshev(void)
+{
+    biquad_coeffs_t c[FILTER_MAX_SECTIONS];
+    filter_chain_t chain;
+    size_t n = design(FILTER_CHEBYSHEV, 4, c, &chain);
+    double lo = 0;
+    double hi = 0;
+
+    CHECK(n == 2);
+    // Equiripple between 0 and +1 dB with the DC gain normalized to 1
+    for (double f = 0; f <= FC_HZ; f += 0.05) {
+        double db = design_db(c, n, f);
+        lo = fmin(lo, db);
+        hi = fmax(hi, db);
+    }
+    CHECK(lo > -0.01);
+    CHECK_NEAR(hi, 1.0, 0.02);
+    CHECK_NEAR(design_db(c, n, FC_HZ), 0, 0.02);
+    // Steeper than the Butterworth of the same order
+    CHECK(design_db(c, n, 2 * FC_HZ) < -30);
+    CHECK_NEAR(measured_db(&chain, 2), design_db(c, n, 2), 0.05);
+    CHECK_NEAR(measured_db(&chain, 2 * FC_HZ), design_db(c, n, 2 * FC_HZ), 0.5);
+}
+
+static void test_bessel(void)
+{
+    biquad_coeffs_t c[FILTER_MAX_SECTIONS];
+    filter_chain_t chain;
+    float step[256];
+
+    for (unsigned order = 1; order <= FILTER_BESSEL_MAX_ORDER; order++) {
+        size_t n = design(FILTER_BESSEL, order, c, &chain);
+        CHECK(n == (order + 1) / 2);
+        CHECK_NEAR(design_db(c, n, FC_HZ), -3.01, 0.05);
+    }
+
+    // Order 4 step response: about 1 % overshoot (0.84 % for the analog
+    // prototype, a little more after the bilinear warp) where the
+    // Butterworth of the same order rings by over 10 %
+    design(FILTER_BESSEL, 4, c, &chain);
+    CHECK(step_overshoot(&chain, step) < 0.015f);
+    CHECK_NEAR(step[255], 1.0, 1e-4);
+    design(FILTER_BUTTERWORTH, 4, c, &chain);
+    CHECK(step_overshoot(&chain, step) > 0.10f);
+
+    CHECK(filter_design_lowpass(FILTER_BESSEL, FILTER_BESSEL_MAX_ORDER + 1, FC_HZ, FS_HZ, 0, c,
+                                FILTER_MAX_SECTIONS) == 0);
+    CHECK(filter_design_lowpass(FILTER_BUTTERWORTH, 4, FS_HZ / 2, FS_HZ, 0, c, FILTER_MAX_SECTIONS) == 0);
+}
+
+static void test_moving_average(void)
+{
+    filter_chain_t chain;
+
+    filter_chain_init(&chain);
+    CHECK(filter_chain_add_moving_average(&chain, 10));
+    CHECK(!filter_chain_add_moving_average(&chain, FILTER_MAX_WINDOW + 1));
+
+    // Nulls at multiples of fs / len
+    CHECK(measured_db(&chain, FS_HZ / 10) < -60);
+    CHECK(measured_db(&chain, 2 * FS_HZ / 10) < -60);
+    // sin(pi f len / fs) / (len sin(pi f / fs)) at 5 Hz
+    double expected = 20 * log10(fabs(sin(M_PI * 0.5) / (10 * sin(M_PI * 0.05))));
+    CHECK_NEAR(measured_db(&chain, FC_HZ), expected, 0.05);
+}
+
+static void test_median(void)
+{
+    filter_chain_t chain;
+    float data[] = {NAN, 1, 2, 100, 3, INFINITY, 4, -INFINITY, 5, 6};
+
+    filter_chain_init(&chain);
+    CHECK(filter_chain_add_median(&chain, 3));
+    CHECK(!filter_chain_add_median(&chain, 4));
+
+    filter_chain_process(&chain, data, sizeof(data) / sizeof(data[0]));
+
+    CHECK(data[0] == 0);    // Empty window: nothing to repeat
+    CHECK(data[1] == 1);
+    CHECK(data[3] == 2);    // The spike is rejected
+    CHECK(data[4] == 3);
+    CHECK(data[5] == 3);    // inf repeats 3: {100, 3, 3}
+    CHECK(data[6] == 3);
+    CHECK(data[7] == 4);    // -inf repeats 4: {3, 4, 4}
+    for (size_t i = 0; i < sizeof(data) / sizeof(data[0]); i++) {
+        CHECK(isfinite(data[i]));
+    }
+}
+
+// A median in front of a biquad: non-finite samples, first ones included,
+// must not reach the IIR state, which would stay NaN for good
+static void test_median_guards_biquad(void)
+{
+    filter_chain_t chain;
+    biquad_coeffs_t c[FILTER_MAX_SECTIONS];
+    size_t n = filter_design_lowpass(FILTER_BUTTERWORTH, 2, FC_HZ, FS_HZ, 0, c, FILTER_MAX_SECTIONS);
+    float data[64];
+
+    filter_chain_init(&chain);
+    CHECK(filter_chain_add_median(&chain, 3));
+    CHECK(filter_chain_add_biquads(&chain, c, n));
+
+    data[0] = NAN;
+    data[1] = INFINITY;
+    data[2] = -INFINITY;
+    for (size_t i = 3; i < 64; i++) {
+        data[i] = (i % 9 == 0) ? NAN : 25.0f;
+    }
+    filter_chain_process(&chain, data, 3);          // Only non-finite samples, window still empty
+    filter_chain_process(&chain, data + 3, 61);
+    for (size_t i = 0; i < 64; i++) {
+        CHECK(isfinite(data[i]));
+    }
+    CHECK(isfinite(chain.stages[1].iir.z1[0]) && isfinite(chain.stages[1].iir.z2[0]));
+
+    // After a reset the window is empty again
+    filter_chain_reset(&chain);
+    data[0] = NAN;
+    filter_chain_process(&chain, data, 1);
+    CHECK(data[0] == 0);
+}
+
+int main(void)
+{
+    test_butterworth();
+    test_chebyshev();
+    test_bessel();
+    test_moving_average();
+    test_median();
+    test_median_guards_biquad();
+    HOST_TEST_END();
+}
@@ -0,0 +1,288 @@
+/**
+ * @file test_flash_log.c
+ * @author David Ramírez Betancourth
+ * @brief flash_log on the file-image backend: wrap-around, remount, torn
+ * record recovery, foreign content and erase rotation
+ */
+
+#include "flash_log.h"
+#include "host_test.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define IMAGE_PATH   "test_flash_log.img"
+#define NUM_SECTORS  8
+
+// File backend wrapped to count erases per sector
+typedef struct {
+    flash_log_backend_t file;
+    uint32_t erases[NUM_SECTORS];
+} counting_backend_t;
+
+static counting_backend_t counting;
+
+static esp_err_t counting_read(void *ctx, uint32_t offset, void *buf, size_t len)
+{
+    counting_backend_t *c = ctx;
+    return c->file.read(c->file.ctx, offset, buf, len);
+}
+
+static esp_err_t counting_write(void *ctx, uint32_t offset, const void *buf, size_t len)
+{
+    counting_backend_t *c = ctx;
+    return c->file.write(c->file.ctx, offset, buf, len);
+}
+
+static esp_err_t counting_erase(void *ctx, uint32_t offset)
+{
+    counting_backend_t *c = ctx;
+    c->erases[offset / FLASH_LOG_SECTOR_SIZE]++;
+    return c->file.erase_sector(c->file.ctx, offset);
+}
+
+static flash_log_backend_t open_image(void)
+{
+    flash_log_backend_t backend = {
+        .read = counting_read,
+        .write = counting_write,
+        .erase_sector = counting_erase,
+        .size = NUM_SECTORS * FLASH_LOG_SECTOR_SIZE,
+        .ctx = &counting,
+    };
+
+    CHECK(flash_log_file_backend(IMAGE_PATH, NUM_SECTORS * FLASH_LOG_SECTOR_SIZE, &counting.file) == ESP_OK);
+    return backend;
+}
+
+static void close_image(void)
+{
+    flash_log_file_backend_close(&counting.file);
+}
+
+// Record seq: its number followed by seq % 41 bytes derived from it
+static size_t make_record(uint32_t seq, uint8_t *buf)
+{
+    size_t len = 4 + seq % 41;
+
+    memcpy(buf, &seq, 4);
+    for (size_t i = 4; i < len; i++) {
+        buf[i] = (uint8_t)(seq * 31 + i);
+    }
+    return len;
+}
+
+// Records refused because the staging buffer was full, then retried
+static uint32_t retried;
+
+static void append(uint32_t first, uint32_t count)
+{
+    uint8_t rec[64];
+
+    for (uint32_t seq = first; seq < first + count; seq++) {
+        size_t len = make_record(seq, rec);
+        if (!flash_log_append(rec, len)) {
+            retried++;
+            CHECK(flash_log_flush() == ESP_OK);
+            CHECK(flash_log_append(rec, len));
+        }
+    }
+    CHECK(flash_log_flush() == ESP_OK);
+}
+
+// Read the whole log, checking every record. Returns the number read and
+// the first/last sequence numbers; records must be consecutive except at
+// the gaps the caller allows.
+static uint32_t read_all(uint32_t *first, uint32_t *last, uint32_t *gaps)
+{
+    flash_log_iter_t it;
+    uint8_t buf[FLASH_LOG_MAX_RECORD];
+    uint8_t expected[64];
+    size_t len;
+    uint32_t count = 0;
+
+    *gaps = 0;
+    flash_log_iter_init(&it);
+    while (flash_log_iter_next(&it, buf, sizeof(buf), &len)) {
+        uint32_t seq;
+        memcpy(&seq, buf, 4);
+        CHECK(len == make_record(seq, expected));
+        CHECK(memcmp(buf, expected, len) == 0);
+        if (count == 0) {
+            *first = seq;
+        } else if (seq != *last + 1) {
+            CHECK(seq > *last);
+            (*gaps)++;
+        }
+        *last = seq;
+        count++;
+    }
+    return count;
+}
+
+static void test_wrap_and_remount(void)
+{
+    flash_log_backend_t backend = open_image();
+    flash_log_stats_t stats;
+    uint32_t first, last, gaps;
+
+    CHECK(flash_log_mount(&backend) == ESP_OK);
+    flash_log_get_stats(&stats);
+    CHECK(stats.generation == 1);
+    CHECK(read_all(&first, &last, &gaps) == 0);
+
+    retried = 0;
+    // About five times the log area, 5000 records of 16..52 bytes with headers
+    append(0, 5000);
+    flash_log_get_stats(&stats);
+    CHECK(stats.appended == 5000);
+    CHECK(stats.written == 5000);
+    CHECK(stats.dropped == retried);
+    CHECK(stats.write_errors == 0);
+
+    uint32_t count = read_all(&first, &last, &gaps);
+    printf("after wrap: %u records %u..%u in %u sectors, generation %u\n", count, first, last, NUM_SECTORS,
+           stats.generation);
+    CHECK(last == 4999);
+    CHECK(gaps == 0);
+    CHECK(count == last - first + 1);
+    // At least the sectors other than the one being written hold data
+    CHECK(count * 32 > (NUM_SECTORS - 1) * FLASH_LOG_SECTOR_SIZE * 3 / 4);
+
+    // Remount from the image: same content, writing continues behind it
+    close_image();
+    backend = open_image();
+    CHECK(flash_log_mount(&backend) == ESP_OK);
+    flash_log_stats_t remounted;
+    flash_log_get_stats(&remounted);
+    CHECK(remounted.generation == stats.generation);
+    CHECK(remounted.write_sector == stats.write_sector);
+    CHECK(remounted.write_offset == stats.write_offset);
+    CHECK(remounted.torn_records == 0);
+
+    uint32_t first2, last2;
+    CHECK(read_all(&first2, &last2, &gaps) == count);
+    CHECK(first2 == first && last2 == last);
+
+    append(5000, 100);
+    CHECK(read_all(&first2, &last2, &gaps) > 0);
+    CHECK(last2 == 5099);
+    CHECK(gaps == 0);
+    close_image();
+}
+
+// Power lost while a record was programmed: header written, payload not
+static void test_torn_record(void)
+{
+    flash_log_backend_t backend = open_image();
+    flash_log_stats_t stats;
+    uint32_t first, last, gaps;
+
+    CHECK(flash_log_mount(&backend) == ESP_OK);
+    flash_log_get_stats(&stats);
+    uint32_t before = read_all(&first, &last, &gaps);
+
+    uint8_t torn[8] = {20, 0, (uint8_t)~20, 0xFF, 0x12, 0x34, 0x56, 0x78};
+    uint8_t half[6] = {0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF};
+    uint32_t at = stats.write_sector * FLASH_LOG_SECTOR_SIZE + stats.write_offset;
+    CHECK(counting.file.write(counting.file.ctx, at, torn, sizeof(torn)) == ESP_OK);
+    CHECK(counting.file.write(counting.file.ctx, at + 8, half, sizeof(half)) == ESP_OK);
+    close_image();
+
+    backend = open_image();
+    CHECK(flash_log_mount(&backend) == ESP_OK);
+    flash_log_get_stats(&stats);
+    CHECK(stats.torn_records == 1);
+    CHECK(stats.write_offset == FLASH_LOG_SECTOR_SIZE);
+
+    // Everything before the damage is still there
+    uint32_t first2, last2;
+    CHECK(read_all(&first2, &last2, &gaps) == before);
+    CHECK(last2 == last);
+
+    // New records go to a fresh sector and are readable after the damage
+    uint32_t sector = stats.write_sector;
+    append(6000, 10);
+    flash_log_get_stats(&stats);
+    CHECK(stats.write_sector == (sector + 1) % NUM_SECTORS);
+    read_all(&first2, &last2, &gaps);
+    CHECK(last2 == 6009);
+    close_image();
+
+    // The rewritten log mounts clean
+    backend = open_image();
+    CHECK(flash_log_mount(&backend) == ESP_OK);
+    flash_log_get_stats(&stats);
+    CHECK(stats.torn_records == 0);
+    close_image();
+}
+
+// Erases rotate over the area: no sector is erased more than once more
+// than any other
+static void test_wear(void)
+{
+    flash_log_backend_t backend;
+    uint32_t lo = UINT32_MAX, hi = 0;
+
+    remove(IMAGE_PATH);
+    memset(counting.erases, 0, sizeof(counting.erases));
+    backend = open_image();
+    CHECK(flash_log_mount(&backend) == ESP_OK);
+    append(0, 20000);
+    for (int s = 0; s < NUM_SECTORS; s++) {
+        lo = counting.erases[s] < lo ? counting.erases[s] : lo;
+        hi = counting.erases[s] > hi ? counting.erases[s] : hi;
+    }
+    printf("erases per sector: %u..%u\n", lo, hi);
+    CHECK(lo > 0);
+    CHECK(hi - lo <= 1);
+    close_image();
+}
+
+static void test_foreign_content(void)
+{
+    flash_log_backend_t backend;
+    flash_log_stats_t stats;
+    uint32_t first, last, gaps;
+    FILE *f = fopen(IMAGE_PATH, "wb");
+
+    // Something else was stored in the partition
+    for (int i = 0; i < NUM_SECTORS * FLASH_LOG_SECTOR_SIZE; i++) {
+        fputc(i * 7, f);
+    }
+    fclose(f);
+
+    backend = open_image();
+    CHECK(flash_log_mount(&backend) == ESP_OK);
+    flash_log_get_stats(&stats);
+    CHECK(stats.generation == 1);
+    CHECK(stats.sectors_erased == 1);
+    CHECK(read_all(&first, &last, &gaps) == 0);
+    append(0, 50);
+    CHECK(read_all(&first, &last, &gaps) == 50);
+    close_image();
+}
+
+static void test_bad_args(void)
+{
+    flash_log_backend_t backend;
+
+    CHECK(flash_log_file_backend(IMAGE_PATH, FLASH_LOG_SECTOR_SIZE, &backend) == ESP_ERR_INVALID_ARG);
+    CHECK(flash_log_file_backend(IMAGE_PATH, 3 * FLASH_LOG_SECTOR_SIZE + 1, &backend) == ESP_ERR_INVALID_ARG);
+    CHECK(flash_log_file_backend("no_such_dir/x.img", 2 * FLASH_LOG_SECTOR_SIZE, &backend) == ESP_ERR_NOT_FOUND);
+    CHECK(flash_log_mount(NULL) == ESP_ERR_INVALID_ARG);
+    CHECK(!flash_log_append("x", 0));
+    CHECK(!flash_log_append("x", FLASH_LOG_MAX_RECORD + 1));
+}
+
+int main(void)
+{
+    remove(IMAGE_PATH);
+    test_wrap_and_remount();
+    test_torn_record();
+    test_wear();
+    test_foreign_content();
+    test_bad_args();
+    remove(IMAGE_PATH);
+    HOST_TEST_END();
+}
@@ -0,0 +1,555 @@
+/**
+ * @file test_json_scan.c
+ * @author David Ramírez Betancourth
+ * @brief json_scan: valid and invalid bodies split at every chunk boundary,
+ * the documented limits, generated documents and a mutation fuzz run
+ *
+ * The scanner keeps all its state in json_scan_t, so the verdict and the
+ * extracted values must not depend on how the body is split. Every case is
+ * fed whole, one byte at a time, in every fixed chunk size and split in
+ * two at every position, as http_server_read_body() may deliver it.
+ *
+ * The fuzz run mutates generated documents and checks that random chunking
+ * gives the same result as the whole body; run it under HOST_TEST_SANITIZE
+ * for memory errors.
+ */
+
+#include "json_scan.h"
+#include "host_test.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define GEN_DOCS        20000
+#define FUZZ_ROUNDS     200000
+#define DOC_MAX         4096
+#define UNTOUCHED       -12345.0
+
+// "pwm_val" is the key the /pwmValues.json handler asks for
+static const char *const keys[] = {
+    "pwm_val",
+    "temp",
+    "k23_aaaaaaaaaaaaaaaaaaa",      // JSON_SCAN_KEY_LEN - 1 characters, the longest that matches
+};
+#define NUM_KEYS (sizeof(keys) / sizeof(keys[0]))
+
+typedef struct {
+    bool fed;               // json_scan_feed() never failed
+    bool done;              // json_scan_finish()
+    uint32_t found;
+    double values[NUM_KEYS];
+} scan_result_t;
+
+typedef size_t (*chunker_t)(size_t pos, size_t len, void *ctx);
+
+static scan_result_t scan_chunked(const char *data, size_t len, chunker_t next_chunk, void *ctx)
+{
+    scan_result_t r = {.fed = true};
+    json_scan_t scan;
+
+    for (size_t i = 0; i < NUM_KEYS; i++) {
+        r.values[i] = UNTOUCHED;
+    }
+    json_scan_init(&scan, keys, NUM_KEYS, r.values);
+    for (size_t pos = 0; pos <= len; ) {
+        size_t n = next_chunk(pos, len, ctx);
+        if (n > len - pos) {
+            n = len - pos;
+        }
+        r.fed &= json_scan_feed(&scan, data + pos, n);
+        if (pos == len) {
+            break;
+        }
+        pos += n;
+    }
+    r.done = json_scan_finish(&scan);
+    r.found = scan.found;
+    return r;
+}
+
+static size_t chunk_fixed(size_t pos, size_t len, void *ctx)
+{
+    (void)pos, (void)len;
+    return *(size_t *)ctx;
+}
+
+static size_t chunk_split(size_t pos, size_t len, void *ctx)
+{
+    size_t at = *(size_t *)ctx;
+    (void)len;
+    return pos < at ? at - pos : len - pos;
+}
+
+static bool same_result(const scan_result_t *a, const scan_result_t *b)
+{
+    return a->fed == b->fed && a->done == b->done && a->found == b->found &&
+           memcmp(a->values, b->values, sizeof(a->values)) == 0;
+}
+
+static scan_result_t scan_whole(const char *data, size_t len)
+{
+    size_t all = len + 1;
+    return scan_chunked(data, len, chunk_fixed, &all);
+}
+
+// Whole, every fixed chunk size and every two-piece split agree; returns the whole-body result
+static scan_result_t scan_all_splits(const char *data, size_t len, int *mismatches)
+{
+    scan_result_t whole = scan_whole(data, len);
+
+    for (size_t size = 1; size <= len; size++) {
+        scan_result_t r = scan_chunked(data, len, chunk_fixed, &size);
+        *mismatches += !same_result(&whole, &r);
+    }
+    for (size_t at = 0; at <= len; at++) {
+        scan_result_t r = scan_chunked(data, len, chunk_split, &at);
+        *mismatches += !same_result(&whole, &r);
+    }
+    return whole;
+}
+
+//-----------------------------------Fixed cases-------------------------------------
+
+typedef struct {
+    const char *body;
+    bool ok;
+    uint32_t found;
+    double values[NUM_KEYS];
+} body_case_t;
+
+static const body_case_t cases[] = {
+    // Accepted
+    {"{\"pwm_val\": 42}", true, 1, {42}},
+    {"  \r\n\t{ \"pwm_val\" :\t-3.5e1 , \"temp\":25.125 }\n ", true, 3, {-35, 25.125}},
+    {"{}", true, 0},
+    {"{\"temp\":1,\"temp\":2}", true, 2, {0, 2}},
+    {"{\"pwm_val\":7,\"pwm_val\":\"later string\"}", true, 1, {7}},
+    {"{\"pwm_val\":0.0001E+3}", true, 1, {0.1}},
+    {"{\"pwm\":1,\"pwm_val2\":2,\"Pwm_val\":3,\"\":4}", true, 0},
+    {"{\"s\":\"a \\\" } ] \\\\\",\"pwm_val\":1}", true, 1, {1}},
+    {"{\"a\":true,\"b\":false,\"c\":null,\"temp\":-0}", true, 2, {0, -0.0}},
+    {"{\"n\":{\"pwm_val\":9,\"x\":[1,{\"y\":\"}\"}]},\"pwm_val\":8}", true, 1, {8}},
+    {"{\"a\":[\"]\\\"[\", {}], \"temp\":3}", true, 2, {0, 3}},
+    {"{\"k23_aaaaaaaaaaaaaaaaaaa\":23}", true, 4, {0, 0, 23}},
+    // Escapes and overlong keys never match, even when they spell a requested key
+    {"{\"pwm\\u005fval\":5}", true, 0},
+    {"{\"pwm_\\val\":5}", true, 0},
+    {"{\"k23_aaaaaaaaaaaaaaaaaaaa\":24}", true, 0},
+    {"{\"k23_aaaaaaaaaaaaaaaaaaa_and_then_some_more\":1}", true, 0},
+    // Nested values are only bracket-matched, not validated
+    {"{\"a\":[1,,],\"pwm_val\":2}", true, 1, {2}},
+    // Rejected
+    {"", false},
+    {"   ", false},
+    {"[]", false},
+    {"{", false},
+    {"{\"pwm_val\":42", false},
+    {"{\"pwm_val\":42,}", false},
+    {"{,\"a\":1}", false},
+    {"{\"a\" 1}", false},
+    {"{\"a\":}", false},
+    {"{\"a\":-}", false},
+    {"{\"a\":+1}", false},
+    {"{\"a\":.5}", false},
+    {"{\"a\":1.2.3}", false},
+    {"{\"a\":1e}", false},
+    {"{\"a\":0x10}", false},
+    {"{\"a\":tru}", false},
+    {"{\"a\":nulls}", false},
+    {"{\"a\":True}", false},
+    {"{\"a\":\"x\ny\"}", false},
+    {"{\"a\nb\":1}", false},
+    {"{\"a\":[}]}", false},
+    {"{\"a\":{]}", false},
+    {"{\"a\":1}}", false},
+    {"{\"a\":1}x", false},
+    {"{}{}", false},
+    {"{\"a\":1} {\"b\":2}", false},
+};
+
+static void test_cases(void)
+{
+    CHECK(strlen(keys[2]) == JSON_SCAN_KEY_LEN - 1);
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        const body_case_t *t = &cases[c];
+        int mismatches = 0;
+        scan_result_t r = scan_all_splits(t->body, strlen(t->body), &mismatches);
+        bool ok = r.fed && r.done;
+
+        if (mismatches || ok != t->ok || (ok && r.found != t->found)) {
+            fprintf(stderr, "case %zu: %s\n", c, t->body);
+        }
+        CHECK(mismatches == 0);
+        CHECK(ok == t->ok);
+        if (!t->ok) {
+            continue;
+        }
+        CHECK(r.found == t->found);
+        for (size_t k = 0; k < NUM_KEYS; k++) {
+            if (t->found & (1u << k)) {
+                CHECK(r.values[k] == t->values[k] && signbit(r.values[k]) == signbit(t->values[k]));
+            } else {
+                CHECK(r.values[k] == UNTOUCHED);
+            }
+        }
+    }
+}
+
+//-----------------------------------Limits------------------------------------------
+
+static bool accepts(const char *body)
+{
+    scan_result_t r = scan_whole(body, strlen(body));
+    return r.fed && r.done;
+}
+
+static void test_limits(void)
+{
+    char body[256];
+    char num[64];
+    size_t n;
+
+    // JSON_SCAN_NUM_LEN - 1 characters is the longest number
+    memset(num, '0', sizeof(num));
+    num[0] = '1';
+    n = (size_t)snprintf(body, sizeof(body), "{\"temp\":%.*s}", JSON_SCAN_NUM_LEN - 1, num);
+    CHECK(n < sizeof(body) && accepts(body));
+    CHECK(scan_whole(body, n).values[1] == 1e30);
+    snprintf(body, sizeof(body), "{\"temp\":%.*s}", JSON_SCAN_NUM_LEN, num);
+    CHECK(!accepts(body));
+
+    // JSON_SCAN_MAX_DEPTH levels inside a value
+    snprintf(body, sizeof(body), "{\"a\":%.*s%.*s}", JSON_SCAN_MAX_DEPTH,
+             "[{[{[{[{[{[{[{[{[{[{", JSON_SCAN_MAX_DEPTH, "}]}]}]}]}]}]}]}]}]}]");
+    CHECK(accepts(body));
+    // One deeper, the closing order matches so only the limit rejects it
+    snprintf(body, sizeof(body), "{\"a\":[%.*s%.*s]}", JSON_SCAN_MAX_DEPTH,
+             "{[{[{[{[{[{[{[{[{[{[", JSON_SCAN_MAX_DEPTH, "]}]}]}]}]}]}]}]}]}]}");
+    CHECK(!accepts(body));
+
+    // Keys past JSON_SCAN_MAX_KEYS are ignored
+    const char *many[JSON_SCAN_MAX_KEYS + 1] = {"k0", "k1", "k2", "k3", "k4", "k5", "k6", "k7", "k8"};
+    double values[JSON_SCAN_MAX_KEYS + 1] = {0};
+    json_scan_t scan;
+    const char *all = "{\"k0\":0,\"k1\":1,\"k2\":2,\"k3\":3,\"k4\":4,\"k5\":5,\"k6\":6,\"k7\":7,\"k8\":8}";
+
+    json_scan_init(&scan, many, JSON_SCAN_MAX_KEYS + 1, values);
+    CHECK(json_scan_feed(&scan, all, strlen(all)));
+    CHECK(json_scan_finish(&scan));
+    CHECK(scan.found == (1u << JSON_SCAN_MAX_KEYS) - 1);
+    CHECK(values[7] == 7 && values[8] == 0);
+
+    // Asking for a key of JSON_SCAN_KEY_LEN characters finds nothing, even an exact match
+    const char *overlong[] = {"k24_aaaaaaaaaaaaaaaaaaaa"};
+    const char *exact = "{\"k24_aaaaaaaaaaaaaaaaaaaa\":1}";
+
+    CHECK(strlen(overlong[0]) == JSON_SCAN_KEY_LEN);
+    json_scan_init(&scan, overlong, 1, values);
+    CHECK(json_scan_feed(&scan, exact, strlen(exact)));
+    CHECK(json_scan_finish(&scan) && !json_scan_found(&scan, 0));
+
+    // A failed scanner stays failed
+    json_scan_init(&scan, keys, NUM_KEYS, values);
+    CHECK(!json_scan_feed(&scan, "x", 1));
+    CHECK(!json_scan_feed(&scan, "{}", 2));
+    CHECK(!json_scan_finish(&scan));
+}
+
+//-----------------------------------Generated documents-----------------------------
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15u;
+
+static uint32_t rnd(uint32_t n)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)((rng_state >> 32) % n);
+}
+
+typedef struct {
+    char text[DOC_MAX];
+    size_t len;
+    uint32_t found;
+    double values[NUM_KEYS];
+} doc_t;
+
+static void put(doc_t *d, const char *s)
+{
+    size_t n = strlen(s);
+    if (d->len + n < DOC_MAX) {
+        memcpy(d->text + d->len, s, n);
+        d->len += n;
+    }
+}
+
+static void put_space(doc_t *d)
+{
+    static const char *const ws[] = {"", "", " ", "\n", "\t ", "\r\n  "};
+    put(d, ws[rnd(6)]);
+}
+
+static void put_number(doc_t *d, char *out)
+{
+    size_t n = 0;
+
+    if (rnd(2)) {
+        out[n++] = '-';
+    }
+    if (rnd(5) == 0) {
+        out[n++] = '0';
+    } else {
+        out[n++] = (char)('1' + rnd(9));
+        for (uint32_t i = rnd(9); i > 0; i--) {
+            out[n++] = (char)('0' + rnd(10));
+        }
+    }
+    if (rnd(2)) {
+        out[n++] = '.';
+        for (uint32_t i = rnd(6) + 1; i > 0; i--) {
+            out[n++] = (char)('0' + rnd(10));
+        }
+    }
+    if (rnd(3) == 0) {
+        out[n++] = "eE"[rnd(2)];
+        if (rnd(2)) {
+            out[n++] = "+-"[rnd(2)];
+        }
+        for (uint32_t i = rnd(2) + 1; i > 0; i--) {
+            out[n++] = (char)('0' + rnd(10));
+        }
+    }
+    out[n] = '\0';
+    put(d, out);
+}
+
+static void put_string(doc_t *d)
+{
+    static const char *const parts[] = {"a", "pwm_val", " ", "}", "]", "{", "[", ",", ":", "\\\"", "\\\\",
+                                        "\\n", "\\u00e9", "\xc3\xa9"};
+    put(d, "\"");
+    for (uint32_t i = rnd(6); i > 0; i--) {
+        put(d, parts[rnd(14)]);
+    }
+    put(d, "\"");
+}
+
+static const char *const key_pool[] = {
+    "pwm_val", "temp", "k23_aaaaaaaaaaaaaaaaaaa", "pwm", "pwm_val2", "", "x", "pwm\\u005fval",
+    "k23_aaaaaaaaaaaaaaaaaaaa",
+};
+
+static void put_value(doc_t *d, int depth, int match);
+
+static void put_container(doc_t *d, int depth)
+{
+    bool obj = rnd(2);
+    uint32_t n = rnd(4);
+
+    put(d, obj ? "{" : "[");
+    for (uint32_t i = 0; i < n; i++) {
+        put_space(d);
+        if (obj) {
+            put(d, "\"");
+            put(d, key_pool[rnd(9)]);
+            put(d, "\":");
+            put_space(d);
+        }
+        put_value(d, depth + 1, -1);
+        put_space(d);
+        if (i + 1 < n) {
+            put(d, ",");
+        }
+    }
+    put(d, obj ? "}" : "]");
+}
+
+// match is the index of the requested key this value belongs to, -1 if none
+static void put_value(doc_t *d, int depth, int match)
+{
+    char num[JSON_SCAN_NUM_LEN];
+
+    switch (rnd(depth < 5 ? 6 : 4)) {
+    case 0:
+    case 1:
+        put_number(d, num);
+        if (match >= 0) {
+            d->values[match] = strtod(num, NULL);
+            d->found |= 1u << match;
+        }
+        break;
+    case 2:
+        put_string(d);
+        break;
+    case 3:
+        put(d, (const char *[]) {"true", "false", "null"}[rnd(3)]);
+        break;
+    default:
+        put_container(d, depth);
+        break;
+    }
+}
+
+static void generate(doc_t *d)
+{
+    uint32_t n = rnd(7);
+
+    d->len = 0;
+    d->found = 0;
+    for (size_t k = 0; k < NUM_KEYS; k++) {
+        d->values[k] = UNTOUCHED;
+    }
+    put_space(d);
+    put(d, "{");
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t key = rnd(9);
+        put_space(d);
+        put(d, "\"");
+        put(d, key_pool[key]);
+        put(d, "\"");
+        put_space(d);
+        put(d, ":");
+        put_space(d);
+        put_value(d, 0, key < NUM_KEYS ? (int)key : -1);
+        put_space(d);
+        if (i + 1 < n) {
+            put(d, ",");
+        }
+    }
+    put(d, "}");
+    put_space(d);
+}
+
+static void test_generated(void)
+{
+    static doc_t doc;
+    int mismatches = 0;
+    int wrong = 0;
+
+    for (int i = 0; i < GEN_DOCS; i++) {
+        generate(&doc);
+        CHECK(doc.len < DOC_MAX - 1);
+
+        scan_result_t r = (i % 16 == 0) ? scan_all_splits(doc.text, doc.len, &mismatches)
+                                         : scan_whole(doc.text, doc.len);
+        if (!r.fed || !r.done || r.found != doc.found ||
+            memcmp(r.values, doc.values, sizeof(doc.values)) != 0) {
+            if (wrong++ < 5) {
+                fprintf(stderr, "generated: %.*s\n", (int)doc.len, doc.text);
+            }
+        }
+    }
+    CHECK(wrong == 0);
+    CHECK(mismatches == 0);
+}
+
+//-----------------------------------Fuzz--------------------------------------------
+
+static size_t chunk_random(size_t pos, size_t len, void *ctx)
+{
+    (void)pos, (void)len, (void)ctx;
+    return rnd(4) == 0 ? 0 : rnd(17) + 1;
+}
+
+static size_t chunk_bytes(size_t pos, size_t len, void *ctx)
+{
+    (void)pos, (void)len, (void)ctx;
+    return 1;
+}
+
+// Chunking never changes the result; an accepted body is one object and
+// rejects anything appended. Returns whether the body was accepted.
+static bool check_one(const uint8_t *data, size_t len)
+{
+    // Exact-size copy so the sanitizer sees any read past the end
+    char *body = malloc(len ? len : 1);
+    char *longer = malloc(len + 1);
+
+    memcpy(body, data, len);
+    memcpy(longer, data, len);
+    longer[len] = 'x';
+
+    scan_result_t whole = scan_whole(body, len);
+    scan_result_t random = scan_chunked(body, len, chunk_random, NULL);
+    scan_result_t bytes = scan_chunked(body, len, chunk_bytes, NULL);
+    bool ok = whole.fed && whole.done;
+
+    CHECK(same_result(&whole, &random));
+    CHECK(same_result(&whole, &bytes));
+    CHECK(whole.found < (1u << NUM_KEYS));
+    CHECK(!whole.done || whole.fed);
+    if (ok) {
+        scan_result_t appended = scan_whole(longer, len + 1);
+        CHECK(!appended.done);
+        CHECK(memchr(body, '{', len) != NULL && memchr(body, '}', len) != NULL);
+    }
+    free(body);
+    free(longer);
+    return ok;
+}
+
+static void mutate(doc_t *d)
+{
+    static const char interesting[] = "{}[]\":,\\ -+.0123456789eEtfnulrsa\n\t";
+
+    for (uint32_t m = rnd(4) + 1; m > 0; m--) {
+        size_t pos = d->len ? rnd((uint32_t)d->len) : 0;
+        char c = rnd(4) ? interesting[rnd(sizeof(interesting) - 1)] : (char)rnd(256);
+
+        switch (rnd(5)) {
+        case 0:             // Replace
+            if (d->len) {
+                d->text[pos] = c;
+            }
+            break;
+        case 1:             // Insert
+            if (d->len + 1 < DOC_MAX) {
+                memmove(d->text + pos + 1, d->text + pos, d->len - pos);
+                d->text[pos] = c;
+                d->len++;
+            }
+            break;
+        case 2:             // Delete
+            if (d->len) {
+                memmove(d->text + pos, d->text + pos + 1, d->len - pos - 1);
+                d->len--;
+            }
+            break;
+        case 3: {           // Duplicate a short run, deepens nesting or repeats keys
+            size_t run = rnd(16) + 1;
+            if (pos + run <= d->len && d->len + run < DOC_MAX) {
+                memmove(d->text + pos + run, d->text + pos, d->len - pos);
+                d->len += run;
+            }
+            break;
+        }
+        default:            // Truncate
+            d->len = pos;
+            break;
+        }
+    }
+}
+
+static void test_fuzz(void)
+{
+    static doc_t doc;
+    uint32_t accepted = 0;
+
+    for (int i = 0; i < FUZZ_ROUNDS; i++) {
+        if (i % 8 == 0) {
+            generate(&doc);
+        }
+        mutate(&doc);
+        accepted += check_one((const uint8_t *)doc.text, doc.len);
+    }
+    printf("fuzz: %d mutated bodies, %u still accepted\n", FUZZ_ROUNDS, accepted);
+}
+
+int main(void)
+{
+    test_cases();
+    test_limits();
+    test_generated();
+    test_fuzz();
+    HOST_TEST_END();
+}
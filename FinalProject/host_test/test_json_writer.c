@@ -0,0 +1,153 @@
+/**
+ * @file test_json_writer.c
+ * @author David Ramírez Betancourth
+ * @brief json_writer output, escaping, float formatting against strtod
+ * and the overflow/nesting errors
+ */
+
+#include "json_writer.h"
+#include "host_test.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const char *write_float(char *buf, size_t cap, float value, int decimals)
+{
+    json_writer_t w;
+
+    json_writer_init(&w, buf, cap);
+    json_float(&w, value, decimals);
+    return json_writer_finish(&w, NULL);
+}
+
+static void test_structure(void)
+{
+    char buf[128];
+    json_writer_t w;
+    size_t len;
+
+    json_writer_init(&w, buf, sizeof(buf));
+    json_obj_begin(&w);
+    json_kv_int(&w, "n", -42);
+    json_kv_float(&w, "t", 25.125f, 2);
+    json_key(&w, "a");
+    json_arr_begin(&w);
+    json_bool(&w, true);
+    json_null(&w);
+    json_obj_begin(&w);
+    json_obj_end(&w);
+    json_arr_end(&w);
+    json_kv_str(&w, "s", "q\"\\\n\x01");
+    json_kv_float(&w, "nan", NAN, 2);
+    json_obj_end(&w);
+
+    const char *out = json_writer_finish(&w, &len);
+    const char *expected = "{\"n\":-42,\"t\":25.13,\"a\":[true,null,{}],\"s\":\"q\\\"\\\\\\u000a\\u0001\",\"nan\":null}";
+    CHECK(out && strcmp(out, expected) == 0);
+    CHECK(len == strlen(expected));
+}
+
+static void test_errors(void)
+{
+    char buf[16];
+    json_writer_t w;
+
+    // Sticky overflow
+    json_writer_init(&w, buf, sizeof(buf));
+    json_obj_begin(&w);
+    json_kv_str(&w, "key", "a long value");
+    json_obj_end(&w);
+    CHECK(json_writer_finish(&w, NULL) == NULL);
+    CHECK(buf[0] == '\0');
+
+    // Left open
+    json_writer_init(&w, buf, sizeof(buf));
+    json_arr_begin(&w);
+    CHECK(json_writer_finish(&w, NULL) == NULL);
+
+    // Too deep
+    char deep[64];
+    json_writer_init(&w, deep, sizeof(deep));
+    for (int i = 0; i <= JSON_WRITER_MAX_DEPTH; i++) {
+        json_arr_begin(&w);
+    }
+    for (int i = 0; i <= JSON_WRITER_MAX_DEPTH; i++) {
+        json_arr_end(&w);
+    }
+    CHECK(json_writer_finish(&w, NULL) == NULL);
+
+    // Exactly full
+    json_writer_init(&w, buf, 3);
+    json_arr_begin(&w);
+    json_arr_end(&w);
+    CHECK(json_writer_finish(&w, NULL) != NULL);
+}
+
+static void test_float_cases(void)
+{
+    char buf[40];
+    const char *out;
+
+    out = write_float(buf, sizeof(buf), 0.995f, 2);
+    CHECK(out && strcmp(out, "1.00") == 0);
+    out = write_float(buf, sizeof(buf), -0.001f, 2);
+    CHECK(out && strcmp(out, "0.00") == 0);
+    out = write_float(buf, sizeof(buf), -12.5f, 0);
+    CHECK(out && strcmp(out, "-13") == 0);
+    out = write_float(buf, sizeof(buf), 3.0f, 9);
+    CHECK(out && strcmp(out, "3.000000") == 0);
+    out = write_float(buf, sizeof(buf), 1e13f, 6);
+    CHECK(out && strcmp(out, "9.99999983e+12") == 0);
+    out = write_float(buf, sizeof(buf), -3.4e38f, 0);
+    CHECK(out && strcmp(out, "-3.39999995e+38") == 0);
+    out = write_float(buf, sizeof(buf), INFINITY, 2);
+    CHECK(out && strcmp(out, "null") == 0);
+}
+
+// Random floats over the whole range: the text parses back to the value
+// rounded to the requested decimals
+static void test_float_random(void)
+{
+    char buf[40];
+    uint32_t state = 2463534242u;
+
+    for (int i = 0; i < 200000; i++) {
+        uint32_t bits;
+        float value;
+
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        bits = state;
+        memcpy(&value, &bits, sizeof(value));
+        if (!isfinite(value)) {
+            continue;
+        }
+        int decimals = (int)(state % 7);
+
+        const char *out = write_float(buf, sizeof(buf), value, decimals);
+        CHECK(out != NULL);
+        if (!out) {
+            continue;
+        }
+        double parsed = strtod(out, NULL);
+        double mag = fabs((double)value);
+        double tol = 0.5 * pow(10, -decimals) + mag * 1e-15;  // Ties, and strtod rounding
+        if (mag * pow(10, decimals) >= 9.2e18) {
+            tol = mag * 1e-8;       // %.9g fallback
+        }
+        if (!(fabs(parsed - (double)value) <= tol)) {
+            fprintf(stderr, "%.9g with %d decimals gave %s\n", (double)value, decimals, out);
+            host_test_failures++;
+        }
+    }
+}
+
+int main(void)
+{
+    test_structure();
+    test_errors();
+    test_float_cases();
+    test_float_random();
+    HOST_TEST_END();
+}
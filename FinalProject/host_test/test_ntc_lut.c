@@ -0,0 +1,139 @@
+/**
+ * @file test_ntc_lut.c
+ * @author David Ramírez Betancourth
+ * @brief NTC table against the exact beta model over all 4096 codes, on
+ * the ESP32-like calibration curve and on a linear one
+ *
+ * The reference takes the same calibrated mV as the table knots and
+ * evaluates the beta model in double precision, so the error reported is
+ * the table's own: interpolation between knots plus milli-degree rounding.
+ */
+
+#include "ntc_lut.h"
+#include "host_test.h"
+
+#include "esp_adc/adc_cali.h"
+
+#define CODES 4096
+
+// Same divider and NTC as main.c
+static const ntc_params_t params = {
+    .beta = 10000.0,
+    .r0 = 10000.0,
+    .t0 = 298.15,
+    .r_fixed = 1000.0,
+    .v_in = 4.8,
+};
+
+static const adc_config_t conf = {
+    .unit_id = ADC_UNIT_1, .channel = ADC_CHANNEL_3, .atten = ADC_ATTEN_DB_12, .bitwidth = ADC_BITWIDTH_12,
+};
+
+static int linear_curve(int raw)
+{
+    return (int)(((int64_t)raw * 50000 + 32768) / 65536) + 75;
+}
+
+static bool exact_celsius(int voltage_mv, double *out)
+{
+    double vo = voltage_mv / 1000.0;
+
+    if (vo <= 0 || vo >= params.v_in) {
+        return false;
+    }
+    double rt = params.r_fixed * (params.v_in - vo) / vo;
+    *out = params.beta * params.t0 / (log(rt / params.r0) * params.t0 + params.beta) - 273.15;
+    return true;
+}
+
+// Worst |table - exact| in °C; every code the exact model accepts must convert
+static double worst_error(const ntc_lut_t *lut, adc_channel_handle_t handle, int *at_code)
+{
+    double worst = 0;
+
+    for (int code = 0; code < CODES; code++) {
+        int mv;
+        double exact;
+        int32_t mdeg;
+
+        raw_to_voltage(handle, code, &mv);
+        if (!exact_celsius(mv, &exact)) {
+            continue;
+        }
+        if (!ntc_lut_lookup(lut, code, &mdeg)) {
+            fprintf(stderr, "code %d (%d mV) not converted\n", code, mv);
+            host_test_failures++;
+            continue;
+        }
+        double err = fabs(mdeg / 1000.0 - exact);
+        if (err > worst) {
+            worst = err;
+            *at_code = code;
+        }
+    }
+    return worst;
+}
+
+static void check_curve(const char *name)
+{
+    static ntc_lut_t lut;
+    adc_channel_handle_t handle;
+    int code = 0;
+
+    set_adc(&conf, &handle);
+    CHECK(handle != NULL);
+    ntc_lut_build(&lut, &params, handle);
+
+    double worst = worst_error(&lut, handle, &code);
+    printf("%s: max error %.3f C at code %d\n", name, worst, code);
+    CHECK(worst <= 0.1);
+
+    // The fixed-point entry agrees with the integer one on whole codes
+    for (code = 0; code < CODES; code++) {
+        int32_t a;
+        int32_t b;
+        bool ok_a = ntc_lut_lookup(&lut, code, &a);
+        bool ok_b = ntc_lut_lookup_q(&lut, code << 6, 6, &b);
+        CHECK(ok_a == ok_b && (!ok_a || a == b));
+    }
+
+    // Half a code up lands between the two neighbours
+    int32_t lo_mdeg;
+    int32_t mid_mdeg;
+    int32_t hi_mdeg;
+    CHECK(ntc_lut_lookup(&lut, 2000, &lo_mdeg) && ntc_lut_lookup(&lut, 2001, &hi_mdeg));
+    CHECK(ntc_lut_lookup_q(&lut, (2000 << 4) + 8, 4, &mid_mdeg));
+    CHECK((mid_mdeg - lo_mdeg) * (hi_mdeg - mid_mdeg) >= 0);
+
+    adc_release(handle);
+}
+
+int main(void)
+{
+    int32_t mdeg;
+    ntc_lut_t lut = {0};
+    float celsius;
+
+    check_curve("esp32 curve");
+    host_adc_cali_set_curve(linear_curve);
+    check_curve("linear curve");
+    host_adc_cali_set_curve(NULL);
+
+    // Out of range codes and fractional widths
+    CHECK(!ntc_lut_lookup(&lut, -1, &mdeg));
+    CHECK(!ntc_lut_lookup(&lut, CODES, &mdeg));
+    CHECK(!ntc_lut_lookup_q(&lut, 0, 17, &mdeg));
+
+    // Knots outside the divider range are refused, not interpolated
+    lut.mdeg[3] = NTC_LUT_INVALID;
+    CHECK(!ntc_lut_lookup(&lut, 3 << NTC_LUT_STEP_BITS, &mdeg));
+    CHECK(!ntc_lut_lookup(&lut, (2 << NTC_LUT_STEP_BITS) + 1, &mdeg));
+    CHECK(ntc_lut_lookup(&lut, 4 << NTC_LUT_STEP_BITS, &mdeg));
+
+    // The reference formula refuses the ends of the divider
+    CHECK(!ntc_voltage_to_celsius(&params, 0, &celsius));
+    CHECK(!ntc_voltage_to_celsius(&params, 4800, &celsius));
+    CHECK(ntc_voltage_to_celsius(&params, 436, &celsius));
+    CHECK_NEAR(celsius, 25.0, 0.1);
+    HOST_TEST_END();
+}
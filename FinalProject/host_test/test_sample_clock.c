@@ -0,0 +1,165 @@
+/**
+ * @file test_sample_clock.c
+ * @author David Ramírez Betancourth
+ * @brief sample_clock over 24 simulated hours: wake-up jitter and
+ * occasional stalls must not move any job off its start + k * period grid
+ *
+ * The timer callback is replaced by a loop that wakes at each returned
+ * deadline plus a random latency and calls sample_clock_run_due(). Every
+ * callback works out which grid point it serves; drift would show up as
+ * lateness growing over the day, or as grid points neither fired nor
+ * counted as missed.
+ */
+
+#include "sample_clock.h"
+#include "host_test.h"
+
+#include "esp_timer.h"
+
+#define START_US   ((int64_t)1000000)
+#define DAY_US     ((int64_t)24 * 3600 * 1000000)
+#define HOUR_US    ((int64_t)3600 * 1000000)
+#define JITTER_US  200                  // Usual esp_timer task wake-up latency
+#define STALL_US   35000                // Rare long stall (flash erase, WiFi burst)
+#define STALL_ODDS 20000                // One wake-up in STALL_ODDS
+
+typedef struct {
+    int64_t period_us;
+    int64_t now_us;             // Synthetic clock, set by the loop
+    uint64_t calls;
+    uint64_t missed;            // Grid points skipped, as the callbacks saw them
+    int64_t last_k;
+    int64_t max_late_us;        // Against the grid point served
+    int64_t max_overdue_us;     // Against the pending deadline, skipped periods included
+    int64_t late_sum[2];        // First and last hour
+    uint64_t late_n[2];
+    int64_t relative_drift_us;  // What re-arming at now + period would have lost
+    uint64_t bad;
+} job_t;
+
+static int64_t sim_now;
+static uint64_t rng_state = 0x853C49E6748FEA9Bu;
+
+static uint32_t rng(uint32_t n)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)((rng_state >> 32) % n);
+}
+
+static void job_cb(void *user_ctx)
+{
+    job_t *job = user_ctx;
+    int64_t since = sim_now - START_US;
+    int64_t k = since / job->period_us;             // Latest grid point passed
+    int64_t late = since - k * job->period_us;
+
+    // One callback per served grid point, never early, never twice
+    if (k <= job->last_k) {
+        job->bad++;
+    }
+    int64_t overdue = since - (job->last_k + 1) * job->period_us;
+    if (overdue > job->max_overdue_us) {
+        job->max_overdue_us = overdue;
+    }
+    job->missed += (uint64_t)(k - job->last_k - 1);
+    job->last_k = k;
+    job->calls++;
+
+    if (late > job->max_late_us) {
+        job->max_late_us = late;
+    }
+    if (since < HOUR_US) {
+        job->late_sum[0] += late;
+        job->late_n[0]++;
+    } else if (since >= DAY_US - HOUR_US) {
+        job->late_sum[1] += late;
+        job->late_n[1]++;
+    }
+    job->relative_drift_us += late;
+}
+
+int main(void)
+{
+    static job_t jobs[] = {
+        {.period_us = 10000},               // 100 Hz sampling
+        {.period_us = 1000000},             // Display tick
+        {.period_us = 1000000},             // Flash log age check, same period as the display
+        {.period_us = 333333},              // Not a divisor of anything else
+    };
+    const int num_jobs = (int)(sizeof(jobs) / sizeof(jobs[0]));
+    int ids[4];
+    uint64_t wakeups = 0;
+
+    // Argument checks
+    CHECK(sample_clock_add(SAMPLE_CLOCK_MIN_PERIOD_US - 1, job_cb, &jobs[0], NULL) == ESP_ERR_INVALID_ARG);
+    CHECK(sample_clock_add(1000, NULL, NULL, NULL) == ESP_ERR_INVALID_ARG);
+    CHECK(sample_clock_start() == ESP_ERR_INVALID_ARG);
+
+    for (int i = 0; i < num_jobs; i++) {
+        jobs[i].last_k = 0;
+        CHECK(sample_clock_add(jobs[i].period_us, job_cb, &jobs[i], &ids[i]) == ESP_OK);
+    }
+    CHECK(sample_clock_add(1000, job_cb, NULL, NULL) == ESP_ERR_NO_MEM);
+
+    host_time_set(START_US);
+    CHECK(sample_clock_start() == ESP_OK);
+    CHECK(sample_clock_add(1000, job_cb, NULL, NULL) == ESP_ERR_INVALID_STATE);
+
+    // Nothing is due at start, the first deadline is one period out
+    int64_t next = sample_clock_run_due(START_US);
+    CHECK(next == START_US + jobs[0].period_us);
+
+    while (next < START_US + DAY_US) {
+        int64_t latency = rng(JITTER_US + 1);
+        if (rng(STALL_ODDS) == 0) {
+            latency += rng(STALL_US + 1);
+        }
+        sim_now = next + latency;
+        next = sample_clock_run_due(sim_now);
+        CHECK(next > sim_now);
+        wakeups++;
+    }
+    CHECK(sample_clock_stop() == ESP_OK);
+    host_time_set(-1);
+
+    printf("%llu wake-ups over 24 h\n", (unsigned long long)wakeups);
+    for (int i = 0; i < num_jobs; i++) {
+        job_t *job = &jobs[i];
+        sample_clock_stats_t stats;
+        sample_clock_get_stats(ids[i], &stats);
+
+        double first_hour = (double)job->late_sum[0] / (double)job->late_n[0];
+        double last_hour = (double)job->late_sum[1] / (double)job->late_n[1];
+        printf("%7lld us: fired %9llu missed %4llu, max late %5lld us (%5lld us on the grid), mean late %.1f us (first hour) %.1f us "
+               "(last hour); now + period re-arming would have drifted %.1f s\n",
+               (long long)job->period_us, (unsigned long long)stats.fired, (unsigned long long)stats.missed,
+               (long long)stats.max_late_us, (long long)job->max_late_us, first_hour, last_hour, job->relative_drift_us * 1e-6);
+
+        CHECK(job->bad == 0);
+        CHECK(stats.period_us == job->period_us);
+        CHECK(stats.fired == job->calls);
+        CHECK(stats.missed == job->missed);
+        CHECK(stats.max_late_us == job->max_overdue_us);
+
+        // Every grid point of the day was either fired or counted as missed
+        int64_t grid_points = DAY_US / job->period_us;
+        CHECK((int64_t)(stats.fired + stats.missed) >= grid_points - 1);
+        CHECK((int64_t)(stats.fired + stats.missed) <= grid_points);
+
+        // Lateness is bounded by the wake-up latency, not by the elapsed time
+        CHECK(job->max_late_us <= JITTER_US + STALL_US);
+        CHECK(stats.max_late_us <= JITTER_US + STALL_US);
+        CHECK(fabs(last_hour - first_hour) < 25.0);
+    }
+
+    // Jobs slower than the worst stall never lose a tick
+    CHECK(jobs[1].missed == 0 && jobs[2].missed == 0 && jobs[3].missed == 0);
+    CHECK(jobs[0].missed > 0);
+
+    sample_clock_stats_t none;
+    sample_clock_get_stats(num_jobs, &none);
+    CHECK(none.fired == 0 && none.period_us == 0);
+    HOST_TEST_END();
+}
@@ -0,0 +1,258 @@
+/**
+ * @file test_sample_codec.c
+ * @author David Ramírez Betancourth
+ * @brief sample_codec round trips (lossless and fixed point), full
+ * buffers, malformed streams and the size on sensor-like series
+ */
+
+#include "sample_codec.h"
+#include "host_test.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SERIES_LEN 2000
+
+static int64_t ts[SERIES_LEN];
+static float vals[SERIES_LEN];
+static uint8_t stream[SERIES_LEN * SAMPLE_CODEC_MAX_SAMPLE + SAMPLE_CODEC_MAX_HEADER];
+
+// Small deterministic generator so runs are repeatable across libcs
+static uint32_t rng_state = 12345;
+
+static uint32_t rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static size_t encode(uint32_t unit, uint32_t scale, size_t n)
+{
+    sample_codec_enc_t enc;
+
+    CHECK(sample_codec_enc_init(&enc, stream, sizeof(stream), unit, scale));
+    for (size_t i = 0; i < n; i++) {
+        CHECK(sample_codec_enc_put(&enc, ts[i], vals[i]));
+    }
+    return sample_codec_enc_len(&enc);
+}
+
+// Arbitrary timestamps (jumps, repeats, going backwards) and float bit
+// patterns, including NaN payloads, infinities and denormals
+static void test_lossless(void)
+{
+    sample_codec_dec_t dec;
+    int64_t t = 1700000000000000;
+
+    for (size_t i = 0; i < SERIES_LEN; i++) {
+        uint32_t bits = rng();
+        switch (rng() % 4) {
+        case 0: t += 50000; break;
+        case 1: t += (int64_t)(rng() % 2000000) - 1000000; break;
+        case 2: break;
+        default: t += (int64_t)rng() << 8; break;
+        }
+        ts[i] = t;
+        memcpy(&vals[i], &bits, sizeof(bits));
+    }
+    vals[10] = INFINITY;
+    vals[11] = -0.0f;
+    vals[12] = 1e-42f;
+
+    size_t len = encode(1, 0, SERIES_LEN);
+    CHECK(sample_codec_dec_init(&dec, stream, len));
+
+    size_t n = 0;
+    int64_t t_out;
+    float v_out;
+    while (sample_codec_dec_next(&dec, &t_out, &v_out)) {
+        CHECK(n < SERIES_LEN);
+        if (n < SERIES_LEN) {
+            CHECK(t_out == ts[n]);
+            CHECK(memcmp(&v_out, &vals[n], sizeof(float)) == 0);
+        }
+        n++;
+    }
+    CHECK(n == SERIES_LEN);
+    CHECK(!dec.error);
+}
+
+// Times are truncated to the unit, values rounded to 1 / scale
+static void test_fixed_point(void)
+{
+    sample_codec_dec_t dec;
+    int64_t t = 0;
+
+    for (size_t i = 0; i < SERIES_LEN; i++) {
+        t += 49000 + rng() % 2000;
+        ts[i] = t;
+        vals[i] = (float)((int32_t)(rng() % 200000) - 100000) / 997.0f;
+    }
+    vals[5] = NAN;      // Saturates to the lowest code
+    vals[6] = 1e12f;    // Saturates to the highest code
+
+    size_t len = encode(1000, 100, SERIES_LEN);
+    CHECK(sample_codec_dec_init(&dec, stream, len));
+    for (size_t i = 0; i < SERIES_LEN; i++) {
+        int64_t t_out;
+        float v_out;
+        CHECK(sample_codec_dec_next(&dec, &t_out, &v_out));
+        CHECK(t_out == ts[i] / 1000 * 1000);
+        if (i == 5) {
+            CHECK(v_out == (float)INT32_MIN / 100);
+        } else if (i == 6) {
+            CHECK(v_out == (float)INT32_MAX / 100);
+        } else {
+            CHECK_NEAR(v_out, vals[i], 0.5 / 100 + fabsf(vals[i]) * 1e-6);
+        }
+    }
+}
+
+static void test_full_buffer(void)
+{
+    sample_codec_enc_t enc;
+    sample_codec_dec_t dec;
+    uint8_t small[40];
+    size_t accepted = 0;
+
+    CHECK(!sample_codec_enc_init(&enc, small, SAMPLE_CODEC_MAX_HEADER - 1, 1000, 0));
+    CHECK(!sample_codec_enc_init(&enc, small, sizeof(small), 0, 0));
+    CHECK(sample_codec_enc_init(&enc, small, sizeof(small), 1000, 0));
+
+    for (int i = 0; i < 40; i++) {
+        size_t before = sample_codec_enc_len(&enc);
+        if (sample_codec_enc_put(&enc, i * 1000000LL, 1.5f * (float)i)) {
+            CHECK(accepted == (size_t)i);   // Nothing is accepted after a refusal
+            accepted++;
+        } else {
+            CHECK(sample_codec_enc_len(&enc) == before);
+        }
+    }
+    CHECK(accepted > 0 && accepted < 40);
+    CHECK(sample_codec_enc_len(&enc) <= sizeof(small));
+
+    CHECK(sample_codec_dec_init(&dec, small, sample_codec_enc_len(&enc)));
+    int64_t t;
+    float v;
+    size_t n = 0;
+    while (sample_codec_dec_next(&dec, &t, &v)) {
+        CHECK(t == (int64_t)n * 1000000);
+        CHECK(v == 1.5f * (float)n);
+        n++;
+    }
+    CHECK(n == accepted);
+    CHECK(!dec.error);
+}
+
+// Truncated and corrupted streams end with an error, never read past the
+// end (checked under -fsanitize=address) and never hit undefined behaviour
+static void test_malformed(void)
+{
+    sample_codec_dec_t dec;
+    uint8_t bad_version[] = {2, 1, 0};
+    uint8_t zero_unit[] = {1, 0, 0};
+    uint8_t endless[16];
+    int64_t t;
+    float v;
+
+    CHECK(!sample_codec_dec_init(&dec, bad_version, sizeof(bad_version)));
+    CHECK(!sample_codec_dec_init(&dec, zero_unit, sizeof(zero_unit)));
+    CHECK(!sample_codec_dec_init(&dec, NULL, 10));
+
+    memset(endless, 0xFF, sizeof(endless));
+    endless[0] = 1;
+    endless[1] = 1;
+    endless[2] = 0;
+    CHECK(sample_codec_dec_init(&dec, endless, sizeof(endless)));
+    CHECK(!sample_codec_dec_next(&dec, &t, &v));
+    CHECK(dec.error);
+
+    // Every truncation of a valid stream
+    for (size_t i = 0; i < 50; i++) {
+        ts[i] = (int64_t)i * 50000;
+        vals[i] = (float)i;
+    }
+    size_t len = encode(1, 0, 50);
+    for (size_t cut = 0; cut < len; cut++) {
+        uint8_t *copy = malloc(cut ? cut : 1);
+        memcpy(copy, stream, cut);
+        if (sample_codec_dec_init(&dec, copy, cut)) {
+            size_t n = 0;
+            while (sample_codec_dec_next(&dec, &t, &v)) {
+                CHECK(t == ts[n] && v == vals[n]);
+                n++;
+            }
+            CHECK(n <= 50);
+        }
+        free(copy);
+    }
+
+    // Random bytes after a valid header
+    for (int round = 0; round < 20000; round++) {
+        uint8_t junk[64];
+        size_t n = 3 + rng() % (sizeof(junk) - 3);
+        junk[0] = 1;
+        junk[1] = (uint8_t)(1 + rng() % 127);
+        junk[2] = (uint8_t)(rng() % 128);
+        for (size_t i = 3; i < n; i++) {
+            junk[i] = (uint8_t)rng();
+        }
+        CHECK(sample_codec_dec_init(&dec, junk, n));
+        for (int k = 0; k < 64 && sample_codec_dec_next(&dec, &t, &v); k++) {
+        }
+    }
+}
+
+// Series shaped like the telemetry: 20 S/s from the sample clock with
+// scheduling jitter, LM35 temperature with ADC noise, wind speed steps
+static void test_sensor_series(void)
+{
+    const size_t n = SERIES_LEN;
+    int64_t t = 5000000;
+    float temp = 24.0f;
+    float wind = 0.0f;
+
+    for (size_t i = 0; i < n; i++) {
+        t += 50000 + (int64_t)(rng() % 101) - 50;
+        ts[i] = t;
+        temp += 0.002f;
+        vals[i] = temp + (float)((int)(rng() % 5) - 2) * 0.08f;
+    }
+
+    size_t json = 0;
+    char line[64];
+    for (size_t i = 0; i < n; i++) {
+        json += (size_t)snprintf(line, sizeof(line), "{\"t\":%lld,\"v\":%.2f},", (long long)ts[i], vals[i]);
+    }
+    size_t raw = n * (sizeof(int64_t) + sizeof(float));
+    size_t lossless = encode(1, 0, n);
+    size_t fixed_ms = encode(1000, 100, n);
+
+    printf("temperature, %zu samples: json %zu B, raw %zu B, lossless us %zu B (%.2f B/sample), "
+           "ms + 0.01 %zu B (%.2f B/sample, %.1fx vs json)\n",
+           n, json, raw, lossless, (double)lossless / n, fixed_ms, (double)fixed_ms / n, (double)json / fixed_ms);
+    CHECK(lossless < raw);
+    CHECK(fixed_ms < n * 3);
+
+    for (size_t i = 0; i < n; i++) {
+        if (i % 200 == 0) {
+            wind = (float)(rng() % 300) / 10.0f;
+        }
+        vals[i] = wind;
+    }
+    fixed_ms = encode(1000, 100, n);
+    printf("wind steps, %zu samples: ms + 0.01 %zu B (%.2f B/sample)\n", n, fixed_ms, (double)fixed_ms / n);
+    CHECK(fixed_ms < n * 5 / 2);
+}
+
+int main(void)
+{
+    test_lossless();
+    test_fixed_point();
+    test_full_buffer();
+    test_malformed();
+    test_sensor_series();
+    HOST_TEST_END();
+}
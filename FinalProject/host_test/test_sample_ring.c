@@ -0,0 +1,227 @@
+/**
+ * @file test_sample_ring.c
+ * @author David Ramírez Betancourth
+ * @brief sample_ring: wrap-around, overrun accounting and a two-thread
+ * stress run mixing the copying and zero-copy paths
+ */
+
+#include "sample_ring.h"
+#include "host_test.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+#define STRESS_SAMPLES  4000000
+#define STRESS_CAPACITY 1024
+
+static sample_t make_sample(uint64_t seq)
+{
+    return (sample_t) {
+        .timestamp_us = (int64_t)seq,
+        .value = (float)(seq & 0xFFFF),
+        .source = (uint8_t)seq,
+    };
+}
+
+static bool sample_ok(const sample_t *s)
+{
+    uint64_t seq = (uint64_t)s->timestamp_us;
+    return s->value == (float)(seq & 0xFFFF) && s->source == (uint8_t)seq;
+}
+
+static void test_basic(void)
+{
+    sample_t storage[8];
+    sample_t in[12];
+    sample_t out[12];
+    sample_ring_t ring;
+    sample_ring_stats_t stats;
+
+    CHECK(!sample_ring_init(&ring, storage, 6));
+    CHECK(!sample_ring_init(&ring, NULL, 8));
+    CHECK(sample_ring_init(&ring, storage, 8));
+
+    for (int i = 0; i < 12; i++) {
+        in[i] = make_sample((uint64_t)i);
+    }
+
+    // Move the indices off zero so the next batch wraps
+    CHECK(sample_ring_push(&ring, in, 5) == 5);
+    CHECK(sample_ring_pop(&ring, out, 5) == 5);
+    CHECK(sample_ring_push(&ring, in, 12) == 8);
+    CHECK(sample_ring_count(&ring) == 8);
+    CHECK(sample_ring_pop(&ring, out, 12) == 8);
+    for (int i = 0; i < 8; i++) {
+        CHECK(out[i].timestamp_us == i);
+    }
+
+    sample_ring_get_stats(&ring, &stats);
+    CHECK(stats.pushed == 13);
+    CHECK(stats.popped == 13);
+    CHECK(stats.dropped == 4);
+    CHECK(stats.overruns == 1);
+    CHECK(stats.high_water == 8);
+    CHECK(stats.capacity == 8);
+
+    // Reserve stops at the end of the buffer, the remainder comes next
+    sample_t *span;
+    CHECK(sample_ring_reserve(&ring, &span, 6) == 3);
+    CHECK(span == &storage[5]);
+    sample_ring_commit(&ring, 3);
+    CHECK(sample_ring_reserve(&ring, &span, 3) == 3);
+    CHECK(span == &storage[0]);
+    sample_ring_commit(&ring, 3);
+
+    const sample_t *view;
+    CHECK(sample_ring_peek(&ring, &view) == 3);
+    CHECK(view == &storage[5]);
+    sample_ring_release(&ring, 3);
+    CHECK(sample_ring_peek(&ring, &view) == 3);
+    sample_ring_release(&ring, 3);
+    CHECK(sample_ring_peek(&ring, &view) == 0);
+}
+
+//-----------------------------------Stress-------------------------------------------
+
+static sample_ring_t stress_ring;
+static sample_t stress_storage[STRESS_CAPACITY];
+
+// Producer alternates push() and reserve()/commit() with varying batch
+// sizes; whatever does not fit is dropped, as the acquisition task does
+static void *producer(void *arg)
+{
+    sample_t batch[97];
+    uint64_t seq = 0;
+    unsigned batch_len = 1;
+
+    (void)arg;
+    while (seq < STRESS_SAMPLES) {
+        batch_len = batch_len % 97 + 1;
+        if (seq + batch_len > STRESS_SAMPLES) {
+            batch_len = (unsigned)(STRESS_SAMPLES - seq);
+        }
+
+        if (batch_len & 1) {
+            for (unsigned i = 0; i < batch_len; i++) {
+                batch[i] = make_sample(seq + i);
+            }
+            sample_ring_push(&stress_ring, batch, batch_len);
+        } else {
+            unsigned done = 0;
+            while (done < batch_len) {
+                sample_t *span;
+                size_t n = sample_ring_reserve(&stress_ring, &span, batch_len - done);
+                if (n == 0) {
+                    break;
+                }
+                for (size_t i = 0; i < n; i++) {
+                    span[i] = make_sample(seq + done + i);
+                }
+                sample_ring_commit(&stress_ring, n);
+                done += (unsigned)n;
+            }
+            sample_ring_drop(&stress_ring, batch_len - done);
+        }
+        seq += batch_len;
+        if ((seq & 0x3FF) < batch_len) {
+            sched_yield();
+        }
+    }
+
+    // Closing sample, retried until it fits so the consumer knows to stop
+    sample_t *span;
+    while (sample_ring_reserve(&stress_ring, &span, 1) == 0) {
+        sched_yield();
+    }
+    *span = make_sample(STRESS_SAMPLES);
+    sample_ring_commit(&stress_ring, 1);
+    return NULL;
+}
+
+typedef struct {
+    uint64_t received;
+    uint64_t gaps;          // Samples missing between consecutive reads
+    uint64_t corrupt;
+    uint64_t out_of_order;
+} consumer_result_t;
+
+static void consume(consumer_result_t *r, const sample_t *s, int64_t *last)
+{
+    if (!sample_ok(s)) {
+        r->corrupt++;
+    }
+    if (s->timestamp_us <= *last) {
+        r->out_of_order++;
+    } else {
+        r->gaps += (uint64_t)(s->timestamp_us - *last - 1);
+    }
+    *last = s->timestamp_us;
+    r->received++;
+}
+
+// Consumer alternates pop() and peek()/release()
+static void *consumer(void *arg)
+{
+    consumer_result_t *r = arg;
+    sample_t out[61];
+    int64_t last = -1;
+    unsigned turn = 0;
+
+    while (last < STRESS_SAMPLES) {
+        size_t n;
+        if (++turn & 1) {
+            n = sample_ring_pop(&stress_ring, out, 61);
+            for (size_t i = 0; i < n; i++) {
+                consume(r, &out[i], &last);
+            }
+        } else {
+            const sample_t *view;
+            n = sample_ring_peek(&stress_ring, &view);
+            for (size_t i = 0; i < n; i++) {
+                consume(r, &view[i], &last);
+            }
+            sample_ring_release(&stress_ring, n);
+        }
+        if (n == 0) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void test_stress(void)
+{
+    pthread_t prod;
+    pthread_t cons;
+    consumer_result_t result = {0};
+    sample_ring_stats_t stats;
+
+    CHECK(sample_ring_init(&stress_ring, stress_storage, STRESS_CAPACITY));
+
+    pthread_create(&cons, NULL, consumer, &result);
+    pthread_create(&prod, NULL, producer, NULL);
+    pthread_join(prod, NULL);
+    pthread_join(cons, NULL);
+
+    sample_ring_get_stats(&stress_ring, &stats);
+    printf("stress: %llu received, %u dropped in %u overruns, high water %zu\n",
+           (unsigned long long)result.received, (unsigned)stats.dropped, (unsigned)stats.overruns,
+           stats.high_water);
+
+    CHECK(result.corrupt == 0);
+    CHECK(result.out_of_order == 0);
+    CHECK(stats.pushed == stats.popped);
+    CHECK(stats.popped == result.received);
+    CHECK(stats.high_water <= STRESS_CAPACITY);
+    // Every sample is either delivered or counted as dropped
+    CHECK(result.gaps == stats.dropped);
+    CHECK(result.received + stats.dropped == (uint64_t)STRESS_SAMPLES + 1);
+}
+
+int main(void)
+{
+    test_basic();
+    test_stress();
+    HOST_TEST_END();
+}
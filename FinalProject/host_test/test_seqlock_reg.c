@@ -0,0 +1,150 @@
+/**
+ * @file test_seqlock_reg.c
+ * @author David Ramírez Betancourth
+ * @brief seqlock_reg: one writer thread against several readers, every
+ * copy checked for tearing
+ *
+ * Write n stores a value whose four words and two timestamp halves are all
+ * derived from n, so any copy mixing two writes is caught. Readers also
+ * check that the version they get is n and never goes backwards.
+ */
+
+#include "seqlock_reg.h"
+#include "host_test.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+#define WRITES   2000000
+#define READERS  4
+
+typedef struct {
+    uint32_t a, b, c, d;
+} value_t;
+
+typedef struct {
+    pthread_t thread;
+    uint64_t reads;
+    uint64_t torn;
+    uint64_t backwards;
+    uint64_t changes;           // Reads that saw a newer version than the previous one
+} reader_t;
+
+static seqlock_reg_t reg;
+static atomic_bool writing;
+static uint32_t bad_versions;      // Writes that did not return their own number
+
+static value_t make_value(uint32_t n)
+{
+    return (value_t) {n, ~n, n * 2654435761u, n ^ 0xA5A5A5A5u};
+}
+
+static int64_t make_timestamp(uint32_t n)
+{
+    // Both halves change on every write
+    return (int64_t)(((uint64_t)(n * 40503u) << 32) | n);
+}
+
+static void *writer(void *arg)
+{
+    (void)arg;
+    for (uint32_t n = 1; n <= WRITES; n++) {
+        value_t v = make_value(n);
+        if (seqlock_reg_write(&reg, &v, sizeof(v), make_timestamp(n)) != n) {
+            bad_versions++;
+        }
+        if ((n & 0xFFF) == 0) {
+            sched_yield();
+        }
+    }
+    atomic_store(&writing, false);
+    return NULL;
+}
+
+static void *reader(void *arg)
+{
+    reader_t *r = arg;
+    uint32_t last = 0;
+
+    while (atomic_load(&writing)) {
+        value_t v;
+        int64_t ts;
+        uint32_t version = seqlock_reg_read(&reg, &v, sizeof(v), &ts);
+        value_t expected = make_value(version);
+
+        r->reads++;
+        if (version == 0) {
+            continue;               // Nothing written yet
+        }
+        if (v.a != expected.a || v.b != expected.b || v.c != expected.c || v.d != expected.d ||
+            ts != make_timestamp(version)) {
+            r->torn++;
+        }
+        if (version < last) {
+            r->backwards++;
+        } else if (version > last) {
+            r->changes++;
+        }
+        last = version;
+    }
+    return NULL;
+}
+
+static void test_single_thread(void)
+{
+    value_t v = make_value(7);
+    value_t out = {0};
+    int64_t ts = -1;
+    uint16_t small = 0x1234;
+    uint16_t small_out = 0;
+
+    seqlock_reg_init(&reg);
+    CHECK(seqlock_reg_read(&reg, &out, sizeof(out), &ts) == 0);
+    CHECK(ts == 0 && out.a == 0);
+    CHECK(seqlock_reg_version(&reg) == 0);
+
+    CHECK(seqlock_reg_write(&reg, &v, sizeof(v), -5) == 1);
+    CHECK(seqlock_reg_read(&reg, &out, sizeof(out), &ts) == 1);
+    CHECK(out.a == v.a && out.d == v.d && ts == -5);
+    CHECK(seqlock_reg_read(&reg, &out, sizeof(out), NULL) == 1);
+
+    // Values shorter than a word, and reads of part of a value
+    CHECK(seqlock_reg_write(&reg, &small, sizeof(small), 9) == 2);
+    CHECK(seqlock_reg_read(&reg, &small_out, sizeof(small_out), &ts) == 2);
+    CHECK(small_out == small && ts == 9);
+    CHECK(seqlock_reg_version(&reg) == 2);
+}
+
+static void test_readers_vs_writer(void)
+{
+    static reader_t readers[READERS];
+    pthread_t writer_thread;
+
+    seqlock_reg_init(&reg);
+    atomic_store(&writing, true);
+    for (int i = 0; i < READERS; i++) {
+        pthread_create(&readers[i].thread, NULL, reader, &readers[i]);
+    }
+    pthread_create(&writer_thread, NULL, writer, NULL);
+
+    pthread_join(writer_thread, NULL);
+    CHECK(bad_versions == 0);
+    for (int i = 0; i < READERS; i++) {
+        reader_t *r = &readers[i];
+        pthread_join(r->thread, NULL);
+        printf("reader %d: %llu reads, %llu new versions seen, %llu torn, %llu backwards\n", i,
+               (unsigned long long)r->reads, (unsigned long long)r->changes, (unsigned long long)r->torn,
+               (unsigned long long)r->backwards);
+        CHECK(r->torn == 0);
+        CHECK(r->backwards == 0);
+        CHECK(r->changes > 0);
+    }
+    CHECK(seqlock_reg_version(&reg) == WRITES);
+}
+
+int main(void)
+{
+    test_single_thread();
+    test_readers_vs_writer();
+    HOST_TEST_END();
+}
@@ -0,0 +1,217 @@
+/**
+ * @file test_stream_align.c
+ * @author David Ramírez Betancourth
+ * @brief stream_align: two streams with a timestamp skew, a rate mismatch
+ * and delivery delays, checked against the signals they sample
+ *
+ * Both streams sample known functions of time. Every pair must carry the
+ * reference sample untouched and the other stream within the linear
+ * interpolation bound, h^2 / 8 * max|g''|, of its true value at the
+ * reference timestamp.
+ */
+
+#include "stream_align.h"
+#include "host_test.h"
+
+#include <stdlib.h>
+
+#define REF      0
+#define OTHER    1
+#define PERIOD_US 50000                     // 20 readings/s, as in main.c
+#define RUN_US   ((int64_t)600 * 1000000)   // 10 minutes
+#define MAX_LEN  ((size_t)(RUN_US / (PERIOD_US / 2)))
+#define MAX_GAP_US (3 * PERIOD_US)
+
+#define SIGNAL_PERIOD_S 10.0
+#define OTHER_AMPL 5.0
+
+typedef struct {
+    double skew_us;         // Other stream timestamps offset from the reference
+    double rate;            // Other stream rate / reference rate
+    int64_t ref_delay_us;   // Delivery delay of each stream
+    int64_t other_delay_us;
+    size_t gap_at;          // Other samples [gap_at, gap_at + gap_len) are lost
+    size_t gap_len;
+} scenario_t;
+
+typedef struct {
+    size_t pairs;
+    size_t expected;
+    uint32_t dropped;
+    double worst;           // Worst |other - g(t)| over the pairs
+} result_t;
+
+static double ref_signal(int64_t t_us)
+{
+    return 40.0 + 3.0 * cos(2.0 * M_PI * (double)t_us * 1e-6 / SIGNAL_PERIOD_S);
+}
+
+static double other_signal(int64_t t_us)
+{
+    return 25.0 + OTHER_AMPL * sin(2.0 * M_PI * (double)t_us * 1e-6 / SIGNAL_PERIOD_S);
+}
+
+static double interp_bound(double h_us)
+{
+    double w = 2.0 * M_PI / SIGNAL_PERIOD_S;
+    double h = h_us * 1e-6;
+    return OTHER_AMPL * w * w * h * h / 8.0;
+}
+
+static result_t run(const scenario_t *sc)
+{
+    static sample_t ref[MAX_LEN];
+    static sample_t other[MAX_LEN];
+    size_t n_ref = 0;
+    size_t n_other = 0;
+    result_t res = {0};
+    stream_align_t align;
+    aligned_pair_t out[STREAM_ALIGN_PENDING];
+
+    for (int64_t t = 0; t < RUN_US; t += PERIOD_US) {
+        ref[n_ref++] = (sample_t) {.timestamp_us = t, .value = (float)ref_signal(t), .source = REF};
+    }
+    for (size_t k = 0;; k++) {
+        int64_t t = (int64_t)llround(sc->skew_us + (double)k * PERIOD_US / sc->rate);
+        if (t >= RUN_US) {
+            break;
+        }
+        if (k >= sc->gap_at && k < sc->gap_at + sc->gap_len) {
+            continue;
+        }
+        other[n_other++] = (sample_t) {.timestamp_us = t, .value = (float)other_signal(t), .source = OTHER};
+    }
+
+    // Reference samples the other stream covers without a gap wider than MAX_GAP_US
+    for (size_t i = 0, j = 0; i < n_ref; i++) {
+        int64_t t = ref[i].timestamp_us;
+        while (j + 1 < n_other && other[j + 1].timestamp_us < t) {
+            j++;
+        }
+        if (t == other[j].timestamp_us ||
+            (j + 1 < n_other && other[j].timestamp_us <= t && t <= other[j + 1].timestamp_us &&
+             other[j + 1].timestamp_us - other[j].timestamp_us <= MAX_GAP_US)) {
+            res.expected++;
+        }
+    }
+
+    // Deliver both streams in arrival order
+    stream_align_init(&align, REF, OTHER, MAX_GAP_US);
+    size_t i = 0;
+    size_t j = 0;
+    int64_t last_pair_us = -1;
+    while (i < n_ref || j < n_other) {
+        bool take_ref = j == n_other ||
+                        (i < n_ref && ref[i].timestamp_us + sc->ref_delay_us <= other[j].timestamp_us + sc->other_delay_us);
+        const sample_t *s = take_ref ? &ref[i++] : &other[j++];
+        size_t n = stream_align_push(&align, s, out, STREAM_ALIGN_PENDING);
+
+        for (size_t k = 0; k < n; k++) {
+            // The reference sample comes through untouched, in order
+            CHECK(out[k].timestamp_us > last_pair_us);
+            CHECK(out[k].timestamp_us % PERIOD_US == 0);
+            CHECK(out[k].ref == ref[out[k].timestamp_us / PERIOD_US].value);
+            last_pair_us = out[k].timestamp_us;
+
+            double err = fabs(out[k].other - other_signal(out[k].timestamp_us));
+            if (err > res.worst) {
+                res.worst = err;
+            }
+        }
+        res.pairs += n;
+    }
+    res.dropped = align.dropped;
+    return res;
+}
+
+static void check_scenario(const char *name, const scenario_t *sc)
+{
+    result_t r = run(sc);
+    double bound = interp_bound(PERIOD_US / sc->rate) + 1e-4;   // Plus float rounding
+
+    printf("%-28s pairs %5zu/%5zu dropped %3u, worst error %.2e (bound %.2e)\n", name, r.pairs, r.expected,
+           (unsigned)r.dropped, r.worst, bound);
+    CHECK(r.pairs == r.expected);
+    CHECK(r.worst <= bound);
+}
+
+static void test_skew_and_rate(void)
+{
+    static const double skews_us[] = {0, 17000, -23000, PERIOD_US - 1};
+    static const double rates[] = {1.0, 1.0005, 0.995, 1.02};
+    char name[64];
+
+    for (size_t s = 0; s < sizeof(skews_us) / sizeof(skews_us[0]); s++) {
+        for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+            scenario_t sc = {.skew_us = skews_us[s], .rate = rates[r]};
+            snprintf(name, sizeof(name), "skew %+6.0f us rate %.4f", skews_us[s], rates[r]);
+            check_scenario(name, &sc);
+        }
+    }
+}
+
+// adc_task sees the streams in blocks: the other stream may trail by many
+// readings (up to the pending queue) or lead by less than one
+static void test_delivery_delay(void)
+{
+    static const int64_t delays_us[] = {PERIOD_US / 2, 3 * PERIOD_US, 10 * PERIOD_US, 14 * PERIOD_US};
+    char name[64];
+
+    for (size_t d = 0; d < sizeof(delays_us) / sizeof(delays_us[0]); d++) {
+        scenario_t sc = {.skew_us = 7000, .rate = 1.001, .other_delay_us = delays_us[d]};
+        snprintf(name, sizeof(name), "other %lld ms late", (long long)(delays_us[d] / 1000));
+        check_scenario(name, &sc);
+    }
+
+    scenario_t lead = {.skew_us = -7000, .rate = 0.999, .ref_delay_us = 3 * PERIOD_US / 4};
+    check_scenario("other 37 ms early", &lead);
+}
+
+// Reference samples inside a gap wider than max_gap_us are dropped, the
+// ones on either side are still paired
+static void test_gap(void)
+{
+    scenario_t short_gap = {.skew_us = 11000, .rate = 1.0, .gap_at = 1000, .gap_len = 2};
+    scenario_t long_gap = {.skew_us = 11000, .rate = 1.0, .gap_at = 1000, .gap_len = 5};
+
+    check_scenario("2 readings lost", &short_gap);
+    result_t r = run(&long_gap);
+    check_scenario("5 readings lost", &long_gap);
+    CHECK(r.dropped > 0);
+}
+
+// Other stream stalled past the pending queue: the oldest reference
+// samples are given up one by one, the newest are still paired
+static void test_stall(void)
+{
+    stream_align_t align;
+    aligned_pair_t out[STREAM_ALIGN_PENDING];
+    sample_t s = {.source = OTHER, .timestamp_us = 0, .value = 1.0f};
+
+    stream_align_init(&align, REF, OTHER, (int64_t)100000);
+    CHECK(stream_align_push(&align, &s, out, STREAM_ALIGN_PENDING) == 0);
+    for (int k = 1; k <= STREAM_ALIGN_PENDING + 4; k++) {
+        sample_t r = {.source = REF, .timestamp_us = (int64_t)k * 1000, .value = (float)k};
+        CHECK(stream_align_push(&align, &r, out, STREAM_ALIGN_PENDING) == 0);
+    }
+    CHECK(align.dropped == 4);
+
+    s.timestamp_us = (STREAM_ALIGN_PENDING + 4) * 1000;
+    s.value = 1.0f + (float)(STREAM_ALIGN_PENDING + 4);
+    CHECK(stream_align_push(&align, &s, out, STREAM_ALIGN_PENDING) == STREAM_ALIGN_PENDING);
+    CHECK(out[0].timestamp_us == 5000 && out[0].other == 6.0f);
+    CHECK(out[STREAM_ALIGN_PENDING - 1].other == s.value);
+
+    // Samples of other sources are ignored
+    s.source = 7;
+    CHECK(stream_align_push(&align, &s, out, STREAM_ALIGN_PENDING) == 0);
+}
+
+int main(void)
+{
+    test_skew_and_rate();
+    test_delivery_delay();
+    test_gap();
+    test_stall();
+    HOST_TEST_END();
+}
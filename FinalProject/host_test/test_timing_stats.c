@@ -0,0 +1,144 @@
+/**
+ * @file test_timing_stats.c
+ * @author David Ramírez Betancourth
+ * @brief timing_stats: summary fields, bucket layout and percentiles
+ * against the exact order statistic of a known distribution
+ */
+
+#include "timing_stats.h"
+#include "host_test.h"
+
+#include <stdlib.h>
+
+#define SAMPLES 100000
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15u;
+
+static double uniform(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return ((rng_state >> 11) + 0.5) / 9007199254740992.0;
+}
+
+static int cmp_int64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a;
+    int64_t y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void test_empty_and_clamp(void)
+{
+    static timing_stats_t stats;
+    timing_summary_t s;
+
+    timing_stats_init(&stats);
+    timing_stats_summary(&stats, &s);
+    CHECK(s.count == 0 && s.min_us == 0 && s.mean_us == 0 && s.max_us == 0 && s.p99_us == 0);
+    CHECK(timing_stats_percentile(&stats, 500) == 0);
+
+    // Negative durations (clock stepped back) count as 0
+    timing_stats_record(&stats, -5);
+    timing_stats_record(&stats, 10);
+    timing_stats_record(&stats, 20);
+    timing_stats_summary(&stats, &s);
+    CHECK(s.count == 3 && s.min_us == 0 && s.mean_us == 10 && s.max_us == 20);
+    CHECK(timing_stats_percentile(&stats, 1) == 0);
+
+    // init clears
+    timing_stats_init(&stats);
+    timing_stats_summary(&stats, &s);
+    CHECK(s.count == 0 && s.max_us == 0);
+}
+
+// Below 8 us every value has its own bucket, so percentiles are exact
+static void test_exact_low_range(void)
+{
+    static timing_stats_t stats;
+
+    timing_stats_init(&stats);
+    for (int v = 0; v < 8; v++) {
+        for (int i = 0; i < 10; i++) {
+            timing_stats_record(&stats, v);
+        }
+    }
+    for (int v = 0; v < 8; v++) {
+        // Rank 10 * (v + 1) of 80 is the last copy of v
+        CHECK(timing_stats_percentile(&stats, (uint32_t)(125 * (v + 1))) == v);
+    }
+}
+
+// A single value comes back within half a bucket (6.25 %) at every scale
+// the histogram resolves; past 2^27 us everything lands in the last bucket
+static void test_range(void)
+{
+    static timing_stats_t stats;
+
+    for (int64_t v = 8; v < ((int64_t)1 << 27); v = v * 9 / 8 + 1) {
+        timing_stats_init(&stats);
+        timing_stats_record(&stats, v);
+        int64_t p = timing_stats_percentile(&stats, 500);
+        CHECK(llabs(p - v) <= v / 16 + 1);
+    }
+
+    int64_t top = ((int64_t)1 << 27) - 1;
+    timing_stats_init(&stats);
+    timing_stats_record(&stats, top);
+    int64_t last = timing_stats_percentile(&stats, 500);
+    CHECK(llabs(last - top) <= top / 16);
+
+    timing_stats_init(&stats);
+    timing_stats_record(&stats, (int64_t)3600 * 1000000);
+    CHECK(timing_stats_percentile(&stats, 500) == last);
+    timing_summary_t s;
+    timing_stats_summary(&stats, &s);
+    CHECK(s.max_us == (int64_t)3600 * 1000000);
+}
+
+// Exponential latencies (mean 500 us) plus a 1 % tail around 20 ms, the
+// shape adc_task sees: every estimate within a bucket of the exact value
+static void test_percentiles(void)
+{
+    static timing_stats_t stats;
+    static int64_t sorted[SAMPLES];
+    static const uint32_t permille[] = {10, 100, 500, 900, 950, 990, 999, 1000};
+    int64_t sum = 0;
+
+    timing_stats_init(&stats);
+    for (int i = 0; i < SAMPLES; i++) {
+        double v = -500.0 * log(uniform());
+        if (i % 100 == 0) {
+            v = 20000.0 + 2000.0 * uniform();
+        }
+        sorted[i] = (int64_t)v;
+        sum += sorted[i];
+        timing_stats_record(&stats, sorted[i]);
+    }
+    qsort(sorted, SAMPLES, sizeof(sorted[0]), cmp_int64);
+
+    for (size_t k = 0; k < sizeof(permille) / sizeof(permille[0]); k++) {
+        size_t rank = ((size_t)SAMPLES * permille[k] + 999) / 1000;
+        int64_t exact = sorted[rank - 1];
+        int64_t est = timing_stats_percentile(&stats, permille[k]);
+        printf("p%-5.1f exact %6lld us, estimate %6lld us\n", permille[k] / 10.0, (long long)exact, (long long)est);
+        CHECK(llabs(est - exact) <= exact / 8 + 1);
+    }
+
+    timing_summary_t s;
+    timing_stats_summary(&stats, &s);
+    CHECK(s.count == SAMPLES);
+    CHECK(s.min_us == sorted[0] && s.max_us == sorted[SAMPLES - 1]);
+    CHECK(s.mean_us == sum / SAMPLES);
+    CHECK(s.p99_us == timing_stats_percentile(&stats, 990));
+}
+
+int main(void)
+{
+    test_empty_and_clamp();
+    test_exact_low_range();
+    test_range();
+    test_percentiles();
+    HOST_TEST_END();
+}
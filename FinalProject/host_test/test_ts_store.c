@@ -0,0 +1,286 @@
+/**
+ * @file test_ts_store.c
+ * @author David Ramírez Betancourth
+ * @brief ts_store tiers, aggregates, paged queries and tier selection
+ *
+ * The roll-up tests feed irregular, gappy series and compare every tier
+ * with aggregates recomputed from the samples themselves, including after
+ * the 1 s and 1 min rings have wrapped.
+ */
+
+#include "ts_store.h"
+#include "host_test.h"
+
+#define START_US   10000000LL   // First sample at 10 s
+#define PERIOD_US  50000LL      // 20 S/s
+#define SAMPLES    3600         // 3 minutes
+
+#define ROLLUP_MAX  20000
+
+static ts_store_t store;
+
+typedef struct {
+    uint32_t t_ms;
+    int16_t q;              // Value as stored, scale 100
+} sample_t;
+
+static sample_t series[ROLLUP_MAX];
+static uint64_t rng_state = 0x9E3779B97F4A7C15u;
+
+static uint32_t rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)(rng_state >> 32);
+}
+
+// 0, 0.5, ... 9.5 repeating every second
+static float value_at(int i)
+{
+    return (float)(i % 20) * 0.5f;
+}
+
+static void fill(void)
+{
+    ts_store_init(&store, "wind", 100.0f);
+    for (int i = 0; i < SAMPLES; i++) {
+        ts_store_insert(&store, START_US + i * PERIOD_US, value_at(i));
+    }
+}
+
+// Page through the last minute the way the console and HTTP history do
+static void test_paging(void)
+{
+    ts_point_t page[64];
+    int64_t now = START_US + SAMPLES * PERIOD_US;
+    int64_t from = now - 60000000;
+    int64_t last = -1;
+    size_t total = 0;
+    size_t n;
+    int pages = 0;
+
+    while ((n = ts_store_query(&store, TS_TIER_RAW, from, now, page, 64)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            CHECK(page[i].timestamp_us > last);
+            int idx = (int)((page[i].timestamp_us - START_US) / PERIOD_US);
+            CHECK(page[i].mean == value_at(idx));
+            last = page[i].timestamp_us;
+        }
+        total += n;
+        pages++;
+        CHECK(pages < 100);
+        if (n < 64 || pages >= 100) {
+            break;
+        }
+        from = page[n - 1].timestamp_us + TS_STORE_TICK_US;
+    }
+
+    // The raw tier holds the last TS_STORE_RAW_LEN samples, all within the minute
+    CHECK(total == TS_STORE_RAW_LEN);
+    CHECK(last == START_US + (SAMPLES - 1) * PERIOD_US);
+}
+
+static void test_aggregates(void)
+{
+    static ts_point_t sec[TS_STORE_SEC_LEN];
+    ts_point_t min[4];
+    int64_t now = START_US + SAMPLES * PERIOD_US;
+
+    // 180 intervals started, the last one is still open
+    size_t n = ts_store_query(&store, TS_TIER_SEC, 0, now, sec, TS_STORE_SEC_LEN);
+    CHECK(n == SAMPLES / 20 - 1);
+    CHECK(sec[0].timestamp_us == START_US);
+    for (size_t i = 0; i < n; i++) {
+        CHECK(sec[i].min == 0.0f);
+        CHECK(sec[i].max == 9.5f);
+        CHECK_NEAR(sec[i].mean, 4.75, 0.006);
+        CHECK(sec[i].timestamp_us == START_US + (int64_t)i * 1000000);
+    }
+
+    // Samples span 10 s .. 190 s: minutes 0, 1 and 2 are closed, 3 is open
+    n = ts_store_query(&store, TS_TIER_MIN, 0, now, min, 4);
+    CHECK(n == 3);
+    CHECK(min[0].timestamp_us == 0);
+    CHECK(min[2].timestamp_us == 120000000);
+    CHECK_NEAR(min[1].mean, 4.75, 0.006);
+}
+
+static void test_best_tier(void)
+{
+    int64_t now = START_US + SAMPLES * PERIOD_US;
+
+    CHECK(ts_store_best_tier(&store, now - 30000000) == TS_TIER_RAW);
+    CHECK(ts_store_best_tier(&store, 30000000) == TS_TIER_SEC);
+    CHECK(ts_store_best_tier(&store, 5000000) == TS_TIER_MIN);
+}
+
+static void test_insert_rules(void)
+{
+    ts_store_t *s = ts_store_find("wind");
+    ts_point_t p[4];
+
+    CHECK(s == &store);
+    CHECK(ts_store_find("nothing") == NULL);
+
+    ts_store_init(&store, "wind", 100.0f);
+    ts_store_insert(&store, 2000000, 1000.0f);     // Clamped to +327.67
+    ts_store_insert(&store, 1000000, 5.0f);        // Older, ignored
+    ts_store_insert(&store, 2000000, NAN);         // Same ms is accepted, NaN clamps low
+    ts_store_insert(&store, -5, 1.0f);             // Negative time, ignored
+    size_t n = ts_store_query(&store, TS_TIER_RAW, 0, 3000000, p, 4);
+    CHECK(n == 2);
+    CHECK_NEAR(p[0].mean, 327.67, 1e-3);
+    CHECK_NEAR(p[1].mean, -327.68, 1e-3);
+
+    CHECK(ts_store_query(&store, TS_TIER_RAW, 3000000, 2000000, p, 4) == 0);
+    CHECK(ts_store_query(&store, TS_TIER_COUNT, 0, 3000000, p, 4) == 0);
+}
+
+// Expected closed intervals of one tier, straight from the samples: the
+// interval of the newest sample is still open and the ring keeps the last cap
+static size_t expected_tier(size_t n_samples, uint32_t interval_ms, uint32_t cap, ts_point_t *out)
+{
+    static ts_point_t all[ROLLUP_MAX];
+    size_t k = 0;
+
+    for (size_t i = 0; i < n_samples;) {
+        uint32_t start = series[i].t_ms - series[i].t_ms % interval_ms;
+        int lo = series[i].q;
+        int hi = series[i].q;
+        long sum = 0;
+        size_t j = i;
+
+        for (; j < n_samples && series[j].t_ms < start + interval_ms; j++) {
+            lo = series[j].q < lo ? series[j].q : lo;
+            hi = series[j].q > hi ? series[j].q : hi;
+            sum += series[j].q;
+        }
+        all[k++] = (ts_point_t) {
+            .timestamp_us = (int64_t)start * 1000,
+            .min = lo / 100.0f,
+            .mean = lround((double)sum / (double)(j - i)) / 100.0f,
+            .max = hi / 100.0f,
+        };
+        i = j;
+    }
+
+    size_t closed = k - 1;
+    size_t first = closed > cap ? closed - cap : 0;
+    for (size_t i = first; i < closed; i++) {
+        out[i - first] = all[i];
+    }
+    return closed - first;
+}
+
+static void check_tier(ts_store_t *s, ts_tier_t tier, size_t n_samples, uint32_t interval_ms, uint32_t cap)
+{
+    static ts_point_t want[ROLLUP_MAX];
+    static ts_point_t got[ROLLUP_MAX];
+    size_t n_want = expected_tier(n_samples, interval_ms, cap, want);
+    size_t n_got = ts_store_query(s, tier, 0, (int64_t)series[n_samples - 1].t_ms * 1000, got, ROLLUP_MAX);
+    size_t bad = 0;
+
+    CHECK(n_got == n_want);
+    for (size_t i = 0; i < n_got && i < n_want; i++) {
+        if (got[i].timestamp_us != want[i].timestamp_us || fabsf(got[i].min - want[i].min) > 1e-4f ||
+            fabsf(got[i].mean - want[i].mean) > 1e-4f || fabsf(got[i].max - want[i].max) > 1e-4f) {
+            if (bad++ == 0) {
+                fprintf(stderr, "tier %d point %zu: t %lld min/mean/max %.2f/%.2f/%.2f, expected t %lld %.2f/%.2f/%.2f\n",
+                        tier, i, (long long)got[i].timestamp_us, got[i].min, got[i].mean, got[i].max,
+                        (long long)want[i].timestamp_us, want[i].min, want[i].mean, want[i].max);
+            }
+        }
+    }
+    CHECK(bad == 0);
+}
+
+// n samples starting at start_ms, steps of 1..max_step_ms with an occasional
+// gap of up to max_gap_ms, values over the whole +-327 range
+static void feed(ts_store_t *s, size_t n, uint32_t start_ms, uint32_t max_step_ms, uint32_t max_gap_ms)
+{
+    uint32_t t_ms = start_ms;
+
+    ts_store_init(s, NULL, 100.0f);
+    for (size_t i = 0; i < n; i++) {
+        t_ms += 1 + rng() % max_step_ms;
+        if (rng() % 256 == 0) {
+            t_ms += rng() % max_gap_ms;
+        }
+        series[i].t_ms = t_ms;
+        series[i].q = (int16_t)((int)(rng() % 65535) - 32767);
+        ts_store_insert(s, (int64_t)t_ms * 1000, series[i].q / 100.0f);
+    }
+}
+
+static void check_all_tiers(ts_store_t *s, size_t n)
+{
+    check_tier(s, TS_TIER_SEC, n, 1000, TS_STORE_SEC_LEN);
+    check_tier(s, TS_TIER_MIN, n, 60000, TS_STORE_MIN_LEN);
+
+    // The raw tier is the last TS_STORE_RAW_LEN samples as they came in
+    static ts_point_t raw[TS_STORE_RAW_LEN];
+    size_t first = n > TS_STORE_RAW_LEN ? n - TS_STORE_RAW_LEN : 0;
+    CHECK(ts_store_query(s, TS_TIER_RAW, 0, (int64_t)series[n - 1].t_ms * 1000, raw, TS_STORE_RAW_LEN) ==
+          n - first);
+    CHECK(raw[0].timestamp_us == (int64_t)series[first].t_ms * 1000);
+    CHECK_NEAR(raw[0].mean, series[first].q / 100.0, 1e-4);
+}
+
+static void test_rollup(void)
+{
+    static ts_store_t s;
+
+    // Dense, a few minutes: several samples per second, seconds and whole
+    // minutes skipped by the gaps
+    feed(&s, 16000, 123456, 200, 90000);
+    printf("dense: %u..%u ms, %u s and %u min aggregates\n", series[0].t_ms, series[15999].t_ms,
+           s.tiers[TS_TIER_SEC].count, s.tiers[TS_TIER_MIN].count);
+    CHECK(s.tiers[TS_TIER_SEC].count == TS_STORE_SEC_LEN);
+    check_all_tiers(&s, 16000);
+
+    // Sparse, over a day: at most a sample every few seconds, so the minute
+    // ring wraps too
+    feed(&s, ROLLUP_MAX, 5000, 9000, 600000);
+    printf("sparse: %u..%u ms, %u s and %u min aggregates\n", series[0].t_ms, series[ROLLUP_MAX - 1].t_ms,
+           s.tiers[TS_TIER_SEC].count, s.tiers[TS_TIER_MIN].count);
+    CHECK(s.tiers[TS_TIER_MIN].count == TS_STORE_MIN_LEN);
+    check_all_tiers(&s, ROLLUP_MAX);
+
+    // This sparse, 1200 raw samples reach further back than 900 s aggregates,
+    // so past the raw ring only the minutes are left
+    int64_t oldest_raw = (int64_t)s.raw_t[s.tiers[TS_TIER_RAW].head] * 1000;
+    int64_t oldest_sec = (int64_t)s.sec_t[s.tiers[TS_TIER_SEC].head] * 1000;
+    CHECK(oldest_raw < oldest_sec);
+    CHECK(ts_store_best_tier(&s, oldest_raw) == TS_TIER_RAW);
+    CHECK(ts_store_best_tier(&s, oldest_raw - 1000) == TS_TIER_MIN);
+}
+
+// A mean that lands on .5 of a stored step rounds away from zero, both signs
+static void test_rollup_rounding(void)
+{
+    static ts_store_t s;
+    ts_point_t p[2];
+
+    ts_store_init(&s, NULL, 100.0f);
+    ts_store_insert(&s, 1000000, 0.01f);
+    ts_store_insert(&s, 1500000, 0.02f);
+    ts_store_insert(&s, 2000000, -0.01f);
+    ts_store_insert(&s, 2500000, -0.02f);
+    ts_store_insert(&s, 3000000, 0.0f);
+    CHECK(ts_store_query(&s, TS_TIER_SEC, 0, 3000000, p, 2) == 2);
+    CHECK_NEAR(p[0].mean, 0.02, 1e-6);
+    CHECK_NEAR(p[1].mean, -0.02, 1e-6);
+}
+
+int main(void)
+{
+    fill();
+    test_paging();
+    test_aggregates();
+    test_best_tier();
+    test_insert_rules();
+    test_rollup();
+    test_rollup_rounding();
+    HOST_TEST_END();
+}
@@ -0,0 +1,255 @@
+/**
+ * @file test_web_assets.c
+ * @author David Ramírez Betancourth
+ * @brief Generated web page table: every page file routed by the one
+ * wildcard handler, web_asset_find() hits and misses, lookup cost, gzip
+ * payloads and page-load bytes
+ *
+ * The table is generated from main/webpage by gen_web_assets.py, the same
+ * build step the firmware uses. Page-load bytes are response bodies as
+ * http_server_send_asset() sends them; headers (about 200 bytes per
+ * response) come on top either way.
+ */
+
+#include "web_assets.h"
+#include "host_test.h"
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#if HOST_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#define LOOKUPS  2000000
+
+// Every file in the page directory has an entry, the index is also at "/"
+static void test_every_file_routed(void)
+{
+    DIR *dir = opendir(WEBPAGE_DIR);
+    struct dirent *entry;
+    int files = 0;
+
+    CHECK(dir != NULL);
+    while (dir && (entry = readdir(dir)) != NULL) {
+        char path[512];
+        char uri[300];
+        struct stat st;
+
+        snprintf(path, sizeof(path), "%s/%s", WEBPAGE_DIR, entry->d_name);
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+            continue;
+        }
+        snprintf(uri, sizeof(uri), "/%s", entry->d_name);
+        const web_asset_t *asset = web_asset_find(uri);
+        if (!asset) {
+            fprintf(stderr, "%s has no entry in web_assets[]\n", uri);
+            host_test_failures++;
+            continue;
+        }
+        CHECK(strcmp(asset->path, uri) == 0);
+        CHECK(asset->len > 0 && asset->len <= asset->raw_len);
+        // HTML gets versioned links written in, the rest is the file as is
+        if (!strstr(uri, ".html")) {
+            CHECK(asset->raw_len == (uint32_t)st.st_size);
+        }
+        files++;
+    }
+    if (dir) {
+        closedir(dir);
+    }
+
+    CHECK(WEB_ASSETS_COUNT == files + 1);
+    CHECK(web_asset_find("/") != NULL && web_asset_find("/")->data == web_asset_find("/index.html")->data);
+    printf("%d page files (+ \"/\") in web_assets[], served by one wildcard handler\n", files);
+}
+
+static void test_lookup(void)
+{
+    static const char *const misses[] = {
+        "", "app.css", "/app", "/app.cs", "/app.cssx", "/app.css/", "/APP.CSS", "/index", "/zzz", "/ ", "?v=1",
+    };
+
+    for (int i = 1; i < WEB_ASSETS_COUNT; i++) {
+        CHECK(strcmp(web_assets[i - 1].path, web_assets[i].path) < 0);
+    }
+
+    for (int i = 0; i < WEB_ASSETS_COUNT; i++) {
+        char uri[128];
+
+        CHECK(web_asset_find(web_assets[i].path) == &web_assets[i]);
+        // The query string is not part of the path
+        snprintf(uri, sizeof(uri), "%s?v=%s", web_assets[i].path, web_assets[i].version);
+        CHECK(web_asset_find(uri) == &web_assets[i]);
+        snprintf(uri, sizeof(uri), "%s?", web_assets[i].path);
+        CHECK(web_asset_find(uri) == &web_assets[i]);
+    }
+    for (size_t i = 0; i < sizeof(misses) / sizeof(misses[0]); i++) {
+        if (web_asset_find(misses[i]) != NULL) {
+            fprintf(stderr, "\"%s\" found\n", misses[i]);
+            host_test_failures++;
+        }
+    }
+
+    CHECK(strcmp(web_asset_find("/app.css")->mime, "text/css") == 0);
+    CHECK(strcmp(web_asset_find("/app.js")->mime, "application/javascript") == 0);
+    CHECK(strcmp(web_asset_find("/")->mime, "text/html") == 0);
+}
+
+// Linear strcmp scan over the same table, what one handler per file amounts to
+static const web_asset_t *linear_find(const char *uri)
+{
+    for (int i = 0; i < WEB_ASSETS_COUNT; i++) {
+        if (strcmp(web_assets[i].path, uri) == 0) {
+            return &web_assets[i];
+        }
+    }
+    return NULL;
+}
+
+static double time_lookups(const web_asset_t *(*find)(const char *), const char *const *uris, int n)
+{
+    size_t found = 0;
+    double t0 = host_seconds();
+
+    for (int i = 0; i < LOOKUPS; i++) {
+        found += find(uris[i % n]) != NULL;
+    }
+    double dt = host_seconds() - t0;
+    host_sink = (double)found;
+    return dt / LOOKUPS * 1e9;
+}
+
+static void test_lookup_cost(void)
+{
+    // What a page load asks for, plus a miss
+    static const char *const uris[] = {
+        "/", "/app.css?v=0", "/app.js?v=0", "/jquery-3.3.1.min.js?v=0", "/favicon.ico", "/robots.txt",
+    };
+    static const char *const plain[] = {
+        "/", "/app.css", "/app.js", "/jquery-3.3.1.min.js", "/favicon.ico", "/robots.txt",
+    };
+    const int n = sizeof(uris) / sizeof(uris[0]);
+
+    double binary_ns = time_lookups(web_asset_find, uris, n);
+    double linear_ns = time_lookups(linear_find, plain, n);
+    printf("lookup: %.1f ns binary search (%d entries), %.1f ns linear scan\n", binary_ns, WEB_ASSETS_COUNT,
+           linear_ns);
+    // Nothing next to the cost of the request itself
+    CHECK(binary_ns < 1000.0);
+}
+
+#if HOST_HAVE_ZLIB
+static uint8_t *read_file(const char *name, size_t *len)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", WEBPAGE_DIR, name);
+    FILE *f = fopen(path, "rb");
+    uint8_t *buf = NULL;
+
+    if (f && fseek(f, 0, SEEK_END) == 0) {
+        *len = (size_t)ftell(f);
+        buf = malloc(*len + 1);
+        rewind(f);
+        if (fread(buf, 1, *len, f) != *len) {
+            free(buf);
+            buf = NULL;
+        }
+    }
+    if (f) {
+        fclose(f);
+    }
+    return buf;
+}
+
+// Inflates a gzip payload, the result is NUL terminated
+static uint8_t *gunzip(const web_asset_t *asset)
+{
+    uint8_t *out = malloc(asset->raw_len + 1);
+    z_stream z = {0};
+
+    inflateInit2(&z, 15 + 16);
+    z.next_in = (uint8_t *)asset->data;
+    z.avail_in = asset->len;
+    z.next_out = out;
+    z.avail_out = asset->raw_len;
+    int ret = inflate(&z, Z_FINISH);
+    CHECK(ret == Z_STREAM_END && z.total_out == asset->raw_len && z.avail_in == 0);
+    inflateEnd(&z);
+    out[asset->raw_len] = '\0';
+    return out;
+}
+
+// Every payload inflates to its file; index.html links carry the versions
+static void test_gzip_payloads(void)
+{
+    for (int i = 0; i < WEB_ASSETS_COUNT; i++) {
+        const web_asset_t *asset = &web_assets[i];
+        const char *name = strcmp(asset->path, "/") == 0 ? "index.html" : asset->path + 1;
+        size_t file_len = 0;
+        uint8_t *file = read_file(name, &file_len);
+        uint8_t *content = asset->gzip ? gunzip(asset) : (uint8_t *)asset->data;
+
+        CHECK(file != NULL);
+        if (file && !strstr(name, ".html")) {
+            CHECK(file_len == asset->raw_len && memcmp(content, file, file_len) == 0);
+        }
+        if (file && strstr(name, ".html")) {
+            for (int j = 0; j < WEB_ASSETS_COUNT; j++) {
+                const char *other = web_assets[j].path + 1;
+                char versioned[128];
+
+                file[file_len] = '\0';
+                snprintf(versioned, sizeof(versioned), "%s?v=%s\"", other, web_assets[j].version);
+                if (*other && !strstr(other, ".html") && strstr((char *)file, other)) {
+                    CHECK(strstr((char *)content, versioned) != NULL);
+                }
+            }
+        }
+        if (asset->gzip) {
+            free(content);
+        }
+        free(file);
+    }
+}
+#endif
+
+// Bodies of a first page load: the page, what it links and the browser's
+// /favicon.ico. A repeat load sends no bodies: the versioned links are
+// immutable in the cache, "/" and /favicon.ico get a 304
+static void test_page_load_bytes(void)
+{
+    static const char *const page[] = {"/", "/app.css", "/app.js", "/jquery-3.3.1.min.js", "/favicon.ico"};
+    size_t raw = 0;
+    size_t sent = 0;
+
+    for (size_t i = 0; i < sizeof(page) / sizeof(page[0]); i++) {
+        const web_asset_t *asset = web_asset_find(page[i]);
+        CHECK(asset != NULL);
+        if (!asset) {
+            continue;
+        }
+        printf("  %-22s %7u -> %6u bytes%s\n", page[i], (unsigned)asset->raw_len, (unsigned)asset->len,
+               asset->gzip ? " (gzip)" : "");
+        raw += asset->raw_len;
+        sent += asset->len;
+    }
+
+    printf("page load: %zu bytes uncompressed, %zu gzip (%.0f%% less)\n", raw, sent,
+           100.0 * (double)(raw - sent) / (double)raw);
+    CHECK(sent * 10 <= raw * 3);    // At least 70% less
+}
+
+int main(void)
+{
+    test_every_file_routed();
+    test_lookup();
+    test_lookup_cost();
+#if HOST_HAVE_ZLIB
+    test_gzip_payloads();
+#endif
+    test_page_load_bytes();
+    HOST_TEST_END();
+}
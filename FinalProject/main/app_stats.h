@@ -0,0 +1,38 @@
+/**
+ * @file app_stats.h
+ * @author David Ramírez Betancourth
+ * @brief Acquisition timing measured by adc_task in main.c, header
+ *
+ * The collectors stay private to main.c; reports (UART, /stats.json) read
+ * them through these accessors.
+ */
+
+#ifndef APP_STATS_H
+#define APP_STATS_H
+
+#include <stddef.h>
+
+#include "timing_stats.h"
+
+/**
+ * @brief Timing of one sample source
+ */
+typedef struct {
+    const char *name;
+    timing_stats_t *interval;   ///< Between consecutive samples of the source
+    timing_stats_t *latency;    ///< Sample timestamp -> adc_task consumption
+} app_source_stats_t;
+
+/**
+ * @brief Number of sample sources.
+ */
+size_t app_stats_source_count(void);
+
+/**
+ * @brief Collectors of one source, NULL if source is out of range.
+ *
+ * The collectors are live; read them through timing_stats_summary().
+ */
+const app_source_stats_t *app_stats_source(size_t source);
+
+#endif // APP_STATS_H
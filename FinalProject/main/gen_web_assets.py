@@ -0,0 +1,201 @@
+#!/usr/bin/env python3
+"""
+@file gen_web_assets.py
+@author David Ramírez Betancourth
+@brief Build step: compresses the web page files and emits them as C data
+
+Every asset becomes an entry of web_assets[], sorted by path so
+web_asset_find() (emitted with the table) can binary-search it, holding the gzip-compressed bytes (raw bytes
+if gzip does not make it smaller), the MIME type, an ETag and a version
+string, both taken from the SHA-256 of the uncompressed content.
+
+HTML files are processed last: references to the other assets
+("app.js", "/app.js", ...) are rewritten to "app.js?v=<version>", so those
+URLs change whenever the file does and can be cached as immutable.
+
+The --index file is also served at "/". Adding a file to the page is
+only a matter of listing it in WEB_ASSET_FILES.
+
+Usage: gen_web_assets.py --out-dir DIR [--index FILE] FILE...
+"""
+
+import argparse
+import gzip
+import hashlib
+import os
+import re
+
+MIME_TYPES = {
+    ".html": "text/html",
+    ".css": "text/css",
+    ".js": "application/javascript",
+    ".ico": "image/x-icon",
+    ".png": "image/png",
+    ".svg": "image/svg+xml",
+    ".json": "application/json",
+}
+
+
+FIND_SOURCE = [
+    "const web_asset_t *web_asset_find(const char *uri)",
+    "{",
+    "    size_t len = strcspn(uri, \"?\");",
+    "    size_t lo = 0;",
+    "    size_t hi = WEB_ASSETS_COUNT;",
+    "",
+    "    while (lo < hi) {",
+    "        size_t mid = lo + (hi - lo) / 2;",
+    "        const char *path = web_assets[mid].path;",
+    "        int cmp = strncmp(path, uri, len);",
+    "",
+    "        if (cmp == 0 && path[len] != '\\0') {",
+    "            cmp = 1;    // Longer than the URI, sorts after it",
+    "        }",
+    "        if (cmp == 0) {",
+    "            return &web_assets[mid];",
+    "        }",
+    "        if (cmp < 0) {",
+    "            lo = mid + 1;",
+    "        } else {",
+    "            hi = mid;",
+    "        }",
+    "    }",
+    "    return NULL;",
+    "}",
+    "",
+]
+
+
+def c_ident(name):
+    return "web_asset_" + re.sub(r"[^0-9a-zA-Z]", "_", name)
+
+
+def link_versions(html, versions):
+    """Append ?v=<version> to quoted references of the other assets."""
+    for name, version in versions.items():
+        pattern = r'(["\'])(/?' + re.escape(name) + r')\1'
+        html = re.sub(pattern, lambda m: m.group(1) + m.group(2) + "?v=" + version + m.group(1), html)
+    return html
+
+
+def build_asset(path, content):
+    name = os.path.basename(path)
+    digest = hashlib.sha256(content).hexdigest()
+    packed = gzip.compress(content, compresslevel=9, mtime=0)
+    use_gzip = len(packed) < len(content)
+
+    return {
+        "name": name,
+        "path": "/" + name,
+        "ident": c_ident(name),
+        "mime": MIME_TYPES.get(os.path.splitext(name)[1].lower(), "application/octet-stream"),
+        "data": packed if use_gzip else content,
+        "raw_len": len(content),
+        "gzip": use_gzip,
+        "etag": '"' + digest[:16] + '"',
+        "version": digest[:8],
+    }
+
+
+def write_header(out_dir, assets):
+    lines = [
+        "// Generated by gen_web_assets.py, do not edit",
+        "#ifndef WEB_ASSETS_H",
+        "#define WEB_ASSETS_H",
+        "",
+        "#include <stdbool.h>",
+        "#include <stdint.h>",
+        "",
+        "typedef struct {",
+        "    const char *path;       // URI, \"/\" + file name",
+        "    const char *mime;",
+        "    const uint8_t *data;",
+        "    uint32_t len;",
+        "    uint32_t raw_len;       // Uncompressed size",
+        "    const char *etag;       // Quoted",
+        "    const char *version;    // Value of ?v= in versioned links",
+        "    bool gzip;              // data is gzip encoded",
+        "} web_asset_t;",
+        "",
+    ]
+    lines += [
+        "#define WEB_ASSETS_COUNT %d" % len(assets),
+        "",
+        "// Sorted by path (strcmp order)",
+        "extern const web_asset_t web_assets[WEB_ASSETS_COUNT];",
+        "",
+        "// Asset at the path of uri (anything from '?' on is ignored), NULL if none",
+        "const web_asset_t *web_asset_find(const char *uri);",
+        "",
+        "#endif // WEB_ASSETS_H",
+        "",
+    ]
+
+    with open(os.path.join(out_dir, "web_assets.h"), "w", newline="\n") as f:
+        f.write("\n".join(lines))
+
+
+def write_source(out_dir, assets):
+    lines = ["// Generated by gen_web_assets.py, do not edit", '#include "web_assets.h"', "", "#include <string.h>", ""]
+
+    # One data array per file, aliases (the "/" index) share it
+    for ident, data in {a["ident"]: a["data"] for a in assets}.items():
+        lines.append("static const uint8_t %s_data[%d] = {" % (ident, len(data)))
+        for i in range(0, len(data), 16):
+            lines.append("    " + ", ".join("0x%02x" % b for b in data[i:i + 16]) + ",")
+        lines.append("};")
+        lines.append("")
+
+    lines.append("const web_asset_t web_assets[WEB_ASSETS_COUNT] = {")
+    for a in assets:
+        lines.append('    {"%s", "%s", %s_data, %d, %d, "%s", "%s", %s},' % (
+            a["path"], a["mime"], a["ident"], len(a["data"]), a["raw_len"],
+            a["etag"].replace('"', '\\"'), a["version"], "true" if a["gzip"] else "false"))
+    lines.append("};")
+    lines.append("")
+    lines += FIND_SOURCE
+
+    with open(os.path.join(out_dir, "web_assets.c"), "w", newline="\n") as f:
+        f.write("\n".join(lines))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--out-dir", required=True)
+    parser.add_argument("--index", help="file also served at /")
+    parser.add_argument("files", nargs="+")
+    args = parser.parse_args()
+
+    contents = {}
+    for path in args.files:
+        with open(path, "rb") as f:
+            contents[path] = f.read()
+
+    pages = [p for p in args.files if p.lower().endswith(".html")]
+    others = [p for p in args.files if p not in pages]
+
+    assets = [build_asset(p, contents[p]) for p in others]
+    versions = {a["name"]: a["version"] for a in assets}
+    for path in pages:
+        html = link_versions(contents[path].decode("utf-8"), versions)
+        assets.append(build_asset(path, html.encode("utf-8")))
+
+    if args.index:
+        index = next(a for a in assets if a["name"] == os.path.basename(args.index))
+        assets.append(dict(index, path="/"))
+
+    assets.sort(key=lambda a: a["path"].encode("utf-8"))
+
+    os.makedirs(args.out_dir, exist_ok=True)
+    write_header(args.out_dir, assets)
+    write_source(args.out_dir, assets)
+
+    files = {a["ident"]: a for a in assets}.values()
+    total_raw = sum(a["raw_len"] for a in files)
+    total = sum(len(a["data"]) for a in files)
+    print("web assets: %d files, %d -> %d bytes (%.0f%% smaller)" %
+          (len(files), total_raw, total, 100.0 * (total_raw - total) / max(total_raw, 1)))
+
+
+if __name__ == "__main__":
+    main()
@@ -8,15 +8,31 @@
 #include "driver/gpio.h"
 #include "driver/uart.h"
 #include "freertos/queue.h"
+#include "esp_timer.h"
 
 #include "adc_utils.h"
+#include "acq_service.h"
+#include "sample_ring.h"
+#include "ntc_lut.h"
+#include "adc_decimator.h"
+#include "filter_chain.h"
+#include "timing_stats.h"
+#include "stream_align.h"
+#include "anemometer.h"
+#include "sample_clock.h"
+#include "telemetry_bus.h"
+#include "ts_store.h"
+#include "flash_log.h"
+#include "sample_codec.h"
 #include "tim_ch_duty.h"
 #include "io_utils.h"
 
+#include "app_stats.h"
 #include "wifi_app.h"
 #include "http_server.h"
 
 #include <math.h>
+#include <string.h>
 
 #include <ssd1306.h>
 
@@ -27,8 +43,32 @@
 #define ADC_UNIT   ADC_UNIT_1
 #define ADC_ATTEN  ADC_ATTEN_DB_12
 
-#define LM35_ADC_DATA_TYPE true
-#define NTC_DATA_TYPE false
+// Sample sources carried in sample_t.source
+#define LM35_ADC_DATA_TYPE 1
+#define NTC_DATA_TYPE 0
+
+#define ADC_RING_LEN 64           // Power of two
+
+#define ADC_SAMPLE_RATE_HZ 1280   // Per channel
+#define ADC_BLOCK_LEN      64     // Samples per block
+#define ADC_OVERSAMPLE_LOG2 6     // 64:1 decimation -> 20 readings/s per channel, +3 bits
+#define ADC_OUTPUT_RATE_HZ ((float)ADC_SAMPLE_RATE_HZ / (1 << ADC_OVERSAMPLE_LOG2))
+
+#define ADC_BENCH_ROUNDS       1000   // "adcbench": oneshot rounds per path
+#define ADC_BENCH_MAX_CHANNELS 8
+
+#define ADC_MEDIAN_LEN     5      // Spike rejection
+#define ADC_LOWPASS_ORDER  2      // Butterworth low-pass on the decimated stream
+#define ADC_LOWPASS_HZ     2.0f
+
+#define DISPLAY_PERIOD_US  1000000
+
+//-------------------Flash log-----------------
+#define TLOG_PARTITION     "tlog"
+#define TLOG_RECORD_BYTES  256    // Per topic, ~120 samples with the codec
+#define TLOG_BLOCK_VERSION 2      // Record: version, topic, sample_codec stream
+#define TLOG_TIME_UNIT_US  1000
+#define TLOG_MAX_AGE_US    ((int64_t)FLASH_LOG_FLUSH_MS * 1000 / 2)  // Checked as often, closed within FLASH_LOG_FLUSH_MS
 
 //-------------------UART----------------------
 #define UART_NUM UART_NUM_0
@@ -40,26 +80,51 @@
 #define PWM_FREQ_HZ 1000
 #define PWM_PIN GPIO_NUM_27
 
-//-----------------------------------------Struct----------------------------------------
-
-typedef struct {
-    float value;
-    bool type;
-} adc_type_data_t;
-
 //---------------------------------------Global Vars ------------------------------------
 
 
-static QueueHandle_t adc_data_queue;
+// Acquisition -> adc_task samples, the producer wakes adc_task with a task notification
+static sample_t adc_ring_storage[ADC_RING_LEN];
+static sample_ring_t adc_ring;
+static TaskHandle_t adc_task_handle;
+static TaskHandle_t display_task_handle;
+static int display_clock_id;
+
+// Acquisition timing, indexed by sample source (read by the UART and HTTP stats reports through app_stats.h)
+static timing_stats_t adc_interval_stats[2];   // Between consecutive samples of a source
+static timing_stats_t adc_latency_stats[2];    // Sample timestamp -> adc_task consumption
+static const app_source_stats_t adc_source_stats[2] = {
+    [NTC_DATA_TYPE] = {"ntc", &adc_interval_stats[NTC_DATA_TYPE], &adc_latency_stats[NTC_DATA_TYPE]},
+    [LM35_ADC_DATA_TYPE] = {"lm35", &adc_interval_stats[LM35_ADC_DATA_TYPE], &adc_latency_stats[LM35_ADC_DATA_TYPE]},
+};
 static QueueHandle_t uart_rx_queue;
 
-QueueHandle_t http_send_lm35_queue;
-QueueHandle_t http_receive_pwm_queue;
-QueueHandle_t http_send_anemo_queue;
+// Telemetry topics, consumers look them up by name
+static int topic_ntc;       // "ntc_c"     NTC temperature (float, °C)
+static int topic_ambient;   // "ambient_c" LM35 temperature (float, °C)
+static int topic_wind;      // "wind_kmh"  Wind speed (float, km/h)
+static int topic_pwm_cmd;   // "pwm_cmd"   Requested thruster duty (int, %)
+static int topic_pwm_duty;  // "pwm_duty"  Applied thruster duty (int, %)
+
+// pwm_cmd -> pwm_task
+static QueueHandle_t pwm_cmd_queue;
 
+// History of the published values, fed from adc_task through the bus
+static ts_store_t wind_history;
+static ts_store_t ambient_history;
 
-// Mutex for shared ADC resource
-SemaphoreHandle_t xMutex;
+// Bus messages are encoded per topic, one flash log record per full buffer
+// (or per TLOG_MAX_AGE_US for slow topics). Two buffers per topic so a
+// closed one can be appended outside the lock.
+typedef struct {
+    sample_codec_enc_t enc;
+    uint8_t record[2][TLOG_RECORD_BYTES];
+    int active;
+    int64_t first_us;       // Timestamp of the first sample of the open record
+} tlog_stream_t;
+
+static tlog_stream_t tlog_streams[TELEMETRY_MAX_TOPICS];
+static portMUX_TYPE tlog_lock = portMUX_INITIALIZER_UNLOCKED;
 
 static uint8_t uart_rx_buffer[RD_BUF_SIZE];
 
@@ -87,112 +152,361 @@ adc_config_t lm35_adc_conf = {
 };
 adc_channel_handle_t lm35_adc_handle = NULL;
 
+// NTC divider and beta model, these constants should be specific to your NTC thermistor
+static const ntc_params_t ntc_params = {
+    .beta = 10000.0,      // Beta value for your NTC
+    .r0 = 10000.0,        // Resistance of NTC at T0 (e.g., 10k Ohms at 25°C)
+    .t0 = 298.15,         // Reference temperature in Kelvin (25°C + 273.15)
+    .r_fixed = 1000.0,    // Resistor in voltage divider (1k Ohm)
+    .v_in = 4.8,          // Input voltage to the voltage divider
+};
+
+// Raw code -> temperature, built once at startup from ntc_params
+static ntc_lut_t ntc_lut;
+
+// Heated NTC anemometer, King's law constants. Placeholder calibration:
+// fit king_a/king_b/king_n against a reference anemometer for a real sensor.
+static const anemometer_params_t anemo_params = {
+    .power_w = 0.05,        // Power dissipated in the NTC
+    .king_a = 0.002,        // Still-air conductance (W/K)
+    .king_b = 0.002,        // Forced-convection term (W/K per sqrt(m/s))
+    .king_n = 0.5,
+    .alpha_per_k = 0.0028,  // Air thermal conductivity drift
+    .t_ref_c = 25.0,
+};
+
+// dT x ambient -> km/h, built once at startup from anemo_params
+static anemometer_t anemo;
+
+// Oversampling stages between acquisition and adc_task
+static adc_decimator_t ntc_decimator;
+static adc_decimator_t lm35_decimator;
+
+// Digital filtering of the decimated temperature streams
+static filter_chain_t ntc_filter;
+static filter_chain_t lm35_filter;
+
 //-----------------------------------Helper Functions------------------------------------------
 
-double ntc_temperature;
-void ntc_task(void *arg) {
+// Hands converted, filtered readings to adc_task. The newest closes the block,
+// older ones are one output period apart.
+static void adc_publish(uint8_t source, const float *values, size_t n, int64_t timestamp_us) {
 
-    adc_type_data_t ntc_item;
-    ntc_item.type = NTC_DATA_TYPE;
-    ntc_item.value = 0;
+    const int64_t period_us = (int64_t)(1000000.0f / ADC_OUTPUT_RATE_HZ);
 
-    // These constants should be specific to your NTC thermistor
-    const float beta = 10000.0;     // Beta value for your NTC
-    const float R0 = 10000.0;      // Resistance of NTC at T0 (e.g., 10k Ohms at 25°C)
-    const float T0 = 298.15;       // Reference temperature in Kelvin (25°C + 273.15)
-    const float R2 = 1000.0;       // Resistor in voltage divider (1k Ohm)
+    if (n == 0) {
+        return;
+    }
 
-    const float Vi = 4.8;          // Input voltage to the voltage divider
+    for (size_t k = 0; k < n; k++) {
+        sample_t *item;
 
-    float Vo = 0;                  // Voltage measured across R2
-    float Rt = 0;                  // Resistance of the NTC
-    float T = 0;                   // Temperature in Kelvin
-    float final_T = 0;             // Temperature in Celsius
+        if (sample_ring_reserve(&adc_ring, &item, 1) == 0) {
+            sample_ring_drop(&adc_ring, n - k); // adc_task is behind, counted as overrun
+            break;
+        }
+        item->value = values[k];
+        item->source = source;
+        item->timestamp_us = timestamp_us - (int64_t)(n - 1 - k) * period_us;
+        sample_ring_commit(&adc_ring, 1);
+    }
 
-    // 1. Configure ADC
-    set_adc(&ntc_adc_conf, &ntc_adc_handle); // Assuming ntc_adc_conf and ntc_adc_handle are defined globally
+    xTaskNotifyGive(adc_task_handle);
+}
 
-    int raw_val = 0;
-    int voltage_mv = 0;
+/**
+ * @brief NTC client of the acquisition service.
+ *
+ * Runs in the acquisition task, so it never blocks: the block is decimated,
+ * converted, filtered and handed to adc_task.
+ */
+static void ntc_block_cb(adc_channel_t channel, const uint16_t *raw, size_t count, int64_t timestamp_us, void *user_ctx) {
 
-    while (1) {
+    static int block[ADC_BLOCK_LEN];
+    static int32_t decimated[ADC_BLOCK_LEN];
+    static float values[ADC_BLOCK_LEN];
+    unsigned frac_bits = adc_decimator_frac_bits(&ntc_decimator);
+    size_t n = 0;
 
-        xSemaphoreTake(xMutex, portMAX_DELAY); // Acquire mutex for ADC
+    for (size_t i = 0; i < count; i++) {
+        block[i] = raw[i];
+    }
 
-        get_raw_data(ntc_adc_handle, &raw_val);
-        raw_to_voltage(ntc_adc_handle, raw_val, &voltage_mv);
+    size_t produced = adc_decimator_process(&ntc_decimator, block, count, decimated);
+    for (size_t k = 0; k < produced; k++) {
+        int32_t mdeg;
+        if (ntc_lut_lookup_q(&ntc_lut, decimated[k], frac_bits, &mdeg)) {
+            values[n++] = (float)mdeg / 1000.0f;
+        } // else out of range, e.g. sensor disconnected
+    }
+    filter_chain_process(&ntc_filter, values, n);
 
-        Vo = (float)voltage_mv / 1000.0f; // Convert mV to Volts (voltage across R2)
+    adc_publish(NTC_DATA_TYPE, values, n, timestamp_us);
+}
 
-        // CORRECTED FORMULA FOR Rt (NTC Resistance)
-        // Given: Vo is measured across R2, R1 is NTC, Vi is total input
-        // Rt = R2 * (Vi - Vo) / Vo
-        // Make sure (Vi - Vo) is not negative or zero if Vo approaches Vi,
-        // which implies issues with the circuit or ADC range.
-        if (Vo > 0 && Vi > Vo) { // Avoid division by zero and negative resistance
-            Rt = (R2 * (Vi - Vo)) / Vo;
-        } else {
-            // Handle error or set a default/error value for Rt
-            // For now, we'll just skip the calculation and print an error.
-            printf("Error: Invalid Vo (%.2fV) or Vi (%.2fV) for Rt calculation.\r\n", Vo, Vi);
-            xSemaphoreGive(xMutex); // Release mutex
-            vTaskDelay(pdMS_TO_TICKS(500));
-            continue; // Skip to next iteration
-        }
+/**
+ * @brief LM35 client of the acquisition service, same pipeline as the NTC.
+ */
+static void lm35_block_cb(adc_channel_t channel, const uint16_t *raw, size_t count, int64_t timestamp_us, void *user_ctx) {
+
+    static int block[ADC_BLOCK_LEN];
+    static int32_t decimated[ADC_BLOCK_LEN];
+    static float values[ADC_BLOCK_LEN];
+    float scale = 1.0f / (float)(10 << adc_decimator_frac_bits(&lm35_decimator)); // 10 mV/°C
+    size_t n = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        block[i] = raw[i];
+    }
+
+    // Convert before decimating: the calibration curve bends above code ~2880,
+    // so the mean of the codes does not map to the mean of the voltages
+    raw_to_voltage_block(lm35_adc_handle, block, block, count);
+    size_t produced = adc_decimator_process(&lm35_decimator, block, count, decimated);
+    for (size_t k = 0; k < produced; k++) {
+        values[n++] = (float)decimated[k] * scale;
+    }
+    filter_chain_process(&lm35_filter, values, n);
+
+    adc_publish(LM35_ADC_DATA_TYPE, values, n, timestamp_us);
+}
+
+size_t app_stats_source_count(void) {
+    return sizeof(adc_source_stats) / sizeof(adc_source_stats[0]);
+}
+
+const app_source_stats_t *app_stats_source(size_t source) {
+    return source < app_stats_source_count() ? &adc_source_stats[source] : NULL;
+}
+
+// Dump acquisition timing and ring counters to the console
+static void print_adc_stats(void) {
+    timing_summary_t interval;
+    timing_summary_t latency;
+    sample_ring_stats_t ring;
+
+    for (int src = 0; src < 2; src++) {
+        timing_stats_summary(adc_source_stats[src].interval, &interval);
+        timing_stats_summary(adc_source_stats[src].latency, &latency);
+        printf("%s interval us: n=%lu min=%lld mean=%lld max=%lld p99=%lld\r\n", adc_source_stats[src].name,
+               (unsigned long)interval.count, interval.min_us, interval.mean_us, interval.max_us, interval.p99_us);
+        printf("%s latency  us: n=%lu min=%lld mean=%lld max=%lld p99=%lld\r\n", adc_source_stats[src].name,
+               (unsigned long)latency.count, latency.min_us, latency.mean_us, latency.max_us, latency.p99_us);
+    }
 
+    for (size_t id = 0; id < acq_service_client_count(); id++) {
+        acq_client_stats_t *client = acq_service_client_stats(id);
 
-        // Steinhart-Hart equation (Beta approximation) - this part was already correct
-        T = (beta * T0) / (logf(Rt / R0) * T0 + beta);
-        final_T = T - 273.15f; // Convert Kelvin to Celsius
+        timing_stats_summary(&client->hold, &interval);
+        timing_stats_summary(&client->wait, &latency);
+        printf("acq %s: %lu Hz hold max=%lld p99=%lld us, wait max=%lld p99=%lld us\r\n", client->name,
+               (unsigned long)client->rate_hz, interval.max_us, interval.p99_us, latency.max_us, latency.p99_us);
+    }
 
-        ntc_temperature = final_T; // Send to http as global var (if used)
+    adc_stream_stats_t stream;
+    adc_stream_get_stats(&stream);
+    printf("adc stream: hw=%lu Hz decimation=%lu reads=%llu lost=%llu unknown=%llu\r\n",
+           (unsigned long)stream.hw_rate_hz, (unsigned long)stream.decimation, (unsigned long long)stream.reads,
+           (unsigned long long)stream.lost, (unsigned long long)stream.unknown);
 
-        // VERBOSE
-        // printf("Raw: %d, Voltage_mv: %d, Vo: %.2fV, Rt: %.2f Ohms, T_Kelvin: %.2f K, T_Celsius: %.2f °C\r\n",
-        //        raw_val, voltage_mv, Vo, Rt, T, final_T);
+    sample_clock_stats_t display_clock;
+    sample_clock_get_stats(display_clock_id, &display_clock);
+    printf("display clock: fired=%llu missed=%llu max_late=%lld us\r\n", (unsigned long long)display_clock.fired,
+           (unsigned long long)display_clock.missed, display_clock.max_late_us);
 
-        ntc_item.value = final_T;
-        // Ensure the queue exists and is handled correctly by the consumer task
-        if (xQueueSend(adc_data_queue, &ntc_item, (TickType_t)pdMS_TO_TICKS(10)) != pdPASS) {
-            printf("Failed to send NTC data to queue.\r\n");
+    sample_ring_get_stats(&adc_ring, &ring);
+    printf("ring: dropped=%lu overruns=%lu high_water=%u/%u\r\n",
+           (unsigned long)ring.dropped, (unsigned long)ring.overruns, (unsigned)ring.high_water, (unsigned)ring.capacity);
+}
+
+// Oneshot reads/s of every ADC1 channel, one get_raw_data() plus timestamp
+// per channel against get_raw_data_multi(). ADC1 belongs to the continuous
+// driver, so acquisition pauses for the run (a gap of a few hundred ms).
+static void run_adc_bench(void) {
+    adc_channel_handle_t handles[ADC_BENCH_MAX_CHANNELS];
+    int raw[ADC_BENCH_MAX_CHANNELS];
+    int64_t ts[ADC_BENCH_MAX_CHANNELS];
+    int64_t skew_single = 0;
+    int64_t skew_multi = 0;
+    esp_err_t err = ESP_OK;
+
+    size_t n = adc_unit_channels(ADC_UNIT, handles, ADC_BENCH_MAX_CHANNELS);
+    if (n == 0 || acq_service_stop() != ESP_OK) {
+        printf("adcbench: acquisition not running\r\n");
+        return;
+    }
+
+    int64_t t0 = esp_timer_get_time();
+    for (int r = 0; r < ADC_BENCH_ROUNDS; r++) {
+        for (size_t i = 0; i < n; i++) {
+            get_raw_data(handles[i], &raw[i]);
+            ts[i] = esp_timer_get_time();
         }
+        skew_single += ts[n - 1] - ts[0];
+    }
+    int64_t t_single = esp_timer_get_time() - t0;
+
+    t0 = esp_timer_get_time();
+    for (int r = 0; r < ADC_BENCH_ROUNDS && err == ESP_OK; r++) {
+        err = get_raw_data_multi(handles, n, raw, ts);
+        skew_multi += ts[n - 1] - ts[0];
+    }
+    int64_t t_multi = esp_timer_get_time() - t0;
 
-        xSemaphoreGive(xMutex); // Release mutex
+    ESP_ERROR_CHECK(acq_service_start(NULL));
 
-        vTaskDelay(pdMS_TO_TICKS(51)); // Delay
+    if (err != ESP_OK) {
+        printf("adcbench: get_raw_data_multi failed: %s\r\n", esp_err_to_name(err));
+        return;
     }
+    double reads = (double)ADC_BENCH_ROUNDS * n;
+    printf("adcbench %u channels: per channel %.0f reads/s (first->last %lld us), multi %.0f reads/s (first->last %lld us)\r\n",
+           (unsigned)n, reads * 1e6 / t_single, skew_single / ADC_BENCH_ROUNDS, reads * 1e6 / t_multi,
+           skew_multi / ADC_BENCH_ROUNDS);
 }
 
-void lm35_task(void *arg) {
-    
-    adc_type_data_t lm35_item;
-    lm35_item.type = LM35_ADC_DATA_TYPE;
-    lm35_item.value = 0;
+// Display tick, runs in the esp_timer task
+static void display_clock_cb(void *user_ctx) {
+    xTaskNotifyGive(display_task_handle);
+}
 
-    float final_T = 0; // Temperature in Celsius
+// pwm_cmd subscriber, runs in the publisher's task
+static void pwm_cmd_cb(const telemetry_msg_t *msg, void *user_ctx) {
+    int duty = msg->value.i;
+    xQueueSend(pwm_cmd_queue, &duty, 0);
+}
 
-    // 1. Configure ADC
-    set_adc(&lm35_adc_conf, &lm35_adc_handle);
+// History subscriber, runs in adc_task
+static void history_cb(const telemetry_msg_t *msg, void *user_ctx) {
+    ts_store_insert((ts_store_t *)user_ctx, msg->timestamp_us, msg->value.f);
+}
 
-    int raw_val = 0;
-    int voltage_mv = 0;
+// Start a new record in the active buffer of a topic. Floats keep 0.01, ints are exact.
+static void tlog_stream_start(tlog_stream_t *stream, const telemetry_msg_t *msg) {
+    uint8_t *record = stream->record[stream->active];
 
-    while (1) {
-        
-        xSemaphoreTake(xMutex, portMAX_DELAY); // Acquire mutex for ADC
-        get_raw_data(lm35_adc_handle, &raw_val);
-        raw_to_voltage(lm35_adc_handle, raw_val, &voltage_mv);
+    record[0] = TLOG_BLOCK_VERSION;
+    record[1] = (uint8_t)msg->topic;
+    sample_codec_enc_init(&stream->enc, record + 2, TLOG_RECORD_BYTES - 2, TLOG_TIME_UNIT_US,
+                          msg->type == TELEMETRY_FLOAT ? 100 : 1);
+    stream->first_us = msg->timestamp_us;
+}
 
-        final_T = (float)voltage_mv / 10.0f;
-        
-        //VERBOSE
-        //printf("T: %.2f °C\r\n", final_T);
+// Close the open record of a topic and switch buffers. Called with tlog_lock held.
+static const uint8_t *tlog_stream_close(tlog_stream_t *stream, size_t *out_len) {
+    const uint8_t *record = stream->record[stream->active];
 
-        lm35_item.value = final_T;
-        xQueueSend(adc_data_queue, &lm35_item, (TickType_t)pdMS_TO_TICKS(10)); // Send the full struct
-        xSemaphoreGive(xMutex); // Release mutex
+    *out_len = 2 + sample_codec_enc_len(&stream->enc);
+    stream->active ^= 1;
+    stream->enc.buf = NULL;
+    return record;
+}
+
+// Flash log subscriber, runs in the publishers' tasks
+static void tlog_cb(const telemetry_msg_t *msg, void *user_ctx) {
+    const uint8_t *full = NULL;
+    size_t full_len = 0;
+
+    if (msg->topic < 0 || msg->topic >= TELEMETRY_MAX_TOPICS) {
+        return;
+    }
+
+    tlog_stream_t *stream = &tlog_streams[msg->topic];
+    float value = msg->type == TELEMETRY_FLOAT ? msg->value.f : (float)msg->value.i;
+
+    taskENTER_CRITICAL(&tlog_lock);
+    if (!stream->enc.buf) {
+        tlog_stream_start(stream, msg);
+    }
+    if (!sample_codec_enc_put(&stream->enc, msg->timestamp_us, value)) {
+        full = tlog_stream_close(stream, &full_len);
+        tlog_stream_start(stream, msg);
+        sample_codec_enc_put(&stream->enc, msg->timestamp_us, value);
+    }
+    taskEXIT_CRITICAL(&tlog_lock);
+
+    if (full) {
+        flash_log_append(full, full_len); // Only copies, counted as dropped if the writer is behind
+    }
+}
+
+// Close records older than TLOG_MAX_AGE_US, so slow topics (pwm) and the
+// tail of the fast ones reach flash too. Runs in the esp_timer task, only copies.
+static void tlog_flush_cb(void *user_ctx) {
+    int64_t now = esp_timer_get_time();
+
+    for (int topic = 0; topic < TELEMETRY_MAX_TOPICS; topic++) {
+        tlog_stream_t *stream = &tlog_streams[topic];
+        const uint8_t *record = NULL;
+        size_t len = 0;
+
+        taskENTER_CRITICAL(&tlog_lock);
+        if (stream->enc.buf && stream->enc.count > 0 && now - stream->first_us >= TLOG_MAX_AGE_US) {
+            record = tlog_stream_close(stream, &len);
+        }
+        taskEXIT_CRITICAL(&tlog_lock);
+
+        if (record) {
+            flash_log_append(record, len);
+        }
+    }
+}
+
+static void print_log_stats(void) {
+    flash_log_stats_t log;
+
+    flash_log_get_stats(&log);
+    printf("tlog: appended=%lu dropped=%lu written=%lu errors=%lu erased=%lu torn=%lu\r\n",
+           (unsigned long)log.appended, (unsigned long)log.dropped, (unsigned long)log.written,
+           (unsigned long)log.write_errors, (unsigned long)log.sectors_erased, (unsigned long)log.torn_records);
+    printf("tlog: generation=%lu sector=%lu offset=%lu mount=%lld us\r\n", (unsigned long)log.generation,
+           (unsigned long)log.write_sector, (unsigned long)log.write_offset, log.mount_us);
+}
+
+// Dump the last minute of raw samples of a store as a sample_codec stream in hex
+static void print_history_hex(const char *name) {
+    static ts_point_t points[64];
+    static uint8_t stream[1024];
+    ts_store_t *store = ts_store_find(name);
+    sample_codec_enc_t enc;
+    int64_t now = esp_timer_get_time();
+    int64_t from = now - 60000000;
+    size_t n;
+
+    if (!store) {
+        printf("hist: no history named \"%s\"\r\n", name);
+        return;
+    }
+
+    sample_codec_enc_init(&enc, stream, sizeof(stream), 1000, 100);
+    while ((n = ts_store_query(store, TS_TIER_RAW, from, now, points, 64)) > 0) {
+        size_t i = 0;
+        while (i < n && sample_codec_enc_put(&enc, points[i].timestamp_us, points[i].mean)) {
+            i++;
+        }
+        if (i < n || n < 64) {
+            break; // Buffer full (print what fits) or nothing newer
+        }
+        // The store keeps ms and queries from an inclusive ms, resume one tick later
+        from = points[n - 1].timestamp_us + TS_STORE_TICK_US;
+    }
+
+    printf("hist %s (%u samples, %u bytes):\r\n", name, (unsigned)enc.count, (unsigned)sample_codec_enc_len(&enc));
+    for (size_t i = 0; i < sample_codec_enc_len(&enc); i++) {
+        printf("%02x%s", stream[i], (i % 32 == 31) ? "\r\n" : "");
+    }
+    printf("\r\n");
+}
 
-        vTaskDelay(pdMS_TO_TICKS(50));
+// Dump the last minute of 1 s aggregates of a store to the console
+static void print_history(const char *name, ts_store_t *store) {
+    static ts_point_t points[60];
+    int64_t now = esp_timer_get_time();
+
+    size_t n = ts_store_query(store, TS_TIER_SEC, now - 60000000, now, points, 60);
+    printf("%s, last %u s (min/mean/max):\r\n", name, (unsigned)n);
+    for (size_t i = 0; i < n; i++) {
+        printf("%10lld ms %7.2f %7.2f %7.2f\r\n", points[i].timestamp_us / 1000, points[i].min, points[i].mean, points[i].max);
     }
 }
 
@@ -225,60 +539,87 @@ void uart_rx_task(void *arg) {
 
 			//Handle str_buffer here
             printf("UART RX: %s\r\n", str_buffer);
+
+            if (strncmp(str_buffer, "stats", 5) == 0) {
+                print_adc_stats();
+            } else if (strncmp(str_buffer, "adcbench", 8) == 0) {
+                run_adc_bench();
+            } else if (strncmp(str_buffer, "log", 3) == 0) {
+                print_log_stats();
+            } else if (strncmp(str_buffer, "hist ", 5) == 0) {
+                str_buffer[strcspn(str_buffer, "\r\n")] = '\0';
+                print_history_hex(str_buffer + 5);
+            } else if (strncmp(str_buffer, "history", 7) == 0) {
+                print_history("wind km/h", &wind_history);
+                print_history("ambient C", &ambient_history);
+            }
             
         }
     }
 }
 
 void adc_task(void *arg) {
-    adc_type_data_t adc_item;
-    // These now hold the last known state for each sensor.
-    // Initialize to a default/non-zero value if you want, or handle the initial zero case.
-    float current_ntc = 0.0f;
-    float current_lm35 = 0.0f;
-    float diff = 0.0f;
+    const sample_t *batch;
+    size_t count;
+
+    int64_t last_timestamp[2] = {0, 0};
 
-    TickType_t last_display_time = xTaskGetTickCount();
+    // NTC samples are the timebase, LM35 is interpolated onto them (tolerate ~2 missed readings)
+    stream_align_t align;
+    aligned_pair_t pairs[STREAM_ALIGN_PENDING];
+    stream_align_init(&align, NTC_DATA_TYPE, LM35_ADC_DATA_TYPE, (int64_t)(3 * 1000000.0f / ADC_OUTPUT_RATE_HZ));
+
+    while(1) {
+        // Wait until the acquisition side has committed new samples
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        while ((count = sample_ring_peek(&adc_ring, &batch)) > 0) {
+            int64_t now = esp_timer_get_time();
+
+            for (size_t i = 0; i < count; i++) {
+                uint8_t src = batch[i].source;
+
+                if (last_timestamp[src] != 0) {
+                    timing_stats_record(&adc_interval_stats[src], batch[i].timestamp_us - last_timestamp[src]);
+                }
+                last_timestamp[src] = batch[i].timestamp_us;
+                timing_stats_record(&adc_latency_stats[src], now - batch[i].timestamp_us);
+
+                telemetry_publish_float(src == LM35_ADC_DATA_TYPE ? topic_ambient : topic_ntc,
+                                        batch[i].value, batch[i].timestamp_us);
+
+                // One wind estimate per time-aligned NTC/LM35 pair, LM35 is the ambient
+                size_t paired = stream_align_push(&align, &batch[i], pairs, STREAM_ALIGN_PENDING);
+                for (size_t k = 0; k < paired; k++) {
+                    float wind_kmh = anemometer_kmh(&anemo, pairs[k].ref - pairs[k].other, pairs[k].other);
+                    telemetry_publish_float(topic_wind, wind_kmh, pairs[k].timestamp_us);
+                }
+            }
+            sample_ring_release(&adc_ring, count);
+        }
+    }
+}
 
+void display_task(void *arg) {
+    telemetry_msg_t msg;
     char wind[20];
     char ambient[20];
 
     while(1) {
-        // Wait for any new data from either sensor
-        if (xQueueReceive(adc_data_queue, &adc_item, portMAX_DELAY)) {
-            
-            // --- FIX: Logic is now separated ---
-
-            if(adc_item.type) { // Assuming LM35_DATA_TYPE is 1 or a defined constant
-                // 1. Update ONLY the lm35 value
-                current_lm35 = adc_item.value;
-                
-                xQueueOverwrite(http_send_lm35_queue, &current_lm35);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
 
-            } else {
-                
-                current_ntc = adc_item.value;
-            }
-            
-            // --- Recalculate and send the difference AFTER any update ---
-            diff = fabs(current_ntc - current_lm35);
-            xQueueOverwrite(http_send_anemo_queue, &diff);
+        float wind_kmh = telemetry_latest(topic_wind, &msg) ? msg.value.f : 0.0f;
+        float ambient_c = telemetry_latest(topic_ambient, &msg) ? msg.value.f : 0.0f;
 
+        sprintf(wind, "%.2f Km/h", wind_kmh);
+        sprintf(ambient, "%.2f C", ambient_c); // Removed degree symbol for simplicity in sprintf
 
-            // The display logic can remain the same, as it will just show the latest stored state
-            sprintf(wind, "%.2f Km/h", diff);
-            sprintf(ambient, "%.2f C", current_lm35); // Removed degree symbol for simplicity in sprintf
-            
-            if (xTaskGetTickCount() - last_display_time >= pdMS_TO_TICKS(1000)) {
-                ssd1306_clear();
-                ssd1306_print_str(18,0,"Wind Speed:", false);
-                ssd1306_print_str(28,15,wind, false);
-                ssd1306_print_str(18,30,"Ambient Temp:", false);
-                ssd1306_print_str(28,45,ambient, false);
-                ssd1306_display();
-                last_display_time = xTaskGetTickCount();
-            }
-        }
+        ssd1306_clear();
+        ssd1306_print_str(18,0,"Wind Speed:", false);
+        ssd1306_print_str(28,15,wind, false);
+        ssd1306_print_str(18,30,"Ambient Temp:", false);
+        ssd1306_print_str(28,45,ambient, false);
+        ssd1306_display();
     }
 }
 
@@ -288,10 +629,10 @@ void pwm_task(void *arg) {
     int new_pwm = 0;
 
     while(1) {
-        if(xQueueReceive(http_receive_pwm_queue, &new_pwm, portMAX_DELAY)) {
-            printf("PWM http received: %d\r\n", new_pwm);
+        if(xQueueReceive(pwm_cmd_queue, &new_pwm, portMAX_DELAY)) {
             current_pwm = new_pwm;
             pwm_set_duty(&thruster_pwm, &timer, current_pwm);
+            telemetry_publish_int(topic_pwm_duty, current_pwm, esp_timer_get_time());
         }
         
     }
@@ -301,9 +642,6 @@ void pwm_task(void *arg) {
 void app_main(void)
 {
     init_ssd1306();
-    //MUTEX
-    xMutex = xSemaphoreCreateMutex();
-    printf("Mutex created successfully.\r\n");
 
     //PWM
     pwm_timer_init(&timer);
@@ -313,10 +651,64 @@ void app_main(void)
     printf("Channel Initialized. \r\n");
 
     //ADC
-    adc_data_queue = xQueueCreate(10, sizeof(adc_type_data_t));
-    http_receive_pwm_queue = xQueueCreate(10, sizeof(int));
-    http_send_lm35_queue = xQueueCreate(1, sizeof(float));
-    http_send_anemo_queue = xQueueCreate(1, sizeof(float));
+    sample_ring_init(&adc_ring, adc_ring_storage, ADC_RING_LEN);
+    for (int src = 0; src < 2; src++) {
+        timing_stats_init(&adc_interval_stats[src]);
+        timing_stats_init(&adc_latency_stats[src]);
+    }
+
+    //Telemetry
+    ESP_ERROR_CHECK(telemetry_register("ntc_c", TELEMETRY_FLOAT, &topic_ntc));
+    ESP_ERROR_CHECK(telemetry_register("ambient_c", TELEMETRY_FLOAT, &topic_ambient));
+    ESP_ERROR_CHECK(telemetry_register("wind_kmh", TELEMETRY_FLOAT, &topic_wind));
+    ESP_ERROR_CHECK(telemetry_register("pwm_cmd", TELEMETRY_INT, &topic_pwm_cmd));
+    ESP_ERROR_CHECK(telemetry_register("pwm_duty", TELEMETRY_INT, &topic_pwm_duty));
+
+    pwm_cmd_queue = xQueueCreate(10, sizeof(int));
+    ESP_ERROR_CHECK(telemetry_subscribe(topic_pwm_cmd, pwm_cmd_cb, NULL));
+
+    ts_store_init(&wind_history, "wind_kmh", 100);    // 0.01 resolution
+    ts_store_init(&ambient_history, "ambient_c", 100);
+    ESP_ERROR_CHECK(telemetry_subscribe(topic_wind, history_cb, &wind_history));
+    ESP_ERROR_CHECK(telemetry_subscribe(topic_ambient, history_cb, &ambient_history));
+
+    // Oneshot handles are only used for their calibration, sampling runs in continuous mode
+    set_adc(&ntc_adc_conf, &ntc_adc_handle);
+    set_adc(&lm35_adc_conf, &lm35_adc_handle);
+    ntc_lut_build(&ntc_lut, &ntc_params, ntc_adc_handle);
+    anemometer_build(&anemo, &anemo_params, 1.0f, 40.0f, 0.0f, 50.0f);
+
+    adc_decimator_init(&ntc_decimator, ADC_OVERSAMPLE_LOG2);
+    adc_decimator_init(&lm35_decimator, ADC_OVERSAMPLE_LOG2);
+    printf("ADC oversampling x%d: +%.1f bits ENOB\r\n", 1 << ADC_OVERSAMPLE_LOG2, adc_decimator_enob_gain(&ntc_decimator));
+
+    biquad_coeffs_t lowpass[FILTER_MAX_SECTIONS];
+    size_t sections = filter_design_lowpass(FILTER_BUTTERWORTH, ADC_LOWPASS_ORDER, ADC_LOWPASS_HZ,
+                                            ADC_OUTPUT_RATE_HZ, 0, lowpass, FILTER_MAX_SECTIONS);
+    filter_chain_t *chains[] = {&ntc_filter, &lm35_filter};
+    for (size_t i = 0; i < sizeof(chains) / sizeof(chains[0]); i++) {
+        filter_chain_init(chains[i]);
+        filter_chain_add_median(chains[i], ADC_MEDIAN_LEN);
+        filter_chain_add_biquads(chains[i], lowpass, sections);
+    }
+
+    // ADC1 belongs to the acquisition service, sensors register as clients
+    acq_client_config_t ntc_client = {
+        .channel = &ntc_adc_conf,
+        .rate_hz = ADC_SAMPLE_RATE_HZ,
+        .block_len = ADC_BLOCK_LEN,
+        .on_block = ntc_block_cb,
+        .name = "ntc",
+    };
+    acq_client_config_t lm35_client = {
+        .channel = &lm35_adc_conf,
+        .rate_hz = ADC_SAMPLE_RATE_HZ,
+        .block_len = ADC_BLOCK_LEN,
+        .on_block = lm35_block_cb,
+        .name = "lm35",
+    };
+    ESP_ERROR_CHECK(acq_service_register(&ntc_client, NULL));
+    ESP_ERROR_CHECK(acq_service_register(&lm35_client, NULL));
 
     //Initialize NVS
 	esp_err_t ret = nvs_flash_init();
@@ -327,14 +719,30 @@ void app_main(void)
 	}
 	ESP_ERROR_CHECK(ret);
 	
+	// Telemetry log, kept across reboots
+	flash_log_backend_t tlog_backend;
+	if (flash_log_partition_backend(TLOG_PARTITION, &tlog_backend) == ESP_OK &&
+		flash_log_mount(&tlog_backend) == ESP_OK &&
+		flash_log_start() == ESP_OK) {
+		ESP_ERROR_CHECK(telemetry_subscribe(TELEMETRY_ALL_TOPICS, tlog_cb, NULL));
+		ESP_ERROR_CHECK(sample_clock_add(TLOG_MAX_AGE_US, tlog_flush_cb, NULL, NULL));
+		print_log_stats();
+	} else {
+		printf("Telemetry log unavailable (no \"%s\" partition?)\r\n", TLOG_PARTITION);
+	}
+
 	// Start Wifi
 	wifi_app_start();
 
     
 	
-    xTaskCreate(uart_rx_task, "uart_rx_task", 2048, NULL, 5, NULL);
-    xTaskCreate(ntc_task, "ntc_task", 4096, NULL, 4, NULL);
-    xTaskCreate(lm35_task, "lm35_task", 4096, NULL, 4, NULL);
-    xTaskCreate(adc_task, "adc_task", 4096, NULL, 4, NULL);
+    xTaskCreate(uart_rx_task, "uart_rx_task", 3072, NULL, 5, NULL);
+    xTaskCreate(adc_task, "adc_task", 4096, NULL, 4, &adc_task_handle);
     xTaskCreate(pwm_task, "pwm_task", 4096, NULL, 4, NULL);
+    xTaskCreate(display_task, "display_task", 3072, NULL, 3, &display_task_handle);
+
+    ESP_ERROR_CHECK(sample_clock_add(DISPLAY_PERIOD_US, display_clock_cb, NULL, &display_clock_id));
+
+    ESP_ERROR_CHECK(acq_service_start(NULL));
+    ESP_ERROR_CHECK(sample_clock_start());
 }
\ No newline at end of file
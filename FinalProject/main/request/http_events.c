@@ -0,0 +1,225 @@
+/**
+ * @file http_events.c
+ * @author David Ramírez Betancourth
+ * @brief Server-Sent Events telemetry stream (/events)
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+
+#include "http_events.h"
+#include "http_server.h"
+#include "tasks_common.h"
+#include "telemetry_bus.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const char TAG[] = "http_events";
+
+typedef struct {
+	httpd_req_t *req;			// Async copy, owned by the events task
+	uint32_t sent_seq;			// Snapshot the client last received
+	int64_t last_send_us;
+} events_client_t;
+
+static TaskHandle_t events_task_handle;
+static QueueHandle_t events_new_clients;
+static events_client_t events_clients[HTTP_EVENTS_MAX_CLIENTS];
+static int events_num_clients;				// Events task only
+static int events_slots_used;				// Clients connected or still queued, under events_lock
+static portMUX_TYPE events_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// "id: <seq>\nevent: telemetry\ndata: <json>\n\n"
+static char events_frame[HTTP_TELEMETRY_JSON_MAX + 48];
+
+static int events_slots_in_use(void)
+{
+	taskENTER_CRITICAL(&events_lock);
+	int used = events_slots_used;
+	taskEXIT_CRITICAL(&events_lock);
+	return used;
+}
+
+// Takes a slot for a new client, false if all HTTP_EVENTS_MAX_CLIENTS are taken
+static bool events_take_slot(void)
+{
+	bool taken = false;
+
+	taskENTER_CRITICAL(&events_lock);
+	if (events_slots_used < HTTP_EVENTS_MAX_CLIENTS) {
+		events_slots_used++;
+		taken = true;
+	}
+	taskEXIT_CRITICAL(&events_lock);
+	return taken;
+}
+
+static void events_release_slot(void)
+{
+	taskENTER_CRITICAL(&events_lock);
+	events_slots_used--;
+	taskEXIT_CRITICAL(&events_lock);
+}
+
+// Bus subscriber: only a wake-up, the frame is built later from the latest values
+static void events_bus_cb(const telemetry_msg_t *msg, void *user_ctx)
+{
+	if (events_slots_in_use() > 0) {
+		xTaskNotifyGive(events_task_handle);
+	}
+}
+
+// True if the socket can take more data right now
+static bool events_socket_writable(int fd)
+{
+	fd_set wfds;
+	struct timeval tv = {0, 0};
+
+	FD_ZERO(&wfds);
+	FD_SET(fd, &wfds);
+	return select(fd + 1, NULL, &wfds, NULL, &tv) > 0;
+}
+
+static void events_drop(int index)
+{
+	httpd_req_t *req = events_clients[index].req;
+
+	// The chunked reply is left unterminated, the connection cannot be reused
+	httpd_sess_trigger_close(req->handle, httpd_req_to_sockfd(req));
+	httpd_req_async_handler_complete(req);
+	events_clients[index] = events_clients[events_num_clients - 1];
+	events_num_clients--;
+	events_release_slot();
+	ESP_LOGI(TAG, "client left, %d connected", events_num_clients);
+}
+
+static void events_accept(httpd_req_t *req)
+{
+	static const char hello[] = "retry: 2000\n\n";
+	struct timeval send_timeout = {0, 500000};
+	int fd = httpd_req_to_sockfd(req);
+
+	// Bounds a blocking send; writability is checked first anyway
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout));
+
+	httpd_resp_set_type(req, "text/event-stream");
+	httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+	if (httpd_resp_send_chunk(req, hello, sizeof(hello) - 1) != ESP_OK) {
+		httpd_req_async_handler_complete(req);
+		events_release_slot();
+		return;
+	}
+
+	events_clients[events_num_clients++] = (events_client_t) {
+		.req = req,
+		.sent_seq = 0,
+		.last_send_us = esp_timer_get_time(),
+	};
+	ESP_LOGI(TAG, "client joined, %d connected", events_num_clients);
+}
+
+static void events_task(void *arg)
+{
+	httpd_req_t *req;
+
+	while (1) {
+		ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(HTTP_EVENTS_HEARTBEAT_MS));
+
+		while (xQueueReceive(events_new_clients, &req, 0) == pdTRUE) {
+			events_accept(req);
+		}
+		if (events_num_clients == 0) {
+			continue;
+		}
+
+		uint32_t seq;
+		char json[HTTP_TELEMETRY_JSON_MAX];
+		size_t json_len = http_server_telemetry_json(json, sizeof(json), &seq);
+		int frame_len = snprintf(events_frame, sizeof(events_frame), "id: %lu\nevent: telemetry\ndata: %s\n\n",
+								 (unsigned long)seq, json_len ? json : "{}");
+		int64_t now = esp_timer_get_time();
+
+		for (int i = events_num_clients - 1; i >= 0; i--) {
+			events_client_t *client = &events_clients[i];
+			bool idle = now - client->last_send_us >= (int64_t)HTTP_EVENTS_HEARTBEAT_MS * 1000;
+			const char *data = events_frame;
+			size_t len = (size_t)frame_len;
+
+			if (client->sent_seq == seq) {
+				if (!idle) {
+					continue;
+				}
+				data = ": ping\n\n";
+				len = 8;
+			}
+
+			// A busy socket skips this frame and gets a newer one later
+			if (!events_socket_writable(httpd_req_to_sockfd(client->req))) {
+				if (now - client->last_send_us >= (int64_t)HTTP_EVENTS_STALL_MS * 1000) {
+					events_drop(i);
+				}
+				continue;
+			}
+
+			if (httpd_resp_send_chunk(client->req, data, len) != ESP_OK) {
+				events_drop(i);
+				continue;
+			}
+			client->sent_seq = seq;
+			client->last_send_us = now;
+		}
+
+		// Let publishes pile up into the next frame
+		vTaskDelay(pdMS_TO_TICKS(HTTP_EVENTS_MIN_PERIOD_MS));
+	}
+}
+
+esp_err_t http_events_start(void)
+{
+	if (events_task_handle) {
+		return ESP_OK;
+	}
+
+	events_new_clients = xQueueCreate(HTTP_EVENTS_MAX_CLIENTS, sizeof(httpd_req_t *));
+	if (!events_new_clients) {
+		return ESP_ERR_NO_MEM;
+	}
+
+	if (xTaskCreatePinnedToCore(events_task, "http_events", HTTP_EVENTS_TASK_STACK_SIZE, NULL,
+								HTTP_EVENTS_TASK_PRIORITY, &events_task_handle, HTTP_EVENTS_TASK_CORE_ID) != pdPASS) {
+		return ESP_ERR_NO_MEM;
+	}
+
+	return telemetry_subscribe(TELEMETRY_ALL_TOPICS, events_bus_cb, NULL);
+}
+
+esp_err_t http_events_handler(httpd_req_t *req)
+{
+	httpd_req_t *async_req;
+
+	// The slot is held from here until the events task drops the client, so
+	// the queue never carries more clients than events_clients[] can take
+	if (!events_task_handle || !events_take_slot()) {
+		httpd_resp_set_status(req, "503 Service Unavailable");
+		return httpd_resp_send(req, "Too many event clients", HTTPD_RESP_USE_STRLEN);
+	}
+
+	if (httpd_req_async_handler_begin(req, &async_req) != ESP_OK) {
+		events_release_slot();
+		return ESP_FAIL;
+	}
+
+	if (xQueueSend(events_new_clients, &async_req, 0) != pdTRUE) {
+		httpd_req_async_handler_complete(async_req);
+		events_release_slot();
+		return ESP_FAIL;
+	}
+
+	xTaskNotifyGive(events_task_handle);
+	return ESP_OK;
+}
@@ -0,0 +1,35 @@
+/**
+ * @file http_events.h
+ * @author David Ramírez Betancourth
+ * @brief Server-Sent Events telemetry stream (/events), header
+ *
+ * Clients are detached from the httpd worker with the async request API
+ * and served by one events task. A bus subscriber only wakes that task;
+ * frames are built from the latest values when they are sent, so a slow
+ * client never accumulates a backlog, it just receives the newest
+ * snapshot once its socket can take it.
+ */
+
+#ifndef MAIN_HTTP_EVENTS_H_
+#define MAIN_HTTP_EVENTS_H_
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+#define HTTP_EVENTS_MAX_CLIENTS		3
+#define HTTP_EVENTS_MIN_PERIOD_MS	100		// At most 10 frames/s per client
+#define HTTP_EVENTS_HEARTBEAT_MS	15000	// Comment line when idle, detects closed sockets
+#define HTTP_EVENTS_STALL_MS		10000	// Drop a client that cannot take a frame for this long
+
+/**
+ * Creates the events task and subscribes it to the telemetry bus.
+ * @return ESP_OK, or ESP_ERR_NO_MEM.
+ */
+esp_err_t http_events_start(void);
+
+/**
+ * GET /events handler, hands the request over to the events task.
+ */
+esp_err_t http_events_handler(httpd_req_t *req);
+
+#endif /* MAIN_HTTP_EVENTS_H_ */
@@ -6,20 +6,58 @@
 #include "esp_log.h"
 #include "esp_ota_ops.h"
 #include "esp_timer.h"
+#include "esp_random.h"
 #include "sys/param.h"
 #include "driver/gpio.h"
 
 #include "http_server.h"
+#include "http_events.h"
+#include "http_ws.h"
 #include "tasks_common.h"
 #include "wifi_app.h"
+#include "timing_stats.h"
+#include "app_stats.h"
+#include "acq_service.h"
+#include "telemetry_bus.h"
+#include "ts_store.h"
+#include "sample_codec.h"
+#include "json_writer.h"
+#include "json_scan.h"
+#include "lwip/sockets.h"
 //#include "rgb_led.h"
 //#include "freertos/queue.h"
 
-#include <cJSON.h>
+#include <stdio.h>
+#include <stdlib.h>
 
 // Tag used for ESP serial console messages
 static const char TAG[] = "http_server";
 
+// Request bodies are read in pieces of this size, see http_server_read_body()
+#define HTTP_BODY_SCRATCH_LEN		128
+#define HTTP_BODY_TIMEOUT_MS		2000	// Whole body, from the first receive
+#define HTTP_PWM_BODY_MAX			256		// {"pwm_val": N} plus some slack
+#define HTTP_SERVER_RECV_TIMEOUT_S	10
+#define HTTP_STATS_JSON_MAX			2048	// /stats.json: 2 sources and ACQ_SERVICE_MAX_CLIENTS clients
+
+// /events and /ws clients hold their socket for as long as they stay; page
+// loads and polls get HTTP_SERVER_PAGE_SOCKETS on top of those
+#define HTTP_SERVER_PAGE_SOCKETS	4
+#if CONFIG_HTTPD_WS_SUPPORT
+#define HTTP_SERVER_STREAM_SOCKETS	(HTTP_EVENTS_MAX_CLIENTS + HTTP_WS_MAX_CLIENTS)
+#else
+#define HTTP_SERVER_STREAM_SOCKETS	HTTP_EVENTS_MAX_CLIENTS
+#endif
+#define HTTP_SERVER_MAX_OPEN_SOCKETS	(HTTP_SERVER_STREAM_SOCKETS + HTTP_SERVER_PAGE_SOCKETS)
+
+// httpd_start() needs 3 lwIP sockets of its own besides the sessions
+#if CONFIG_LWIP_MAX_SOCKETS < HTTP_SERVER_MAX_OPEN_SOCKETS + 3
+#error "CONFIG_LWIP_MAX_SOCKETS is too low for HTTP_SERVER_MAX_OPEN_SOCKETS, see sdkconfig.defaults"
+#endif
+
+// Receives one piece of a request body, returns false to reject it
+typedef bool (*http_body_sink_t)(const char *data, size_t len, void *ctx);
+
 // HTTP server task handle
 static httpd_handle_t http_server_handle = NULL;
 
@@ -29,89 +67,123 @@ static TaskHandle_t task_http_server_monitor = NULL;
 // Queue handle used to manipulate the main queue of events
 static QueueHandle_t http_server_monitor_queue_handle;
 
-// Embedded files: JQuery, index.html, app.css, app.js and favicon.ico files
-extern const uint8_t jquery_3_3_1_min_js_start[]	asm("_binary_jquery_3_3_1_min_js_start");
-extern const uint8_t jquery_3_3_1_min_js_end[]		asm("_binary_jquery_3_3_1_min_js_end");
-extern const uint8_t index_html_start[]				asm("_binary_index_html_start");
-extern const uint8_t index_html_end[]				asm("_binary_index_html_end");
-extern const uint8_t app_css_start[]				asm("_binary_app_css_start");
-extern const uint8_t app_css_end[]					asm("_binary_app_css_end");
-extern const uint8_t app_js_start[]					asm("_binary_app_js_start");
-extern const uint8_t app_js_end[]					asm("_binary_app_js_end");
-extern const uint8_t favicon_ico_start[]			asm("_binary_favicon_ico_start");
-extern const uint8_t favicon_ico_end[]				asm("_binary_favicon_ico_end");
+// Web page files, gzip-compressed at build time (gen_web_assets.py)
+#include "web_assets.h"
 
 //-----------------------------------UTILS----------------------------
 /**
- * @brief Receives HTTP request content, handling content length, memory allocation, and reception.
- *
- * @param req Pointer to the httpd_req_t structure.
- * @param buf_out Pointer to a char* where the allocated buffer containing the received content will be stored.
- * The caller is responsible for freeing this buffer.
- * @return ESP_OK on success, ESP_FAIL on error.
+ * Sends an embedded web asset with caching headers.
+ * Versioned URLs (?v=<hash>, written into index.html at build time) change
+ * with the content, so they are cached as immutable. Other URLs are
+ * revalidated with the ETag and answered with a bodyless 304 when unchanged.
+ * Assets are sent gzip-encoded, which every browser accepts.
+ * @param req HTTP request for which the uri needs to be handled.
+ * @param asset asset to send.
+ * @return ESP_OK, or the send error.
  */
-esp_err_t receive_http_content(httpd_req_t *req, char **buf_out) {
-    int content_len = req->content_len;
-
-    // 1. Check for valid content length
-    if (content_len <= 0) {
-        ESP_LOGE(TAG, "Empty or invalid content length received.");
-        httpd_resp_send_500(req);
-        return ESP_FAIL;
-    }
-
-    // 2. Allocate memory for the request content
-    char* buf = (char*)malloc(content_len + 1);
-    if (!buf) {
-        ESP_LOGE(TAG, "Failed to allocate memory for request content");
-        httpd_resp_send_500(req);
-        return ESP_FAIL;
-    }
-
-    // 3. Receive the content
-    int received = 0;
-    int ret;
-    while (received < content_len) {
-        ret = httpd_req_recv(req, buf + received, content_len - received);
-        if (ret <= 0) {
-            if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
-                // Continue if it's a timeout, try receiving again
-                continue;
-            }
-            ESP_LOGE(TAG, "Failed to receive request content: %d", ret);
-            free(buf); // Free allocated memory on error
-            httpd_resp_send_500(req);
-            return ESP_FAIL;
-        }
-        received += ret;
-    }
-    buf[received] = '\0'; // Null-terminate the received data
-
-    printf("Received JSON data: %s\n", buf); // Print for debugging
-
-    *buf_out = buf; // Pass the allocated buffer back to the caller
-    return ESP_OK;
+static esp_err_t http_server_send_asset(httpd_req_t *req, const web_asset_t *asset)
+{
+	char query[32];
+	char version[12];
+	char if_none_match[24];
+
+	if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+		httpd_query_key_value(query, "v", version, sizeof(version)) == ESP_OK &&
+		strcmp(version, asset->version) == 0) {
+		httpd_resp_set_hdr(req, "Cache-Control", "public, max-age=31536000, immutable");
+	} else {
+		httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+	}
+	httpd_resp_set_hdr(req, "ETag", asset->etag);
+
+	if (httpd_req_get_hdr_value_str(req, "If-None-Match", if_none_match, sizeof(if_none_match)) == ESP_OK &&
+		strcmp(if_none_match, asset->etag) == 0) {
+		httpd_resp_set_status(req, "304 Not Modified");
+		return httpd_resp_send(req, NULL, 0);
+	}
+
+	httpd_resp_set_type(req, asset->mime);
+	if (asset->gzip) {
+		httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+	}
+	return httpd_resp_send(req, (const char *)asset->data, asset->len);
 }
 
-// Helper function to safely extract a float value from a cJSON object
-static float get_float_from_json(cJSON *json_obj, const char *key) {
-    cJSON *item = cJSON_GetObjectItemCaseSensitive(json_obj, key);
-    if (cJSON_IsNumber(item)) {
-        return (float)cJSON_GetNumberValue(item);
-    } else {
-        ESP_LOGW(TAG, "%s value not found or not a number, defaulting to 0", key);
-        return 0.0f; // Default value if not found or not a number
-    }
+/**
+ * Receives a request body into the sink without allocating.
+ * The body goes through a fixed scratch buffer in pieces; requests that are
+ * empty, larger than max_len, malformed (sink returns false) or not fully
+ * received before the deadline are answered with 400/413/408 here.
+ * @param req HTTP request.
+ * @param max_len largest accepted body.
+ * @param timeout_ms time allowed for the whole body.
+ * @param sink called for every received piece, returns false to reject the body.
+ * @param ctx passed to sink.
+ * @return ESP_OK if the whole body was accepted. On ESP_FAIL the handler must
+ * return ESP_FAIL too, so the connection (with any unread body) gets closed.
+ */
+static esp_err_t http_server_read_body(httpd_req_t *req, size_t max_len, uint32_t timeout_ms,
+									   http_body_sink_t sink, void *ctx)
+{
+	// Handlers all run in the one httpd task, a single scratch buffer is enough
+	static char scratch[HTTP_BODY_SCRATCH_LEN];
+	int64_t deadline = esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+	int fd = httpd_req_to_sockfd(req);
+	size_t left = req->content_len;
+	esp_err_t err = ESP_OK;
+
+	if (left == 0) {
+		httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Empty body");
+		return ESP_FAIL;
+	}
+	if (left > max_len) {
+		httpd_resp_set_status(req, "413 Payload Too Large");
+		httpd_resp_send(req, NULL, 0);
+		return ESP_FAIL;
+	}
+
+	while (left > 0) {
+		int64_t remaining_us = deadline - esp_timer_get_time();
+		if (remaining_us <= 0) {
+			httpd_resp_send_err(req, HTTPD_408_REQ_TIMEOUT, NULL);
+			err = ESP_FAIL;
+			break;
+		}
+
+		// Bound each receive by what is left of the deadline
+		struct timeval timeout = {
+			.tv_sec = remaining_us / 1000000,
+			.tv_usec = remaining_us % 1000000,
+		};
+		setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+		int ret = httpd_req_recv(req, scratch, MIN(left, sizeof(scratch)));
+		if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+			continue;
+		}
+		if (ret <= 0) {
+			err = ESP_FAIL;     // Connection lost, nobody to answer
+			break;
+		}
+		left -= ret;
+
+		if (!sink(scratch, ret, ctx)) {
+			httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Malformed body");
+			err = ESP_FAIL;
+			break;
+		}
+	}
+
+	struct timeval timeout = {.tv_sec = HTTP_SERVER_RECV_TIMEOUT_S};
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+	return err;
 }
 
-static float get_int_from_json(cJSON *json_obj, const char *key) {
-    cJSON *item = cJSON_GetObjectItemCaseSensitive(json_obj, key);
-    if (cJSON_IsNumber(item)) {
-        return (int)cJSON_GetNumberValue(item);
-    } else {
-        ESP_LOGW(TAG, "%s value not found or not a number, defaulting to 0", key);
-        return 0;
-    }
+// http_server_read_body() sink feeding a json_scan_t
+static bool http_server_json_scan_sink(const char *data, size_t len, void *ctx)
+{
+	return json_scan_feed((json_scan_t *)ctx, data, len);
 }
 
 //---------------------------------HTTP------------------------------------
@@ -166,171 +238,302 @@ static void http_server_monitor(void *parameter)
 }
 
 /**
- * Jquery get handler is requested when accessing the web page.
+ * Web page files: one wildcard GET handler over the generated asset table,
+ * looked up by binary search (web_asset_find(), see gen_web_assets.py).
+ * Registered last, so it only sees URIs no other handler took.
  * @param req HTTP request for which the uri needs to be handled.
- * @return ESP_OK
+ * @return ESP_OK, or the send error.
  */
-static esp_err_t http_server_jquery_handler(httpd_req_t *req)
+static esp_err_t http_server_asset_handler(httpd_req_t *req)
 {
-	ESP_LOGI(TAG, "Jquery requested");
+	const web_asset_t *asset = web_asset_find(req->uri);
 
-	httpd_resp_set_type(req, "application/javascript");
-	httpd_resp_send(req, (const char *)jquery_3_3_1_min_js_start, jquery_3_3_1_min_js_end - jquery_3_3_1_min_js_start);
-
-	return ESP_OK;
+	if (!asset) {
+		return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, NULL);
+	}
+	return http_server_send_asset(req, asset);
 }
 
 /**
- * Sends the index.html page.
- * @param req HTTP request for which the uri needs to be handled.
- * @return ESP_OK
+ * URI matcher: wildcards for the asset handler, and /ws refused while the
+ * ws channel is full. httpd completes the WebSocket handshake before the
+ * /ws handler runs, so this is the last point where the browser can still
+ * be turned away (it gets the 404 of the asset handler and uses /events).
  */
-static esp_err_t http_server_index_html_handler(httpd_req_t *req)
+static bool http_server_uri_match(const char *reference_uri, const char *uri_to_match, size_t match_upto)
 {
-	ESP_LOGI(TAG, "index.html requested");
-
-	httpd_resp_set_type(req, "text/html");
-	httpd_resp_send(req, (const char *)index_html_start, index_html_end - index_html_start);
-
-	return ESP_OK;
+#if CONFIG_HTTPD_WS_SUPPORT
+	if (strcmp(reference_uri, "/ws") == 0 && !http_ws_has_room()) {
+		return false;
+	}
+#endif
+	return httpd_uri_match_wildcard(reference_uri, uri_to_match, match_upto);
 }
 
-/**
- * app.css get handler is requested when accessing the web page.
- * @param req HTTP request for which the uri needs to be handled.
- * @return ESP_OK
- */
-static esp_err_t http_server_app_css_handler(httpd_req_t *req)
+// Sends {"<key>": <latest value of topic>} from a stack buffer, no heap involved
+static esp_err_t send_topic_value_json(httpd_req_t *req, const char *topic, const char *key)
 {
-	ESP_LOGI(TAG, "app.css requested");
+	char buf[48];
+	json_writer_t w;
+	telemetry_msg_t msg;
+	float value = 0.0f;
+	size_t len;
+
+	if (telemetry_latest(telemetry_find(topic), &msg)) {
+		value = msg.value.f;
+	}
 
-	httpd_resp_set_type(req, "text/css");
-	httpd_resp_send(req, (const char *)app_css_start, app_css_end - app_css_start);
+	json_writer_init(&w, buf, sizeof(buf));
+	json_obj_begin(&w);
+	json_kv_float(&w, key, value, 2);
+	json_obj_end(&w);
+	if (!json_writer_finish(&w, &len)) {
+		return ESP_FAIL;
+	}
 
-	return ESP_OK;
+	httpd_resp_set_type(req, "application/json");
+	return httpd_resp_send(req, buf, len);
 }
 
-/**
- * app.js get handler is requested when accessing the web page.
- * @param req HTTP request for which the uri needs to be handled.
- * @return ESP_OK
- */
-static esp_err_t http_server_app_js_handler(httpd_req_t *req)
+static esp_err_t http_server_get_lm35_sensor_readings_json_handler(httpd_req_t *req)
 {
-	ESP_LOGI(TAG, "app.js requested");
-
-	httpd_resp_set_type(req, "application/javascript");
-	httpd_resp_send(req, (const char *)app_js_start, app_js_end - app_js_start);
-
-	return ESP_OK;
+	return send_topic_value_json(req, "ambient_c", "temp");
 }
 
-/**
- * Sends the .ico (icon) file when accessing the web page.
- * @param req HTTP request for which the uri needs to be handled.
- * @return ESP_OK
- */
-static esp_err_t http_server_favicon_ico_handler(httpd_req_t *req)
+static esp_err_t http_server_get_anemo_readings_json_handler(httpd_req_t *req)
 {
-	ESP_LOGI(TAG, "favicon.ico requested");
-
-	httpd_resp_set_type(req, "image/x-icon");
-	httpd_resp_send(req, (const char *)favicon_ico_start, favicon_ico_end - favicon_ico_start);
-
-	return ESP_OK;
+	return send_topic_value_json(req, "wind_kmh", "wind");
 }
 
-extern QueueHandle_t http_send_lm35_queue;
-static esp_err_t http_server_get_lm35_sensor_readings_json_handler(httpd_req_t *req)
+size_t http_server_telemetry_json(char *buf, size_t cap, uint32_t *seq_sum)
 {
-	ESP_LOGI(TAG, "/lm35Sensor.json requested");
-
-	cJSON *root;
-    char *json_string = NULL;
-	float lm35_temp = 0.0f;
-
-    root = cJSON_CreateObject();
-
-	xQueuePeek(http_send_lm35_queue, &lm35_temp, (TickType_t)pdMS_TO_TICKS(100));
+	telemetry_msg_t msgs[TELEMETRY_MAX_TOPICS];
+	bool valid[TELEMETRY_MAX_TOPICS];
+	json_writer_t w;
+	uint32_t sum = 0;
+	size_t len;
+
+	int count = telemetry_topic_count();
+	for (int topic = 0; topic < count; topic++) {
+		valid[topic] = telemetry_latest(topic, &msgs[topic]);
+		if (valid[topic]) {
+			sum += msgs[topic].seq;     // Every publish raises the sum
+		}
+	}
 
-	printf("http in, lm35 temp: %.2f\r\n", lm35_temp);
+	json_writer_init(&w, buf, cap);
+	json_obj_begin(&w);
+	json_kv_int(&w, "seq", sum);
+	json_kv_int(&w, "t_ms", esp_timer_get_time() / 1000);
+	json_key(&w, "topics");
+	json_obj_begin(&w);
+	for (int topic = 0; topic < count; topic++) {
+		json_key(&w, telemetry_topic_name(topic));
+		if (!valid[topic]) {
+			json_null(&w);
+			continue;
+		}
+		json_obj_begin(&w);
+		json_key(&w, "v");
+		if (msgs[topic].type == TELEMETRY_FLOAT) {
+			json_float(&w, msgs[topic].value.f, 2);
+		} else {
+			json_int(&w, msgs[topic].value.i);
+		}
+		json_kv_int(&w, "seq", msgs[topic].seq);
+		json_kv_int(&w, "t_ms", msgs[topic].timestamp_us / 1000);
+		json_obj_end(&w);
+	}
+	json_obj_end(&w);
+	json_obj_end(&w);
 
-    if (cJSON_AddNumberToObject(root, "temp", lm35_temp) == NULL) {
-        cJSON_Delete(root);
-        return ESP_FAIL;
-    }
+	if (seq_sum) {
+		*seq_sum = sum;
+	}
+	return json_writer_finish(&w, &len) ? len : 0;
+}
 
-    json_string = cJSON_Print(root);
+/**
+ * All telemetry topics in one consistent reply, see http_server_telemetry_json().
+ * The ETag is built from the topic sequences, so a client whose copy is
+ * current gets a 304 without a body.
+ */
+static esp_err_t http_server_get_telemetry_json_handler(httpd_req_t *req)
+{
+	static uint32_t boot_tag;
+	char buf[HTTP_TELEMETRY_JSON_MAX];
+	char etag[24];
+	char if_none_match[24];
+	uint32_t seq_sum;
+
+	// Sequences restart at boot, the tag keeps ETags of different boots apart
+	if (boot_tag == 0) {
+		boot_tag = esp_random() | 1;
+	}
 
-	printf("Requested JSON: %s\n", json_string);
+	size_t len = http_server_telemetry_json(buf, sizeof(buf), &seq_sum);
+	if (len == 0) {
+		return ESP_FAIL;
+	}
 
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, json_string, strlen(json_string));
+	snprintf(etag, sizeof(etag), "\"%08lx-%lx\"", (unsigned long)boot_tag, (unsigned long)seq_sum);
+	httpd_resp_set_hdr(req, "ETag", etag);
+	httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
 
-    cJSON_Delete(root);
-    cJSON_free(json_string);
+	if (httpd_req_get_hdr_value_str(req, "If-None-Match", if_none_match, sizeof(if_none_match)) == ESP_OK &&
+		strcmp(if_none_match, etag) == 0) {
+		httpd_resp_set_status(req, "304 Not Modified");
+		return httpd_resp_send(req, NULL, 0);
+	}
 
-    return ESP_OK;
+	httpd_resp_set_type(req, "application/json");
+	return httpd_resp_send(req, buf, len);
 }
 
-extern QueueHandle_t http_send_anemo_queue;
-static esp_err_t http_server_get_anemo_readings_json_handler(httpd_req_t *req)
+// Writes "<name>":{"n","min","mean","max","p99"} (microseconds) for one collector
+static void write_timing_summary(json_writer_t *w, const char *name, timing_stats_t *stats)
 {
-	ESP_LOGI(TAG, "/anemoSensor.json requested");
-
-	cJSON *root;
-    char *json_string = NULL;
-	float anemo_diff = 0.0f;
+	timing_summary_t summary;
+	timing_stats_summary(stats, &summary);
+
+	json_key(w, name);
+	json_obj_begin(w);
+	json_kv_int(w, "n", summary.count);
+	json_kv_int(w, "min", summary.min_us);
+	json_kv_int(w, "mean", summary.mean_us);
+	json_kv_int(w, "max", summary.max_us);
+	json_kv_int(w, "p99", summary.p99_us);
+	json_obj_end(w);
+}
 
-    root = cJSON_CreateObject();
+static esp_err_t http_server_get_stats_json_handler(httpd_req_t *req)
+{
+	// Handlers run one at a time in the httpd task
+	static char buf[HTTP_STATS_JSON_MAX];
+	json_writer_t w;
+	size_t len;
+
+	json_writer_init(&w, buf, sizeof(buf));
+	json_obj_begin(&w);
+
+	// adc_task: sample spacing and age at consumption, per source
+	for (size_t src = 0; src < app_stats_source_count(); src++) {
+		const app_source_stats_t *source = app_stats_source(src);
+		json_key(&w, source->name);
+		json_obj_begin(&w);
+		write_timing_summary(&w, "interval_us", source->interval);
+		write_timing_summary(&w, "latency_us", source->latency);
+		json_obj_end(&w);
+	}
 
-	xQueuePeek(http_send_anemo_queue, &anemo_diff, (TickType_t)pdMS_TO_TICKS(100));
+	// Acquisition service clients: time spent in the callback and sample age at dispatch
+	json_key(&w, "acq");
+	json_obj_begin(&w);
+	for (size_t id = 0; id < acq_service_client_count(); id++) {
+		acq_client_stats_t *client = acq_service_client_stats(id);
+		json_key(&w, client->name);
+		json_obj_begin(&w);
+		json_kv_int(&w, "rate_hz", client->rate_hz);
+		write_timing_summary(&w, "hold_us", &client->hold);
+		write_timing_summary(&w, "wait_us", &client->wait);
+		json_obj_end(&w);
+	}
+	json_obj_end(&w);
+	json_obj_end(&w);
 
-    if (cJSON_AddNumberToObject(root, "wind", anemo_diff) == NULL) {
-        cJSON_Delete(root);
-        return ESP_FAIL;
-    }
+	if (!json_writer_finish(&w, &len)) {
+		return ESP_FAIL;
+	}
 
-    json_string = cJSON_Print(root);
+	httpd_resp_set_type(req, "application/json");
+	return httpd_resp_send(req, buf, len);
+}
 
-	printf("Requested JSON: %s\n", json_string);
+/**
+ * History of one signal as a sample_codec stream (ms time unit, 0.01 resolution).
+ * GET /history.bin?topic=wind_kmh&seconds=60, the finest tier that covers the range is used.
+ */
+static esp_err_t http_server_get_history_bin_handler(httpd_req_t *req)
+{
+	static ts_point_t points[64];
+	static uint8_t stream[1024];
+	char query[64];
+	char topic[24] = "wind_kmh";
+	char seconds_str[12];
+	int seconds = 60;
+
+	if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+		httpd_query_key_value(query, "topic", topic, sizeof(topic));
+		if (httpd_query_key_value(query, "seconds", seconds_str, sizeof(seconds_str)) == ESP_OK) {
+			seconds = atoi(seconds_str);
+		}
+	}
+	if (seconds <= 0 || seconds > 24 * 3600) {
+		seconds = 60;
+	}
 
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, json_string, strlen(json_string));
+	ts_store_t *store = ts_store_find(topic);
+	if (!store) {
+		httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Unknown topic");
+		return ESP_OK;
+	}
 
-    cJSON_Delete(root);
-    cJSON_free(json_string);
+	int64_t now = esp_timer_get_time();
+	int64_t from = now - (int64_t)seconds * 1000000;
+	ts_tier_t tier = ts_store_best_tier(store, from);
+	sample_codec_enc_t enc;
+	size_t n;
+
+	httpd_resp_set_type(req, "application/octet-stream");
+	httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+
+	// One stream, sent in chunks whenever the buffer is close to full
+	sample_codec_enc_init(&enc, stream, sizeof(stream), 1000, 100);
+	while ((n = ts_store_query(store, tier, from, now, points, 64)) > 0) {
+		for (size_t i = 0; i < n; i++) {
+			if (enc.cap - enc.len < SAMPLE_CODEC_MAX_SAMPLE) {
+				if (httpd_resp_send_chunk(req, (const char *)stream, enc.len) != ESP_OK) {
+					return ESP_FAIL;
+				}
+				enc.len = 0; // Delta state is kept, the chunks concatenate into one stream
+			}
+			sample_codec_enc_put(&enc, points[i].timestamp_us, points[i].mean);
+		}
+		if (n < 64) {
+			break;
+		}
+		// The store keeps ms and queries from an inclusive ms, resume one tick later
+		from = points[n - 1].timestamp_us + TS_STORE_TICK_US;
+	}
 
-    return ESP_OK;
+	if (enc.len > 0 && httpd_resp_send_chunk(req, (const char *)stream, enc.len) != ESP_OK) {
+		return ESP_FAIL;
+	}
+	return httpd_resp_send_chunk(req, NULL, 0);
 }
 
 
-extern QueueHandle_t http_receive_pwm_queue;
 static esp_err_t http_server_pwm_value_handler(httpd_req_t *req)
 {
-    ESP_LOGI(TAG, "/pwmValues.json requested (POST)");
-
-	char *buf = NULL; 
-   
-    if (receive_http_content(req, &buf) != ESP_OK) {
-        return ESP_FAIL;
-    }
-
-    cJSON *root = cJSON_Parse(buf);
-    free(buf);
-
-    int pwm_val = get_int_from_json(root, "pwm_val");
+	static const char *const keys[] = {"pwm_val"};
+	double pwm_val = 0.0;
+	json_scan_t scan;
 
-    printf("Pwm Value Parsed: %d\n", pwm_val);
+	json_scan_init(&scan, keys, 1, &pwm_val);
+	if (http_server_read_body(req, HTTP_PWM_BODY_MAX, HTTP_BODY_TIMEOUT_MS, http_server_json_scan_sink, &scan) != ESP_OK) {
+		return ESP_FAIL;
+	}
 
-    cJSON_Delete(root);
+	if (!json_scan_finish(&scan) || !json_scan_found(&scan, 0) || !(pwm_val >= 0.0 && pwm_val <= 100.0)) {
+		return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Expected {\"pwm_val\": 0-100}");
+	}
 
-    httpd_resp_set_hdr(req, "Connection", "close");
-    httpd_resp_send(req, NULL, 0);
+	httpd_resp_set_hdr(req, "Connection", "close");
+	httpd_resp_send(req, NULL, 0);
 
-	xQueueSend(http_receive_pwm_queue, &pwm_val, (TickType_t)pdMS_TO_TICKS(10));
+	telemetry_publish_int(telemetry_find("pwm_cmd"), (int32_t)pwm_val, esp_timer_get_time());
 
-    return ESP_OK;
+	return ESP_OK;
 }
 
 
@@ -362,9 +565,18 @@ static httpd_handle_t http_server_configure(void)
 	// Increase uri handlers
 	config.max_uri_handlers = 20;
 
+	// Web page files go through one wildcard handler, /ws is refused when full
+	config.uri_match_fn = http_server_uri_match;
+
+	// Room for every stream client plus page loads. LRU purging stays off:
+	// an /events socket receives nothing after its request, so it would
+	// always look least recently used and be the one closed
+	config.max_open_sockets = HTTP_SERVER_MAX_OPEN_SOCKETS;
+	config.lru_purge_enable = false;
+
 
 	// Increase the timeout limits
-	config.recv_wait_timeout = 10;
+	config.recv_wait_timeout = HTTP_SERVER_RECV_TIMEOUT_S;
 	config.send_wait_timeout = 10;
 
 	ESP_LOGI(TAG,
@@ -377,70 +589,80 @@ static httpd_handle_t http_server_configure(void)
 	{
 		ESP_LOGI(TAG, "http_server_configure: Registering URI handlers");
 
-		// register index.html handler
-		httpd_uri_t index_html = {
-				.uri = "/",
+		// register lm35Sensor.json handler
+		httpd_uri_t lm35_sensor_json = {
+				.uri = "/lm35Sensor.json",
 				.method = HTTP_GET,
-				.handler = http_server_index_html_handler,
+				.handler = http_server_get_lm35_sensor_readings_json_handler,
 				.user_ctx = NULL
 		};
-		httpd_register_uri_handler(http_server_handle, &index_html);
+		httpd_register_uri_handler(http_server_handle, &lm35_sensor_json);
 
-		// register query handler
-		httpd_uri_t jquery_js = {
-				.uri = "/jquery-3.3.1.min.js",
+		// register anemoSensor.json handler
+		httpd_uri_t anemo_sensor_json = {
+				.uri = "/anemoSensor.json",
 				.method = HTTP_GET,
-				.handler = http_server_jquery_handler,
+				.handler = http_server_get_anemo_readings_json_handler,
 				.user_ctx = NULL
 		};
-		httpd_register_uri_handler(http_server_handle, &jquery_js);
-
-
-		// register app.css handler
-		httpd_uri_t app_css = {
-				.uri = "/app.css",
+		httpd_register_uri_handler(http_server_handle, &anemo_sensor_json);
+		
+		// register telemetry.json handler
+		httpd_uri_t telemetry_json = {
+				.uri = "/telemetry.json",
 				.method = HTTP_GET,
-				.handler = http_server_app_css_handler,
+				.handler = http_server_get_telemetry_json_handler,
 				.user_ctx = NULL
 		};
-		httpd_register_uri_handler(http_server_handle, &app_css);
+		httpd_register_uri_handler(http_server_handle, &telemetry_json);
+
+		// register events handler (SSE, served by the events task)
+		if (http_events_start() == ESP_OK) {
+			httpd_uri_t events = {
+					.uri = "/events",
+					.method = HTTP_GET,
+					.handler = http_events_handler,
+					.user_ctx = NULL
+			};
+			httpd_register_uri_handler(http_server_handle, &events);
+		} else {
+			ESP_LOGE(TAG, "Could not start the events task");
+		}
 
-		// register app.js handler
-		httpd_uri_t app_js = {
-				.uri = "/app.js",
-				.method = HTTP_GET,
-				.handler = http_server_app_js_handler,
-				.user_ctx = NULL
-		};
-		httpd_register_uri_handler(http_server_handle, &app_js);
+#if CONFIG_HTTPD_WS_SUPPORT
+		// register ws handler (binary PWM commands in, telemetry out)
+		if (http_ws_start(http_server_handle) == ESP_OK) {
+			httpd_uri_t ws = {
+					.uri = "/ws",
+					.method = HTTP_GET,
+					.handler = http_ws_handler,
+					.user_ctx = NULL,
+					.is_websocket = true
+			};
+			httpd_register_uri_handler(http_server_handle, &ws);
+		} else {
+			ESP_LOGE(TAG, "Could not start the ws task");
+		}
+#endif
 
-		// register favicon.ico handler
-		httpd_uri_t favicon_ico = {
-				.uri = "/favicon.ico",
+		// register stats.json handler
+		httpd_uri_t stats_json = {
+				.uri = "/stats.json",
 				.method = HTTP_GET,
-				.handler = http_server_favicon_ico_handler,
+				.handler = http_server_get_stats_json_handler,
 				.user_ctx = NULL
 		};
-		httpd_register_uri_handler(http_server_handle, &favicon_ico);
+		httpd_register_uri_handler(http_server_handle, &stats_json);
 
-		// register lm35Sensor.json handler
-		httpd_uri_t lm35_sensor_json = {
-				.uri = "/lm35Sensor.json",
+		// register history.bin handler
+		httpd_uri_t history_bin = {
+				.uri = "/history.bin",
 				.method = HTTP_GET,
-				.handler = http_server_get_lm35_sensor_readings_json_handler,
+				.handler = http_server_get_history_bin_handler,
 				.user_ctx = NULL
 		};
-		httpd_register_uri_handler(http_server_handle, &lm35_sensor_json);
+		httpd_register_uri_handler(http_server_handle, &history_bin);
 
-		// register anemoSensor.json handler
-		httpd_uri_t anemo_sensor_json = {
-				.uri = "/anemoSensor.json",
-				.method = HTTP_GET,
-				.handler = http_server_get_anemo_readings_json_handler,
-				.user_ctx = NULL
-		};
-		httpd_register_uri_handler(http_server_handle, &anemo_sensor_json);
-		
 		// register toogle_led handler
 		httpd_uri_t pwm_values_json = {
 				.uri = "/pwmValues.json",
@@ -450,6 +672,15 @@ static httpd_handle_t http_server_configure(void)
 		};
 		httpd_register_uri_handler(http_server_handle, &pwm_values_json);
 
+		// register the web page files, must stay last (matches every GET)
+		httpd_uri_t assets = {
+				.uri = "/*",
+				.method = HTTP_GET,
+				.handler = http_server_asset_handler,
+				.user_ctx = NULL
+		};
+		httpd_register_uri_handler(http_server_handle, &assets);
+
 		return http_server_handle;
 	}
 
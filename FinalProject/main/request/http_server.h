@@ -8,11 +8,16 @@
 #ifndef MAIN_HTTP_SERVER_H_
 #define MAIN_HTTP_SERVER_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
 #define OTA_UPDATE_PENDING 		0
 #define OTA_UPDATE_SUCCESSFUL	1
 #define OTA_UPDATE_FAILED		-1
 #define BLINK_GPIO				2
 
+#define HTTP_TELEMETRY_JSON_MAX	640		// Buffer for http_server_telemetry_json()
+
 /**
  * Messages for the HTTP monitor
  */
@@ -58,6 +63,16 @@ void http_server_start(void);
  */
 void http_server_stop(void);
 
+/**
+ * Writes the snapshot of all telemetry topics as JSON:
+ * {"seq":S,"t_ms":T,"topics":{"<name>":{"v":V,"seq":N,"t_ms":T},...}}
+ * @param buf output buffer, HTTP_TELEMETRY_JSON_MAX bytes are enough.
+ * @param cap capacity of buf.
+ * @param seq_sum optional, sum of the topic sequences (changes on every publish).
+ * @return length without the terminator, 0 if it did not fit.
+ */
+size_t http_server_telemetry_json(char *buf, size_t cap, uint32_t *seq_sum);
+
 /**
  * Timer callback function which calls esp_restart upon successful firmware update.
  */
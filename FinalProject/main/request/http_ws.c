@@ -0,0 +1,377 @@
+/**
+ * @file http_ws.c
+ * @author David Ramírez Betancourth
+ * @brief WebSocket control and telemetry channel (/ws)
+ */
+
+#include "http_ws.h"
+
+#if CONFIG_HTTPD_WS_SUPPORT
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+
+#include "tasks_common.h"
+#include "telemetry_bus.h"
+
+#include <string.h>
+
+static const char TAG[] = "http_ws";
+
+typedef struct {
+	int fd;
+	bool topics_sent;
+	uint32_t sent_seq;			// Sum of the topic sequences last sent
+} ws_client_t;
+
+static httpd_handle_t ws_server;
+static TaskHandle_t ws_task_handle;
+static ws_client_t ws_clients[HTTP_WS_MAX_CLIENTS];
+static int ws_num_clients;
+static bool ws_push_queued;		// ws_push_work() waiting in the httpd queue
+static portMUX_TYPE ws_clients_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Largest server frame: TOPICS with full-length names
+static uint8_t ws_frame[2 + TELEMETRY_MAX_TOPICS * (3 + TELEMETRY_NAME_LEN)];
+
+//-----------------------------------Encoding--------------------------------------
+
+static inline uint8_t *put_u16(uint8_t *p, uint16_t v)
+{
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+	return p + 2;
+}
+
+static inline uint8_t *put_u32(uint8_t *p, uint32_t v)
+{
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+	p[2] = (uint8_t)(v >> 16);
+	p[3] = (uint8_t)(v >> 24);
+	return p + 4;
+}
+
+static inline uint16_t get_u16(const uint8_t *p)
+{
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t get_u32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static size_t ws_build_topics(uint8_t *out)
+{
+	int count = telemetry_topic_count();
+	uint8_t *p = out;
+
+	*p++ = HTTP_WS_MSG_TOPICS;
+	*p++ = (uint8_t)count;
+	for (int topic = 0; topic < count; topic++) {
+		telemetry_msg_t msg;
+		const char *name = telemetry_topic_name(topic);
+		size_t len = strlen(name);
+
+		telemetry_latest(topic, &msg);  // Only for the type, valid even if never published
+		*p++ = (uint8_t)topic;
+		*p++ = msg.type;
+		*p++ = (uint8_t)len;
+		memcpy(p, name, len);
+		p += len;
+	}
+	return (size_t)(p - out);
+}
+
+// Latest value of every published topic, returns the length and the sequence sum
+static size_t ws_build_telemetry(uint8_t *out, uint32_t *seq_sum)
+{
+	int count = telemetry_topic_count();
+	uint8_t *p = out + 2;
+	uint8_t n = 0;
+	uint32_t sum = 0;
+
+	for (int topic = 0; topic < count; topic++) {
+		telemetry_msg_t msg;
+		uint32_t bits;
+
+		if (!telemetry_latest(topic, &msg)) {
+			continue;
+		}
+		memcpy(&bits, &msg.value, sizeof(bits));
+		*p++ = (uint8_t)topic;
+		*p++ = msg.type;
+		p = put_u32(p, msg.seq);
+		p = put_u32(p, (uint32_t)(msg.timestamp_us / 1000));
+		p = put_u32(p, bits);
+		sum += msg.seq;
+		n++;
+	}
+	out[0] = HTTP_WS_MSG_TELEMETRY;
+	out[1] = n;
+	*seq_sum = sum;
+	return (size_t)(p - out);
+}
+
+//-----------------------------------Clients---------------------------------------
+
+static bool ws_add_client(int fd)
+{
+	bool added = false;
+
+	taskENTER_CRITICAL(&ws_clients_lock);
+	if (ws_num_clients < HTTP_WS_MAX_CLIENTS) {
+		ws_clients[ws_num_clients++] = (ws_client_t) {.fd = fd};
+		added = true;
+	}
+	taskEXIT_CRITICAL(&ws_clients_lock);
+
+	return added;
+}
+
+bool http_ws_has_room(void)
+{
+	bool room;
+
+	taskENTER_CRITICAL(&ws_clients_lock);
+	room = ws_num_clients < HTTP_WS_MAX_CLIENTS;
+	taskEXIT_CRITICAL(&ws_clients_lock);
+
+	return room;
+}
+
+static void ws_remove_client(int fd)
+{
+	taskENTER_CRITICAL(&ws_clients_lock);
+	for (int i = 0; i < ws_num_clients; i++) {
+		if (ws_clients[i].fd == fd) {
+			ws_clients[i] = ws_clients[--ws_num_clients];
+			break;
+		}
+	}
+	taskEXIT_CRITICAL(&ws_clients_lock);
+}
+
+static bool ws_socket_writable(int fd)
+{
+	fd_set wfds;
+	struct timeval tv = {0, 0};
+
+	FD_ZERO(&wfds);
+	FD_SET(fd, &wfds);
+	return select(fd + 1, NULL, &wfds, NULL, &tv) > 0;
+}
+
+static esp_err_t ws_send(int fd, const uint8_t *data, size_t len)
+{
+	httpd_ws_frame_t frame = {
+		.type = HTTPD_WS_TYPE_BINARY,
+		.final = true,
+		.payload = (uint8_t *)data,
+		.len = len,
+	};
+	return httpd_ws_send_frame_async(ws_server, fd, &frame);
+}
+
+// A failed send can leave part of a frame on the socket, the session is
+// closed rather than reused
+static void ws_close_client(int fd)
+{
+	ws_remove_client(fd);
+	httpd_sess_trigger_close(ws_server, fd);
+}
+
+//-----------------------------------Push------------------------------------------
+
+/**
+ * Sends the latest telemetry to every client that has not seen it.
+ * Runs in the httpd task (queued by ws_task with httpd_queue_work()), the
+ * same task that sends the replies in http_ws_handler(), so frames to one
+ * socket are never written by two tasks at once.
+ */
+static void ws_push_work(void *arg)
+{
+	ws_client_t clients[HTTP_WS_MAX_CLIENTS];
+
+	taskENTER_CRITICAL(&ws_clients_lock);
+	ws_push_queued = false;
+	int count = ws_num_clients;
+	memcpy(clients, ws_clients, sizeof(ws_client_t) * count);
+	taskEXIT_CRITICAL(&ws_clients_lock);
+
+	if (count == 0) {
+		return;
+	}
+
+	uint32_t seq;
+	size_t len = ws_build_telemetry(ws_frame, &seq);
+
+	for (int i = 0; i < count; i++) {
+		int fd = clients[i].fd;
+
+		if (httpd_ws_get_fd_info(ws_server, fd) != HTTPD_WS_CLIENT_WEBSOCKET) {
+			ws_remove_client(fd);
+			continue;
+		}
+		// A busy socket skips this frame and gets a newer one later
+		if (clients[i].sent_seq == seq || !ws_socket_writable(fd)) {
+			continue;
+		}
+
+		if (!clients[i].topics_sent) {
+			static uint8_t topics[sizeof(ws_frame)];
+			if (ws_send(fd, topics, ws_build_topics(topics)) != ESP_OK) {
+				ws_close_client(fd);
+				continue;
+			}
+		}
+		if (ws_send(fd, ws_frame, len) != ESP_OK) {
+			ws_close_client(fd);
+			continue;
+		}
+
+		taskENTER_CRITICAL(&ws_clients_lock);
+		for (int j = 0; j < ws_num_clients; j++) {
+			if (ws_clients[j].fd == fd) {
+				ws_clients[j].topics_sent = true;
+				ws_clients[j].sent_seq = seq;
+			}
+		}
+		taskEXIT_CRITICAL(&ws_clients_lock);
+	}
+}
+
+//-----------------------------------Task------------------------------------------
+
+static void ws_bus_cb(const telemetry_msg_t *msg, void *user_ctx)
+{
+	if (ws_num_clients > 0) {
+		xTaskNotifyGive(ws_task_handle);
+	}
+}
+
+// Paces the pushes: at most one queued at a time and one per HTTP_WS_MIN_PERIOD_MS
+static void ws_task(void *arg)
+{
+	while (1) {
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+		bool queue = false;
+		taskENTER_CRITICAL(&ws_clients_lock);
+		if (ws_num_clients > 0 && !ws_push_queued) {
+			ws_push_queued = true;
+			queue = true;
+		}
+		taskEXIT_CRITICAL(&ws_clients_lock);
+
+		if (queue && httpd_queue_work(ws_server, ws_push_work, NULL) != ESP_OK) {
+			taskENTER_CRITICAL(&ws_clients_lock);
+			ws_push_queued = false;
+			taskEXIT_CRITICAL(&ws_clients_lock);
+		}
+
+		// Let publishes pile up into the next frame
+		vTaskDelay(pdMS_TO_TICKS(HTTP_WS_MIN_PERIOD_MS));
+	}
+}
+
+//-----------------------------------API-------------------------------------------
+
+esp_err_t http_ws_start(httpd_handle_t server)
+{
+	// A restarted server brings new sockets
+	taskENTER_CRITICAL(&ws_clients_lock);
+	ws_server = server;
+	ws_num_clients = 0;
+	ws_push_queued = false;
+	taskEXIT_CRITICAL(&ws_clients_lock);
+
+	if (ws_task_handle) {
+		return ESP_OK;
+	}
+
+	if (xTaskCreatePinnedToCore(ws_task, "http_ws", HTTP_WS_TASK_STACK_SIZE, NULL,
+								HTTP_WS_TASK_PRIORITY, &ws_task_handle, HTTP_WS_TASK_CORE_ID) != pdPASS) {
+		return ESP_ERR_NO_MEM;
+	}
+
+	return telemetry_subscribe(TELEMETRY_ALL_TOPICS, ws_bus_cb, NULL);
+}
+
+esp_err_t http_ws_handler(httpd_req_t *req)
+{
+	int fd = httpd_req_to_sockfd(req);
+
+	// Handshake done
+	if (req->method == HTTP_GET) {
+		if (!ws_add_client(fd)) {
+			// Normally refused in the URI match already, see http_ws_has_room()
+			ESP_LOGW(TAG, "Too many clients, closing %d", fd);
+			return ESP_FAIL;
+		}
+		xTaskNotifyGive(ws_task_handle);
+		return ESP_OK;
+	}
+
+	uint8_t buf[8];
+	httpd_ws_frame_t frame = {.payload = buf};
+
+	// Length first, our messages are tiny so anything bigger is a protocol error
+	if (httpd_ws_recv_frame(req, &frame, 0) != ESP_OK || frame.len > sizeof(buf)) {
+		ws_remove_client(fd);
+		return ESP_FAIL;
+	}
+	if (frame.len > 0 && httpd_ws_recv_frame(req, &frame, sizeof(buf)) != ESP_OK) {
+		ws_remove_client(fd);
+		return ESP_FAIL;
+	}
+	if (frame.type == HTTPD_WS_TYPE_CLOSE) {
+		ws_remove_client(fd);
+		return ESP_OK;
+	}
+	if (frame.type != HTTPD_WS_TYPE_BINARY || frame.len == 0) {
+		return ESP_OK;
+	}
+
+	uint8_t reply[5];
+	size_t reply_len = 0;
+
+	switch (buf[0]) {
+	case HTTP_WS_MSG_PWM:
+		if (frame.len >= 4) {
+			uint8_t duty = buf[3] > 100 ? 100 : buf[3];
+			telemetry_publish_int(telemetry_find("pwm_cmd"), duty, esp_timer_get_time());
+			reply[0] = HTTP_WS_MSG_PWM_ACK;
+			put_u16(&reply[1], get_u16(&buf[1]));
+			reply[3] = duty;
+			reply_len = 4;
+		}
+		break;
+	case HTTP_WS_MSG_PING:
+		if (frame.len >= 5) {
+			reply[0] = HTTP_WS_MSG_PONG;
+			put_u32(&reply[1], get_u32(&buf[1]));
+			reply_len = 5;
+		}
+		break;
+	default:
+		break;
+	}
+
+	if (reply_len == 0) {
+		return ESP_OK;
+	}
+
+	// Sent here, in the httpd task like the pushes (see ws_push_work())
+	if (ws_send(fd, reply, reply_len) != ESP_OK) {
+		ws_remove_client(fd);
+		return ESP_FAIL;	// httpd closes the session
+	}
+	return ESP_OK;
+}
+
+#endif // CONFIG_HTTPD_WS_SUPPORT
@@ -0,0 +1,65 @@
+/**
+ * @file http_ws.h
+ * @author David Ramírez Betancourth
+ * @brief WebSocket control and telemetry channel (/ws), header
+ *
+ * Binary frames, little-endian, first byte is the message type.
+ *
+ * Client to server:
+ *   HTTP_WS_MSG_PWM       u8 type, u16 seq, u8 duty (%)   -> HTTP_WS_MSG_PWM_ACK
+ *   HTTP_WS_MSG_PING      u8 type, u32 token              -> HTTP_WS_MSG_PONG
+ *
+ * Server to client:
+ *   HTTP_WS_MSG_PWM_ACK   u8 type, u16 seq, u8 duty        (after publishing pwm_cmd)
+ *   HTTP_WS_MSG_PONG      u8 type, u32 token
+ *   HTTP_WS_MSG_TOPICS    u8 type, u8 count, count x {u8 id, u8 type, u8 len, name}
+ *   HTTP_WS_MSG_TELEMETRY u8 type, u8 count, count x {u8 id, u8 type, u32 seq, u32 t_ms, 4 byte value}
+ *
+ * TOPICS is sent once per connection before the first TELEMETRY. TELEMETRY
+ * frames carry the latest value of every topic and are pushed when the bus
+ * changes, coalesced like the /events stream. The ws task only paces the
+ * pushes; every frame, replies included, is written from the httpd task.
+ *
+ * Requires CONFIG_HTTPD_WS_SUPPORT.
+ */
+
+#ifndef MAIN_HTTP_WS_H_
+#define MAIN_HTTP_WS_H_
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+#define HTTP_WS_MAX_CLIENTS		3
+#define HTTP_WS_MIN_PERIOD_MS	50		// At most 20 telemetry frames/s per client
+
+#define HTTP_WS_MSG_PWM			0x01
+#define HTTP_WS_MSG_PING		0x02
+#define HTTP_WS_MSG_TELEMETRY	0x10
+#define HTTP_WS_MSG_TOPICS		0x11
+#define HTTP_WS_MSG_PWM_ACK		0x81
+#define HTTP_WS_MSG_PONG		0x82
+
+#if CONFIG_HTTPD_WS_SUPPORT
+
+/**
+ * Creates the ws task and subscribes it to the telemetry bus.
+ * @param server running server the clients connect to.
+ * @return ESP_OK, or ESP_ERR_NO_MEM.
+ */
+esp_err_t http_ws_start(httpd_handle_t server);
+
+/**
+ * /ws handler, registered with is_websocket set.
+ */
+esp_err_t http_ws_handler(httpd_req_t *req);
+
+/**
+ * Whether another client can connect. The handshake is completed before
+ * http_ws_handler() runs, so a full server must refuse it earlier, in the
+ * URI match (see http_server.c).
+ */
+bool http_ws_has_room(void);
+
+#endif // CONFIG_HTTPD_WS_SUPPORT
+
+#endif /* MAIN_HTTP_WS_H_ */
@@ -23,4 +23,24 @@
 #define HTTP_SERVER_MONITOR_PRIORITY		3
 #define HTTP_SERVER_MONITOR_CORE_ID			0
 
+// HTTP Server-Sent Events task
+#define HTTP_EVENTS_TASK_STACK_SIZE			4096
+#define HTTP_EVENTS_TASK_PRIORITY			3
+#define HTTP_EVENTS_TASK_CORE_ID			0
+
+// HTTP WebSocket telemetry task
+#define HTTP_WS_TASK_STACK_SIZE				3072
+#define HTTP_WS_TASK_PRIORITY				3
+#define HTTP_WS_TASK_CORE_ID				0
+
+// ADC continuous acquisition task
+#define ADC_STREAM_TASK_STACK_SIZE			4096
+#define ADC_STREAM_TASK_PRIORITY			6
+#define ADC_STREAM_TASK_CORE_ID				1
+
+// Flash telemetry log writer task
+#define FLASH_LOG_TASK_STACK_SIZE			4096
+#define FLASH_LOG_TASK_PRIORITY				2
+#define FLASH_LOG_TASK_CORE_ID				0
+
 #endif /* MAIN_TASKS_COMMON_H_ */
@@ -0,0 +1,209 @@
+/**
+ * @file acq_service.c
+ * @author David Ramírez Betancourth
+ * @brief ADC1 acquisition service
+ */
+
+#include "acq_service.h"
+
+#include <string.h>
+
+#include "esp_timer.h"
+
+// Per client state, only touched by the acquisition task once started
+typedef struct {
+    acq_client_config_t config;
+    adc_config_t channel;
+    uint32_t phase;                               // scan samples summed into acc
+    uint32_t acc;
+    size_t fill;                                  // samples in block
+    uint16_t block[ADC_STREAM_MAX_BLOCK_LEN];
+    acq_client_stats_t stats;
+} acq_client_t;
+
+static acq_client_t acq_clients[ACQ_SERVICE_MAX_CLIENTS];
+static size_t acq_num_clients = 0;
+static int64_t acq_scan_period_us = 0;
+static bool acq_running = false;
+
+//-----------------------------------Dispatch--------------------------------------
+
+static void acq_deliver(acq_client_t *client, int64_t timestamp_us)
+{
+    int64_t start = esp_timer_get_time();
+    timing_stats_record(&client->stats.wait, start - timestamp_us);
+
+    client->config.on_block(client->channel.channel, client->block, client->fill,
+                            timestamp_us, client->config.user_ctx);
+
+    timing_stats_record(&client->stats.hold, esp_timer_get_time() - start);
+    client->stats.blocks++;
+    client->fill = 0;
+}
+
+// adc_stream block consumer, fans one scan block out to the clients of its channel
+static void acq_on_block(adc_channel_t channel, const uint16_t *raw, size_t count, void *user_ctx)
+{
+    // The block is complete now, its last sample is the newest
+    int64_t block_end = esp_timer_get_time();
+
+    for (size_t c = 0; c < acq_num_clients; c++) {
+        acq_client_t *client = &acq_clients[c];
+        uint32_t stride = client->stats.stride;
+
+        if (client->channel.channel != channel) {
+            continue;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            client->acc += raw[i];
+            if (++client->phase < stride) {
+                continue;
+            }
+            client->block[client->fill++] = (uint16_t)((client->acc + stride / 2) / stride);
+            client->acc = 0;
+            client->phase = 0;
+
+            if (client->fill == client->config.block_len) {
+                acq_deliver(client, block_end - (int64_t)(count - 1 - i) * acq_scan_period_us);
+            }
+        }
+    }
+}
+
+//-----------------------------------API-------------------------------------------
+
+esp_err_t acq_service_register(const acq_client_config_t *client, int *out_id)
+{
+    if (acq_running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!client || !client->channel || !client->on_block ||
+        client->channel->unit_id != ADC_UNIT_1 ||
+        client->rate_hz < ADC_STREAM_MIN_RATE_HZ || client->rate_hz > ADC_STREAM_MAX_RATE_HZ ||
+        client->block_len == 0 || client->block_len > ADC_STREAM_MAX_BLOCK_LEN) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (acq_num_clients >= ACQ_SERVICE_MAX_CLIENTS) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    acq_client_t *slot = &acq_clients[acq_num_clients];
+    memset(slot, 0, sizeof(*slot));
+    slot->config = *client;
+    slot->channel = *client->channel;
+    slot->config.channel = &slot->channel;
+    slot->stats.name = client->name ? client->name : "?";
+    slot->stats.rate_hz = client->rate_hz;
+    timing_stats_init(&slot->stats.hold);
+    timing_stats_init(&slot->stats.wait);
+
+    if (out_id) {
+        *out_id = (int)acq_num_clients;
+    }
+    acq_num_clients++;
+    return ESP_OK;
+}
+
+esp_err_t acq_service_start(const adc_stream_backend_t *backend)
+{
+    adc_config_t scan_list[ACQ_SERVICE_MAX_CLIENTS];
+    size_t num_channels = 0;
+    uint32_t scan_rate = 0;
+    size_t scan_block = ADC_STREAM_MAX_BLOCK_LEN;
+    esp_err_t err;
+
+    if (acq_running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (acq_num_clients == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (size_t c = 0; c < acq_num_clients; c++) {
+        if (acq_clients[c].config.rate_hz > scan_rate) {
+            scan_rate = acq_clients[c].config.rate_hz;
+        }
+    }
+
+    for (size_t c = 0; c < acq_num_clients; c++) {
+        acq_client_t *client = &acq_clients[c];
+        size_t k;
+
+        if (scan_rate % client->config.rate_hz != 0) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        client->stats.stride = scan_rate / client->config.rate_hz;
+        client->phase = 0;
+        client->acc = 0;
+        client->fill = 0;
+
+        // Scan blocks no longer than the shortest client block, to not add latency
+        size_t span = client->config.block_len * client->stats.stride;
+        if (span < scan_block) {
+            scan_block = span;
+        }
+
+        for (k = 0; k < num_channels; k++) {
+            if (scan_list[k].channel == client->channel.channel) {
+                break;
+            }
+        }
+        if (k < num_channels) {
+            if (scan_list[k].atten != client->channel.atten) {
+                return ESP_ERR_INVALID_ARG; // One channel, one attenuation
+            }
+            continue;
+        }
+        scan_list[num_channels++] = client->channel;
+    }
+
+    acq_scan_period_us = 1000000 / scan_rate;
+
+    adc_stream_config_t stream_conf = {
+        .channels = scan_list,
+        .num_channels = num_channels,
+        .sample_rate_hz = scan_rate,
+        .block_len = scan_block,
+        .on_block = acq_on_block,
+        .user_ctx = NULL,
+    };
+
+    err = adc_stream_init(&stream_conf, backend);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = adc_stream_start();
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    acq_running = true;
+    return ESP_OK;
+}
+
+esp_err_t acq_service_stop(void)
+{
+    if (!acq_running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t err = adc_stream_stop();
+    if (err == ESP_OK) {
+        acq_running = false;
+    }
+    return err;
+}
+
+size_t acq_service_client_count(void)
+{
+    return acq_num_clients;
+}
+
+acq_client_stats_t *acq_service_client_stats(int id)
+{
+    if (id < 0 || (size_t)id >= acq_num_clients) {
+        return NULL;
+    }
+    return &acq_clients[id].stats;
+}
@@ -0,0 +1,104 @@
+/**
+ * @file acq_service.h
+ * @author David Ramírez Betancourth
+ * @brief ADC1 acquisition service, header
+ *
+ * Single owner of ADC1. Clients register a channel, a rate and a block
+ * consumer instead of sharing the converter under a lock; the service
+ * runs one scan over every registered channel at the fastest requested
+ * rate and hands each client its own averaged, blocked stream.
+ *
+ * Every dispatch is timed per client: "hold" is how long the client kept
+ * the acquisition task in its callback and "wait" is the age of the
+ * newest sample of a block when its callback starts.
+ */
+
+#ifndef ACQ_SERVICE_H
+#define ACQ_SERVICE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "adc_utils.h"
+#include "adc_stream.h"
+#include "timing_stats.h"
+
+#define ACQ_SERVICE_MAX_CLIENTS  4
+
+/**
+ * @brief Callback receiving a block of samples of one client
+ *
+ * Runs in the acquisition task context, keep it short and non-blocking.
+ *
+ * @param raw           Samples, averaged down to the client rate.
+ * @param count         Number of samples (the client block length).
+ * @param timestamp_us  esp_timer time of the newest sample, older samples
+ *                      are one client period apart.
+ */
+typedef void (*acq_block_cb_t)(adc_channel_t channel, const uint16_t *raw, size_t count,
+                               int64_t timestamp_us, void *user_ctx);
+
+/**
+ * @brief Client registration
+ */
+typedef struct {
+    const adc_config_t *channel;    ///< Channel to sample (ADC_UNIT_1)
+    uint32_t rate_hz;               ///< Delivered rate, must divide the fastest client rate
+    size_t   block_len;             ///< Samples per callback (1..ADC_STREAM_MAX_BLOCK_LEN)
+    acq_block_cb_t on_block;        ///< Block consumer
+    void    *user_ctx;              ///< Passed back to on_block
+    const char *name;               ///< Shown in the statistics
+} acq_client_config_t;
+
+/**
+ * @brief Per-client counters
+ */
+typedef struct {
+    const char *name;
+    uint32_t rate_hz;
+    uint32_t stride;                ///< Scan samples averaged per delivered sample
+    uint64_t blocks;                ///< Callbacks made
+    timing_stats_t hold;            ///< Time spent inside the callback
+    timing_stats_t wait;            ///< Newest sample -> callback start
+} acq_client_stats_t;
+
+/**
+ * @brief Register a client. Only allowed while the service is stopped.
+ *
+ * Several clients may share a channel, it is scanned once.
+ *
+ * @param[in]  client  Registration (copied, the channel config too).
+ * @param[out] out_id  Client index, may be NULL.
+ * @return ESP_OK, ESP_ERR_INVALID_ARG, ESP_ERR_NO_MEM when full or
+ *         ESP_ERR_INVALID_STATE if running.
+ */
+esp_err_t acq_service_register(const acq_client_config_t *client, int *out_id);
+
+/**
+ * @brief Build the scan schedule and start acquisition.
+ *
+ * @param[in] backend  Backend for adc_stream, NULL selects the DMA backend.
+ * @return ESP_OK, ESP_ERR_INVALID_ARG when a client rate does not divide
+ *         the scan rate, or the error of adc_stream_init()/start().
+ */
+esp_err_t acq_service_start(const adc_stream_backend_t *backend);
+
+/**
+ * @brief Stop acquisition. Clients stay registered.
+ */
+esp_err_t acq_service_stop(void);
+
+/**
+ * @brief Number of registered clients.
+ */
+size_t acq_service_client_count(void);
+
+/**
+ * @brief Counters of one client, NULL if id is out of range.
+ *
+ * The returned collectors are live; read them through timing_stats_summary().
+ */
+acq_client_stats_t *acq_service_client_stats(int id);
+
+#endif // ACQ_SERVICE_H
@@ -0,0 +1,52 @@
+/**
+ * @file adc_decimator.c
+ * @author David Ramírez Betancourth
+ * @brief Oversample-and-decimate stage for ADC streams
+ */
+
+#include "adc_decimator.h"
+
+bool adc_decimator_init(adc_decimator_t *dec, unsigned ratio_log2)
+{
+    if (!dec || ratio_log2 > ADC_DECIMATOR_MAX_RATIO_LOG2) {
+        return false;
+    }
+
+    dec->ratio_log2 = (uint8_t)ratio_log2;
+    dec->frac_bits = (uint8_t)(ratio_log2 / 2);
+    dec->count = 0;
+    dec->acc = 0;
+    return true;
+}
+
+size_t adc_decimator_process(adc_decimator_t *dec, const int *in, size_t count, int32_t *out)
+{
+    const uint32_t ratio = 1u << dec->ratio_log2;
+    const unsigned shift = dec->ratio_log2 - dec->frac_bits;
+    // Round half to even: half-up would bias every output by 1/(2R) LSB
+    const int32_t half = shift ? (1 << (shift - 1)) - 1 : 0;
+    const int32_t odd = shift ? 1 : 0;
+    size_t produced = 0;
+
+    int32_t acc = dec->acc;
+    uint32_t n = dec->count;
+
+    for (size_t i = 0; i < count; i++) {
+        acc += in[i];
+        if (++n == ratio) {
+            out[produced++] = (acc + half + ((acc >> shift) & odd)) >> shift;
+            acc = 0;
+            n = 0;
+        }
+    }
+
+    dec->acc = acc;
+    dec->count = n;
+    return produced;
+}
+
+float adc_decimator_enob_gain(const adc_decimator_t *dec)
+{
+    // SNR improves by 10*log10(R) dB, i.e. 0.5 bit per doubling of R
+    return 0.5f * (float)dec->ratio_log2;
+}
@@ -0,0 +1,68 @@
+/**
+ * @file adc_decimator.h
+ * @author David Ramírez Betancourth
+ * @brief Oversample-and-decimate stage for ADC streams, header
+ *
+ * Boxcar (first order CIC) decimator with power-of-two ratios. Every
+ * 2^N input samples are summed into one output. Half of the N bits of
+ * growth are kept as fractional bits: with white noise each 4x of
+ * oversampling buys one extra effective bit.
+ */
+
+#ifndef ADC_DECIMATOR_H
+#define ADC_DECIMATOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ADC_DECIMATOR_MAX_RATIO_LOG2 12   ///< Up to 4096:1, sum of 12-bit codes fits in int32
+
+/**
+ * @brief Decimator state
+ */
+typedef struct {
+    uint8_t ratio_log2;     ///< Decimation ratio R = 2^ratio_log2
+    uint8_t frac_bits;      ///< Fractional bits of the output (ratio_log2 / 2)
+    uint32_t count;         ///< Inputs accumulated for the current output
+    int32_t acc;            ///< Running sum
+} adc_decimator_t;
+
+/**
+ * @brief Initialize a decimator.
+ *
+ * @param[out] dec         Decimator to initialize.
+ * @param[in]  ratio_log2  log2 of the decimation ratio (0..ADC_DECIMATOR_MAX_RATIO_LOG2).
+ * @return false if the ratio is out of range.
+ */
+bool adc_decimator_init(adc_decimator_t *dec, unsigned ratio_log2);
+
+/**
+ * @brief Feed a block of samples.
+ *
+ * Outputs are the mean of each group of R inputs, in fixed point with
+ * frac_bits fractional bits (input units << frac_bits). State carries
+ * over between calls, so blocks need not be multiples of R.
+ *
+ * @param[in,out] dec    Decimator.
+ * @param[in]     in     Input samples.
+ * @param[in]     count  Number of input samples.
+ * @param[out]    out    Outputs, room for count / R + 1 values.
+ * @return Number of outputs written.
+ */
+size_t adc_decimator_process(adc_decimator_t *dec, const int *in, size_t count, int32_t *out);
+
+/**
+ * @brief Fractional bits carried by the outputs.
+ */
+static inline unsigned adc_decimator_frac_bits(const adc_decimator_t *dec)
+{
+    return dec->frac_bits;
+}
+
+/**
+ * @brief Effective resolution gained, in bits, assuming white input noise.
+ */
+float adc_decimator_enob_gain(const adc_decimator_t *dec);
+
+#endif // ADC_DECIMATOR_H
@@ -0,0 +1,411 @@
+/**
+ * @file adc_stream.c
+ * @author David Ramírez Betancourth
+ * @brief Continuous (DMA) ADC acquisition engine
+ */
+
+#include "adc_stream.h"
+
+#include "esp_adc/adc_continuous.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "tasks_common.h"
+
+// Conversions fetched from the backend per poll
+#define ADC_STREAM_READ_SAMPLES     128
+#define ADC_STREAM_READ_TIMEOUT_MS  100
+
+// DMA driver sizing: one frame per poll. The pool between the driver ISR
+// and this task must ride out the longest stall of the task: a flash sector
+// erase (flash_log) disables the cache on both cores for up to a few
+// hundred ms. With CONFIG_ADC_CONTINUOUS_ISR_IRAM_SAFE the ISR keeps filling
+// the pool meanwhile; whatever does not fit is counted in stats.lost.
+#define ADC_STREAM_DMA_FRAME_BYTES  (ADC_STREAM_READ_SAMPLES * SOC_ADC_DIGI_RESULT_BYTES)
+#define ADC_STREAM_DMA_POOL_MIN     (ADC_STREAM_DMA_FRAME_BYTES * 4)
+#ifndef ADC_STREAM_MAX_STALL_MS
+#define ADC_STREAM_MAX_STALL_MS     400     // Worst-case 4 KB sector erase of common SPI NOR parts
+#endif
+#ifndef ADC_STREAM_DMA_POOL_MAX
+#define ADC_STREAM_DMA_POOL_MAX     (16 * 1024)
+#endif
+
+#if !CONFIG_ADC_CONTINUOUS_ISR_IRAM_SAFE
+#warning "CONFIG_ADC_CONTINUOUS_ISR_IRAM_SAFE is off: ADC samples are lost while flash is written"
+#endif
+
+#if CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32S2
+#define ADC_STREAM_OUTPUT_TYPE      ADC_DIGI_OUTPUT_FORMAT_TYPE1
+#define ADC_STREAM_GET_CHANNEL(p)   ((p)->type1.channel)
+#define ADC_STREAM_GET_DATA(p)      ((p)->type1.data)
+#else
+#define ADC_STREAM_OUTPUT_TYPE      ADC_DIGI_OUTPUT_FORMAT_TYPE2
+#define ADC_STREAM_GET_CHANNEL(p)   ((p)->type2.channel)
+#define ADC_STREAM_GET_DATA(p)      ((p)->type2.data)
+#endif
+
+// Per scan-list entry state
+typedef struct {
+    adc_channel_t channel;
+    uint32_t phase;                               // hardware samples summed into acc
+    uint32_t acc;                                 // sum of the current decimation group
+    size_t fill;                                  // samples in block
+    uint16_t block[ADC_STREAM_MAX_BLOCK_LEN];
+} adc_stream_lane_t;
+
+static adc_stream_config_t stream_config;
+static adc_config_t stream_channels[ADC_STREAM_MAX_CHANNELS];
+static adc_stream_backend_t stream_backend;
+static adc_stream_lane_t stream_lanes[ADC_STREAM_MAX_CHANNELS];
+static int8_t lane_of_channel[SOC_ADC_MAX_CHANNEL_NUM];
+static adc_stream_sample_t read_buf[ADC_STREAM_READ_SAMPLES];
+
+static adc_stream_stats_t stream_stats;
+static portMUX_TYPE stream_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static bool stream_configured = false;
+static volatile bool stream_running = false;
+static volatile TaskHandle_t stream_task_handle = NULL;
+
+//-----------------------------------DMA backend----------------------------------
+
+typedef struct {
+    adc_continuous_handle_t handle;
+    portMUX_TYPE lost_lock;                       // lost is bumped from the driver ISR
+    uint32_t lost;
+    uint8_t frame[ADC_STREAM_DMA_FRAME_BYTES];
+} adc_stream_dma_ctx_t;
+
+static adc_stream_dma_ctx_t dma_ctx = {
+    .lost_lock = portMUX_INITIALIZER_UNLOCKED,
+};
+
+static bool IRAM_ATTR dma_on_pool_ovf(adc_continuous_handle_t handle, const adc_continuous_evt_data_t *edata, void *user_data)
+{
+    adc_stream_dma_ctx_t *ctx = (adc_stream_dma_ctx_t *)user_data;
+    // The driver drops the oldest frame of the pool on overflow
+    portENTER_CRITICAL_ISR(&ctx->lost_lock);
+    ctx->lost += ADC_STREAM_DMA_FRAME_BYTES / SOC_ADC_DIGI_RESULT_BYTES;
+    portEXIT_CRITICAL_ISR(&ctx->lost_lock);
+    return false;
+}
+
+static esp_err_t dma_start(void *arg, const adc_stream_hw_config_t *hw)
+{
+    adc_stream_dma_ctx_t *ctx = (adc_stream_dma_ctx_t *)arg;
+    esp_err_t err;
+
+    // Whole frames covering ADC_STREAM_MAX_STALL_MS at the programmed rate
+    uint64_t stall_bytes = (uint64_t)hw->conv_rate_hz * ADC_STREAM_MAX_STALL_MS / 1000 * SOC_ADC_DIGI_RESULT_BYTES;
+    uint32_t pool_bytes = (uint32_t)((stall_bytes + ADC_STREAM_DMA_FRAME_BYTES - 1) / ADC_STREAM_DMA_FRAME_BYTES) *
+                          ADC_STREAM_DMA_FRAME_BYTES;
+    if (pool_bytes < ADC_STREAM_DMA_POOL_MIN) {
+        pool_bytes = ADC_STREAM_DMA_POOL_MIN;
+    }
+    if (pool_bytes > ADC_STREAM_DMA_POOL_MAX) {
+        pool_bytes = ADC_STREAM_DMA_POOL_MAX - ADC_STREAM_DMA_POOL_MAX % ADC_STREAM_DMA_FRAME_BYTES;
+    }
+
+    adc_continuous_handle_cfg_t handle_cfg = {
+        .max_store_buf_size = pool_bytes,
+        .conv_frame_size = ADC_STREAM_DMA_FRAME_BYTES,
+    };
+    err = adc_continuous_new_handle(&handle_cfg, &ctx->handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    adc_digi_pattern_config_t pattern[SOC_ADC_PATT_LEN_MAX] = {0};
+    for (size_t i = 0; i < hw->num_channels; i++) {
+        pattern[i].unit = hw->channels[i].unit_id;
+        pattern[i].channel = hw->channels[i].channel & 0x7;
+        pattern[i].atten = hw->channels[i].atten;
+        pattern[i].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+    }
+
+    adc_continuous_config_t dig_cfg = {
+        .pattern_num = hw->num_channels,
+        .adc_pattern = pattern,
+        .sample_freq_hz = hw->conv_rate_hz,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = ADC_STREAM_OUTPUT_TYPE,
+    };
+    err = adc_continuous_config(ctx->handle, &dig_cfg);
+    if (err == ESP_OK) {
+        adc_continuous_evt_cbs_t cbs = {
+            .on_pool_ovf = dma_on_pool_ovf,
+        };
+        err = adc_continuous_register_event_callbacks(ctx->handle, &cbs, ctx);
+    }
+    if (err == ESP_OK) {
+        err = adc_continuous_start(ctx->handle);
+    }
+    if (err != ESP_OK) {
+        adc_continuous_deinit(ctx->handle);
+        ctx->handle = NULL;
+    }
+    return err;
+}
+
+static esp_err_t dma_stop(void *arg)
+{
+    adc_stream_dma_ctx_t *ctx = (adc_stream_dma_ctx_t *)arg;
+
+    if (!ctx->handle) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    adc_continuous_stop(ctx->handle);
+    adc_continuous_deinit(ctx->handle);
+    ctx->handle = NULL;
+    return ESP_OK;
+}
+
+static esp_err_t dma_read(void *arg, adc_stream_sample_t *out, size_t max_samples,
+                          size_t *out_count, uint32_t timeout_ms)
+{
+    adc_stream_dma_ctx_t *ctx = (adc_stream_dma_ctx_t *)arg;
+    uint32_t want = max_samples * SOC_ADC_DIGI_RESULT_BYTES;
+    uint32_t got = 0;
+
+    *out_count = 0;
+    if (want > sizeof(ctx->frame)) {
+        want = sizeof(ctx->frame);
+    }
+
+    esp_err_t err = adc_continuous_read(ctx->handle, ctx->frame, want, &got, timeout_ms);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    size_t n = 0;
+    for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= got; i += SOC_ADC_DIGI_RESULT_BYTES) {
+        const adc_digi_output_data_t *p = (const adc_digi_output_data_t *)&ctx->frame[i];
+        out[n].channel = ADC_STREAM_GET_CHANNEL(p);
+        out[n].raw = ADC_STREAM_GET_DATA(p);
+        n++;
+    }
+    *out_count = n;
+    return ESP_OK;
+}
+
+static uint32_t dma_take_lost(void *arg)
+{
+    adc_stream_dma_ctx_t *ctx = (adc_stream_dma_ctx_t *)arg;
+    uint32_t lost;
+
+    // Read and clear in one step, the ISR may run on the other core
+    taskENTER_CRITICAL(&ctx->lost_lock);
+    lost = ctx->lost;
+    ctx->lost = 0;
+    taskEXIT_CRITICAL(&ctx->lost_lock);
+    return lost;
+}
+
+static const adc_stream_backend_t dma_backend = {
+    .start = dma_start,
+    .stop = dma_stop,
+    .read = dma_read,
+    .take_lost = dma_take_lost,
+    .ctx = &dma_ctx,
+};
+
+const adc_stream_backend_t *adc_stream_dma_backend(void)
+{
+    return &dma_backend;
+}
+
+//-----------------------------------Engine---------------------------------------
+
+static void adc_stream_task(void *arg)
+{
+    while (stream_running) {
+        adc_stream_poll(ADC_STREAM_READ_TIMEOUT_MS);
+    }
+    stream_task_handle = NULL;
+    vTaskDelete(NULL);
+}
+
+esp_err_t adc_stream_init(const adc_stream_config_t *config, const adc_stream_backend_t *backend)
+{
+    if (stream_running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!config || !config->channels || !config->on_block ||
+        config->num_channels == 0 || config->num_channels > ADC_STREAM_MAX_CHANNELS ||
+        config->num_channels > SOC_ADC_PATT_LEN_MAX ||
+        config->sample_rate_hz < ADC_STREAM_MIN_RATE_HZ || config->sample_rate_hz > ADC_STREAM_MAX_RATE_HZ ||
+        config->block_len == 0 || config->block_len > ADC_STREAM_MAX_BLOCK_LEN) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!backend) {
+        backend = &dma_backend;
+    }
+    if (!backend->start || !backend->stop || !backend->read) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int8_t lanes[SOC_ADC_MAX_CHANNEL_NUM];
+    memset(lanes, -1, sizeof(lanes));
+    for (size_t i = 0; i < config->num_channels; i++) {
+        const adc_config_t *ch = &config->channels[i];
+        // Continuous mode on ADC2 is not supported (and ADC2 is taken by WiFi)
+        if (ch->unit_id != ADC_UNIT_1 || ch->channel >= SOC_ADC_MAX_CHANNEL_NUM ||
+            lanes[ch->channel] != -1) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        lanes[ch->channel] = (int8_t)i;
+    }
+
+    // Raise the hardware rate to the SoC minimum and average the surplus away
+    uint32_t total_hz = config->sample_rate_hz * config->num_channels;
+    uint32_t decimation = 1;
+    if (total_hz < SOC_ADC_SAMPLE_FREQ_THRES_LOW) {
+        decimation = (SOC_ADC_SAMPLE_FREQ_THRES_LOW + total_hz - 1) / total_hz;
+    }
+    if ((uint64_t)total_hz * decimation > SOC_ADC_SAMPLE_FREQ_THRES_HIGH) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memcpy(lane_of_channel, lanes, sizeof(lane_of_channel));
+    stream_config = *config;
+    memcpy(stream_channels, config->channels, config->num_channels * sizeof(adc_config_t));
+    stream_config.channels = stream_channels;
+    stream_backend = *backend;
+
+    memset(stream_lanes, 0, sizeof(stream_lanes));
+    for (size_t i = 0; i < config->num_channels; i++) {
+        stream_lanes[i].channel = config->channels[i].channel;
+    }
+
+    memset(&stream_stats, 0, sizeof(stream_stats));
+    stream_stats.hw_rate_hz = total_hz * decimation;
+    stream_stats.decimation = decimation;
+
+    stream_configured = true;
+    return ESP_OK;
+}
+
+esp_err_t adc_stream_start(void)
+{
+    if (!stream_configured || stream_running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    adc_stream_hw_config_t hw = {
+        .channels = stream_channels,
+        .num_channels = stream_config.num_channels,
+        .conv_rate_hz = stream_stats.hw_rate_hz,
+    };
+    // Oneshot reads of ADC1 are refused while the continuous driver owns it
+    adc_unit_set_streaming(ADC_UNIT_1, true);
+    esp_err_t err = stream_backend.start(stream_backend.ctx, &hw);
+    if (err != ESP_OK) {
+        adc_unit_set_streaming(ADC_UNIT_1, false);
+        return err;
+    }
+
+    stream_stats.started_us = esp_timer_get_time();
+    stream_running = true;
+
+    TaskHandle_t handle = NULL;
+    if (xTaskCreatePinnedToCore(adc_stream_task, "adc_stream", ADC_STREAM_TASK_STACK_SIZE, NULL,
+                                ADC_STREAM_TASK_PRIORITY, &handle, ADC_STREAM_TASK_CORE_ID) != pdPASS) {
+        stream_running = false;
+        stream_backend.stop(stream_backend.ctx);
+        adc_unit_set_streaming(ADC_UNIT_1, false);
+        return ESP_ERR_NO_MEM;
+    }
+    stream_task_handle = handle;
+    return ESP_OK;
+}
+
+esp_err_t adc_stream_stop(void)
+{
+    if (!stream_running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    stream_running = false;
+    while (stream_task_handle) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    esp_err_t err = stream_backend.stop(stream_backend.ctx);
+    if (err == ESP_OK) {
+        adc_unit_set_streaming(ADC_UNIT_1, false);
+    }
+    return err;
+}
+
+size_t adc_stream_poll(uint32_t timeout_ms)
+{
+    size_t count = 0;
+    uint64_t unknown = 0;
+    uint32_t lost = 0;
+
+    if (!stream_configured) {
+        return 0;
+    }
+
+    if (stream_backend.read(stream_backend.ctx, read_buf, ADC_STREAM_READ_SAMPLES, &count, timeout_ms) != ESP_OK) {
+        count = 0;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        const adc_stream_sample_t *s = &read_buf[i];
+        int lane_idx = (s->channel < SOC_ADC_MAX_CHANNEL_NUM) ? lane_of_channel[s->channel] : -1;
+        if (lane_idx < 0) {
+            unknown++;
+            continue;
+        }
+
+        // Boxcar over each group of decimation samples: keeping only one of
+        // them would fold everything above the delivered Nyquist rate back in
+        adc_stream_lane_t *lane = &stream_lanes[lane_idx];
+        lane->acc += s->raw;
+        if (++lane->phase < stream_stats.decimation) {
+            continue;
+        }
+        uint16_t value = (uint16_t)((lane->acc + lane->phase / 2) / lane->phase);
+        lane->phase = 0;
+        lane->acc = 0;
+
+        lane->block[lane->fill++] = value;
+        if (lane->fill == stream_config.block_len) {
+            stream_config.on_block(lane->channel, lane->block, lane->fill, stream_config.user_ctx);
+            lane->fill = 0;
+
+            taskENTER_CRITICAL(&stream_stats_lock);
+            stream_stats.blocks++;
+            stream_stats.samples[lane_idx] += stream_config.block_len;
+            taskEXIT_CRITICAL(&stream_stats_lock);
+        }
+    }
+
+    if (stream_backend.take_lost) {
+        lost = stream_backend.take_lost(stream_backend.ctx);
+    }
+
+    taskENTER_CRITICAL(&stream_stats_lock);
+    if (count > 0) {
+        stream_stats.reads++;
+    }
+    stream_stats.unknown += unknown;
+    stream_stats.lost += lost;
+    taskEXIT_CRITICAL(&stream_stats_lock);
+
+    return count;
+}
+
+void adc_stream_get_stats(adc_stream_stats_t *out)
+{
+    if (!out) {
+        return;
+    }
+
+    taskENTER_CRITICAL(&stream_stats_lock);
+    *out = stream_stats;
+    taskEXIT_CRITICAL(&stream_stats_lock);
+}
@@ -0,0 +1,143 @@
+/**
+ * @file adc_stream.h
+ * @author David Ramírez Betancourth
+ * @brief Continuous (DMA) ADC acquisition engine, header
+ *
+ * Runs ADC1 in continuous mode over a scan list of channels and hands out
+ * fixed-size blocks of raw samples per channel. The hardware access goes
+ * through a small backend interface so the engine can be driven by a mock
+ * source instead of the DMA driver.
+ */
+
+#ifndef ADC_STREAM_H
+#define ADC_STREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "adc_utils.h"
+
+// Limits of the engine
+#define ADC_STREAM_MAX_CHANNELS   8
+#define ADC_STREAM_MAX_BLOCK_LEN  256
+#define ADC_STREAM_MIN_RATE_HZ    1
+#define ADC_STREAM_MAX_RATE_HZ    20000
+
+/**
+ * @brief One conversion result as produced by a backend
+ */
+typedef struct {
+    uint8_t  channel;   ///< ADC channel the conversion belongs to
+    uint16_t raw;       ///< Raw conversion code
+} adc_stream_sample_t;
+
+/**
+ * @brief Hardware parameters the engine asks the backend to run with
+ */
+typedef struct {
+    const adc_config_t *channels;   ///< Scan list, converted in this order
+    size_t   num_channels;          ///< Entries in the scan list
+    uint32_t conv_rate_hz;          ///< Total conversions per second (all channels)
+} adc_stream_hw_config_t;
+
+/**
+ * @brief Backend operations (DMA driver or mock)
+ */
+typedef struct {
+    esp_err_t (*start)(void *ctx, const adc_stream_hw_config_t *hw);
+    esp_err_t (*stop)(void *ctx);
+    /**
+     * Read up to max_samples conversions. Must return ESP_ERR_TIMEOUT when
+     * nothing arrived within timeout_ms.
+     */
+    esp_err_t (*read)(void *ctx, adc_stream_sample_t *out, size_t max_samples,
+                      size_t *out_count, uint32_t timeout_ms);
+    /** Optional: conversions lost by the backend since the last call. */
+    uint32_t (*take_lost)(void *ctx);
+    void *ctx;
+} adc_stream_backend_t;
+
+/**
+ * @brief Callback receiving a full block of samples of one channel
+ *
+ * Runs in the acquisition task context, keep it short and non-blocking.
+ */
+typedef void (*adc_stream_block_cb_t)(adc_channel_t channel, const uint16_t *raw,
+                                      size_t count, void *user_ctx);
+
+/**
+ * @brief Acquisition engine configuration
+ */
+typedef struct {
+    const adc_config_t *channels;   ///< Channels to scan (ADC_UNIT_1 only)
+    size_t   num_channels;          ///< Number of channels (1..ADC_STREAM_MAX_CHANNELS)
+    uint32_t sample_rate_hz;        ///< Delivered rate per channel (1..20000 S/s)
+    size_t   block_len;             ///< Samples per channel per block (1..ADC_STREAM_MAX_BLOCK_LEN)
+    adc_stream_block_cb_t on_block; ///< Block consumer
+    void    *user_ctx;              ///< Passed back to on_block
+} adc_stream_config_t;
+
+/**
+ * @brief Engine counters
+ */
+typedef struct {
+    uint32_t hw_rate_hz;                          ///< Conversion rate programmed into the backend
+    uint32_t decimation;                          ///< Hardware samples averaged per delivered sample
+    uint64_t reads;                               ///< Backend reads that returned data
+    uint64_t blocks;                              ///< Blocks delivered (all channels)
+    uint64_t samples[ADC_STREAM_MAX_CHANNELS];    ///< Samples delivered, per scan-list entry
+    uint64_t lost;                                ///< Conversions lost by the backend
+    uint64_t unknown;                             ///< Conversions for channels not in the scan list
+    int64_t  started_us;                          ///< esp_timer time of adc_stream_start()
+} adc_stream_stats_t;
+
+/**
+ * @brief Configure the engine.
+ *
+ * The hardware rate is raised to the lowest rate the SoC supports when the
+ * requested rate is below it; each delivered sample is the mean of the
+ * `decimation` conversions it replaces, so noise above the delivered
+ * Nyquist rate is averaged down instead of folded in.
+ *
+ * @param[in] config   Engine configuration (copied).
+ * @param[in] backend  Backend to use, NULL selects the DMA backend.
+ * @return ESP_OK, ESP_ERR_INVALID_ARG or ESP_ERR_INVALID_STATE if running.
+ */
+esp_err_t adc_stream_init(const adc_stream_config_t *config, const adc_stream_backend_t *backend);
+
+/**
+ * @brief Start the backend and the acquisition task.
+ */
+esp_err_t adc_stream_start(void);
+
+/**
+ * @brief Stop the acquisition task and the backend.
+ */
+esp_err_t adc_stream_stop(void);
+
+/**
+ * @brief Read once from the backend and deliver any completed blocks.
+ *
+ * This is what the acquisition task runs in a loop. It is public so a mock
+ * backend can be pumped directly without the task.
+ *
+ * @param[in] timeout_ms  Maximum time to wait for the backend.
+ * @return Number of conversions consumed.
+ */
+size_t adc_stream_poll(uint32_t timeout_ms);
+
+/**
+ * @brief Snapshot the engine counters.
+ *
+ * @param[out] out  Destination of the snapshot.
+ */
+void adc_stream_get_stats(adc_stream_stats_t *out);
+
+/**
+ * @brief Backend backed by the ESP-IDF adc_continuous (DMA) driver.
+ */
+const adc_stream_backend_t *adc_stream_dma_backend(void);
+
+#endif // ADC_STREAM_H
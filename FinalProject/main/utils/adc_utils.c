@@ -6,9 +6,22 @@
 
 #include "adc_utils.h"
 
+#include "esp_timer.h"
+
 // Maximum number of ADC channels to support
 #define MAX_ADC_CHANNELS 10
 
+// Cached line-fitting coefficients: mV = offset + (raw * slope) >> ADC_CALI_SLOPE_SHIFT
+#define ADC_CALI_SLOPE_SHIFT 16
+#define ADC_CALI_FULL_SCALE  ((1 << SOC_ADC_RTC_MAX_BITWIDTH) - 1)
+// Upper end of the fit. On ESP32 at 12 dB / 12 bit the driver blends a
+// lookup table into the line above this code, so the line is fitted below it
+#define ADC_CALI_FIT_MAX     2880
+#define ADC_CALI_MAX_ERR_MV  1
+
+#define ADC_NUM_UNITS  (ADC_UNIT_2 + 1)
+#define ADC_NUM_ATTENS SOC_ADC_ATTEN_NUM
+
 // Internal structure (matches the handle type)
 struct adc_channel_handle_internal_t {
     adc_config_t config;
@@ -16,72 +29,161 @@ struct adc_channel_handle_internal_t {
     adc_cali_handle_t cali_handle;
     bool calibrated;
     bool in_use;
+    bool cali_cached;           // cali_slope_q16/cali_offset_mv are valid
+    int32_t cali_slope_q16;     // mV per code, Q16
+    int32_t cali_offset_mv;     // mV at code 0
+    int32_t cali_linear_max;    // Highest code the cached line matches the driver at
+    struct adc_channel_handle_internal_t *next;  // Free list, or channels of the same unit
+    struct adc_channel_handle_internal_t *prev;  // Channels of the same unit
 };
 
-// Global handles and pool
-static adc_oneshot_unit_handle_t adc_unit_handles[ADC_UNIT_2 + 1] = {NULL, NULL};
+// Global handles and pool. Units and calibration schemes are shared by
+// every channel using them and deleted when the last one is released.
+static adc_oneshot_unit_handle_t adc_unit_handles[ADC_NUM_UNITS] = {NULL, NULL};
+static int adc_unit_refs[ADC_NUM_UNITS];
+static adc_cali_handle_t adc_cali_handles[ADC_NUM_UNITS][ADC_NUM_ATTENS];
+static int adc_cali_refs[ADC_NUM_UNITS][ADC_NUM_ATTENS];
+
 static struct adc_channel_handle_internal_t adc_channel_pool[MAX_ADC_CHANNELS];
+static struct adc_channel_handle_internal_t *adc_free_list = NULL;
+static struct adc_channel_handle_internal_t *adc_unit_channels_head[ADC_NUM_UNITS];
+static volatile bool adc_unit_streaming[ADC_NUM_UNITS];   // Owned by the continuous driver
+static bool adc_pool_ready = false;
 
 
-static bool adc_calibration_init_internal(adc_unit_t unit, adc_channel_t channel, adc_atten_t atten, adc_cali_handle_t *out_handle)
+static void adc_pool_init_internal(void)
 {
-    adc_cali_handle_t handle = NULL;
-    bool calibrated = false;
+    for (int i = 0; i < MAX_ADC_CHANNELS; i++) {
+        adc_channel_pool[i].next = (i + 1 < MAX_ADC_CHANNELS) ? &adc_channel_pool[i + 1] : NULL;
+    }
+    adc_free_list = &adc_channel_pool[0];
+    adc_pool_ready = true;
+}
 
+
+static bool adc_calibration_init_internal(adc_unit_t unit, adc_channel_t channel, adc_atten_t atten, adc_cali_handle_t *out_handle)
+{
     if (!out_handle) {
         return false;
     }
     *out_handle = NULL;
 
-    adc_cali_line_fitting_config_t cali_config_line = {
-        .unit_id = unit,
-        .atten = atten,
-        .bitwidth = ADC_BITWIDTH_DEFAULT,
-    };
-    // Attempt to create the calibration scheme
-    if (adc_cali_create_scheme_line_fitting(&cali_config_line, &handle) == ESP_OK) {
-        calibrated = true;
+    // Line fitting depends on unit and attenuation only, one scheme serves all channels
+    if (!adc_cali_handles[unit][atten]) {
+        adc_cali_line_fitting_config_t cali_config_line = {
+            .unit_id = unit,
+            .atten = atten,
+            .bitwidth = ADC_BITWIDTH_DEFAULT,
+        };
+        // Attempt to create the calibration scheme
+        if (adc_cali_create_scheme_line_fitting(&cali_config_line, &adc_cali_handles[unit][atten]) != ESP_OK) {
+            adc_cali_handles[unit][atten] = NULL;
+            return false;
+        }
     }
 
-    if (calibrated) {
-        *out_handle = handle;
-    }
+    adc_cali_refs[unit][atten]++;
+    *out_handle = adc_cali_handles[unit][atten];
+    return true;
+}
 
-    return calibrated;
+static void adc_calibration_deinit_internal(adc_unit_t unit, adc_atten_t atten)
+{
+    if (adc_cali_refs[unit][atten] == 0 || --adc_cali_refs[unit][atten] > 0) {
+        return;
+    }
+    adc_cali_delete_scheme_line_fitting(adc_cali_handles[unit][atten]);
+    adc_cali_handles[unit][atten] = NULL;
 }
 
+static void adc_unit_release_internal(adc_unit_t unit)
+{
+    if (adc_unit_refs[unit] == 0 || --adc_unit_refs[unit] > 0) {
+        return;
+    }
+    adc_oneshot_del_unit(adc_unit_handles[unit]);
+    adc_unit_handles[unit] = NULL;
+}
 
-void set_adc(const adc_config_t *config, adc_channel_handle_t *out_handle)
+// Cache a line through the driver curve so block conversions can run
+// without going through the driver. The line is fitted on 0..ADC_CALI_FIT_MAX
+// and then checked against the driver code by code; it is only used up to
+// the first code where it is off by more than ADC_CALI_MAX_ERR_MV.
+static void adc_calibration_cache_internal(struct adc_channel_handle_internal_t *handle_data)
 {
-    *out_handle = NULL;
+    int v_lo = 0;
+    int v_hi = 0;
+
+    handle_data->cali_cached = false;
 
-    if (!config || !out_handle) {
+    if (!handle_data->calibrated || !handle_data->cali_handle) {
         return;
     }
 
-    int free_index = -1;
-    for (int i = 0; i < MAX_ADC_CHANNELS; i++) {
-        if (!adc_channel_pool[i].in_use) {
-            free_index = i;
+    if (adc_cali_raw_to_voltage(handle_data->cali_handle, 0, &v_lo) != ESP_OK ||
+        adc_cali_raw_to_voltage(handle_data->cali_handle, ADC_CALI_FIT_MAX, &v_hi) != ESP_OK) {
+        return;
+    }
+
+    int64_t span_q = (int64_t)(v_hi - v_lo) << ADC_CALI_SLOPE_SHIFT;
+    int32_t slope = (int32_t)((span_q + ADC_CALI_FIT_MAX / 2) / ADC_CALI_FIT_MAX);
+    int32_t round = 1 << (ADC_CALI_SLOPE_SHIFT - 1);
+    int32_t linear_max = -1;
+
+    for (int raw = 0; raw <= ADC_CALI_FULL_SCALE; raw++) {
+        int expected;
+        if (adc_cali_raw_to_voltage(handle_data->cali_handle, raw, &expected) != ESP_OK) {
+            break;
+        }
+        int err = v_lo + ((raw * slope + round) >> ADC_CALI_SLOPE_SHIFT) - expected;
+        if (err > ADC_CALI_MAX_ERR_MV || err < -ADC_CALI_MAX_ERR_MV) {
             break;
         }
+        linear_max = raw;
     }
 
-    if (free_index == -1) {
+    handle_data->cali_slope_q16 = slope;
+    handle_data->cali_offset_mv = v_lo;
+    handle_data->cali_linear_max = linear_max;
+    handle_data->cali_cached = (linear_max >= 0);
+}
+
+void set_adc(const adc_config_t *config, adc_channel_handle_t *out_handle)
+{
+    if (!out_handle) {
         return;
     }
+    *out_handle = NULL;
 
-    struct adc_channel_handle_internal_t *handle_data = &adc_channel_pool[free_index];
-    memset(handle_data, 0, sizeof(struct adc_channel_handle_internal_t));
-    handle_data->config = *config;
+    if (!config || config->unit_id >= ADC_NUM_UNITS || config->atten >= ADC_NUM_ATTENS) {
+        return;
+    }
+
+    if (!adc_pool_ready) {
+        adc_pool_init_internal();
+    }
+
+    if (!adc_free_list) {
+        return;
+    }
 
     // --- ADC Unit Init ---
     if (!adc_unit_handles[config->unit_id]) {
         adc_oneshot_unit_init_cfg_t init_config = {
             .unit_id = config->unit_id,
         };
-        adc_oneshot_new_unit(&init_config, &adc_unit_handles[config->unit_id]);
+        if (adc_oneshot_new_unit(&init_config, &adc_unit_handles[config->unit_id]) != ESP_OK) {
+            adc_unit_handles[config->unit_id] = NULL;
+            return;
+        }
     }
+    adc_unit_refs[config->unit_id]++;
+
+    struct adc_channel_handle_internal_t *handle_data = adc_free_list;
+    adc_free_list = handle_data->next;
+
+    memset(handle_data, 0, sizeof(struct adc_channel_handle_internal_t));
+    handle_data->config = *config;
     handle_data->unit_handle = adc_unit_handles[config->unit_id];
 
     // --- ADC Channel Config ---
@@ -93,17 +195,82 @@ void set_adc(const adc_config_t *config, adc_channel_handle_t *out_handle)
 
     // --- ADC Calibration Init ---
     handle_data->calibrated = adc_calibration_init_internal(config->unit_id, config->channel, config->atten, &handle_data->cali_handle);
+    adc_calibration_cache_internal(handle_data);
+
+    // --- Group with the other channels of the unit ---
+    handle_data->next = adc_unit_channels_head[config->unit_id];
+    if (handle_data->next) {
+        handle_data->next->prev = handle_data;
+    }
+    adc_unit_channels_head[config->unit_id] = handle_data;
 
     handle_data->in_use = true;
     *out_handle = handle_data;
 }
 
 
+void adc_release(adc_channel_handle_t handle)
+{
+    if (!handle || !handle->in_use) {
+        return;
+    }
+
+    adc_unit_t unit = handle->config.unit_id;
+
+    // --- Ungroup ---
+    if (handle->prev) {
+        handle->prev->next = handle->next;
+    } else {
+        adc_unit_channels_head[unit] = handle->next;
+    }
+    if (handle->next) {
+        handle->next->prev = handle->prev;
+    }
+
+    if (handle->calibrated) {
+        adc_calibration_deinit_internal(unit, handle->config.atten);
+    }
+    adc_unit_release_internal(unit);
+
+    handle->in_use = false;
+    handle->calibrated = false;
+    handle->cali_cached = false;
+    handle->cali_handle = NULL;
+    handle->unit_handle = NULL;
+    handle->prev = NULL;
+    handle->next = adc_free_list;
+    adc_free_list = handle;
+}
+
+
+size_t adc_unit_channels(adc_unit_t unit, adc_channel_handle_t *out_handles, size_t max_handles)
+{
+    size_t count = 0;
+
+    if (unit >= ADC_NUM_UNITS || !out_handles) {
+        return 0;
+    }
+
+    for (adc_channel_handle_t h = adc_unit_channels_head[unit]; h && count < max_handles; h = h->next) {
+        out_handles[count++] = h;
+    }
+    return count;
+}
+
+
+void adc_unit_set_streaming(adc_unit_t unit, bool streaming)
+{
+    if (unit < ADC_NUM_UNITS) {
+        adc_unit_streaming[unit] = streaming;
+    }
+}
+
+
 void get_raw_data(adc_channel_handle_t handle, int *out_raw)
 {
     *out_raw = -1;
 
-    if (!handle || !out_raw || !handle->in_use) {
+    if (!handle || !out_raw || !handle->in_use || adc_unit_streaming[handle->config.unit_id]) {
         return;
     }
 
@@ -111,6 +278,51 @@ void get_raw_data(adc_channel_handle_t handle, int *out_raw)
 }
 
 
+esp_err_t get_raw_data_multi(const adc_channel_handle_t *handles, size_t count, int *out_raw,
+                             int64_t *out_timestamps_us)
+{
+    if (!handles || !out_raw || count == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Validate everything first so the conversions run back to back
+    adc_oneshot_unit_handle_t unit = handles[0] ? handles[0]->unit_handle : NULL;
+    for (size_t i = 0; i < count; i++) {
+        out_raw[i] = -1;
+        if (!handles[i] || !handles[i]->in_use || handles[i]->unit_handle != unit) {
+            unit = NULL;
+        }
+    }
+    if (!unit) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (adc_unit_streaming[handles[0]->config.unit_id]) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t result = ESP_OK;
+    int64_t start = esp_timer_get_time();
+    for (size_t i = 0; i < count; i++) {
+        esp_err_t err = adc_oneshot_read(unit, handles[i]->config.channel, &out_raw[i]);
+        if (err != ESP_OK) {
+            out_raw[i] = -1;
+            if (result == ESP_OK) {
+                result = err;
+            }
+        }
+    }
+    int64_t span = esp_timer_get_time() - start;
+
+    // Conversions are evenly spread over the burst, stamp each at its midpoint
+    if (out_timestamps_us) {
+        for (size_t i = 0; i < count; i++) {
+            out_timestamps_us[i] = start + (span * (int64_t)(2 * i + 1)) / (int64_t)(2 * count);
+        }
+    }
+    return result;
+}
+
+
 void raw_to_voltage(adc_channel_handle_t handle, int raw_data, int *out_voltage)
 {
     *out_voltage = -1;
@@ -124,4 +336,45 @@ void raw_to_voltage(adc_channel_handle_t handle, int raw_data, int *out_voltage)
     }
 
     adc_cali_raw_to_voltage(handle->cali_handle, raw_data, out_voltage);
+}
+
+
+void raw_to_voltage_block(adc_channel_handle_t handle, const int *raw, int *out_voltage, size_t count)
+{
+    if (!raw || !out_voltage) {
+        return;
+    }
+
+    if (!handle || !handle->in_use || !handle->calibrated || !handle->cali_handle) {
+        for (size_t i = 0; i < count; i++) {
+            out_voltage[i] = -1;
+        }
+        return;
+    }
+
+    if (!handle->cali_cached) {
+        for (size_t i = 0; i < count; i++) {
+            int voltage = -1;
+            adc_cali_raw_to_voltage(handle->cali_handle, raw[i], &voltage);
+            out_voltage[i] = voltage;
+        }
+        return;
+    }
+
+    const int32_t slope = handle->cali_slope_q16;
+    const int32_t offset = handle->cali_offset_mv;
+    const int32_t linear_max = handle->cali_linear_max;
+    const int32_t round = 1 << (ADC_CALI_SLOPE_SHIFT - 1);
+
+    for (size_t i = 0; i < count; i++) {
+        int value = raw[i];
+        if (value >= 0 && value <= linear_max) {
+            out_voltage[i] = offset + ((value * slope + round) >> ADC_CALI_SLOPE_SHIFT);
+        } else {
+            // Curved top of the range (or a bad code): ask the driver
+            int voltage = -1;
+            adc_cali_raw_to_voltage(handle->cali_handle, value, &voltage);
+            out_voltage[i] = voltage;
+        }
+    }
 }
\ No newline at end of file
@@ -12,6 +12,8 @@
 #include "esp_adc/adc_cali.h"
 #include "esp_adc/adc_cali_scheme.h"
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -48,15 +50,67 @@ typedef struct adc_channel_handle_internal_t* adc_channel_handle_t;
  */
 void set_adc(const adc_config_t *config, adc_channel_handle_t *out_handle);
 
+/**
+ * @brief Release an ADC channel configured by set_adc().
+ *
+ * The handle goes back to the pool. The calibration scheme and the unit
+ * are deleted when no other channel uses them. Releasing NULL or an
+ * already released handle does nothing.
+ *
+ * @param[in] handle  Handle to release, invalid afterwards.
+ */
+void adc_release(adc_channel_handle_t handle);
+
+/**
+ * @brief List the configured channels of one ADC unit.
+ *
+ * @param[in]  unit         ADC unit.
+ * @param[out] out_handles  Handles of the unit, most recently configured first.
+ * @param[in]  max_handles  Capacity of out_handles.
+ * @return Number of handles written.
+ */
+size_t adc_unit_channels(adc_unit_t unit, adc_channel_handle_t *out_handles, size_t max_handles);
+
+/**
+ * @brief Mark an ADC unit as owned by the continuous (DMA) driver.
+ *
+ * adc_stream sets this while it runs. Oneshot reads of a streaming unit
+ * are refused, its channels are read through acq_service instead.
+ *
+ * @param[in] unit       ADC unit.
+ * @param[in] streaming  True while the continuous driver owns the unit.
+ */
+void adc_unit_set_streaming(adc_unit_t unit, bool streaming);
+
 /**
  * @brief Get the raw ADC reading from a configured channel.
  *
  * @param[in]  handle     Handle to the configured ADC channel.
  * @param[out] out_raw    Pointer to store the raw ADC value.
- * Set to -1 on failure.
+ * Set to -1 on failure, or if the unit is streaming.
  */
 void get_raw_data(adc_channel_handle_t handle, int *out_raw);
 
+/**
+ * @brief Read several channels of one ADC unit in one pass.
+ *
+ * The handles are validated up front and the conversions then run back to
+ * back, with one clock read before and one after the burst; each reading
+ * is stamped at its share of the burst. Pass the list from
+ * adc_unit_channels() to read every configured channel of a unit.
+ *
+ * @param[in]  handles            Channels to read, all on the same unit.
+ * @param[in]  count              Number of handles.
+ * @param[out] out_raw            Raw values in handle order, -1 where a
+ * conversion failed (all of them if the call is refused).
+ * @param[out] out_timestamps_us  esp_timer time of each conversion, may be NULL.
+ * @return ESP_OK, ESP_ERR_INVALID_ARG if a handle is NULL, released or on
+ *         another unit, ESP_ERR_INVALID_STATE if the unit is streaming, or
+ *         the error of the first failed conversion.
+ */
+esp_err_t get_raw_data_multi(const adc_channel_handle_t *handles, size_t count, int *out_raw,
+                             int64_t *out_timestamps_us);
+
 /**
  * @brief Convert raw ADC reading to voltage (mV).
  *
@@ -69,5 +123,23 @@ void get_raw_data(adc_channel_handle_t handle, int *out_raw);
  */
 void raw_to_voltage(adc_channel_handle_t handle, int raw_data, int *out_voltage);
 
+/**
+ * @brief Convert a buffer of raw ADC readings to voltage (mV).
+ *
+ * Codes on the straight part of the calibration curve are converted with
+ * the line cached by set_adc(), in one integer loop. set_adc() checks that
+ * line against the driver at every code and keeps it only up to the first
+ * code where it is more than 1 mV off; codes above that (on ESP32 at 12 dB,
+ * those above about 2880) and channels without a cached line go through
+ * the driver, so results always match raw_to_voltage() within 1 mV.
+ *
+ * @param[in]  handle      Handle to the configured ADC channel.
+ * @param[in]  raw         Raw ADC values (0..4095).
+ * @param[out] out_voltage Voltages in mV, may alias raw.
+ * Set to -1 if not calibrated.
+ * @param[in]  count       Number of values.
+ */
+void raw_to_voltage_block(adc_channel_handle_t handle, const int *raw, int *out_voltage, size_t count);
+
 
 #endif // ADC_UTILS_H
\ No newline at end of file
@@ -0,0 +1,92 @@
+/**
+ * @file anemometer.c
+ * @author David Ramírez Betancourth
+ * @brief Constant-power hot-wire (self-heated thermistor) anemometer model
+ */
+
+#include "anemometer.h"
+
+#include <math.h>
+
+#define MS_TO_KMH 3.6f
+
+float anemometer_model_kmh(const anemometer_params_t *params, float dt_c, float ambient_c)
+{
+    if (dt_c <= 0) {
+        return INFINITY; // Sensor at ambient: no heat kept, speed unbounded
+    }
+
+    float film_c = ambient_c + 0.5f * dt_c;
+    float k_scale = 1.0f + params->alpha_per_k * (film_c - params->t_ref_c);
+    float conductance = params->power_w / dt_c / k_scale;
+
+    float forced = (conductance - params->king_a) / params->king_b;
+    if (forced <= 0) {
+        return 0.0f;
+    }
+
+    return powf(forced, 1.0f / params->king_n) * MS_TO_KMH;
+}
+
+bool anemometer_build(anemometer_t *anemo, const anemometer_params_t *params,
+                      float dt_min, float dt_max, float ta_min, float ta_max)
+{
+    if (!anemo || !params || dt_min <= 0 || dt_max <= dt_min || ta_max <= ta_min) {
+        return false;
+    }
+
+    anemo->dt_min = dt_min;
+    anemo->inv_dt_min = 1.0f / dt_max;
+    anemo->inv_dt_step = (1.0f / dt_min - 1.0f / dt_max) / (ANEMOMETER_DT_POINTS - 1);
+    anemo->ta_min = ta_min;
+    anemo->ta_step = (ta_max - ta_min) / (ANEMOMETER_AMBIENT_POINTS - 1);
+
+    for (int i = 0; i < ANEMOMETER_DT_POINTS; i++) {
+        float dt = 1.0f / (anemo->inv_dt_min + i * anemo->inv_dt_step);
+        for (int j = 0; j < ANEMOMETER_AMBIENT_POINTS; j++) {
+            anemo->sqrt_kmh[i][j] = sqrtf(anemometer_model_kmh(params, dt, ta_min + j * anemo->ta_step));
+        }
+    }
+    return true;
+}
+
+// Split x into a cell index and the position inside the cell, clamped to the axis
+static int axis_locate(float x, float min, float step, int points, float *frac)
+{
+    float pos = (x - min) / step;
+
+    if (!(pos > 0)) {   // Also catches NaN
+        *frac = 0;
+        return 0;
+    }
+    if (pos >= (float)(points - 1)) {
+        *frac = 1;
+        return points - 2;
+    }
+
+    int idx = (int)pos;
+    *frac = pos - (float)idx;
+    return idx;
+}
+
+float anemometer_kmh(const anemometer_t *anemo, float dt_c, float ambient_c)
+{
+    float fr, fc;
+
+    if (!(dt_c >= anemo->dt_min)) {   // Also catches NaN
+        return 0.0f;
+    }
+
+    int r = axis_locate(1.0f / dt_c, anemo->inv_dt_min, anemo->inv_dt_step, ANEMOMETER_DT_POINTS, &fr);
+    int c = axis_locate(ambient_c, anemo->ta_min, anemo->ta_step, ANEMOMETER_AMBIENT_POINTS, &fc);
+
+    float v00 = anemo->sqrt_kmh[r][c];
+    float v01 = anemo->sqrt_kmh[r][c + 1];
+    float v10 = anemo->sqrt_kmh[r + 1][c];
+    float v11 = anemo->sqrt_kmh[r + 1][c + 1];
+
+    float top = v00 + fc * (v01 - v00);
+    float bottom = v10 + fc * (v11 - v10);
+    float root = top + fr * (bottom - top);
+    return root * root;
+}
@@ -0,0 +1,306 @@
+/**
+ * @file filter_chain.c
+ * @author David Ramírez Betancourth
+ * @brief Composable streaming filters (moving average, running median, biquad IIR)
+ */
+
+#include "filter_chain.h"
+
+#include <math.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Bessel prototype poles normalized to -3 dB at 1 rad/s. One entry per
+// conjugate pair (positive imaginary part) plus the real pole of odd orders.
+typedef struct {
+    double re, im;
+} filter_pole_t;
+
+static const filter_pole_t bessel_poles[FILTER_BESSEL_MAX_ORDER + 1][3] = {
+    [1] = {{-1.0000000000, 0.0}},
+    [2] = {{-1.1016013306, 0.6360098248}},
+    [3] = {{-1.3226757999, 0.0}, {-1.0474091610, 0.9992644363}},
+    [4] = {{-1.3700678306, 0.4102497175}, {-0.9952087644, 1.2571057395}},
+    [5] = {{-1.5023162714, 0.0}, {-1.3808773259, 0.7179095876}, {-0.9576765486, 1.4711243207}},
+    [6] = {{-1.5714904036, 0.3208963742}, {-1.3818580976, 0.9714718907}, {-0.9306565229, 1.6618632689}},
+};
+
+//-----------------------------------Stages-------------------------------------
+
+static void moving_average_process(filter_moving_average_t *ma, float *data, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        float x = data[i];
+
+        if (ma->fill < ma->len) {
+            ma->fill++;
+        } else {
+            ma->sum -= ma->window[ma->pos];
+        }
+        ma->window[ma->pos] = x;
+        ma->sum += x;
+
+        if (++ma->pos == ma->len) {
+            ma->pos = 0;
+            // Re-add from scratch once per window so rounding does not accumulate
+            float sum = 0;
+            for (size_t k = 0; k < ma->fill; k++) {
+                sum += ma->window[k];
+            }
+            ma->sum = sum;
+        }
+
+        data[i] = ma->sum / (float)ma->fill;
+    }
+}
+
+static void median_process(filter_median_t *med, float *data, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        float x = data[i];
+        size_t n = med->fill;
+        size_t k;
+
+        // NaN/inf would break the ordering and the lookup below; treat them
+        // as a repeat of the newest sample. Before the first finite sample
+        // there is none, output 0 so later stages (a biquad's state) stay finite
+        if (!isfinite(x)) {
+            if (n == 0) {
+                data[i] = 0.0f;
+                continue;
+            }
+            x = med->window[(med->pos + med->len - 1) % med->len];
+        }
+
+        // Drop the oldest sample from the sorted copy
+        if (n == med->len) {
+            float old = med->window[med->pos];
+            for (k = 0; k + 1 < n && med->sorted[k] != old; k++) {
+            }
+            memmove(&med->sorted[k], &med->sorted[k + 1], (n - k - 1) * sizeof(float));
+            n--;
+        }
+
+        // Insert the new one keeping the order
+        for (k = n; k > 0 && med->sorted[k - 1] > x; k--) {
+            med->sorted[k] = med->sorted[k - 1];
+        }
+        med->sorted[k] = x;
+        n++;
+
+        med->window[med->pos] = x;
+        med->pos = (med->pos + 1) % med->len;
+        med->fill = n;
+
+        data[i] = (n & 1) ? med->sorted[n / 2] : 0.5f * (med->sorted[n / 2 - 1] + med->sorted[n / 2]);
+    }
+}
+
+static void biquad_process(filter_biquad_t *iir, float *data, size_t count)
+{
+    for (size_t s = 0; s < iir->num_sections; s++) {
+        const biquad_coeffs_t c = iir->c[s];
+        float z1 = iir->z1[s];
+        float z2 = iir->z2[s];
+
+        for (size_t i = 0; i < count; i++) {
+            float x = data[i];
+            float y = c.b0 * x + z1;
+            z1 = c.b1 * x - c.a1 * y + z2;
+            z2 = c.b2 * x - c.a2 * y;
+            data[i] = y;
+        }
+
+        iir->z1[s] = z1;
+        iir->z2[s] = z2;
+    }
+}
+
+//-----------------------------------Chain--------------------------------------
+
+void filter_chain_init(filter_chain_t *chain)
+{
+    if (chain) {
+        memset(chain, 0, sizeof(*chain));
+    }
+}
+
+static filter_stage_t *filter_chain_append(filter_chain_t *chain, filter_stage_kind_t kind)
+{
+    if (!chain || chain->num_stages >= FILTER_CHAIN_MAX_STAGES) {
+        return NULL;
+    }
+
+    filter_stage_t *stage = &chain->stages[chain->num_stages];
+    memset(stage, 0, sizeof(*stage));
+    stage->kind = kind;
+    return stage;
+}
+
+bool filter_chain_add_moving_average(filter_chain_t *chain, size_t len)
+{
+    if (len == 0 || len > FILTER_MAX_WINDOW) {
+        return false;
+    }
+
+    filter_stage_t *stage = filter_chain_append(chain, FILTER_STAGE_MOVING_AVERAGE);
+    if (!stage) {
+        return false;
+    }
+    stage->ma.len = len;
+    chain->num_stages++;
+    return true;
+}
+
+bool filter_chain_add_median(filter_chain_t *chain, size_t len)
+{
+    if (len == 0 || len > FILTER_MAX_WINDOW || (len & 1) == 0) {
+        return false;
+    }
+
+    filter_stage_t *stage = filter_chain_append(chain, FILTER_STAGE_MEDIAN);
+    if (!stage) {
+        return false;
+    }
+    stage->median.len = len;
+    chain->num_stages++;
+    return true;
+}
+
+bool filter_chain_add_biquads(filter_chain_t *chain, const biquad_coeffs_t *sections, size_t num_sections)
+{
+    if (!sections || num_sections == 0 || num_sections > FILTER_MAX_SECTIONS) {
+        return false;
+    }
+
+    filter_stage_t *stage = filter_chain_append(chain, FILTER_STAGE_BIQUAD);
+    if (!stage) {
+        return false;
+    }
+    stage->iir.num_sections = num_sections;
+    memcpy(stage->iir.c, sections, num_sections * sizeof(biquad_coeffs_t));
+    chain->num_stages++;
+    return true;
+}
+
+void filter_chain_process(filter_chain_t *chain, float *data, size_t count)
+{
+    for (size_t i = 0; i < chain->num_stages; i++) {
+        filter_stage_t *stage = &chain->stages[i];
+
+        switch (stage->kind) {
+            case FILTER_STAGE_MOVING_AVERAGE:
+                moving_average_process(&stage->ma, data, count);
+                break;
+            case FILTER_STAGE_MEDIAN:
+                median_process(&stage->median, data, count);
+                break;
+            case FILTER_STAGE_BIQUAD:
+                biquad_process(&stage->iir, data, count);
+                break;
+        }
+    }
+}
+
+void filter_chain_reset(filter_chain_t *chain)
+{
+    for (size_t i = 0; i < chain->num_stages; i++) {
+        filter_stage_t *stage = &chain->stages[i];
+
+        switch (stage->kind) {
+            case FILTER_STAGE_MOVING_AVERAGE:
+                stage->ma.pos = stage->ma.fill = 0;
+                stage->ma.sum = 0;
+                break;
+            case FILTER_STAGE_MEDIAN:
+                stage->median.pos = stage->median.fill = 0;
+                break;
+            case FILTER_STAGE_BIQUAD:
+                memset(stage->iir.z1, 0, sizeof(stage->iir.z1));
+                memset(stage->iir.z2, 0, sizeof(stage->iir.z2));
+                break;
+        }
+    }
+}
+
+//-----------------------------------Design-------------------------------------
+
+// Analog prototype pole k (upper half plane or real axis), normalized to 1 rad/s
+static filter_pole_t prototype_pole(filter_response_t response, unsigned order, unsigned k, double ripple_db)
+{
+    filter_pole_t p = {0, 0};
+    // Poles of Butterworth and Chebyshev sit at these angles, k = 0 is closest to the j axis
+    double theta = M_PI * (2.0 * k + 1.0) / (2.0 * order);
+
+    switch (response) {
+        case FILTER_BUTTERWORTH:
+            p.re = -sin(theta);
+            p.im = cos(theta);
+            break;
+        case FILTER_CHEBYSHEV: {
+            double eps = sqrt(pow(10.0, ripple_db / 10.0) - 1.0);
+            double mu = asinh(1.0 / eps) / order;
+            p.re = -sinh(mu) * sin(theta);
+            p.im = cosh(mu) * cos(theta);
+            break;
+        }
+        case FILTER_BESSEL:
+            // Table lists the odd-order real pole first, then pairs
+            p = bessel_poles[order][(order & 1) ? (order / 2 - k) : ((order / 2) - 1 - k)];
+            break;
+    }
+
+    if (fabs(p.im) < 1e-9) {
+        p.im = 0;
+    }
+    return p;
+}
+
+size_t filter_design_lowpass(filter_response_t response, unsigned order, float cutoff_hz,
+                             float sample_rate_hz, float ripple_db,
+                             biquad_coeffs_t *out, size_t max_sections)
+{
+    size_t num_sections = (order + 1) / 2;
+
+    if (!out || order == 0 || num_sections > max_sections ||
+        sample_rate_hz <= 0 || cutoff_hz <= 0 || cutoff_hz >= sample_rate_hz / 2 ||
+        (response == FILTER_BESSEL && order > FILTER_BESSEL_MAX_ORDER) ||
+        (response == FILTER_CHEBYSHEV && ripple_db <= 0)) {
+        return 0;
+    }
+
+    // Pre-warp so the digital cutoff lands where requested
+    const double K = 2.0 * sample_rate_hz;
+    const double wc = K * tan(M_PI * cutoff_hz / sample_rate_hz);
+
+    for (unsigned k = 0; k < num_sections; k++) {
+        filter_pole_t p = prototype_pole(response, order, k, ripple_db);
+        biquad_coeffs_t *c = &out[k];
+
+        if (p.im == 0) {
+            // First order: H(s) = a / (s + a)
+            double a = -p.re * wc;
+            double d0 = K + a;
+            c->b0 = (float)(a / d0);
+            c->b1 = (float)(a / d0);
+            c->b2 = 0;
+            c->a1 = (float)((a - K) / d0);
+            c->a2 = 0;
+        } else {
+            // Conjugate pair: H(s) = w0^2 / (s^2 + a1 s + w0^2)
+            double a1 = -2.0 * p.re * wc;
+            double w0sq = (p.re * p.re + p.im * p.im) * wc * wc;
+            double d0 = K * K + a1 * K + w0sq;
+            c->b0 = (float)(w0sq / d0);
+            c->b1 = (float)(2.0 * w0sq / d0);
+            c->b2 = (float)(w0sq / d0);
+            c->a1 = (float)(2.0 * (w0sq - K * K) / d0);
+            c->a2 = (float)((K * K - a1 * K + w0sq) / d0);
+        }
+    }
+
+    return num_sections;
+}
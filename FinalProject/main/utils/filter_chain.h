@@ -0,0 +1,145 @@
+/**
+ * @file filter_chain.h
+ * @author David Ramírez Betancourth
+ * @brief Composable streaming filters (moving average, running median, biquad IIR), header
+ *
+ * A chain is a fixed array of stages applied in order. Every stage works
+ * in place on whole blocks and keeps its state in the chain itself, so
+ * nothing is allocated after init. The low-pass designer produces biquad
+ * sections from Butterworth, Chebyshev (type I) or Bessel prototypes, see
+ * Notes/2_Signal_Aconditioning.md.
+ */
+
+#ifndef FILTER_CHAIN_H
+#define FILTER_CHAIN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define FILTER_CHAIN_MAX_STAGES  4
+#define FILTER_MAX_WINDOW        16     ///< Moving average / median window
+#define FILTER_MAX_SECTIONS      4      ///< Biquads per stage (order <= 8)
+#define FILTER_BESSEL_MAX_ORDER  6
+
+/**
+ * @brief Analog prototype used by filter_design_lowpass()
+ */
+typedef enum {
+    FILTER_BUTTERWORTH = 0,     ///< Maximally flat passband
+    FILTER_CHEBYSHEV,           ///< Type I, equiripple passband, steeper roll-off
+    FILTER_BESSEL,              ///< Maximally flat group delay, no overshoot
+} filter_response_t;
+
+/**
+ * @brief Biquad coefficients, a0 normalized to 1
+ *
+ * y[n] = b0 x[n] + b1 x[n-1] + b2 x[n-2] - a1 y[n-1] - a2 y[n-2]
+ */
+typedef struct {
+    float b0, b1, b2;
+    float a1, a2;
+} biquad_coeffs_t;
+
+typedef enum {
+    FILTER_STAGE_MOVING_AVERAGE = 0,
+    FILTER_STAGE_MEDIAN,
+    FILTER_STAGE_BIQUAD,
+} filter_stage_kind_t;
+
+typedef struct {
+    size_t len, pos, fill;
+    float sum;
+    float window[FILTER_MAX_WINDOW];
+} filter_moving_average_t;
+
+typedef struct {
+    size_t len, pos, fill;
+    float window[FILTER_MAX_WINDOW];    ///< Arrival order
+    float sorted[FILTER_MAX_WINDOW];    ///< Same samples, ascending
+} filter_median_t;
+
+typedef struct {
+    size_t num_sections;
+    biquad_coeffs_t c[FILTER_MAX_SECTIONS];
+    float z1[FILTER_MAX_SECTIONS];      ///< Transposed direct form II state
+    float z2[FILTER_MAX_SECTIONS];
+} filter_biquad_t;
+
+typedef struct {
+    filter_stage_kind_t kind;
+    union {
+        filter_moving_average_t ma;
+        filter_median_t median;
+        filter_biquad_t iir;
+    };
+} filter_stage_t;
+
+/**
+ * @brief Filter chain
+ */
+typedef struct {
+    size_t num_stages;
+    filter_stage_t stages[FILTER_CHAIN_MAX_STAGES];
+} filter_chain_t;
+
+/**
+ * @brief Empty a chain (no stages, passes samples through).
+ */
+void filter_chain_init(filter_chain_t *chain);
+
+/**
+ * @brief Append a moving average over len samples (1..FILTER_MAX_WINDOW).
+ * @return false if the chain is full or len is out of range.
+ */
+bool filter_chain_add_moving_average(filter_chain_t *chain, size_t len);
+
+/**
+ * @brief Append a running median over len samples (1..FILTER_MAX_WINDOW, odd).
+ *
+ * A NaN or infinite input is replaced by the newest sample in the window,
+ * or by 0 while the window is still empty. The output is always finite.
+ * @return false if the chain is full or len is out of range.
+ */
+bool filter_chain_add_median(filter_chain_t *chain, size_t len);
+
+/**
+ * @brief Append a cascade of biquad sections (1..FILTER_MAX_SECTIONS).
+ * @return false if the chain is full or the section count is out of range.
+ */
+bool filter_chain_add_biquads(filter_chain_t *chain, const biquad_coeffs_t *sections, size_t num_sections);
+
+/**
+ * @brief Run a block through every stage, in place.
+ *
+ * @param[in,out] chain  Chain and its state.
+ * @param[in,out] data   Samples, replaced by the filtered output.
+ * @param[in]     count  Number of samples.
+ */
+void filter_chain_process(filter_chain_t *chain, float *data, size_t count);
+
+/**
+ * @brief Clear the state of every stage, keeping the configuration.
+ */
+void filter_chain_reset(filter_chain_t *chain);
+
+/**
+ * @brief Design a digital low-pass filter as biquad sections.
+ *
+ * Poles of the normalized analog prototype are scaled to the pre-warped
+ * cutoff and mapped with the bilinear transform. Each section has unity
+ * gain at DC, so sensor values are not rescaled.
+ *
+ * @param[in]  response        Prototype family.
+ * @param[in]  order           Filter order (1..2*max_sections, Bessel up to FILTER_BESSEL_MAX_ORDER).
+ * @param[in]  cutoff_hz       -3 dB frequency (Butterworth, Bessel) or ripple band edge (Chebyshev).
+ * @param[in]  sample_rate_hz  Sample rate of the stream.
+ * @param[in]  ripple_db       Passband ripple, Chebyshev only.
+ * @param[out] out             Sections, (order + 1) / 2 of them.
+ * @param[in]  max_sections    Room in out.
+ * @return Number of sections written, 0 on invalid arguments.
+ */
+size_t filter_design_lowpass(filter_response_t response, unsigned order, float cutoff_hz,
+                             float sample_rate_hz, float ripple_db,
+                             biquad_coeffs_t *out, size_t max_sections);
+
+#endif // FILTER_CHAIN_H
@@ -0,0 +1,557 @@
+/**
+ * @file flash_log.c
+ * @author David Ramírez Betancourth
+ * @brief Append-only record log on a flash partition
+ */
+
+#include "flash_log.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_partition.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include "tasks_common.h"
+
+#define FLASH_LOG_MAGIC        0x474F4C54u  // "TLOG"
+#define FLASH_LOG_HEADER_SIZE  16           // Sector header
+#define FLASH_LOG_REC_HDR_SIZE 8            // Record header
+#define FLASH_LOG_ALIGN(n)     (((n) + 3u) & ~3u)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t generation;
+    uint32_t crc;           // Of magic and generation
+    uint32_t reserved;
+} flash_log_sector_hdr_t;
+
+typedef struct {
+    uint16_t len;
+    uint16_t len_inv;       // ~len, tells a record from erased or torn flash
+    uint32_t crc;           // Of the payload
+} flash_log_rec_hdr_t;
+
+static flash_log_backend_t log_backend;
+static uint32_t log_num_sectors = 0;
+static uint32_t log_sector = 0;         // Sector being written
+static uint32_t log_offset = 0;         // Next write inside it
+static uint32_t log_generation = 0;
+static bool log_mounted = false;
+static SemaphoreHandle_t log_mutex = NULL;  // Backend access and write position
+
+// Ping-pong staging: producers fill one buffer while the writer drains the other
+static uint8_t log_stage[2][FLASH_LOG_STAGING_BYTES];
+static size_t log_stage_fill[2];
+static int log_stage_active = 0;
+static portMUX_TYPE log_stage_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static uint8_t log_scratch[FLASH_LOG_MAX_RECORD];   // Mount scan, under log_mutex
+static TaskHandle_t log_task_handle = NULL;
+
+static flash_log_stats_t log_stats;
+static portMUX_TYPE log_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+//-----------------------------------CRC32-----------------------------------------
+
+// IEEE 802.3 (reflected 0xEDB88320), one nibble at a time
+static uint32_t flash_log_crc32(const void *data, size_t len)
+{
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+    };
+    const uint8_t *p = (const uint8_t *)data;
+    uint32_t crc = 0xFFFFFFFFu;
+
+    for (size_t i = 0; i < len; i++) {
+        crc = table[(crc ^ p[i]) & 0x0F] ^ (crc >> 4);
+        crc = table[(crc ^ (p[i] >> 4)) & 0x0F] ^ (crc >> 4);
+    }
+    return ~crc;
+}
+
+//-----------------------------------Sectors---------------------------------------
+
+static bool sector_header_valid(uint32_t sector, uint32_t *out_generation)
+{
+    flash_log_sector_hdr_t hdr;
+
+    if (log_backend.read(log_backend.ctx, sector * FLASH_LOG_SECTOR_SIZE, &hdr, sizeof(hdr)) != ESP_OK ||
+        hdr.magic != FLASH_LOG_MAGIC || hdr.crc != flash_log_crc32(&hdr, 8)) {
+        return false;
+    }
+    *out_generation = hdr.generation;
+    return true;
+}
+
+// Erase a sector and make it the write sector. Called with log_mutex held.
+static esp_err_t sector_open(uint32_t sector, uint32_t generation)
+{
+    flash_log_sector_hdr_t hdr = {
+        .magic = FLASH_LOG_MAGIC,
+        .generation = generation,
+        .reserved = 0xFFFFFFFFu,
+    };
+    hdr.crc = flash_log_crc32(&hdr, 8);
+
+    esp_err_t err = log_backend.erase_sector(log_backend.ctx, sector * FLASH_LOG_SECTOR_SIZE);
+    if (err == ESP_OK) {
+        err = log_backend.write(log_backend.ctx, sector * FLASH_LOG_SECTOR_SIZE, &hdr, sizeof(hdr));
+    }
+
+    taskENTER_CRITICAL(&log_stats_lock);
+    log_stats.sectors_erased++;
+    if (err != ESP_OK) {
+        log_stats.write_errors++;
+    }
+    taskEXIT_CRITICAL(&log_stats_lock);
+
+    // Even on failure move on, the next rotation tries the following sector
+    log_sector = sector;
+    log_generation = generation;
+    log_offset = (err == ESP_OK) ? FLASH_LOG_HEADER_SIZE : FLASH_LOG_SECTOR_SIZE;
+    return err;
+}
+
+// Read and check the record at offset. Returns its payload size, 0 at the
+// end of the written part, -1 for a damaged record.
+static int record_read(uint32_t sector, uint32_t offset, void *buf, size_t max_len, bool *skipped)
+{
+    flash_log_rec_hdr_t hdr;
+    uint32_t base = sector * FLASH_LOG_SECTOR_SIZE;
+
+    *skipped = false;
+
+    if (offset + FLASH_LOG_REC_HDR_SIZE > FLASH_LOG_SECTOR_SIZE) {
+        return 0;
+    }
+    if (log_backend.read(log_backend.ctx, base + offset, &hdr, sizeof(hdr)) != ESP_OK) {
+        return -1;
+    }
+    if (hdr.len == 0xFFFF && hdr.len_inv == 0xFFFF && hdr.crc == 0xFFFFFFFFu) {
+        return 0; // Erased
+    }
+    if (hdr.len_inv != (uint16_t)~hdr.len || hdr.len == 0 || hdr.len > FLASH_LOG_MAX_RECORD ||
+        offset + FLASH_LOG_REC_HDR_SIZE + FLASH_LOG_ALIGN(hdr.len) > FLASH_LOG_SECTOR_SIZE) {
+        return -1;
+    }
+    if (hdr.len > max_len) {
+        *skipped = true;
+        return hdr.len;
+    }
+    if (log_backend.read(log_backend.ctx, base + offset + FLASH_LOG_REC_HDR_SIZE, buf, hdr.len) != ESP_OK ||
+        flash_log_crc32(buf, hdr.len) != hdr.crc) {
+        return -1;
+    }
+    return hdr.len;
+}
+
+//-----------------------------------Mount-----------------------------------------
+
+esp_err_t flash_log_mount(const flash_log_backend_t *backend)
+{
+    esp_err_t err = ESP_OK;
+    int64_t start = esp_timer_get_time();
+
+    if (!backend || !backend->read || !backend->write || !backend->erase_sector ||
+        backend->size < 2 * FLASH_LOG_SECTOR_SIZE || backend->size % FLASH_LOG_SECTOR_SIZE != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (log_task_handle) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!log_mutex) {
+        log_mutex = xSemaphoreCreateMutex();
+        if (!log_mutex) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    xSemaphoreTake(log_mutex, portMAX_DELAY);
+    log_backend = *backend;
+    log_num_sectors = backend->size / FLASH_LOG_SECTOR_SIZE;
+    memset(&log_stats, 0, sizeof(log_stats));
+    log_stage_fill[0] = 0;
+    log_stage_fill[1] = 0;
+
+    // Newest sector
+    int newest = -1;
+    uint32_t newest_gen = 0;
+    for (uint32_t s = 0; s < log_num_sectors; s++) {
+        uint32_t gen;
+        if (sector_header_valid(s, &gen) && (newest < 0 || gen > newest_gen)) {
+            newest = (int)s;
+            newest_gen = gen;
+        }
+    }
+
+    if (newest < 0) {
+        err = sector_open(0, 1); // Blank or foreign content: format lazily, one sector
+    } else {
+        uint32_t offset = FLASH_LOG_HEADER_SIZE;
+        int len;
+        bool skipped;
+
+        while ((len = record_read(newest, offset, log_scratch, sizeof(log_scratch), &skipped)) > 0) {
+            offset += FLASH_LOG_REC_HDR_SIZE + FLASH_LOG_ALIGN(len);
+        }
+
+        log_sector = newest;
+        log_generation = newest_gen;
+        log_offset = offset;
+        if (len < 0) {
+            // Power was lost mid-write, never program over the damaged bytes
+            log_stats.torn_records++;
+            log_offset = FLASH_LOG_SECTOR_SIZE;
+        }
+    }
+
+    log_mounted = (err == ESP_OK);
+    log_stats.mount_us = esp_timer_get_time() - start;
+    xSemaphoreGive(log_mutex);
+
+    return err;
+}
+
+//-----------------------------------Writing---------------------------------------
+
+bool flash_log_append(const void *data, size_t len)
+{
+    bool accepted = false;
+    bool wake = false;
+
+    if (data && len > 0 && len <= FLASH_LOG_MAX_RECORD) {
+        flash_log_rec_hdr_t hdr = {
+            .len = (uint16_t)len,
+            .len_inv = (uint16_t)~len,
+            .crc = flash_log_crc32(data, len),
+        };
+        size_t size = FLASH_LOG_REC_HDR_SIZE + FLASH_LOG_ALIGN(len);
+
+        taskENTER_CRITICAL(&log_stage_lock);
+        int active = log_stage_active;
+        size_t fill = log_stage_fill[active];
+        if (fill + size <= FLASH_LOG_STAGING_BYTES) {
+            uint8_t *dst = &log_stage[active][fill];
+            memcpy(dst, &hdr, sizeof(hdr));
+            memcpy(dst + sizeof(hdr), data, len);
+            memset(dst + sizeof(hdr) + len, 0xFF, size - sizeof(hdr) - len);
+            log_stage_fill[active] = fill + size;
+            wake = (fill + size) * 2 >= FLASH_LOG_STAGING_BYTES;
+            accepted = true;
+        }
+        taskEXIT_CRITICAL(&log_stage_lock);
+    }
+
+    taskENTER_CRITICAL(&log_stats_lock);
+    if (accepted) {
+        log_stats.appended++;
+    } else {
+        log_stats.dropped++;
+    }
+    taskEXIT_CRITICAL(&log_stats_lock);
+
+    if (wake && log_task_handle) {
+        xTaskNotifyGive(log_task_handle);
+    }
+    return accepted;
+}
+
+esp_err_t flash_log_flush(void)
+{
+    esp_err_t result = ESP_OK;
+
+    if (!log_mounted) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(log_mutex, portMAX_DELAY);
+
+    taskENTER_CRITICAL(&log_stage_lock);
+    int idx = log_stage_active;
+    log_stage_active ^= 1;
+    size_t fill = log_stage_fill[idx];
+    taskEXIT_CRITICAL(&log_stage_lock);
+
+    const uint8_t *buf = log_stage[idx];
+    size_t pos = 0;
+    uint32_t rotations = 0;
+
+    while (pos < fill) {
+        // Longest run of whole records that fits in the current sector
+        size_t end = pos;
+        uint32_t records = 0;
+        while (end < fill) {
+            const flash_log_rec_hdr_t *hdr = (const flash_log_rec_hdr_t *)&buf[end];
+            size_t size = FLASH_LOG_REC_HDR_SIZE + FLASH_LOG_ALIGN(hdr->len);
+            if (log_offset + (end - pos) + size > FLASH_LOG_SECTOR_SIZE) {
+                break;
+            }
+            end += size;
+            records++;
+        }
+
+        if (records == 0) {
+            if (++rotations > log_num_sectors) {
+                result = ESP_FAIL; // No sector can be erased, drop the batch
+                break;
+            }
+            sector_open((log_sector + 1) % log_num_sectors, log_generation + 1);
+            continue;
+        }
+
+        esp_err_t err = log_backend.write(log_backend.ctx, log_sector * FLASH_LOG_SECTOR_SIZE + log_offset,
+                                          &buf[pos], end - pos);
+
+        taskENTER_CRITICAL(&log_stats_lock);
+        if (err == ESP_OK) {
+            log_stats.written += records;
+        } else {
+            log_stats.write_errors++;
+        }
+        taskEXIT_CRITICAL(&log_stats_lock);
+
+        if (err == ESP_OK) {
+            log_offset += end - pos;
+        } else {
+            log_offset = FLASH_LOG_SECTOR_SIZE; // Unknown state, continue in a fresh sector
+            result = err;
+        }
+        pos = end;
+    }
+
+    taskENTER_CRITICAL(&log_stage_lock);
+    log_stage_fill[idx] = 0;
+    taskEXIT_CRITICAL(&log_stage_lock);
+
+    xSemaphoreGive(log_mutex);
+    return result;
+}
+
+static void flash_log_task(void *arg)
+{
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(FLASH_LOG_FLUSH_MS));
+        flash_log_flush();
+    }
+}
+
+esp_err_t flash_log_start(void)
+{
+    if (!log_mounted || log_task_handle) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    BaseType_t ok = xTaskCreatePinnedToCore(flash_log_task, "flash_log", FLASH_LOG_TASK_STACK_SIZE, NULL,
+                                            FLASH_LOG_TASK_PRIORITY, &log_task_handle, FLASH_LOG_TASK_CORE_ID);
+    return ok == pdPASS ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+//-----------------------------------Reading---------------------------------------
+
+void flash_log_iter_init(flash_log_iter_t *it)
+{
+    memset(it, 0, sizeof(*it));
+    if (!log_mounted) {
+        return;
+    }
+
+    xSemaphoreTake(log_mutex, portMAX_DELAY);
+    it->sectors_left = log_num_sectors;
+    it->sector = (log_sector + 1) % log_num_sectors;   // Oldest generation follows the newest
+    it->offset = 0;
+    xSemaphoreGive(log_mutex);
+}
+
+static void iter_next_sector(flash_log_iter_t *it)
+{
+    it->sector = (it->sector + 1) % log_num_sectors;
+    it->offset = 0;
+    it->sectors_left--;
+}
+
+bool flash_log_iter_next(flash_log_iter_t *it, void *buf, size_t max_len, size_t *out_len)
+{
+    bool found = false;
+
+    if (!log_mounted || !buf || !out_len) {
+        return false;
+    }
+
+    xSemaphoreTake(log_mutex, portMAX_DELAY);
+    while (!found && it->sectors_left > 0) {
+        uint32_t gen;
+        bool skipped;
+
+        if (it->offset == 0) {
+            if (!sector_header_valid(it->sector, &gen)) {
+                iter_next_sector(it);
+                continue;
+            }
+            it->offset = FLASH_LOG_HEADER_SIZE;
+        }
+        if (it->sector == log_sector && it->offset >= log_offset) {
+            it->sectors_left = 0; // Caught up with the writer
+            break;
+        }
+
+        int len = record_read(it->sector, it->offset, buf, max_len, &skipped);
+        if (len <= 0) {
+            iter_next_sector(it);
+            continue;
+        }
+
+        it->offset += FLASH_LOG_REC_HDR_SIZE + FLASH_LOG_ALIGN(len);
+        if (!skipped) {
+            *out_len = (size_t)len;
+            found = true;
+        }
+    }
+    xSemaphoreGive(log_mutex);
+
+    return found;
+}
+
+//-----------------------------------Partition backend------------------------------
+
+static esp_err_t part_read(void *ctx, uint32_t offset, void *buf, size_t len)
+{
+    return esp_partition_read((const esp_partition_t *)ctx, offset, buf, len);
+}
+
+static esp_err_t part_write(void *ctx, uint32_t offset, const void *buf, size_t len)
+{
+    return esp_partition_write((const esp_partition_t *)ctx, offset, buf, len);
+}
+
+static esp_err_t part_erase_sector(void *ctx, uint32_t offset)
+{
+    return esp_partition_erase_range((const esp_partition_t *)ctx, offset, FLASH_LOG_SECTOR_SIZE);
+}
+
+esp_err_t flash_log_partition_backend(const char *label, flash_log_backend_t *out)
+{
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+
+    if (!part || !out) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    out->read = part_read;
+    out->write = part_write;
+    out->erase_sector = part_erase_sector;
+    out->size = part->size - part->size % FLASH_LOG_SECTOR_SIZE;
+    out->ctx = (void *)part;
+    return ESP_OK;
+}
+
+//-----------------------------------File backend-----------------------------------
+
+// Behaves like NOR flash: writes only clear bits, erase sets them back
+static esp_err_t file_read(void *ctx, uint32_t offset, void *buf, size_t len)
+{
+    FILE *f = (FILE *)ctx;
+
+    if (fseek(f, (long)offset, SEEK_SET) != 0 || fread(buf, 1, len, f) != len) {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t file_write(void *ctx, uint32_t offset, const void *buf, size_t len)
+{
+    FILE *f = (FILE *)ctx;
+    const uint8_t *src = (const uint8_t *)buf;
+    uint8_t chunk[64];
+
+    for (size_t done = 0; done < len; ) {
+        size_t n = len - done < sizeof(chunk) ? len - done : sizeof(chunk);
+
+        if (file_read(ctx, offset + done, chunk, n) != ESP_OK) {
+            return ESP_FAIL;
+        }
+        for (size_t i = 0; i < n; i++) {
+            chunk[i] &= src[done + i];
+        }
+        if (fseek(f, (long)(offset + done), SEEK_SET) != 0 || fwrite(chunk, 1, n, f) != n) {
+            return ESP_FAIL;
+        }
+        done += n;
+    }
+    return fflush(f) == 0 ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t file_erase_sector(void *ctx, uint32_t offset)
+{
+    FILE *f = (FILE *)ctx;
+    uint8_t erased[256];
+
+    memset(erased, 0xFF, sizeof(erased));
+    if (fseek(f, (long)offset, SEEK_SET) != 0) {
+        return ESP_FAIL;
+    }
+    for (size_t done = 0; done < FLASH_LOG_SECTOR_SIZE; done += sizeof(erased)) {
+        if (fwrite(erased, 1, sizeof(erased), f) != sizeof(erased)) {
+            return ESP_FAIL;
+        }
+    }
+    return fflush(f) == 0 ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t flash_log_file_backend(const char *path, uint32_t size, flash_log_backend_t *out)
+{
+    if (!path || !out || size < 2 * FLASH_LOG_SECTOR_SIZE || size % FLASH_LOG_SECTOR_SIZE != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    FILE *f = fopen(path, "r+b");
+    if (!f) {
+        f = fopen(path, "w+b");
+    }
+    if (!f) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Grow a new or short image with erased sectors
+    long end = (fseek(f, 0, SEEK_END) == 0) ? ftell(f) : -1;
+    if (end < 0) {
+        fclose(f);
+        return ESP_FAIL;
+    }
+    for (uint32_t offset = (uint32_t)end - (uint32_t)end % FLASH_LOG_SECTOR_SIZE; offset < size;
+         offset += FLASH_LOG_SECTOR_SIZE) {
+        if (offset >= (uint32_t)end && file_erase_sector(f, offset) != ESP_OK) {
+            fclose(f);
+            return ESP_FAIL;
+        }
+    }
+
+    out->read = file_read;
+    out->write = file_write;
+    out->erase_sector = file_erase_sector;
+    out->size = size;
+    out->ctx = f;
+    return ESP_OK;
+}
+
+void flash_log_file_backend_close(flash_log_backend_t *backend)
+{
+    if (backend && backend->read == file_read && backend->ctx) {
+        fclose((FILE *)backend->ctx);
+        backend->ctx = NULL;
+    }
+}
+
+void flash_log_get_stats(flash_log_stats_t *out)
+{
+    taskENTER_CRITICAL(&log_stats_lock);
+    *out = log_stats;
+    out->generation = log_generation;
+    out->write_sector = log_sector;
+    out->write_offset = log_offset;
+    taskEXIT_CRITICAL(&log_stats_lock);
+}
@@ -0,0 +1,159 @@
+/**
+ * @file flash_log.h
+ * @author David Ramírez Betancourth
+ * @brief Append-only record log on a flash partition, header
+ *
+ * The log area is a ring of 4 KB sectors. Each sector starts with a header
+ * carrying a generation number; records are appended behind it with their
+ * length and a CRC32. When a sector is full the next one is erased and
+ * takes the next generation, so erases rotate evenly over the area.
+ *
+ * On mount the sector with the highest generation is scanned to find the
+ * write position. A record with a bad CRC (power lost mid-write) ends the
+ * sector and writing resumes in the next one.
+ *
+ * Producers only copy records into a RAM staging buffer; a low priority
+ * writer task moves them to flash in batches, so flash erase and write
+ * times never reach the producer. Flash access goes through a small
+ * backend interface: a data partition on the device, or a file image that
+ * emulates NOR flash (host tests, or a file system on the device).
+ */
+
+#ifndef FLASH_LOG_H
+#define FLASH_LOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#define FLASH_LOG_SECTOR_SIZE     4096
+#define FLASH_LOG_MAX_RECORD      1024      ///< Largest payload, bytes
+
+#ifndef FLASH_LOG_STAGING_BYTES
+#define FLASH_LOG_STAGING_BYTES   2048      ///< Per staging buffer, two are used
+#endif
+#ifndef FLASH_LOG_FLUSH_MS
+#define FLASH_LOG_FLUSH_MS        2000      ///< Longest time a record stays in RAM
+#endif
+
+/**
+ * @brief Flash operations (partition or file image)
+ *
+ * Offsets are relative to the start of the log area.
+ */
+typedef struct {
+    esp_err_t (*read)(void *ctx, uint32_t offset, void *buf, size_t len);
+    esp_err_t (*write)(void *ctx, uint32_t offset, const void *buf, size_t len);
+    esp_err_t (*erase_sector)(void *ctx, uint32_t offset);
+    uint32_t size;          ///< Log area size, a multiple of FLASH_LOG_SECTOR_SIZE
+    void *ctx;
+} flash_log_backend_t;
+
+/**
+ * @brief Log counters
+ */
+typedef struct {
+    uint32_t appended;          ///< Records accepted by flash_log_append()
+    uint32_t dropped;           ///< Records refused, staging full or too large
+    uint32_t written;           ///< Records written to flash
+    uint32_t write_errors;      ///< Backend write/erase failures
+    uint32_t sectors_erased;
+    uint32_t generation;        ///< Generation of the sector being written
+    uint32_t write_sector;
+    uint32_t write_offset;
+    uint32_t torn_records;      ///< Damaged records found on mount
+    int64_t  mount_us;          ///< Time taken by the mount scan
+} flash_log_stats_t;
+
+/**
+ * @brief Read position for flash_log_iter_next()
+ */
+typedef struct {
+    uint32_t sectors_left;
+    uint32_t sector;
+    uint32_t offset;
+} flash_log_iter_t;
+
+/**
+ * @brief Mount the log: find the write position, formatting an empty area.
+ *
+ * @param[in] backend  Flash operations (copied).
+ * @return ESP_OK, ESP_ERR_INVALID_ARG, ESP_ERR_INVALID_STATE if the writer
+ *         runs, or the backend error.
+ */
+esp_err_t flash_log_mount(const flash_log_backend_t *backend);
+
+/**
+ * @brief Backend over a data partition.
+ *
+ * @param[in]  label  Partition label.
+ * @param[out] out    Backend.
+ * @return ESP_OK or ESP_ERR_NOT_FOUND.
+ */
+esp_err_t flash_log_partition_backend(const char *label, flash_log_backend_t *out);
+
+/**
+ * @brief Backend over an image file, created or grown with erased sectors.
+ *
+ * Emulates NOR flash: writes can only clear bits and erase sets a sector
+ * back to 0xFF, so torn writes and rewrites behave as on the chip.
+ *
+ * @param[in]  path  Image file.
+ * @param[in]  size  Log area size, a multiple of FLASH_LOG_SECTOR_SIZE (at least two sectors).
+ * @param[out] out   Backend, release it with flash_log_file_backend_close().
+ * @return ESP_OK, ESP_ERR_INVALID_ARG, ESP_ERR_NOT_FOUND if the file cannot
+ *         be opened, or ESP_FAIL on an I/O error.
+ */
+esp_err_t flash_log_file_backend(const char *path, uint32_t size, flash_log_backend_t *out);
+
+/**
+ * @brief Close the file of a backend made by flash_log_file_backend().
+ */
+void flash_log_file_backend_close(flash_log_backend_t *backend);
+
+/**
+ * @brief Start the writer task.
+ */
+esp_err_t flash_log_start(void);
+
+/**
+ * @brief Queue a record for writing. Never blocks.
+ *
+ * @param[in] data  Payload.
+ * @param[in] len   Payload size, 1..FLASH_LOG_MAX_RECORD.
+ * @return false if the record was dropped.
+ */
+bool flash_log_append(const void *data, size_t len);
+
+/**
+ * @brief Write the staged records now, in the caller's context.
+ *
+ * This is what the writer task runs; it is public so the log can be driven
+ * without the task.
+ */
+esp_err_t flash_log_flush(void);
+
+/**
+ * @brief Position an iterator at the oldest record.
+ */
+void flash_log_iter_init(flash_log_iter_t *it);
+
+/**
+ * @brief Read the next record, oldest first.
+ *
+ * @param[in,out] it       Iterator.
+ * @param[out]    buf      Payload destination.
+ * @param[in]     max_len  Capacity of buf, longer records are skipped.
+ * @param[out]    out_len  Payload size.
+ * @return false at the end of the log.
+ */
+bool flash_log_iter_next(flash_log_iter_t *it, void *buf, size_t max_len, size_t *out_len);
+
+/**
+ * @brief Snapshot the counters.
+ */
+void flash_log_get_stats(flash_log_stats_t *out);
+
+#endif // FLASH_LOG_H
@@ -0,0 +1,288 @@
+/**
+ * @file json_scan.c
+ * @author David Ramírez Betancourth
+ * @brief Incremental extraction of numeric fields from a JSON object
+ */
+
+#include "json_scan.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+    ST_START = 0,       // Before '{'
+    ST_KEY_OR_END,      // After '{': '"' or '}'
+    ST_KEY_NEXT,        // After ',': '"'
+    ST_KEY,
+    ST_KEY_ESC,
+    ST_COLON,
+    ST_VALUE,
+    ST_NUMBER,
+    ST_STRING,
+    ST_STRING_ESC,
+    ST_LITERAL,         // true/false/null
+    ST_NESTED,          // Inside a skipped object/array
+    ST_NESTED_STR,
+    ST_NESTED_ESC,
+    ST_AFTER_VALUE,     // ',' or '}'
+    ST_DONE,
+    ST_ERROR,
+};
+
+static inline bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static inline bool is_number_char(char c)
+{
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+// Key just closed: remember which requested key it is, if any
+static void key_done(json_scan_t *scan)
+{
+    scan->match = -1;
+    if (scan->key_escaped || scan->key_len >= JSON_SCAN_KEY_LEN) {
+        return;
+    }
+    scan->key[scan->key_len] = '\0';
+    for (size_t i = 0; i < scan->num_keys; i++) {
+        if (strcmp(scan->key, scan->keys[i]) == 0) {
+            scan->match = (int8_t)i;
+            return;
+        }
+    }
+}
+
+static bool number_done(json_scan_t *scan)
+{
+    char *end;
+
+    scan->num[scan->num_len] = '\0';
+    double value = strtod(scan->num, &end);
+    if (end != scan->num + scan->num_len) {
+        return false;
+    }
+    if (scan->match >= 0) {
+        scan->values[scan->match] = value;
+        scan->found |= 1u << scan->match;
+    }
+    return true;
+}
+
+static bool literal_done(json_scan_t *scan)
+{
+    scan->num[scan->num_len] = '\0';
+    return strcmp(scan->num, "true") == 0 || strcmp(scan->num, "false") == 0 || strcmp(scan->num, "null") == 0;
+}
+
+// Push a skipped container, kind bit 1 for '{'
+static bool nest_push(json_scan_t *scan, char c)
+{
+    if (scan->depth >= JSON_SCAN_MAX_DEPTH) {
+        return false;
+    }
+    if (c == '{') {
+        scan->nest_kinds |= (uint16_t)(1u << scan->depth);
+    } else {
+        scan->nest_kinds &= (uint16_t)~(1u << scan->depth);
+    }
+    scan->depth++;
+    return true;
+}
+
+static bool nest_pop(json_scan_t *scan, char c)
+{
+    bool is_obj = (scan->nest_kinds >> (scan->depth - 1)) & 1;
+
+    if (is_obj != (c == '}')) {
+        return false;
+    }
+    scan->depth--;
+    return true;
+}
+
+// One character, returns false if it must be looked at again in the new state
+static bool step(json_scan_t *scan, char c)
+{
+    switch (scan->state) {
+    case ST_START:
+        if (c == '{') {
+            scan->state = ST_KEY_OR_END;
+        } else if (!is_space(c)) {
+            scan->state = ST_ERROR;
+        }
+        return true;
+
+    case ST_KEY_OR_END:
+    case ST_KEY_NEXT:
+        if (c == '"') {
+            scan->key_len = 0;
+            scan->key_escaped = false;
+            scan->state = ST_KEY;
+        } else if (c == '}' && scan->state == ST_KEY_OR_END) {
+            scan->state = ST_DONE;
+        } else if (!is_space(c)) {
+            scan->state = ST_ERROR;
+        }
+        return true;
+
+    case ST_KEY:
+        if (c == '"') {
+            key_done(scan);
+            scan->state = ST_COLON;
+        } else if (c == '\\') {
+            scan->key_escaped = true;
+            scan->state = ST_KEY_ESC;
+        } else if ((unsigned char)c < 0x20) {
+            scan->state = ST_ERROR;
+        } else if (scan->key_len < JSON_SCAN_KEY_LEN) {
+            scan->key[scan->key_len++] = c;
+        }
+        return true;
+
+    case ST_KEY_ESC:
+        scan->state = ST_KEY;
+        return true;
+
+    case ST_COLON:
+        if (c == ':') {
+            scan->state = ST_VALUE;
+        } else if (!is_space(c)) {
+            scan->state = ST_ERROR;
+        }
+        return true;
+
+    case ST_VALUE:
+        scan->num_len = 0;
+        if (c == '-' || (c >= '0' && c <= '9')) {
+            scan->num[scan->num_len++] = c;
+            scan->state = ST_NUMBER;
+        } else if (c == '"') {
+            scan->state = ST_STRING;
+        } else if (c == 't' || c == 'f' || c == 'n') {
+            scan->num[scan->num_len++] = c;
+            scan->state = ST_LITERAL;
+        } else if (c == '{' || c == '[') {
+            scan->depth = 0;
+            nest_push(scan, c);
+            scan->state = ST_NESTED;
+        } else if (!is_space(c)) {
+            scan->state = ST_ERROR;
+        }
+        return true;
+
+    case ST_NUMBER:
+        if (is_number_char(c)) {
+            if (scan->num_len + 1 >= JSON_SCAN_NUM_LEN) {
+                scan->state = ST_ERROR;
+            } else {
+                scan->num[scan->num_len++] = c;
+            }
+            return true;
+        }
+        scan->state = number_done(scan) ? ST_AFTER_VALUE : ST_ERROR;
+        return false;
+
+    case ST_LITERAL:
+        if (c >= 'a' && c <= 'z') {
+            if (scan->num_len + 1 >= JSON_SCAN_NUM_LEN) {
+                scan->state = ST_ERROR;
+            } else {
+                scan->num[scan->num_len++] = c;
+            }
+            return true;
+        }
+        scan->state = literal_done(scan) ? ST_AFTER_VALUE : ST_ERROR;
+        return false;
+
+    case ST_STRING:
+        if (c == '"') {
+            scan->state = ST_AFTER_VALUE;
+        } else if (c == '\\') {
+            scan->state = ST_STRING_ESC;
+        } else if ((unsigned char)c < 0x20) {
+            scan->state = ST_ERROR;
+        }
+        return true;
+
+    case ST_STRING_ESC:
+        scan->state = ST_STRING;
+        return true;
+
+    case ST_NESTED:
+        if (c == '"') {
+            scan->state = ST_NESTED_STR;
+        } else if (c == '{' || c == '[') {
+            if (!nest_push(scan, c)) {
+                scan->state = ST_ERROR;
+            }
+        } else if (c == '}' || c == ']') {
+            if (!nest_pop(scan, c)) {
+                scan->state = ST_ERROR;
+            } else if (scan->depth == 0) {
+                scan->state = ST_AFTER_VALUE;
+            }
+        }
+        return true;
+
+    case ST_NESTED_STR:
+        if (c == '"') {
+            scan->state = ST_NESTED;
+        } else if (c == '\\') {
+            scan->state = ST_NESTED_ESC;
+        }
+        return true;
+
+    case ST_NESTED_ESC:
+        scan->state = ST_NESTED_STR;
+        return true;
+
+    case ST_AFTER_VALUE:
+        if (c == ',') {
+            scan->state = ST_KEY_NEXT;
+        } else if (c == '}') {
+            scan->state = ST_DONE;
+        } else if (!is_space(c)) {
+            scan->state = ST_ERROR;
+        }
+        return true;
+
+    case ST_DONE:
+        if (!is_space(c)) {
+            scan->state = ST_ERROR;
+        }
+        return true;
+
+    default:
+        return true;
+    }
+}
+
+//-----------------------------------API-------------------------------------------
+
+void json_scan_init(json_scan_t *scan, const char *const *keys, size_t num_keys, double *values)
+{
+    memset(scan, 0, sizeof(*scan));
+    scan->keys = keys;
+    scan->num_keys = num_keys > JSON_SCAN_MAX_KEYS ? JSON_SCAN_MAX_KEYS : num_keys;
+    scan->values = values;
+    scan->match = -1;
+    scan->state = ST_START;
+}
+
+bool json_scan_feed(json_scan_t *scan, const char *data, size_t len)
+{
+    for (size_t i = 0; i < len && scan->state != ST_ERROR; ) {
+        if (step(scan, data[i])) {
+            i++;
+        }
+    }
+    return scan->state != ST_ERROR;
+}
+
+bool json_scan_finish(json_scan_t *scan)
+{
+    return scan->state == ST_DONE;
+}
@@ -0,0 +1,76 @@
+/**
+ * @file json_scan.h
+ * @author David Ramírez Betancourth
+ * @brief Incremental extraction of numeric fields from a JSON object, header
+ *
+ * Validates the structure of one JSON object fed in arbitrary chunks and
+ * picks the numbers of the requested top-level keys, without building a
+ * tree or allocating. Strings, literals, nested objects and arrays are
+ * skipped. Keys longer than JSON_SCAN_KEY_LEN - 1 or containing escapes
+ * never match. Memory is fixed and the work is linear in the input.
+ */
+
+#ifndef JSON_SCAN_H
+#define JSON_SCAN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define JSON_SCAN_KEY_LEN     24
+#define JSON_SCAN_NUM_LEN     32
+#define JSON_SCAN_MAX_KEYS    8
+#define JSON_SCAN_MAX_DEPTH   16
+
+/**
+ * @brief Scanner state
+ */
+typedef struct {
+    const char *const *keys;
+    size_t num_keys;
+    double *values;
+    uint32_t found;         ///< Bit i set once keys[i] was read as a number
+    uint8_t state;
+    uint8_t depth;          // Nesting inside a skipped value
+    uint16_t nest_kinds;    // Bit per nesting level, 1 for '{'
+    uint8_t key_len;
+    uint8_t num_len;
+    bool key_escaped;
+    int8_t match;           // Index of the key whose value comes next, -1 if none
+    char key[JSON_SCAN_KEY_LEN];
+    char num[JSON_SCAN_NUM_LEN];
+} json_scan_t;
+
+/**
+ * @brief Start scanning an object.
+ *
+ * @param[out] scan      Scanner.
+ * @param[in]  keys      Top-level keys to extract, up to JSON_SCAN_MAX_KEYS.
+ * @param[in]  num_keys  Number of keys.
+ * @param[out] values    values[i] receives the number of keys[i]; untouched if absent.
+ */
+void json_scan_init(json_scan_t *scan, const char *const *keys, size_t num_keys, double *values);
+
+/**
+ * @brief Feed the next chunk.
+ *
+ * @return false on a syntax error (the scanner then stays failed).
+ */
+bool json_scan_feed(json_scan_t *scan, const char *data, size_t len);
+
+/**
+ * @brief End of input.
+ *
+ * @return true if exactly one complete object was read.
+ */
+bool json_scan_finish(json_scan_t *scan);
+
+/**
+ * @brief Whether keys[index] was found with a numeric value.
+ */
+static inline bool json_scan_found(const json_scan_t *scan, size_t index)
+{
+    return (scan->found >> index) & 1;
+}
+
+#endif // JSON_SCAN_H
@@ -0,0 +1,237 @@
+/**
+ * @file json_writer.c
+ * @author David Ramírez Betancourth
+ * @brief Streaming JSON writer into a caller buffer
+ */
+
+#include "json_writer.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static const uint32_t pow10_u32[] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+
+//-----------------------------------Output----------------------------------------
+
+// One byte is always kept for the terminator
+static inline void put_char(json_writer_t *w, char c)
+{
+    if (w->len + 1 < w->cap) {
+        w->buf[w->len++] = c;
+    } else {
+        w->overflow = true;
+    }
+}
+
+static void put_raw(json_writer_t *w, const char *s, size_t n)
+{
+    if (w->len + n < w->cap) {
+        memcpy(w->buf + w->len, s, n);
+        w->len += n;
+    } else {
+        w->overflow = true;
+    }
+}
+
+// Digits of v, right-aligned in out[20], returns the first used index
+static size_t format_u64(uint64_t v, char out[20])
+{
+    size_t pos = 20;
+
+    do {
+        out[--pos] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    return pos;
+}
+
+// Comma before a value when its container already has one
+static void value_prefix(json_writer_t *w)
+{
+    if (w->after_key) {
+        w->after_key = false;
+        return;
+    }
+    if (w->depth > 0) {
+        uint32_t bit = 1u << (w->depth - 1);
+        if (w->has_items & bit) {
+            put_char(w, ',');
+        }
+        w->has_items |= bit;
+    }
+}
+
+static void open_container(json_writer_t *w, char c)
+{
+    value_prefix(w);
+    if (w->depth >= JSON_WRITER_MAX_DEPTH) {
+        w->overflow = true;
+        return;
+    }
+    put_char(w, c);
+    w->depth++;
+    w->has_items &= ~(1u << (w->depth - 1));
+}
+
+static void close_container(json_writer_t *w, char c)
+{
+    if (w->depth == 0) {
+        w->overflow = true;
+        return;
+    }
+    put_char(w, c);
+    w->depth--;
+}
+
+//-----------------------------------API-------------------------------------------
+
+void json_writer_init(json_writer_t *w, char *buf, size_t cap)
+{
+    memset(w, 0, sizeof(*w));
+    w->buf = buf;
+    w->cap = buf ? cap : 0;
+}
+
+void json_obj_begin(json_writer_t *w)
+{
+    open_container(w, '{');
+}
+
+void json_obj_end(json_writer_t *w)
+{
+    close_container(w, '}');
+}
+
+void json_arr_begin(json_writer_t *w)
+{
+    open_container(w, '[');
+}
+
+void json_arr_end(json_writer_t *w)
+{
+    close_container(w, ']');
+}
+
+void json_key(json_writer_t *w, const char *key)
+{
+    value_prefix(w);
+    put_char(w, '"');
+    put_raw(w, key, strlen(key));
+    put_raw(w, "\":", 2);
+    w->after_key = true;
+}
+
+void json_str(json_writer_t *w, const char *value)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    value_prefix(w);
+    put_char(w, '"');
+    for (const unsigned char *p = (const unsigned char *)value; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            put_char(w, '\\');
+            put_char(w, (char)*p);
+        } else if (*p < 0x20) {
+            char esc[6] = {'\\', 'u', '0', '0', hex[*p >> 4], hex[*p & 0xF]};
+            put_raw(w, esc, sizeof(esc));
+        } else {
+            put_char(w, (char)*p);
+        }
+    }
+    put_char(w, '"');
+}
+
+void json_int(json_writer_t *w, int64_t value)
+{
+    char digits[20];
+    uint64_t mag = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+    size_t pos = format_u64(mag, digits);
+
+    value_prefix(w);
+    if (value < 0) {
+        put_char(w, '-');
+    }
+    put_raw(w, digits + pos, 20 - pos);
+}
+
+void json_bool(json_writer_t *w, bool value)
+{
+    value_prefix(w);
+    if (value) {
+        put_raw(w, "true", 4);
+    } else {
+        put_raw(w, "false", 5);
+    }
+}
+
+void json_null(json_writer_t *w)
+{
+    value_prefix(w);
+    put_raw(w, "null", 4);
+}
+
+void json_float(json_writer_t *w, float value, int decimals)
+{
+    if (!isfinite(value)) {
+        json_null(w);
+        return;
+    }
+    if (decimals < 0) {
+        decimals = 0;
+    } else if (decimals > 6) {
+        decimals = 6;
+    }
+
+    // Beyond this the scaled value does not fit llround()'s long long
+    uint32_t unit = pow10_u32[decimals];
+    double mag = fabs((double)value);
+    if (mag >= 9.2e18 / unit) {
+        char tmp[32];
+        int n = snprintf(tmp, sizeof(tmp), "%.*g", 9, (double)value);
+        value_prefix(w);
+        put_raw(w, tmp, (size_t)n);
+        return;
+    }
+
+    // Round once on the scaled value so 0.995 -> "1.00" carries correctly
+    uint64_t scaled = (uint64_t)llround(mag * unit);
+    uint64_t int_part = scaled / unit;
+    uint32_t frac = (uint32_t)(scaled % unit);
+    char digits[20];
+    size_t pos = format_u64(int_part, digits);
+
+    value_prefix(w);
+    if (value < 0 && scaled != 0) {
+        put_char(w, '-');
+    }
+    put_raw(w, digits + pos, 20 - pos);
+    if (decimals > 0) {
+        char frac_digits[7];
+        frac_digits[0] = '.';
+        for (int i = decimals; i > 0; i--) {
+            frac_digits[i] = (char)('0' + frac % 10);
+            frac /= 10;
+        }
+        put_raw(w, frac_digits, (size_t)decimals + 1);
+    }
+}
+
+const char *json_writer_finish(json_writer_t *w, size_t *len)
+{
+    if (w->cap == 0 || w->overflow || w->depth != 0) {
+        if (w->cap > 0) {
+            w->buf[0] = '\0';
+        }
+        if (len) {
+            *len = 0;
+        }
+        return NULL;
+    }
+
+    w->buf[w->len] = '\0';
+    if (len) {
+        *len = w->len;
+    }
+    return w->buf;
+}
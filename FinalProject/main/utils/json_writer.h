@@ -0,0 +1,100 @@
+/**
+ * @file json_writer.h
+ * @author David Ramírez Betancourth
+ * @brief Streaming JSON writer into a caller buffer, header
+ *
+ * Writes compact JSON straight into a fixed buffer, usually on the stack,
+ * without touching the heap. Commas are inserted automatically; nesting
+ * is tracked in a bitmask up to JSON_WRITER_MAX_DEPTH levels. Running out
+ * of space (or nesting) sets an overflow flag that sticks, so the calls
+ * need no individual checks; json_writer_finish() reports the outcome.
+ *
+ * Floats are printed with a fixed number of decimals using integer
+ * arithmetic, NaN and infinities as null.
+ */
+
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define JSON_WRITER_MAX_DEPTH 16
+
+/**
+ * @brief Writer state
+ */
+typedef struct {
+    char *buf;
+    size_t cap;
+    size_t len;
+    uint32_t has_items;     // Bit per nesting level: a value was already written
+    uint8_t depth;
+    bool after_key;         // Next value follows a key, no comma
+    bool overflow;
+} json_writer_t;
+
+/**
+ * @brief Start writing into buf.
+ *
+ * @param[out] w    Writer.
+ * @param[in]  buf  Output buffer, NUL terminated by json_writer_finish().
+ * @param[in]  cap  Capacity including the terminator.
+ */
+void json_writer_init(json_writer_t *w, char *buf, size_t cap);
+
+void json_obj_begin(json_writer_t *w);
+void json_obj_end(json_writer_t *w);
+void json_arr_begin(json_writer_t *w);
+void json_arr_end(json_writer_t *w);
+
+/**
+ * @brief Object key, the next call writes its value. Keys are not escaped.
+ */
+void json_key(json_writer_t *w, const char *key);
+
+/**
+ * @brief String value, escaping quotes, backslashes and control characters.
+ */
+void json_str(json_writer_t *w, const char *value);
+void json_int(json_writer_t *w, int64_t value);
+void json_bool(json_writer_t *w, bool value);
+void json_null(json_writer_t *w);
+
+/**
+ * @brief Float value with a fixed number of decimals (0-6), trailing
+ * zeros kept. Values too large for the integer path (|value| * 10^decimals
+ * of 9.2e18 or more) fall back to snprintf("%.9g").
+ */
+void json_float(json_writer_t *w, float value, int decimals);
+
+// Key/value shorthands
+static inline void json_kv_int(json_writer_t *w, const char *key, int64_t value)
+{
+    json_key(w, key);
+    json_int(w, value);
+}
+
+static inline void json_kv_float(json_writer_t *w, const char *key, float value, int decimals)
+{
+    json_key(w, key);
+    json_float(w, value, decimals);
+}
+
+static inline void json_kv_str(json_writer_t *w, const char *key, const char *value)
+{
+    json_key(w, key);
+    json_str(w, value);
+}
+
+/**
+ * @brief Terminate the output.
+ *
+ * @param[in]  w    Writer.
+ * @param[out] len  Length without the terminator, may be NULL.
+ * @return The buffer, NULL if it overflowed or objects are left open.
+ */
+const char *json_writer_finish(json_writer_t *w, size_t *len);
+
+#endif // JSON_WRITER_H
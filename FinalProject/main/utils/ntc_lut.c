@@ -0,0 +1,81 @@
+/**
+ * @file ntc_lut.c
+ * @author David Ramírez Betancourth
+ * @brief NTC raw-code to temperature lookup table
+ */
+
+#include "ntc_lut.h"
+
+#include <math.h>
+
+bool ntc_voltage_to_celsius(const ntc_params_t *params, int voltage_mv, float *out_celsius)
+{
+    float Vo = (float)voltage_mv / 1000.0f; // Convert mV to Volts (voltage across r_fixed)
+
+    // Rt = R2 * (Vi - Vo) / Vo, avoid division by zero and negative resistance
+    if (Vo <= 0 || params->v_in <= Vo) {
+        return false;
+    }
+    float Rt = (params->r_fixed * (params->v_in - Vo)) / Vo;
+
+    // Steinhart-Hart equation (Beta approximation)
+    float T = (params->beta * params->t0) / (logf(Rt / params->r0) * params->t0 + params->beta);
+    *out_celsius = T - 273.15f; // Convert Kelvin to Celsius
+    return true;
+}
+
+void ntc_lut_build(ntc_lut_t *lut, const ntc_params_t *params, adc_channel_handle_t handle)
+{
+    if (!lut || !params) {
+        return;
+    }
+
+    int voltage_mv[NTC_LUT_KNOTS];
+
+    for (int k = 0; k < NTC_LUT_KNOTS; k++) {
+        voltage_mv[k] = k << NTC_LUT_STEP_BITS;
+    }
+    raw_to_voltage_block(handle, voltage_mv, voltage_mv, NTC_LUT_KNOTS);
+
+    // The last knot sits one step past full scale, which the driver refuses;
+    // extend the last segment so the top 16 codes still convert
+    const int last = NTC_LUT_KNOTS - 1;
+    if (voltage_mv[last] < 0 && voltage_mv[last - 1] >= 0 && voltage_mv[last - 2] >= 0) {
+        voltage_mv[last] = 2 * voltage_mv[last - 1] - voltage_mv[last - 2];
+    }
+
+    for (int k = 0; k < NTC_LUT_KNOTS; k++) {
+        float celsius = 0;
+
+        if (voltage_mv[k] >= 0 && ntc_voltage_to_celsius(params, voltage_mv[k], &celsius)) {
+            lut->mdeg[k] = (int32_t)lrintf(celsius * 1000.0f);
+        } else {
+            lut->mdeg[k] = NTC_LUT_INVALID;
+        }
+    }
+}
+
+bool ntc_lut_lookup_q(const ntc_lut_t *lut, int32_t code_q, unsigned frac_bits, int32_t *out_mdeg)
+{
+    if (frac_bits > 16 || code_q < 0 || code_q >= ((int32_t)1 << (NTC_LUT_CODE_BITS + frac_bits))) {
+        return false;
+    }
+
+    const unsigned shift = NTC_LUT_STEP_BITS + frac_bits;
+    int idx = code_q >> shift;
+    int64_t frac = code_q & (((int32_t)1 << shift) - 1);
+    int32_t k0 = lut->mdeg[idx];
+    int32_t k1 = lut->mdeg[idx + 1];
+
+    if (k0 == NTC_LUT_INVALID || k1 == NTC_LUT_INVALID) {
+        return false;
+    }
+
+    *out_mdeg = k0 + (int32_t)(((k1 - k0) * frac + ((int64_t)1 << (shift - 1))) >> shift);
+    return true;
+}
+
+bool ntc_lut_lookup(const ntc_lut_t *lut, int raw, int32_t *out_mdeg)
+{
+    return ntc_lut_lookup_q(lut, raw, 0, out_mdeg);
+}
@@ -0,0 +1,90 @@
+/**
+ * @file ntc_lut.h
+ * @author David Ramírez Betancourth
+ * @brief NTC raw-code to temperature lookup table, header
+ *
+ * The beta model (divide plus logf) is evaluated once per table knot at
+ * startup. Samples are then converted with an integer interpolation
+ * between the two neighbouring knots.
+ */
+
+#ifndef NTC_LUT_H
+#define NTC_LUT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "adc_utils.h"
+
+#define NTC_LUT_CODE_BITS  12                                           ///< ADC code width
+#define NTC_LUT_STEP_BITS  4                                            ///< One knot every 16 codes
+#define NTC_LUT_KNOTS      ((1 << (NTC_LUT_CODE_BITS - NTC_LUT_STEP_BITS)) + 1)
+#define NTC_LUT_INVALID    INT32_MIN                                    ///< Knot outside the divider range
+
+/**
+ * @brief NTC voltage divider and beta model constants
+ *
+ * The NTC is the upper resistor, the ADC measures the voltage across r_fixed.
+ */
+typedef struct {
+    float beta;     ///< Beta value of the NTC
+    float r0;       ///< NTC resistance at t0 (Ohm)
+    float t0;       ///< Reference temperature (K)
+    float r_fixed;  ///< Lower divider resistor (Ohm)
+    float v_in;     ///< Divider supply (V)
+} ntc_params_t;
+
+/**
+ * @brief Table of temperatures in milli-degrees Celsius, one per knot
+ */
+typedef struct {
+    int32_t mdeg[NTC_LUT_KNOTS];
+} ntc_lut_t;
+
+/**
+ * @brief Reference beta-model conversion (float, uses logf).
+ *
+ * @param[in]  params       Divider and NTC constants.
+ * @param[in]  voltage_mv   Voltage across r_fixed in mV.
+ * @param[out] out_celsius  Temperature in °C.
+ * @return false when the voltage is outside the valid divider range.
+ */
+bool ntc_voltage_to_celsius(const ntc_params_t *params, int voltage_mv, float *out_celsius);
+
+/**
+ * @brief Build the table for one ADC channel.
+ *
+ * Each knot code goes through the channel calibration and then through
+ * ntc_voltage_to_celsius().
+ *
+ * @param[out] lut     Table to fill.
+ * @param[in]  params  Divider and NTC constants.
+ * @param[in]  handle  Calibrated ADC channel the codes come from.
+ */
+void ntc_lut_build(ntc_lut_t *lut, const ntc_params_t *params, adc_channel_handle_t handle);
+
+/**
+ * @brief Convert a raw ADC code to temperature.
+ *
+ * @param[in]  lut       Table built with ntc_lut_build().
+ * @param[in]  raw       Raw ADC code (0..4095).
+ * @param[out] out_mdeg  Temperature in milli-degrees Celsius.
+ * @return false if the code falls next to an invalid knot.
+ */
+bool ntc_lut_lookup(const ntc_lut_t *lut, int raw, int32_t *out_mdeg);
+
+/**
+ * @brief Convert a fixed-point ADC code to temperature.
+ *
+ * Same as ntc_lut_lookup() for codes that carry fractional bits, e.g. the
+ * output of an oversampling decimator.
+ *
+ * @param[in]  lut        Table built with ntc_lut_build().
+ * @param[in]  code_q     ADC code << frac_bits.
+ * @param[in]  frac_bits  Fractional bits of code_q (0..16).
+ * @param[out] out_mdeg   Temperature in milli-degrees Celsius.
+ * @return false if the code falls next to an invalid knot.
+ */
+bool ntc_lut_lookup_q(const ntc_lut_t *lut, int32_t code_q, unsigned frac_bits, int32_t *out_mdeg);
+
+#endif // NTC_LUT_H
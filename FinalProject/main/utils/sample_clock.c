@@ -0,0 +1,166 @@
+/**
+ * @file sample_clock.c
+ * @author David Ramírez Betancourth
+ * @brief Deadline driven periodic scheduler on esp_timer
+ */
+
+#include "sample_clock.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+typedef struct {
+    sample_clock_cb_t cb;
+    void *user_ctx;
+    int64_t deadline_us;
+    sample_clock_stats_t stats;
+} sample_clock_job_t;
+
+static sample_clock_job_t clock_jobs[SAMPLE_CLOCK_MAX_JOBS];
+static int clock_num_jobs = 0;
+static portMUX_TYPE clock_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static esp_timer_handle_t clock_timer = NULL;
+static volatile bool clock_running = false;
+
+//-----------------------------------Scheduling------------------------------------
+
+int64_t sample_clock_run_due(int64_t now_us)
+{
+    int64_t next = INT64_MAX;
+
+    for (int i = 0; i < clock_num_jobs; i++) {
+        sample_clock_job_t *job = &clock_jobs[i];
+        int64_t period = job->stats.period_us;
+
+        if (now_us >= job->deadline_us) {
+            int64_t late = now_us - job->deadline_us;
+            int64_t lost = late / period;
+
+            // Stay on the start + k * period grid, whatever happened
+            job->deadline_us += (lost + 1) * period;
+
+            job->cb(job->user_ctx);
+
+            taskENTER_CRITICAL(&clock_stats_lock);
+            job->stats.fired++;
+            job->stats.missed += lost;
+            if (late > job->stats.max_late_us) {
+                job->stats.max_late_us = late;
+            }
+            taskEXIT_CRITICAL(&clock_stats_lock);
+        }
+
+        if (job->deadline_us < next) {
+            next = job->deadline_us;
+        }
+    }
+
+    return next;
+}
+
+static void clock_timer_cb(void *arg)
+{
+    int64_t next = sample_clock_run_due(esp_timer_get_time());
+
+    if (!clock_running) {
+        return;
+    }
+
+    int64_t wait = next - esp_timer_get_time();
+    esp_timer_start_once(clock_timer, wait > 0 ? wait : 1);
+}
+
+//-----------------------------------API-------------------------------------------
+
+esp_err_t sample_clock_add(int64_t period_us, sample_clock_cb_t cb, void *user_ctx, int *out_id)
+{
+    if (clock_running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!cb || period_us < SAMPLE_CLOCK_MIN_PERIOD_US) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (clock_num_jobs >= SAMPLE_CLOCK_MAX_JOBS) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    sample_clock_job_t *job = &clock_jobs[clock_num_jobs];
+    memset(job, 0, sizeof(*job));
+    job->cb = cb;
+    job->user_ctx = user_ctx;
+    job->stats.period_us = period_us;
+
+    if (out_id) {
+        *out_id = clock_num_jobs;
+    }
+    clock_num_jobs++;
+    return ESP_OK;
+}
+
+esp_err_t sample_clock_start(void)
+{
+    esp_err_t err;
+
+    if (clock_running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (clock_num_jobs == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!clock_timer) {
+        const esp_timer_create_args_t timer_args = {
+            .callback = clock_timer_cb,
+            .arg = NULL,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "sample_clock",
+        };
+        err = esp_timer_create(&timer_args, &clock_timer);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    int64_t base = esp_timer_get_time();
+    int64_t first = INT64_MAX;
+    for (int i = 0; i < clock_num_jobs; i++) {
+        clock_jobs[i].deadline_us = base + clock_jobs[i].stats.period_us;
+        if (clock_jobs[i].deadline_us < first) {
+            first = clock_jobs[i].deadline_us;
+        }
+    }
+
+    clock_running = true;
+    err = esp_timer_start_once(clock_timer, first - base);
+    if (err != ESP_OK) {
+        clock_running = false;
+    }
+    return err;
+}
+
+esp_err_t sample_clock_stop(void)
+{
+    if (!clock_running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    clock_running = false;
+    esp_timer_stop(clock_timer); // Not armed if the callback is running, that is fine
+    return ESP_OK;
+}
+
+void sample_clock_get_stats(int id, sample_clock_stats_t *out)
+{
+    if (id < 0 || id >= clock_num_jobs) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+
+    taskENTER_CRITICAL(&clock_stats_lock);
+    *out = clock_jobs[id].stats;
+    taskEXIT_CRITICAL(&clock_stats_lock);
+}
@@ -0,0 +1,78 @@
+/**
+ * @file sample_clock.h
+ * @author David Ramírez Betancourth
+ * @brief Deadline driven periodic scheduler on esp_timer, header
+ *
+ * Runs any number of periodic jobs off a single one-shot esp_timer that is
+ * re-armed for the earliest pending deadline. Deadlines are absolute
+ * (start + k * period), so execution time never accumulates into drift.
+ * A job that falls a whole period behind skips the lost ticks, keeps its
+ * phase and counts them as missed.
+ */
+
+#ifndef SAMPLE_CLOCK_H
+#define SAMPLE_CLOCK_H
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#define SAMPLE_CLOCK_MAX_JOBS       4
+#define SAMPLE_CLOCK_MIN_PERIOD_US  100
+
+/**
+ * @brief Job callback
+ *
+ * Runs in the esp_timer task, keep it short: notifying the task that does
+ * the actual work is the intended use.
+ */
+typedef void (*sample_clock_cb_t)(void *user_ctx);
+
+/**
+ * @brief Job counters
+ */
+typedef struct {
+    int64_t  period_us;
+    uint64_t fired;         ///< Callbacks made
+    uint64_t missed;        ///< Deadlines skipped because a whole period was lost
+    int64_t  max_late_us;   ///< Worst lateness of a callback against its deadline
+} sample_clock_stats_t;
+
+/**
+ * @brief Add a periodic job. Only allowed while the clock is stopped.
+ *
+ * @param[in]  period_us  Period, at least SAMPLE_CLOCK_MIN_PERIOD_US.
+ * @param[in]  cb         Callback.
+ * @param[in]  user_ctx   Passed back to cb.
+ * @param[out] out_id     Job index, may be NULL.
+ * @return ESP_OK, ESP_ERR_INVALID_ARG, ESP_ERR_NO_MEM or ESP_ERR_INVALID_STATE.
+ */
+esp_err_t sample_clock_add(int64_t period_us, sample_clock_cb_t cb, void *user_ctx, int *out_id);
+
+/**
+ * @brief Start the clock, every job first fires one period from now.
+ */
+esp_err_t sample_clock_start(void);
+
+/**
+ * @brief Stop the clock.
+ */
+esp_err_t sample_clock_stop(void);
+
+/**
+ * @brief Run the jobs that are due at now_us.
+ *
+ * This is what the timer callback runs. It is public so the scheduling can
+ * be simulated with a synthetic clock.
+ *
+ * @param[in] now_us  Current time.
+ * @return Earliest pending deadline.
+ */
+int64_t sample_clock_run_due(int64_t now_us);
+
+/**
+ * @brief Snapshot the counters of one job (zeroed if id is out of range).
+ */
+void sample_clock_get_stats(int id, sample_clock_stats_t *out);
+
+#endif // SAMPLE_CLOCK_H
@@ -0,0 +1,226 @@
+/**
+ * @file sample_codec.c
+ * @author David Ramírez Betancourth
+ * @brief Compact binary encoding of timestamped sample series
+ */
+
+#include "sample_codec.h"
+
+#include <math.h>
+#include <string.h>
+
+//-----------------------------------Varints---------------------------------------
+
+static inline uint64_t zigzag(int64_t v)
+{
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t v)
+{
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+// Time deltas wrap instead of overflowing: the decoder undoes the same
+// wrapping, and a corrupt stream cannot cause undefined behaviour
+static inline int64_t wrap_add(int64_t a, int64_t b)
+{
+    return (int64_t)((uint64_t)a + (uint64_t)b);
+}
+
+static inline int64_t wrap_sub(int64_t a, int64_t b)
+{
+    return (int64_t)((uint64_t)a - (uint64_t)b);
+}
+
+static size_t varint_put(uint8_t *out, uint64_t v)
+{
+    size_t n = 0;
+
+    while (v >= 0x80) {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+static bool varint_get(sample_codec_dec_t *dec, uint64_t *out)
+{
+    uint64_t v = 0;
+
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        if (dec->pos >= dec->len) {
+            return false;
+        }
+        uint8_t byte = dec->buf[dec->pos++];
+        v |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *out = v;
+            return true;
+        }
+    }
+    return false; // Longer than 10 bytes
+}
+
+//-----------------------------------Values----------------------------------------
+
+static inline uint32_t value_bits(float value, uint32_t scale)
+{
+    if (scale == 0) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    float q = roundf(value * (float)scale);
+    if (!(q > (float)INT32_MIN)) {      // Also catches NaN
+        return (uint32_t)INT32_MIN;
+    }
+    if (q >= (float)INT32_MAX) {
+        return (uint32_t)INT32_MAX;
+    }
+    return (uint32_t)(int32_t)q;
+}
+
+static inline float value_from_bits(uint32_t bits, uint32_t scale)
+{
+    if (scale == 0) {
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    return (float)(int32_t)bits / (float)scale;
+}
+
+//-----------------------------------Encoder---------------------------------------
+
+bool sample_codec_enc_init(sample_codec_enc_t *enc, uint8_t *buf, size_t cap, uint32_t time_unit_us, uint32_t scale)
+{
+    memset(enc, 0, sizeof(*enc));
+
+    if (!buf || cap < SAMPLE_CODEC_MAX_HEADER || time_unit_us == 0) {
+        return false;
+    }
+
+    enc->buf = buf;
+    enc->cap = cap;
+    enc->time_unit_us = time_unit_us;
+    enc->scale = scale;
+
+    enc->len = varint_put(buf, SAMPLE_CODEC_VERSION);
+    enc->len += varint_put(buf + enc->len, time_unit_us);
+    enc->len += varint_put(buf + enc->len, scale);
+    return true;
+}
+
+bool sample_codec_enc_put(sample_codec_enc_t *enc, int64_t timestamp_us, float value)
+{
+    uint8_t tmp[SAMPLE_CODEC_MAX_SAMPLE];
+    size_t n;
+
+    if (!enc->buf) {
+        return false;
+    }
+
+    int64_t t = timestamp_us / enc->time_unit_us;
+    uint32_t v = value_bits(value, enc->scale);
+    int64_t dt = wrap_sub(t, enc->prev_t);
+
+    if (enc->count == 0) {
+        n = varint_put(tmp, zigzag(t));
+    } else if (enc->count == 1) {
+        n = varint_put(tmp, zigzag(dt));
+    } else {
+        n = varint_put(tmp, zigzag(wrap_sub(dt, enc->prev_dt)));
+    }
+
+    if (enc->scale == 0) {
+        n += varint_put(tmp + n, v ^ enc->prev_v);
+    } else {
+        n += varint_put(tmp + n, zigzag((int64_t)(int32_t)v - (int64_t)(int32_t)enc->prev_v));
+    }
+
+    if (enc->len + n > enc->cap) {
+        return false;
+    }
+    memcpy(enc->buf + enc->len, tmp, n);
+    enc->len += n;
+
+    enc->prev_dt = (enc->count == 0) ? 0 : dt;
+    enc->prev_t = t;
+    enc->prev_v = v;
+    enc->count++;
+    return true;
+}
+
+//-----------------------------------Decoder---------------------------------------
+
+bool sample_codec_dec_init(sample_codec_dec_t *dec, const uint8_t *buf, size_t len)
+{
+    uint64_t version;
+    uint64_t unit;
+    uint64_t scale;
+
+    memset(dec, 0, sizeof(*dec));
+    dec->buf = buf;
+    dec->len = buf ? len : 0;
+
+    if (!varint_get(dec, &version) || version != SAMPLE_CODEC_VERSION ||
+        !varint_get(dec, &unit) || unit == 0 || unit > UINT32_MAX ||
+        !varint_get(dec, &scale) || scale > UINT32_MAX) {
+        dec->error = true;
+        return false;
+    }
+
+    dec->time_unit_us = (uint32_t)unit;
+    dec->scale = (uint32_t)scale;
+    return true;
+}
+
+bool sample_codec_dec_next(sample_codec_dec_t *dec, int64_t *timestamp_us, float *value)
+{
+    uint64_t t_raw;
+    uint64_t v_raw;
+
+    if (dec->error || dec->pos >= dec->len) {
+        return false;
+    }
+    if (!varint_get(dec, &t_raw) || !varint_get(dec, &v_raw)) {
+        dec->error = true;
+        return false;
+    }
+
+    int64_t t;
+    if (dec->count == 0) {
+        t = unzigzag(t_raw);
+        dec->prev_dt = 0;
+    } else if (dec->count == 1) {
+        dec->prev_dt = unzigzag(t_raw);
+        t = wrap_add(dec->prev_t, dec->prev_dt);
+    } else {
+        dec->prev_dt = wrap_add(dec->prev_dt, unzigzag(t_raw));
+        t = wrap_add(dec->prev_t, dec->prev_dt);
+    }
+
+    int64_t t_max = INT64_MAX / dec->time_unit_us;
+    if (t > t_max || t < -t_max) {
+        dec->error = true;  // Not representable in microseconds
+        return false;
+    }
+
+    uint32_t v;
+    if (dec->scale == 0) {
+        v = (uint32_t)v_raw ^ dec->prev_v;
+    } else {
+        v = (uint32_t)(int32_t)((int64_t)(int32_t)dec->prev_v + unzigzag(v_raw));
+    }
+
+    dec->prev_t = t;
+    dec->prev_v = v;
+    dec->count++;
+
+    *timestamp_us = t * dec->time_unit_us;
+    *value = value_from_bits(v, dec->scale);
+    return true;
+}
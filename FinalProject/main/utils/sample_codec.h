@@ -0,0 +1,102 @@
+/**
+ * @file sample_codec.h
+ * @author David Ramírez Betancourth
+ * @brief Compact binary encoding of timestamped sample series, header
+ *
+ * Stream layout, all integers as LEB128 varints:
+ *
+ *   version, time_unit_us, scale, then per sample: time, value
+ *
+ * Times are counted in time_unit_us. The first sample stores its time,
+ * the second the delta to the first and the following ones the change of
+ * that delta (delta-of-delta), zig-zag encoded: a steady rate costs one
+ * byte per sample. With scale > 0 values are stored as round(value * scale)
+ * deltas, zig-zag encoded; with scale 0 the float bits are stored XORed
+ * with the previous ones, which is lossless.
+ */
+
+#ifndef SAMPLE_CODEC_H
+#define SAMPLE_CODEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SAMPLE_CODEC_VERSION      1
+#define SAMPLE_CODEC_MAX_SAMPLE   20    ///< Worst case bytes of one encoded sample
+#define SAMPLE_CODEC_MAX_HEADER   11
+
+/**
+ * @brief Encoder state
+ */
+typedef struct {
+    uint8_t *buf;
+    size_t cap;
+    size_t len;
+    uint32_t time_unit_us;
+    uint32_t scale;
+    uint32_t count;
+    int64_t prev_t;
+    int64_t prev_dt;
+    uint32_t prev_v;        // Fixed-point value, or float bits when scale is 0
+} sample_codec_enc_t;
+
+/**
+ * @brief Decoder state
+ */
+typedef struct {
+    const uint8_t *buf;
+    size_t len;
+    size_t pos;
+    uint32_t time_unit_us;
+    uint32_t scale;
+    uint32_t count;
+    int64_t prev_t;
+    int64_t prev_dt;
+    uint32_t prev_v;
+    bool error;             ///< Set on a malformed stream
+} sample_codec_dec_t;
+
+/**
+ * @brief Start a stream in buf and write its header.
+ *
+ * @param[out] enc           Encoder.
+ * @param[in]  buf           Output buffer.
+ * @param[in]  cap           Capacity, at least SAMPLE_CODEC_MAX_HEADER.
+ * @param[in]  time_unit_us  Time resolution (1000 = ms), at least 1.
+ * @param[in]  scale         Fixed-point factor, 0 for lossless float.
+ * @return false if the header does not fit.
+ */
+bool sample_codec_enc_init(sample_codec_enc_t *enc, uint8_t *buf, size_t cap, uint32_t time_unit_us, uint32_t scale);
+
+/**
+ * @brief Append a sample. Timestamps should not go backwards (it still
+ * round-trips, only less compactly).
+ *
+ * @return false if it does not fit, the encoder is then unchanged.
+ */
+bool sample_codec_enc_put(sample_codec_enc_t *enc, int64_t timestamp_us, float value);
+
+/**
+ * @brief Bytes used so far, header included.
+ */
+static inline size_t sample_codec_enc_len(const sample_codec_enc_t *enc)
+{
+    return enc->len;
+}
+
+/**
+ * @brief Start decoding a stream.
+ *
+ * @return false if the header is malformed or of another version.
+ */
+bool sample_codec_dec_init(sample_codec_dec_t *dec, const uint8_t *buf, size_t len);
+
+/**
+ * @brief Decode the next sample.
+ *
+ * @return false at the end of the stream or on error (see dec->error).
+ */
+bool sample_codec_dec_next(sample_codec_dec_t *dec, int64_t *timestamp_us, float *value);
+
+#endif // SAMPLE_CODEC_H
@@ -0,0 +1,151 @@
+/**
+ * @file sample_ring.c
+ * @author David Ramírez Betancourth
+ * @brief Lock-free single-producer/single-consumer sample ring
+ */
+
+#include "sample_ring.h"
+
+#include <string.h>
+
+bool sample_ring_init(sample_ring_t *ring, sample_t *storage, size_t capacity)
+{
+    if (!ring || !storage || capacity < 2 || (capacity & (capacity - 1)) != 0) {
+        return false;
+    }
+
+    ring->buf = storage;
+    ring->mask = capacity - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->dropped, 0);
+    atomic_init(&ring->overruns, 0);
+    ring->high_water = 0;
+    return true;
+}
+
+size_t sample_ring_reserve(sample_ring_t *ring, sample_t **out, size_t want)
+{
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    size_t capacity = ring->mask + 1;
+    size_t free_slots = capacity - (head - tail);
+    size_t idx = head & ring->mask;
+    size_t to_end = capacity - idx;
+
+    size_t n = want;
+    if (n > free_slots) {
+        n = free_slots;
+    }
+    if (n > to_end) {
+        n = to_end;
+    }
+
+    *out = &ring->buf[idx];
+    return n;
+}
+
+void sample_ring_commit(sample_ring_t *ring, size_t count)
+{
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed) + count;
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    atomic_store_explicit(&ring->head, head, memory_order_release);
+
+    if (head - tail > ring->high_water) {
+        ring->high_water = head - tail;
+    }
+}
+
+void sample_ring_drop(sample_ring_t *ring, size_t count)
+{
+    if (count == 0) {
+        return;
+    }
+    atomic_fetch_add_explicit(&ring->dropped, count, memory_order_relaxed);
+    atomic_fetch_add_explicit(&ring->overruns, 1, memory_order_relaxed);
+}
+
+size_t sample_ring_push(sample_ring_t *ring, const sample_t *src, size_t count)
+{
+    size_t written = 0;
+
+    // At most two spans: up to the end of the buffer, then from the start
+    while (written < count) {
+        sample_t *dst;
+        size_t n = sample_ring_reserve(ring, &dst, count - written);
+        if (n == 0) {
+            break;
+        }
+        memcpy(dst, &src[written], n * sizeof(sample_t));
+        sample_ring_commit(ring, n);
+        written += n;
+    }
+
+    sample_ring_drop(ring, count - written);
+    return written;
+}
+
+size_t sample_ring_peek(sample_ring_t *ring, const sample_t **out)
+{
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t idx = tail & ring->mask;
+    size_t to_end = ring->mask + 1 - idx;
+
+    size_t n = head - tail;
+    if (n > to_end) {
+        n = to_end;
+    }
+
+    *out = &ring->buf[idx];
+    return n;
+}
+
+void sample_ring_release(sample_ring_t *ring, size_t count)
+{
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, tail + count, memory_order_release);
+}
+
+size_t sample_ring_pop(sample_ring_t *ring, sample_t *dst, size_t max)
+{
+    size_t read = 0;
+
+    while (read < max) {
+        const sample_t *src;
+        size_t n = sample_ring_peek(ring, &src);
+        if (n == 0) {
+            break;
+        }
+        if (n > max - read) {
+            n = max - read;
+        }
+        memcpy(&dst[read], src, n * sizeof(sample_t));
+        sample_ring_release(ring, n);
+        read += n;
+    }
+
+    return read;
+}
+
+size_t sample_ring_count(sample_ring_t *ring)
+{
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    return head - tail;
+}
+
+void sample_ring_get_stats(sample_ring_t *ring, sample_ring_stats_t *out)
+{
+    if (!ring || !out) {
+        return;
+    }
+
+    out->pushed = atomic_load_explicit(&ring->head, memory_order_acquire);
+    out->popped = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    out->dropped = atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+    out->overruns = atomic_load_explicit(&ring->overruns, memory_order_relaxed);
+    out->high_water = ring->high_water;
+    out->capacity = ring->mask + 1;
+}
@@ -0,0 +1,126 @@
+/**
+ * @file sample_ring.h
+ * @author David Ramírez Betancourth
+ * @brief Lock-free single-producer/single-consumer sample ring, header
+ *
+ * One task (or callback) produces, one task consumes. Samples move in
+ * batches, either copied (push/pop) or in place (reserve/commit on the
+ * producer side, peek/release on the consumer side). No locks and no
+ * kernel calls are involved; waking the consumer is left to the caller.
+ */
+
+#ifndef SAMPLE_RING_H
+#define SAMPLE_RING_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Timestamped sample
+ */
+typedef struct {
+    int64_t timestamp_us;   ///< esp_timer time the sample was taken
+    float   value;          ///< Converted value
+    uint8_t source;         ///< Producer-defined sensor/channel id
+} sample_t;
+
+/**
+ * @brief Ring state. Capacity must be a power of two.
+ */
+typedef struct {
+    sample_t *buf;
+    size_t    mask;               ///< capacity - 1
+    atomic_size_t head;           ///< Free-running write index (producer)
+    atomic_size_t tail;           ///< Free-running read index (consumer)
+    atomic_uint_fast32_t dropped; ///< Samples rejected because the ring was full
+    atomic_uint_fast32_t overruns;///< Producer batches that did not fit entirely
+    size_t    high_water;         ///< Highest fill level seen by the producer
+} sample_ring_t;
+
+/**
+ * @brief Ring counters
+ */
+typedef struct {
+    uint64_t pushed;        ///< Samples committed since init (wraps with size_t)
+    uint64_t popped;        ///< Samples released since init (wraps with size_t)
+    uint32_t dropped;       ///< Samples lost to a full ring
+    uint32_t overruns;      ///< Batches that lost samples
+    size_t   high_water;    ///< Highest fill level
+    size_t   capacity;      ///< Ring capacity
+} sample_ring_stats_t;
+
+/**
+ * @brief Initialize a ring over caller-provided storage.
+ *
+ * @param[out] ring      Ring to initialize.
+ * @param[in]  storage   Array of capacity samples.
+ * @param[in]  capacity  Number of samples, power of two.
+ * @return false if the arguments are invalid.
+ */
+bool sample_ring_init(sample_ring_t *ring, sample_t *storage, size_t capacity);
+
+/**
+ * @brief Copy a batch into the ring (producer).
+ *
+ * Samples that do not fit are dropped and counted.
+ *
+ * @return Number of samples written.
+ */
+size_t sample_ring_push(sample_ring_t *ring, const sample_t *src, size_t count);
+
+/**
+ * @brief Copy up to max samples out of the ring (consumer).
+ *
+ * @return Number of samples read.
+ */
+size_t sample_ring_pop(sample_ring_t *ring, sample_t *dst, size_t max);
+
+/**
+ * @brief Get a contiguous writable span (producer).
+ *
+ * The span may be shorter than requested when the ring is nearly full or
+ * wraps; call again after committing to get the remainder. Samples the
+ * producer ends up discarding must be reported with sample_ring_drop().
+ *
+ * @param[out] out   Start of the span.
+ * @param[in]  want  Samples wanted.
+ * @return Samples available in the span (0 if full).
+ */
+size_t sample_ring_reserve(sample_ring_t *ring, sample_t **out, size_t want);
+
+/**
+ * @brief Publish count samples written into the reserved span (producer).
+ */
+void sample_ring_commit(sample_ring_t *ring, size_t count);
+
+/**
+ * @brief Record samples the producer had to discard (producer).
+ */
+void sample_ring_drop(sample_ring_t *ring, size_t count);
+
+/**
+ * @brief Get a contiguous readable span (consumer).
+ *
+ * @param[out] out  Start of the span.
+ * @return Samples available in the span (0 if empty).
+ */
+size_t sample_ring_peek(sample_ring_t *ring, const sample_t **out);
+
+/**
+ * @brief Return count samples obtained from sample_ring_peek() (consumer).
+ */
+void sample_ring_release(sample_ring_t *ring, size_t count);
+
+/**
+ * @brief Number of samples currently queued.
+ */
+size_t sample_ring_count(sample_ring_t *ring);
+
+/**
+ * @brief Snapshot the ring counters.
+ */
+void sample_ring_get_stats(sample_ring_t *ring, sample_ring_stats_t *out);
+
+#endif // SAMPLE_RING_H
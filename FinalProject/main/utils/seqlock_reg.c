@@ -0,0 +1,85 @@
+/**
+ * @file seqlock_reg.c
+ * @author David Ramírez Betancourth
+ * @brief Latest-value register guarded by a sequence lock
+ */
+
+#include "seqlock_reg.h"
+
+#include <string.h>
+
+void seqlock_reg_init(seqlock_reg_t *reg)
+{
+    portMUX_INITIALIZE(&reg->lock);
+    atomic_init(&reg->seq, 0);
+    atomic_init(&reg->timestamp[0], 0);
+    atomic_init(&reg->timestamp[1], 0);
+    for (size_t i = 0; i < SEQLOCK_REG_WORDS; i++) {
+        atomic_init(&reg->words[i], 0);
+    }
+}
+
+uint32_t seqlock_reg_write(seqlock_reg_t *reg, const void *value, size_t size, int64_t timestamp_us)
+{
+    uint32_t words[SEQLOCK_REG_WORDS] = {0};
+
+    if (size > SEQLOCK_REG_MAX_SIZE) {
+        size = SEQLOCK_REG_MAX_SIZE;
+    }
+    memcpy(words, value, size);
+    size_t n = (size + 3) / 4;
+
+    taskENTER_CRITICAL(&reg->lock);
+    uint32_t seq = atomic_load_explicit(&reg->seq, memory_order_relaxed);
+
+    atomic_store_explicit(&reg->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    atomic_store_explicit(&reg->timestamp[0], (uint32_t)timestamp_us, memory_order_relaxed);
+    atomic_store_explicit(&reg->timestamp[1], (uint32_t)((uint64_t)timestamp_us >> 32), memory_order_relaxed);
+    for (size_t i = 0; i < n; i++) {
+        atomic_store_explicit(&reg->words[i], words[i], memory_order_relaxed);
+    }
+
+    atomic_store_explicit(&reg->seq, seq + 2, memory_order_release);
+    taskEXIT_CRITICAL(&reg->lock);
+
+    return (seq + 2) / 2;
+}
+
+uint32_t seqlock_reg_read(seqlock_reg_t *reg, void *value, size_t size, int64_t *timestamp_us)
+{
+    uint32_t words[SEQLOCK_REG_WORDS];
+    uint32_t ts_lo;
+    uint32_t ts_hi;
+    uint32_t before;
+
+    if (size > SEQLOCK_REG_MAX_SIZE) {
+        size = SEQLOCK_REG_MAX_SIZE;
+    }
+    size_t n = (size + 3) / 4;
+
+    while (1) {
+        before = atomic_load_explicit(&reg->seq, memory_order_acquire);
+        if (before & 1) {
+            continue; // Writer is mid-update on the other core
+        }
+
+        ts_lo = atomic_load_explicit(&reg->timestamp[0], memory_order_relaxed);
+        ts_hi = atomic_load_explicit(&reg->timestamp[1], memory_order_relaxed);
+        for (size_t i = 0; i < n; i++) {
+            words[i] = atomic_load_explicit(&reg->words[i], memory_order_relaxed);
+        }
+
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&reg->seq, memory_order_relaxed) == before) {
+            break;
+        }
+    }
+
+    memcpy(value, words, size);
+    if (timestamp_us) {
+        *timestamp_us = (int64_t)(((uint64_t)ts_hi << 32) | ts_lo);
+    }
+    return before / 2;
+}
@@ -0,0 +1,72 @@
+/**
+ * @file seqlock_reg.h
+ * @author David Ramírez Betancourth
+ * @brief Latest-value register guarded by a sequence lock, header
+ *
+ * Holds one small value, its timestamp and a version (number of writes).
+ * Readers never block and never take a lock: they copy the value and retry
+ * only if a write overlapped the copy. Writers run the few word stores in a
+ * critical section, so a reader can not preempt a half-done write on the
+ * same core and the retry window on the other core is a handful of cycles.
+ */
+
+#ifndef SEQLOCK_REG_H
+#define SEQLOCK_REG_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "freertos/FreeRTOS.h"
+
+#define SEQLOCK_REG_MAX_SIZE  16   ///< Largest value, bytes
+
+#define SEQLOCK_REG_WORDS     ((SEQLOCK_REG_MAX_SIZE + 3) / 4)
+
+/**
+ * @brief Register state
+ */
+typedef struct {
+    portMUX_TYPE lock;                          ///< Serializes writers only
+    _Atomic uint32_t seq;                       ///< Odd while a write is in progress
+    _Atomic uint32_t timestamp[2];              ///< int64 timestamp, low word first
+    _Atomic uint32_t words[SEQLOCK_REG_WORDS];
+} seqlock_reg_t;
+
+/**
+ * @brief Initialize a register (version 0, no value).
+ */
+void seqlock_reg_init(seqlock_reg_t *reg);
+
+/**
+ * @brief Store a new value.
+ *
+ * @param[in] reg           Register.
+ * @param[in] value         Value, up to SEQLOCK_REG_MAX_SIZE bytes.
+ * @param[in] size          Size of value.
+ * @param[in] timestamp_us  Time the value refers to.
+ * @return Version of the stored value (1 for the first write).
+ */
+uint32_t seqlock_reg_write(seqlock_reg_t *reg, const void *value, size_t size, int64_t timestamp_us);
+
+/**
+ * @brief Take a consistent copy of the value.
+ *
+ * @param[in]  reg           Register.
+ * @param[out] value         Destination, size bytes.
+ * @param[in]  size          Size of value, as written.
+ * @param[out] timestamp_us  Timestamp of the value, may be NULL.
+ * @return Version of the copy, 0 if never written.
+ */
+uint32_t seqlock_reg_read(seqlock_reg_t *reg, void *value, size_t size, int64_t *timestamp_us);
+
+/**
+ * @brief Current version without copying the value.
+ */
+static inline uint32_t seqlock_reg_version(seqlock_reg_t *reg)
+{
+    return atomic_load_explicit(&reg->seq, memory_order_acquire) / 2;
+}
+
+#endif // SEQLOCK_REG_H
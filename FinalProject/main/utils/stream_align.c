@@ -0,0 +1,94 @@
+/**
+ * @file stream_align.c
+ * @author David Ramírez Betancourth
+ * @brief Time alignment of two timestamped sample streams
+ */
+
+#include "stream_align.h"
+
+#include <string.h>
+
+void stream_align_init(stream_align_t *align, uint8_t ref_source, uint8_t other_source, int64_t max_gap_us)
+{
+    memset(align, 0, sizeof(*align));
+    align->ref_source = ref_source;
+    align->other_source = other_source;
+    align->max_gap_us = max_gap_us;
+}
+
+// Other stream at time t, if t lies within [prev, last]
+static bool interpolate_other(const stream_align_t *align, int64_t t, float *out)
+{
+    if (!align->have_last || t > align->last.timestamp_us) {
+        return false;
+    }
+    if (t == align->last.timestamp_us) {
+        *out = align->last.value;
+        return true;
+    }
+    if (!align->have_prev || t < align->prev.timestamp_us) {
+        return false;
+    }
+
+    int64_t span = align->last.timestamp_us - align->prev.timestamp_us;
+    if (span <= 0 || span > align->max_gap_us) {
+        return false;
+    }
+
+    float w = (float)(t - align->prev.timestamp_us) / (float)span;
+    *out = align->prev.value + w * (align->last.value - align->prev.value);
+    return true;
+}
+
+// Emit every pending reference sample the other stream has caught up with
+static size_t drain_pending(stream_align_t *align, aligned_pair_t *out, size_t max_out)
+{
+    size_t n = 0;
+
+    while (align->pending_count > 0 && n < max_out) {
+        const sample_t *ref = &align->pending[align->pending_head];
+
+        if (!align->have_last || ref->timestamp_us > align->last.timestamp_us) {
+            break; // Other stream not there yet (or not started: it may still cover this sample)
+        }
+
+        float other;
+        if (interpolate_other(align, ref->timestamp_us, &other)) {
+            out[n].timestamp_us = ref->timestamp_us;
+            out[n].ref = ref->value;
+            out[n].other = other;
+            n++;
+        } else {
+            align->dropped++; // Older than the interpolation window
+        }
+
+        align->pending_head = (align->pending_head + 1) % STREAM_ALIGN_PENDING;
+        align->pending_count--;
+    }
+
+    return n;
+}
+
+size_t stream_align_push(stream_align_t *align, const sample_t *sample, aligned_pair_t *out, size_t max_out)
+{
+    if (sample->source == align->ref_source) {
+        if (align->pending_count == STREAM_ALIGN_PENDING) {
+            // Other stream stalled: give up on the oldest reference sample
+            align->pending_head = (align->pending_head + 1) % STREAM_ALIGN_PENDING;
+            align->pending_count--;
+            align->dropped++;
+        }
+        size_t tail = (align->pending_head + align->pending_count) % STREAM_ALIGN_PENDING;
+        align->pending[tail] = *sample;
+        align->pending_count++;
+    } else if (sample->source == align->other_source) {
+        align->prev = align->last;
+        align->have_prev = align->have_last;
+        align->last = *sample;
+        align->have_last = true;
+    } else {
+        return 0;
+    }
+
+    return drain_pending(align, out, max_out);
+}
@@ -0,0 +1,71 @@
+/**
+ * @file stream_align.h
+ * @author David Ramírez Betancourth
+ * @brief Time alignment of two timestamped sample streams, header
+ *
+ * One stream is the reference: every reference sample is paired with the
+ * other stream linearly interpolated at the reference timestamp. A pair is
+ * emitted as soon as the other stream has a sample at or after that time,
+ * so each reference sample yields exactly one pair.
+ */
+
+#ifndef STREAM_ALIGN_H
+#define STREAM_ALIGN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sample_ring.h"
+
+#define STREAM_ALIGN_PENDING 16     ///< Reference samples waiting for the other stream
+
+/**
+ * @brief Reference sample and the other stream resampled onto its timestamp
+ */
+typedef struct {
+    int64_t timestamp_us;
+    float ref;
+    float other;
+} aligned_pair_t;
+
+/**
+ * @brief Aligner state
+ */
+typedef struct {
+    uint8_t ref_source;             ///< sample_t.source of the reference stream
+    uint8_t other_source;           ///< sample_t.source of the resampled stream
+    int64_t max_gap_us;             ///< Largest gap between other-stream samples to interpolate across
+    bool    have_prev, have_last;
+    sample_t prev;                  ///< Last two samples of the other stream
+    sample_t last;
+    size_t  pending_head, pending_count;
+    sample_t pending[STREAM_ALIGN_PENDING];
+    uint32_t dropped;               ///< Reference samples that could not be paired
+} stream_align_t;
+
+/**
+ * @brief Initialize an aligner.
+ *
+ * @param[out] align         Aligner.
+ * @param[in]  ref_source    Source id of the reference stream.
+ * @param[in]  other_source  Source id of the stream to resample.
+ * @param[in]  max_gap_us    Reference samples falling in a larger gap of the other stream are dropped.
+ */
+void stream_align_init(stream_align_t *align, uint8_t ref_source, uint8_t other_source, int64_t max_gap_us);
+
+/**
+ * @brief Feed one sample of either stream.
+ *
+ * Samples of other sources are ignored. Each stream must be fed in
+ * timestamp order.
+ *
+ * @param[in,out] align    Aligner.
+ * @param[in]     sample   Sample to feed.
+ * @param[out]    out      Pairs completed by this sample.
+ * @param[in]     max_out  Room in out (STREAM_ALIGN_PENDING is always enough).
+ * @return Number of pairs written.
+ */
+size_t stream_align_push(stream_align_t *align, const sample_t *sample, aligned_pair_t *out, size_t max_out);
+
+#endif // STREAM_ALIGN_H
@@ -0,0 +1,185 @@
+/**
+ * @file telemetry_bus.c
+ * @author David Ramírez Betancourth
+ * @brief Publish/subscribe bus for sensor values and commands
+ */
+
+#include "telemetry_bus.h"
+
+#include <stdatomic.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "seqlock_reg.h"
+
+typedef struct {
+    char name[TELEMETRY_NAME_LEN];
+    telemetry_type_t type;
+    seqlock_reg_t latest;   // value union, version is the topic sequence
+} telemetry_topic_t;
+
+typedef struct {
+    int topic;
+    telemetry_cb_t cb;
+    void *user_ctx;
+} telemetry_sub_t;
+
+// Tables only grow; the counts are published after the entry is written so
+// publishers can walk them without the lock.
+static telemetry_topic_t bus_topics[TELEMETRY_MAX_TOPICS];
+static _Atomic int bus_num_topics = 0;
+static telemetry_sub_t bus_subs[TELEMETRY_MAX_SUBSCRIBERS];
+static _Atomic int bus_num_subs = 0;
+
+// Guards registration, readers of the latest values never take it
+static portMUX_TYPE bus_lock = portMUX_INITIALIZER_UNLOCKED;
+
+//-----------------------------------Registration----------------------------------
+
+static int telemetry_find_locked(const char *name)
+{
+    int count = atomic_load_explicit(&bus_num_topics, memory_order_relaxed);
+
+    for (int i = 0; i < count; i++) {
+        if (strncmp(bus_topics[i].name, name, TELEMETRY_NAME_LEN) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+esp_err_t telemetry_register(const char *name, telemetry_type_t type, int *out_id)
+{
+    esp_err_t err = ESP_OK;
+
+    if (!name || !out_id || name[0] == '\0' || strlen(name) >= TELEMETRY_NAME_LEN) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    taskENTER_CRITICAL(&bus_lock);
+    int id = telemetry_find_locked(name);
+
+    if (id >= 0) {
+        if (bus_topics[id].type != type) {
+            err = ESP_ERR_INVALID_ARG;
+        }
+    } else {
+        id = atomic_load_explicit(&bus_num_topics, memory_order_relaxed);
+        if (id >= TELEMETRY_MAX_TOPICS) {
+            err = ESP_ERR_NO_MEM;
+        } else {
+            telemetry_topic_t *topic = &bus_topics[id];
+            memset(topic, 0, sizeof(*topic));
+            strcpy(topic->name, name);
+            topic->type = type;
+            seqlock_reg_init(&topic->latest);
+            atomic_store_explicit(&bus_num_topics, id + 1, memory_order_release);
+        }
+    }
+    taskEXIT_CRITICAL(&bus_lock);
+
+    if (err == ESP_OK) {
+        *out_id = id;
+    }
+    return err;
+}
+
+int telemetry_find(const char *name)
+{
+    if (!name) {
+        return -1;
+    }
+
+    taskENTER_CRITICAL(&bus_lock);
+    int id = telemetry_find_locked(name);
+    taskEXIT_CRITICAL(&bus_lock);
+    return id;
+}
+
+esp_err_t telemetry_subscribe(int topic, telemetry_cb_t cb, void *user_ctx)
+{
+    esp_err_t err = ESP_OK;
+
+    if (!cb || topic < TELEMETRY_ALL_TOPICS || topic >= TELEMETRY_MAX_TOPICS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    taskENTER_CRITICAL(&bus_lock);
+    int n = atomic_load_explicit(&bus_num_subs, memory_order_relaxed);
+    if (n >= TELEMETRY_MAX_SUBSCRIBERS) {
+        err = ESP_ERR_NO_MEM;
+    } else {
+        bus_subs[n].topic = topic;
+        bus_subs[n].cb = cb;
+        bus_subs[n].user_ctx = user_ctx;
+        atomic_store_explicit(&bus_num_subs, n + 1, memory_order_release);
+    }
+    taskEXIT_CRITICAL(&bus_lock);
+
+    return err;
+}
+
+//-----------------------------------Publishing------------------------------------
+
+static esp_err_t telemetry_publish(int topic, telemetry_type_t type, const telemetry_msg_t *value)
+{
+    telemetry_msg_t msg;
+
+    if (topic < 0 || topic >= atomic_load_explicit(&bus_num_topics, memory_order_acquire) ||
+        bus_topics[topic].type != type) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    msg = *value;
+    msg.topic = (int16_t)topic;
+    msg.type = (uint8_t)type;
+    msg.seq = seqlock_reg_write(&bus_topics[topic].latest, &msg.value, sizeof(msg.value), msg.timestamp_us);
+
+    int n = atomic_load_explicit(&bus_num_subs, memory_order_acquire);
+    for (int i = 0; i < n; i++) {
+        if (bus_subs[i].topic == topic || bus_subs[i].topic == TELEMETRY_ALL_TOPICS) {
+            bus_subs[i].cb(&msg, bus_subs[i].user_ctx);
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t telemetry_publish_float(int topic, float value, int64_t timestamp_us)
+{
+    telemetry_msg_t msg = {.timestamp_us = timestamp_us, .value.f = value};
+    return telemetry_publish(topic, TELEMETRY_FLOAT, &msg);
+}
+
+esp_err_t telemetry_publish_int(int topic, int32_t value, int64_t timestamp_us)
+{
+    telemetry_msg_t msg = {.timestamp_us = timestamp_us, .value.i = value};
+    return telemetry_publish(topic, TELEMETRY_INT, &msg);
+}
+
+//-----------------------------------Queries---------------------------------------
+
+bool telemetry_latest(int topic, telemetry_msg_t *out)
+{
+    if (!out || topic < 0 || topic >= atomic_load_explicit(&bus_num_topics, memory_order_acquire)) {
+        return false;
+    }
+
+    out->topic = (int16_t)topic;
+    out->type = (uint8_t)bus_topics[topic].type;
+    out->seq = seqlock_reg_read(&bus_topics[topic].latest, &out->value, sizeof(out->value), &out->timestamp_us);
+
+    return out->seq != 0;
+}
+
+const char *telemetry_topic_name(int topic)
+{
+    if (topic < 0 || topic >= atomic_load_explicit(&bus_num_topics, memory_order_acquire)) {
+        return NULL;
+    }
+    return bus_topics[topic].name;
+}
+
+int telemetry_topic_count(void)
+{
+    return atomic_load_explicit(&bus_num_topics, memory_order_acquire);
+}
@@ -0,0 +1,123 @@
+/**
+ * @file telemetry_bus.h
+ * @author David Ramírez Betancourth
+ * @brief Publish/subscribe bus for sensor values and commands, header
+ *
+ * Producers register named topics once at startup and publish values to
+ * them; every topic keeps its latest message and a sequence number.
+ * Subscribers are callbacks run in the publisher's context, either for one
+ * topic or for all of them. Nothing is allocated after registration.
+ *
+ * The latest values live in seqlock registers: telemetry_latest() never
+ * blocks and never delays a publisher, whatever task it is called from.
+ */
+
+#ifndef TELEMETRY_BUS_H
+#define TELEMETRY_BUS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#define TELEMETRY_MAX_TOPICS       8
+#define TELEMETRY_MAX_SUBSCRIBERS  8
+#define TELEMETRY_NAME_LEN         16
+
+#define TELEMETRY_ALL_TOPICS       (-1)   ///< Subscribe to every topic
+
+/**
+ * @brief Value type of a topic
+ */
+typedef enum {
+    TELEMETRY_FLOAT = 0,
+    TELEMETRY_INT,
+} telemetry_type_t;
+
+/**
+ * @brief One published value
+ */
+typedef struct {
+    int16_t  topic;         ///< Topic id
+    uint8_t  type;          ///< telemetry_type_t of the topic
+    uint32_t seq;           ///< Per-topic sequence, 1 for the first publish
+    int64_t  timestamp_us;  ///< esp_timer time the value refers to
+    union {
+        float   f;
+        int32_t i;
+    } value;
+} telemetry_msg_t;
+
+/**
+ * @brief Subscriber callback
+ *
+ * Runs in the publisher's task. Keep it short and non-blocking; hand the
+ * message to a queue or a task notification when work is needed.
+ */
+typedef void (*telemetry_cb_t)(const telemetry_msg_t *msg, void *user_ctx);
+
+/**
+ * @brief Register a topic.
+ *
+ * Registering an existing name with the same type returns its id.
+ *
+ * @param[in]  name    Topic name, up to TELEMETRY_NAME_LEN - 1 characters.
+ * @param[in]  type    Value type.
+ * @param[out] out_id  Topic id.
+ * @return ESP_OK, ESP_ERR_INVALID_ARG or ESP_ERR_NO_MEM when full.
+ */
+esp_err_t telemetry_register(const char *name, telemetry_type_t type, int *out_id);
+
+/**
+ * @brief Look a topic up by name.
+ *
+ * @return Topic id, -1 if not registered.
+ */
+int telemetry_find(const char *name);
+
+/**
+ * @brief Subscribe to one topic or to TELEMETRY_ALL_TOPICS.
+ *
+ * Subscriptions are permanent.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_ARG or ESP_ERR_NO_MEM when full.
+ */
+esp_err_t telemetry_subscribe(int topic, telemetry_cb_t cb, void *user_ctx);
+
+/**
+ * @brief Publish a float value and fan it out to the subscribers.
+ *
+ * @param[in] topic         Topic id (TELEMETRY_FLOAT).
+ * @param[in] value         Value.
+ * @param[in] timestamp_us  Time the value refers to.
+ * @return ESP_OK or ESP_ERR_INVALID_ARG.
+ */
+esp_err_t telemetry_publish_float(int topic, float value, int64_t timestamp_us);
+
+/**
+ * @brief Publish an integer value, see telemetry_publish_float().
+ */
+esp_err_t telemetry_publish_int(int topic, int32_t value, int64_t timestamp_us);
+
+/**
+ * @brief Latest message of a topic. Wait-free for the publisher, lock-free
+ * for the caller.
+ *
+ * @param[in]  topic  Topic id.
+ * @param[out] out    Copy of the latest message.
+ * @return false if the topic is unknown or was never published.
+ */
+bool telemetry_latest(int topic, telemetry_msg_t *out);
+
+/**
+ * @brief Name of a topic, NULL if unknown.
+ */
+const char *telemetry_topic_name(int topic);
+
+/**
+ * @brief Number of registered topics, ids run from 0 to count - 1.
+ */
+int telemetry_topic_count(void);
+
+#endif // TELEMETRY_BUS_H
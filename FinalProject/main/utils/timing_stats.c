@@ -0,0 +1,102 @@
+/**
+ * @file timing_stats.c
+ * @author David Ramírez Betancourth
+ * @brief Interval/latency statistics collector
+ */
+
+#include "timing_stats.h"
+
+#include <string.h>
+
+#define SUB_COUNT (1u << TIMING_STATS_SUB_BITS)
+
+// Values below SUB_COUNT get one bucket each, above that every octave is split in SUB_COUNT
+static uint32_t bucket_of(uint64_t v)
+{
+    if (v < SUB_COUNT) {
+        return (uint32_t)v;
+    }
+
+    uint32_t msb = 63 - __builtin_clzll(v);
+    uint32_t sub = (uint32_t)(v >> (msb - TIMING_STATS_SUB_BITS)) & (SUB_COUNT - 1);
+    uint32_t idx = ((msb - TIMING_STATS_SUB_BITS + 1) << TIMING_STATS_SUB_BITS) + sub;
+
+    return idx < TIMING_STATS_BINS ? idx : TIMING_STATS_BINS - 1;
+}
+
+static int64_t bucket_mid(uint32_t idx)
+{
+    if (idx < SUB_COUNT) {
+        return idx;
+    }
+
+    uint32_t msb = (idx >> TIMING_STATS_SUB_BITS) + TIMING_STATS_SUB_BITS - 1;
+    uint64_t width = 1ull << (msb - TIMING_STATS_SUB_BITS);
+    uint64_t low = (1ull << msb) + (uint64_t)(idx & (SUB_COUNT - 1)) * width;
+    return (int64_t)(low + width / 2);
+}
+
+void timing_stats_init(timing_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    portMUX_INITIALIZE(&stats->lock);
+    stats->min_us = INT64_MAX;
+}
+
+void timing_stats_record(timing_stats_t *stats, int64_t value_us)
+{
+    if (value_us < 0) {
+        value_us = 0;
+    }
+    uint32_t idx = bucket_of((uint64_t)value_us);
+
+    taskENTER_CRITICAL(&stats->lock);
+    stats->count++;
+    stats->sum_us += value_us;
+    if (value_us < stats->min_us) {
+        stats->min_us = value_us;
+    }
+    if (value_us > stats->max_us) {
+        stats->max_us = value_us;
+    }
+    stats->bins[idx]++;
+    taskEXIT_CRITICAL(&stats->lock);
+}
+
+// Caller holds the lock
+static int64_t percentile_locked(const timing_stats_t *stats, uint32_t permille)
+{
+    if (stats->count == 0) {
+        return 0;
+    }
+
+    uint64_t rank = ((uint64_t)stats->count * permille + 999) / 1000;
+    uint64_t seen = 0;
+
+    for (uint32_t i = 0; i < TIMING_STATS_BINS; i++) {
+        seen += stats->bins[i];
+        if (seen >= rank) {
+            return bucket_mid(i);
+        }
+    }
+    return stats->max_us;
+}
+
+int64_t timing_stats_percentile(timing_stats_t *stats, uint32_t permille)
+{
+    taskENTER_CRITICAL(&stats->lock);
+    int64_t v = percentile_locked(stats, permille);
+    taskEXIT_CRITICAL(&stats->lock);
+    return v;
+}
+
+void timing_stats_summary(timing_stats_t *stats, timing_summary_t *out)
+{
+    taskENTER_CRITICAL(&stats->lock);
+    out->count = stats->count;
+    out->min_us = stats->count ? stats->min_us : 0;
+    out->max_us = stats->max_us;
+    out->mean_us = stats->count ? stats->sum_us / stats->count : 0;
+    out->p99_us = percentile_locked(stats, 990);
+    taskEXIT_CRITICAL(&stats->lock);
+}
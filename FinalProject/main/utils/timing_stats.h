@@ -0,0 +1,69 @@
+/**
+ * @file timing_stats.h
+ * @author David Ramírez Betancourth
+ * @brief Interval/latency statistics collector, header
+ *
+ * Keeps count, min, mean and max of a stream of durations plus a
+ * log-linear histogram (8 buckets per octave, <= 12.5 % bucket width)
+ * from which percentiles are estimated. Memory is fixed.
+ */
+
+#ifndef TIMING_STATS_H
+#define TIMING_STATS_H
+
+#include <stdint.h>
+
+#include "freertos/FreeRTOS.h"
+
+#define TIMING_STATS_SUB_BITS   3                                   ///< 8 buckets per octave
+#define TIMING_STATS_OCTAVES    24                                  ///< Resolved up to 2^27 us (~134 s), longer values land in the last bucket
+#define TIMING_STATS_BINS       ((TIMING_STATS_OCTAVES + 1) << TIMING_STATS_SUB_BITS)
+
+/**
+ * @brief Collector state
+ */
+typedef struct {
+    portMUX_TYPE lock;
+    uint32_t count;
+    int64_t  sum_us;
+    int64_t  min_us;
+    int64_t  max_us;
+    uint32_t bins[TIMING_STATS_BINS];
+} timing_stats_t;
+
+/**
+ * @brief Snapshot of a collector
+ */
+typedef struct {
+    uint32_t count;
+    int64_t  min_us;
+    int64_t  mean_us;
+    int64_t  max_us;
+    int64_t  p99_us;    ///< Estimated from the histogram
+} timing_summary_t;
+
+/**
+ * @brief Initialize (or clear) a collector.
+ */
+void timing_stats_init(timing_stats_t *stats);
+
+/**
+ * @brief Add one duration. Negative values are clamped to 0.
+ */
+void timing_stats_record(timing_stats_t *stats, int64_t value_us);
+
+/**
+ * @brief Estimate a percentile.
+ *
+ * @param[in] stats     Collector.
+ * @param[in] permille  Percentile in tenths of a percent (990 = p99).
+ * @return Midpoint of the bucket holding the percentile, 0 if empty.
+ */
+int64_t timing_stats_percentile(timing_stats_t *stats, uint32_t permille);
+
+/**
+ * @brief Take a consistent summary of a collector.
+ */
+void timing_stats_summary(timing_stats_t *stats, timing_summary_t *out);
+
+#endif // TIMING_STATS_H
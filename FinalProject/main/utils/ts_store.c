@@ -0,0 +1,251 @@
+/**
+ * @file ts_store.c
+ * @author David Ramírez Betancourth
+ * @brief Fixed-memory multi-resolution time-series store
+ */
+
+#include "ts_store.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+// Points copied per locked section in ts_store_query()
+#define TS_STORE_QUERY_CHUNK 32
+
+static ts_store_t *named_stores[TS_STORE_MAX_NAMED];
+static portMUX_TYPE named_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void ring_setup(ts_ring_t *ring, uint32_t *t_ms, int16_t *min, int16_t *mean, int16_t *max,
+                       uint32_t cap, uint32_t interval_ms)
+{
+    ring->t_ms = t_ms;
+    ring->min = min;
+    ring->mean = mean;
+    ring->max = max;
+    ring->cap = cap;
+    ring->head = 0;
+    ring->count = 0;
+    ring->interval_ms = interval_ms;
+}
+
+// Physical slot of the i-th oldest point
+static inline uint32_t ring_slot(const ts_ring_t *ring, uint32_t i)
+{
+    return (ring->head + ring->cap - ring->count + i) % ring->cap;
+}
+
+static void ring_push(ts_ring_t *ring, uint32_t t_ms, int16_t min, int16_t mean, int16_t max)
+{
+    uint32_t slot = ring->head;
+
+    ring->t_ms[slot] = t_ms;
+    ring->min[slot] = min;
+    ring->mean[slot] = mean;
+    ring->max[slot] = max;
+
+    ring->head = (slot + 1) % ring->cap;
+    if (ring->count < ring->cap) {
+        ring->count++;
+    }
+}
+
+// First point (oldest = 0) with t >= t_ms, count if none
+static uint32_t ring_lower_bound(const ts_ring_t *ring, uint32_t t_ms)
+{
+    uint32_t lo = 0;
+    uint32_t hi = ring->count;
+
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (ring->t_ms[ring_slot(ring, mid)] < t_ms) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static inline int16_t to_fixed(const ts_store_t *store, float value)
+{
+    float q = roundf(value * store->scale);
+
+    if (!(q > -32768.0f)) {     // Also catches NaN
+        return -32768;
+    }
+    if (q > 32767.0f) {
+        return 32767;
+    }
+    return (int16_t)q;
+}
+
+// Add a sample to the open interval of an aggregate tier, closing it first
+// if the sample belongs to a later interval
+static void accum_add(ts_store_t *store, ts_tier_t tier, uint32_t t_ms, int16_t q)
+{
+    ts_ring_t *ring = &store->tiers[tier];
+    ts_accum_t *acc = &store->accum[tier];
+    uint32_t start = t_ms - t_ms % ring->interval_ms;
+
+    if (acc->n > 0 && start != acc->start_ms) {
+        int32_t half = (int32_t)acc->n / 2;
+        int32_t mean = (acc->sum >= 0 ? acc->sum + half : acc->sum - half) / (int32_t)acc->n;
+        ring_push(ring, acc->start_ms, (int16_t)acc->min, (int16_t)mean, (int16_t)acc->max);
+        acc->n = 0;
+    }
+
+    if (acc->n == 0) {
+        acc->start_ms = start;
+        acc->min = q;
+        acc->max = q;
+        acc->sum = q;
+        acc->n = 1;
+        return;
+    }
+
+    if (q < acc->min) {
+        acc->min = q;
+    }
+    if (q > acc->max) {
+        acc->max = q;
+    }
+    acc->sum += q;
+    acc->n++;
+}
+
+//-----------------------------------API-------------------------------------------
+
+void ts_store_init(ts_store_t *store, const char *name, float scale)
+{
+    memset(store, 0, sizeof(*store));
+    portMUX_INITIALIZE(&store->lock);
+    store->name = name;
+    store->scale = scale;
+
+    // Raw points alias min/mean/max to the same array
+    ring_setup(&store->tiers[TS_TIER_RAW], store->raw_t, store->raw_v, store->raw_v, store->raw_v,
+               TS_STORE_RAW_LEN, 0);
+    ring_setup(&store->tiers[TS_TIER_SEC], store->sec_t, store->sec_min, store->sec_mean, store->sec_max,
+               TS_STORE_SEC_LEN, 1000);
+    ring_setup(&store->tiers[TS_TIER_MIN], store->min_t, store->min_min, store->min_mean, store->min_max,
+               TS_STORE_MIN_LEN, 60000);
+
+    if (!name) {
+        return;
+    }
+
+    taskENTER_CRITICAL(&named_lock);
+    for (int i = 0; i < TS_STORE_MAX_NAMED; i++) {
+        if (!named_stores[i] || named_stores[i] == store) {
+            named_stores[i] = store;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL(&named_lock);
+}
+
+ts_store_t *ts_store_find(const char *name)
+{
+    ts_store_t *found = NULL;
+
+    if (!name) {
+        return NULL;
+    }
+
+    taskENTER_CRITICAL(&named_lock);
+    for (int i = 0; i < TS_STORE_MAX_NAMED && named_stores[i]; i++) {
+        if (strcmp(named_stores[i]->name, name) == 0) {
+            found = named_stores[i];
+            break;
+        }
+    }
+    taskEXIT_CRITICAL(&named_lock);
+
+    return found;
+}
+
+void ts_store_insert(ts_store_t *store, int64_t timestamp_us, float value)
+{
+    if (timestamp_us < 0) {
+        return;
+    }
+
+    uint32_t t_ms = (uint32_t)(timestamp_us / 1000);
+    int16_t q = to_fixed(store, value);
+    ts_ring_t *raw = &store->tiers[TS_TIER_RAW];
+
+    taskENTER_CRITICAL(&store->lock);
+    if (raw->count == 0 || t_ms >= raw->t_ms[ring_slot(raw, raw->count - 1)]) {
+        ring_push(raw, t_ms, q, q, q);
+        accum_add(store, TS_TIER_SEC, t_ms, q);
+        accum_add(store, TS_TIER_MIN, t_ms, q);
+    }
+    taskEXIT_CRITICAL(&store->lock);
+}
+
+size_t ts_store_query(ts_store_t *store, ts_tier_t tier, int64_t from_us, int64_t to_us,
+                      ts_point_t *out, size_t max_points)
+{
+    if (tier >= TS_TIER_COUNT || !out || to_us < from_us || to_us < 0) {
+        return 0;
+    }
+
+    const ts_ring_t *ring = &store->tiers[tier];
+    const float inv_scale = 1.0f / store->scale;
+    uint32_t cursor = from_us > 0 ? (uint32_t)(from_us / 1000) : 0;
+    uint32_t to_ms = (uint32_t)(to_us / 1000);
+    size_t n = 0;
+    bool done = false;
+
+    while (!done && n < max_points) {
+        size_t copied = 0;
+
+        taskENTER_CRITICAL(&store->lock);
+        uint32_t i = ring_lower_bound(ring, cursor);
+        while (copied < TS_STORE_QUERY_CHUNK && n < max_points) {
+            if (i >= ring->count) {
+                done = true;
+                break;
+            }
+            uint32_t slot = ring_slot(ring, i++);
+            uint32_t t_ms = ring->t_ms[slot];
+            if (t_ms > to_ms) {
+                done = true;
+                break;
+            }
+            out[n].timestamp_us = (int64_t)t_ms * 1000;
+            out[n].min = ring->min[slot] * inv_scale;
+            out[n].mean = ring->mean[slot] * inv_scale;
+            out[n].max = ring->max[slot] * inv_scale;
+            cursor = t_ms + 1;
+            n++;
+            copied++;
+        }
+        taskEXIT_CRITICAL(&store->lock);
+
+        if (copied == 0) {
+            break;
+        }
+    }
+
+    return n;
+}
+
+ts_tier_t ts_store_best_tier(ts_store_t *store, int64_t from_us)
+{
+    uint32_t from_ms = from_us > 0 ? (uint32_t)(from_us / 1000) : 0;
+    ts_tier_t best = TS_TIER_MIN;
+
+    taskENTER_CRITICAL(&store->lock);
+    for (int tier = TS_TIER_RAW; tier < TS_TIER_COUNT; tier++) {
+        const ts_ring_t *ring = &store->tiers[tier];
+        if (ring->count > 0 && ring->t_ms[ring_slot(ring, 0)] <= from_ms) {
+            best = (ts_tier_t)tier;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL(&store->lock);
+
+    return best;
+}
@@ -0,0 +1,158 @@
+/**
+ * @file ts_store.h
+ * @author David Ramírez Betancourth
+ * @brief Fixed-memory multi-resolution time-series store, header
+ *
+ * One store keeps the history of one signal in three rings: raw samples,
+ * 1 s min/mean/max aggregates and 1 min aggregates. An insert appends the
+ * raw sample and updates the open aggregates, which are closed when a
+ * sample lands in the next second/minute, so inserts are O(1). Queries
+ * locate the range by binary search on the timestamps.
+ *
+ * Values are kept as int16 scaled by a per-store factor and timestamps as
+ * milliseconds since boot (49 days). The tier lengths are build-time
+ * settings, TS_STORE_BYTES gives the resulting footprint of one store.
+ */
+
+#ifndef TS_STORE_H
+#define TS_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "freertos/FreeRTOS.h"
+
+#ifndef TS_STORE_RAW_LEN
+#define TS_STORE_RAW_LEN  1200      ///< Raw samples (1 min at 20 S/s)
+#endif
+#ifndef TS_STORE_SEC_LEN
+#define TS_STORE_SEC_LEN  900       ///< 1 s aggregates (15 min)
+#endif
+#ifndef TS_STORE_MIN_LEN
+#define TS_STORE_MIN_LEN  1440      ///< 1 min aggregates (24 h)
+#endif
+
+#define TS_STORE_MAX_NAMED  4   ///< Stores that can be looked up by name
+#define TS_STORE_TICK_US    1000    ///< Timestamps are kept in ms
+
+// Approximate size of one ts_store_t: 6 bytes per raw sample, 10 per aggregate
+#define TS_STORE_BYTES  (TS_STORE_RAW_LEN * 6 + (TS_STORE_SEC_LEN + TS_STORE_MIN_LEN) * 10)
+
+/**
+ * @brief Resolution tiers, finest first
+ */
+typedef enum {
+    TS_TIER_RAW = 0,
+    TS_TIER_SEC,
+    TS_TIER_MIN,
+    TS_TIER_COUNT,
+} ts_tier_t;
+
+/**
+ * @brief One point returned by a query. Raw points have min == mean == max.
+ */
+typedef struct {
+    int64_t timestamp_us;   ///< Raw: sample time. Aggregates: start of the interval
+    float min;
+    float mean;
+    float max;
+} ts_point_t;
+
+// Ring over one tier, struct of arrays to avoid padding
+typedef struct {
+    uint32_t *t_ms;
+    int16_t *min;           // The raw tier only has this one
+    int16_t *mean;
+    int16_t *max;
+    uint32_t cap;
+    uint32_t head;          // Next write
+    uint32_t count;
+    uint32_t interval_ms;   // 0 for raw
+} ts_ring_t;
+
+// Open aggregate interval
+typedef struct {
+    uint32_t start_ms;
+    int32_t min;
+    int32_t max;
+    int32_t sum;
+    uint32_t n;
+} ts_accum_t;
+
+/**
+ * @brief Store state
+ */
+typedef struct {
+    portMUX_TYPE lock;
+    const char *name;
+    float scale;                    ///< Stored value = value * scale
+    ts_ring_t tiers[TS_TIER_COUNT];
+    ts_accum_t accum[TS_TIER_COUNT];
+
+    uint32_t raw_t[TS_STORE_RAW_LEN];
+    int16_t  raw_v[TS_STORE_RAW_LEN];
+    uint32_t sec_t[TS_STORE_SEC_LEN];
+    int16_t  sec_min[TS_STORE_SEC_LEN];
+    int16_t  sec_mean[TS_STORE_SEC_LEN];
+    int16_t  sec_max[TS_STORE_SEC_LEN];
+    uint32_t min_t[TS_STORE_MIN_LEN];
+    int16_t  min_min[TS_STORE_MIN_LEN];
+    int16_t  min_mean[TS_STORE_MIN_LEN];
+    int16_t  min_max[TS_STORE_MIN_LEN];
+} ts_store_t;
+
+/**
+ * @brief Initialize (or clear) a store.
+ *
+ * @param[in] store  Store.
+ * @param[in] name   Name for ts_store_find(), NULL keeps it anonymous.
+ *                   The string must outlive the store.
+ * @param[in] scale  Stored resolution is 1/scale, range +-32767/scale
+ *                   (100 gives 0.01 over +-327).
+ */
+void ts_store_init(ts_store_t *store, const char *name, float scale);
+
+/**
+ * @brief Look a named store up.
+ *
+ * @return The store, NULL if there is none with that name.
+ */
+ts_store_t *ts_store_find(const char *name);
+
+/**
+ * @brief Add a sample. Timestamps must not go backwards, older samples are ignored.
+ *
+ * @param[in] store         Store.
+ * @param[in] timestamp_us  esp_timer time of the sample.
+ * @param[in] value         Value, clamped to the int16 range.
+ */
+void ts_store_insert(ts_store_t *store, int64_t timestamp_us, float value);
+
+/**
+ * @brief Copy the points of one tier within [from_us, to_us], oldest first.
+ *
+ * The copy is done in short locked chunks so the writer is never held up
+ * for long; points overwritten meanwhile are skipped.
+ *
+ * Both ends are truncated to TS_STORE_TICK_US. To page through a range,
+ * continue from the last timestamp returned plus TS_STORE_TICK_US.
+ *
+ * @param[in]  store       Store.
+ * @param[in]  tier        Tier to read.
+ * @param[in]  from_us     Start of the range, inclusive.
+ * @param[in]  to_us       End of the range, inclusive.
+ * @param[out] out         Points.
+ * @param[in]  max_points  Capacity of out.
+ * @return Number of points written.
+ */
+size_t ts_store_query(ts_store_t *store, ts_tier_t tier, int64_t from_us, int64_t to_us,
+                      ts_point_t *out, size_t max_points);
+
+/**
+ * @brief Finest tier that still holds data as old as from_us.
+ *
+ * @return TS_TIER_MIN if none of the tiers goes back that far.
+ */
+ts_tier_t ts_store_best_tier(ts_store_t *store, int64_t from_us);
+
+#endif // TS_STORE_H
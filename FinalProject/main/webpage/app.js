@@ -15,40 +15,126 @@ $(document).ready(function() {
     const pwmPercentageElement = $('#pwm-percentage-value');
     const pwmBarElement = $('#pwm-bar');
 
+    let pollTimer = null;
+    let socket = null;          // Open /ws connection, null when not available
+    let topicNames = {};        // Topic id -> {name, type}, from the TOPICS frame
+    let pwmSeq = 0;
+    let pendingPwm = null;      // Latest slider value not sent yet over /ws
+    let wsShortLived = 0;       // /ws connections in a row that closed soon after opening
+
+    // /ws message types, see request/http_ws.h
+    const WS_MSG_PWM = 0x01;
+    const WS_MSG_TELEMETRY = 0x10;
+    const WS_MSG_TOPICS = 0x11;
+    const WS_MSG_PWM_ACK = 0x81;
+    const WS_RETRY_MS = 2000;
+    const WS_SHORT_LIVED_MS = 5000;
+    const WS_MAX_SHORT_LIVED = 3;
+
+    /**
+     * @brief Shows a telemetry snapshot (see /telemetry.json) in the UI.
+     * @param {object} data - Snapshot with one entry per topic in data.topics.
+     */
+    function showTelemetry(data) {
+        if (!data || !data.topics) {
+            return;
+        }
+        const ambient = data.topics.ambient_c;
+        const wind = data.topics.wind_kmh;
+        if (ambient) {
+            // Formatted to one decimal place.
+            tempValueElement.html(ambient.v.toFixed(1) + ' °C');
+        }
+        if (wind) {
+            airSpeedValueElement.text(wind.v.toFixed(1) + ' km/h');
+        }
+    }
+
     /**
-     * @brief Fetches sensor readings from the server and updates the UI.
+     * @brief Fetches the telemetry snapshot from the server and updates the UI.
      *
-     * This function makes two GET requests to the ESP32:
-     * 1. /lm35Sensor.json for the temperature.
-     * 2. /anemoSensor.json for the wind speed.
+     * One GET to /telemetry.json returns every sensor. With ifModified the
+     * request carries the last ETag and an unchanged snapshot comes back as
+     * an empty 304 ("notmodified"), which leaves the UI as it is.
      */
     function updateSensorReadings() {
-        // Fetch Temperature Data
-        $.getJSON('/lm35Sensor.json', function(data) {
-            if (data && typeof data.temp !== 'undefined') {
-                // Update the temperature value, formatted to one decimal place.
-                tempValueElement.html(data.temp.toFixed(1) + ' °C');
+        $.ajax({
+            url: '/telemetry.json',
+            dataType: 'json',
+            ifModified: true,
+            success: function(data, status) {
+                if (status !== 'notmodified') {
+                    showTelemetry(data);
+                }
+            },
+            error: function() {
+                console.error("Error: Could not retrieve telemetry data.");
             }
-        }).fail(function() {
-            console.error("Error: Could not retrieve temperature data.");
         });
+    }
+
+    /**
+     * @brief Decodes a binary /ws frame: topic list or telemetry snapshot.
+     * @param {ArrayBuffer} buffer - Frame payload.
+     */
+    function handleSocketFrame(buffer) {
+        const view = new DataView(buffer);
+        const type = view.getUint8(0);
 
-        // Fetch Anemometer (Air Speed) Data
-        $.getJSON('/anemoSensor.json', function(data) {
-            if (data && typeof data.wind !== 'undefined') {
-                // Update the air speed value, formatted to one decimal place.
-                airSpeedValueElement.text(data.wind.toFixed(1) + ' km/h');
+        if (type === WS_MSG_TOPICS) {
+            const count = view.getUint8(1);
+            let pos = 2;
+            topicNames = {};
+            for (let i = 0; i < count; i++) {
+                const id = view.getUint8(pos);
+                const valueType = view.getUint8(pos + 1);
+                const len = view.getUint8(pos + 2);
+                const name = String.fromCharCode.apply(null, new Uint8Array(buffer, pos + 3, len));
+                topicNames[id] = { name: name, type: valueType };
+                pos += 3 + len;
             }
-        }).fail(function() {
-            console.error("Error: Could not retrieve air speed data.");
-        });
+        } else if (type === WS_MSG_TELEMETRY) {
+            const count = view.getUint8(1);
+            const topics = {};
+            for (let i = 0, pos = 2; i < count; i++, pos += 14) {
+                const topic = topicNames[view.getUint8(pos)];
+                if (!topic) {
+                    continue;
+                }
+                // Type 0 is float, 1 is int
+                const value = view.getUint8(pos + 1) === 0 ? view.getFloat32(pos + 10, true) : view.getInt32(pos + 10, true);
+                topics[topic.name] = { v: value, seq: view.getUint32(pos + 2, true), t_ms: view.getUint32(pos + 6, true) };
+            }
+            showTelemetry({ topics: topics });
+        } else if (type === WS_MSG_PWM_ACK) {
+            console.log(`PWM ${view.getUint8(3)}% acknowledged (seq ${view.getUint16(1, true)})`);
+        }
+    }
+
+    /**
+     * @brief Sends a PWM setpoint over /ws: type, u16 sequence, u8 duty.
+     * @param {number} pwmValue - The PWM value (0-100) to be sent.
+     */
+    function sendPwmFrame(pwmValue) {
+        const frame = new DataView(new ArrayBuffer(4));
+        pwmSeq = (pwmSeq + 1) & 0xFFFF;
+        frame.setUint8(0, WS_MSG_PWM);
+        frame.setUint16(1, pwmSeq, true);
+        frame.setUint8(3, pwmValue);
+        socket.send(frame.buffer);
     }
 
     /**
-     * @brief Sends the new PWM value to the server via a POST request.
+     * @brief Sends the new PWM value to the server, over /ws when it is open,
+     * otherwise via a POST request.
      * @param {number} pwmValue - The PWM value (0-100) to be sent.
      */
     function sendPwmValue(pwmValue) {
+        if (socket) {
+            sendPwmFrame(pwmValue);
+            return;
+        }
+
         console.log(`Sending PWM value to server: ${pwmValue}`);
 
         $.ajax({
@@ -69,15 +155,28 @@ $(document).ready(function() {
 
     // --- Event Listeners ---
 
-    // Update the UI in real-time as the slider is moved.
+    // Update the UI in real-time as the slider is moved. Over /ws the value
+    // also goes to the thruster while dragging, at most once per animation frame.
     pwmSlider.on('input', function() {
         const value = $(this).val();
         pwmPercentageElement.text(value + '%');
         pwmBarElement.css('width', value + '%');
+
+        if (socket) {
+            if (pendingPwm === null) {
+                window.requestAnimationFrame(function() {
+                    if (socket && pendingPwm !== null) {
+                        sendPwmFrame(pendingPwm);
+                    }
+                    pendingPwm = null;
+                });
+            }
+            pendingPwm = parseInt(value);
+        }
     });
 
-    // Send the final value to the server only when the user releases the slider.
-    // This prevents sending too many requests while dragging.
+    // Send the final value to the server when the user releases the slider.
+    // Without /ws this is the only update, to avoid a POST per slider step.
     pwmSlider.on('change', function() {
         const value = parseInt($(this).val());
         sendPwmValue(value);
@@ -86,10 +185,77 @@ $(document).ready(function() {
 
     // --- Initialization ---
 
-    // Fetch initial sensor data as soon as the page loads.
-    updateSensorReadings();
+    /**
+     * @brief Polls /telemetry.json every 2 seconds, used when the event stream is not available.
+     */
+    function startPolling() {
+        if (pollTimer === null) {
+            updateSensorReadings();
+            pollTimer = setInterval(updateSensorReadings, 2000);
+        }
+    }
+
+    /**
+     * @brief Subscribes to /events. The browser reconnects by itself; a stream
+     * that gets closed for good (e.g. the server refused it with 503 because
+     * it is full) falls back to polling.
+     */
+    function startEventStream() {
+        if (!window.EventSource) {
+            startPolling();
+            return;
+        }
+        const events = new EventSource('/events');
+        events.addEventListener('telemetry', function(e) {
+            showTelemetry(JSON.parse(e.data));
+        });
+        events.onerror = function() {
+            if (events.readyState === EventSource.CLOSED) {
+                console.error("Event stream closed, falling back to polling.");
+                startPolling();
+            }
+        };
+    }
+
+    /**
+     * @brief Opens /ws for telemetry and PWM. A connection that never opens
+     * (no WebSocket support, or the server is full) falls back to /events;
+     * one that drops later is retried after 2 seconds, unless it keeps
+     * closing within seconds of opening, which also falls back to /events.
+     */
+    function startWebSocket() {
+        if (!window.WebSocket) {
+            startEventStream();
+            return;
+        }
+        const ws = new WebSocket('ws://' + window.location.host + '/ws');
+        let openedAt = 0;
+        ws.binaryType = 'arraybuffer';
+        ws.onopen = function() {
+            openedAt = Date.now();
+            socket = ws;
+        };
+        ws.onmessage = function(e) {
+            if (e.data instanceof ArrayBuffer && e.data.byteLength > 0) {
+                handleSocketFrame(e.data);
+            }
+        };
+        ws.onclose = function() {
+            socket = null;
+            if (openedAt !== 0) {
+                wsShortLived = (Date.now() - openedAt < WS_SHORT_LIVED_MS) ? wsShortLived + 1 : 0;
+            }
+            if (openedAt !== 0 && wsShortLived < WS_MAX_SHORT_LIVED) {
+                setTimeout(startWebSocket, WS_RETRY_MS);
+            } else {
+                console.error("WebSocket unavailable, using the event stream.");
+                startEventStream();
+            }
+        };
+    }
 
-    // Set an interval to automatically update sensor data every 2 seconds (2000 ms).
-    setInterval(updateSensorReadings, 2000);
+    // Fetch initial sensor data as soon as the page loads, then keep it live.
+    updateSensorReadings();
+    startWebSocket();
 
 });
\ No newline at end of file